@@ -638,6 +638,8 @@ static ConfigSetting cpuSettings[] = {
 	ConfigSetting("HideSlowWarnings", &g_Config.bHideSlowWarnings, false, true, false),
 	ConfigSetting("HideStateWarnings", &g_Config.bHideStateWarnings, false, true, false),
 	ConfigSetting("PreloadFunctions", &g_Config.bPreloadFunctions, false, true, true),
+	ConfigSetting("IRBlockCache", &g_Config.bIRBlockCache, false, false, false),
+	ConfigSetting("IRBlockCacheMB", &g_Config.iIRBlockCacheMB, 64, false, false),
 	ConfigSetting("JitDisableFlags", &g_Config.uJitDisableFlags, (uint32_t)0, true, true),
 	ReportedConfigSetting("CPUSpeed", &g_Config.iLockedCPUSpeed, 0, true, true),
 
@@ -882,6 +884,10 @@ static ConfigSetting graphicsSettings[] = {
 	ReportedConfigSetting("SkipBufferEffects", &g_Config.bSkipBufferEffects, false, true, true),
 	ConfigSetting("SoftwareRenderer", &g_Config.bSoftwareRendering, false, true, true),
 	ConfigSetting("SoftwareRendererJit", &g_Config.bSoftwareRenderingJit, true, true, true),
+	ConfigSetting("SoftwareRendererJitCache", &g_Config.bSoftwareRenderingJitCache, true, false, false),
+	ConfigSetting("SoftwareRendererTileStealing", &g_Config.bSoftwareRenderingTileStealing, true, false, false),
+	ConfigSetting("SoftwareRendererHiZ", &g_Config.bSoftwareRenderingHiZ, true, false, false),
+	ConfigSetting("SoftwareRendererTexCache", &g_Config.bSoftwareRenderingTexCache, false, false, false),
 	ReportedConfigSetting("HardwareTransform", &g_Config.bHardwareTransform, true, true, true),
 	ReportedConfigSetting("SoftwareSkinning", &g_Config.bSoftwareSkinning, true, true, true),
 	ReportedConfigSetting("TextureFiltering", &g_Config.iTexFiltering, 1, true, true),
@@ -909,6 +915,7 @@ static ConfigSetting graphicsSettings[] = {
 
 	ReportedConfigSetting("VertexDecCache", &g_Config.bVertexCache, false, true, true),
 	ReportedConfigSetting("TextureBackoffCache", &g_Config.bTextureBackoffCache, false, true, true),
+	ConfigSetting("TextureHashPages", &g_Config.bTextureHashPages, false, false, false),
 	ReportedConfigSetting("VertexDecJit", &g_Config.bVertexDecoderJit, &DefaultCodeGen, false),
 
 #ifndef MOBILE_DEVICE
@@ -934,6 +941,9 @@ static ConfigSetting graphicsSettings[] = {
 	ReportedConfigSetting("TexScalingLevel", &g_Config.iTexScalingLevel, 1, true, true),
 	ReportedConfigSetting("TexScalingType", &g_Config.iTexScalingType, 0, true, true),
 	ReportedConfigSetting("TexDeposterize", &g_Config.bTexDeposterize, false, true, true),
+	ConfigSetting("TexScalingAsync", &g_Config.bTexScalingAsync, true, true, true),
+	ConfigSetting("TexScalingDiskCache", &g_Config.bTexScalingDiskCache, false, true, true),
+	ConfigSetting("TexScalingDiskCacheMB", &g_Config.iTexScalingDiskCacheMB, 512, true, true),
 	ReportedConfigSetting("TexHardwareScaling", &g_Config.bTexHardwareScaling, false, true, true),
 	ConfigSetting("VSyncInterval", &g_Config.bVSync, false, true, true),
 	ReportedConfigSetting("BloomHack", &g_Config.iBloomHack, 0, true, true),
@@ -1593,10 +1603,15 @@ bool Config::Save(const char *saveReason) {
 
 void Config::PostLoadCleanup(bool gameSpecific) {
 	// Override ppsspp.ini JIT value to prevent crashing
-	if (DefaultCpuCore() != (int)CPUCore::JIT && g_Config.iCpuCore == (int)CPUCore::JIT) {
+	if (DefaultCpuCore() != (int)CPUCore::JIT && (g_Config.iCpuCore == (int)CPUCore::JIT || g_Config.iCpuCore == (int)CPUCore::JIT_IR)) {
 		jitForcedOff = true;
 		g_Config.iCpuCore = (int)CPUCore::IR_JIT;
 	}
+#if !PPSSPP_ARCH(AMD64)
+	// There's no native IR backend here, so this would just be the IR interpreter.
+	if (g_Config.iCpuCore == (int)CPUCore::JIT_IR)
+		g_Config.iCpuCore = (int)CPUCore::IR_JIT;
+#endif
 
 	// This caps the exponent 4 (so 16x.)
 	if (iAnisotropyLevel > 4) {
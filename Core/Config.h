@@ -119,6 +119,8 @@ struct Config {
 	bool bHideSlowWarnings;
 	bool bHideStateWarnings;
 	bool bPreloadFunctions;
+	bool bIRBlockCache;  // Keeps IR blocks on disk between runs.  Ini-only.
+	int iIRBlockCacheMB;  // Total for all games' block caches.
 	uint32_t uJitDisableFlags;
 
 	bool bSeparateSASThread;
@@ -161,6 +163,10 @@ struct Config {
 
 	bool bSoftwareRendering;
 	bool bSoftwareRenderingJit;
+	bool bSoftwareRenderingJitCache;  // Keeps the list of JIT funcs a game used on disk, to precompile them.  Ini-only.
+	bool bSoftwareRenderingTileStealing;  // Bins into small tiles that idle threads can steal, instead of one range per thread.  Ini-only.
+	bool bSoftwareRenderingHiZ;  // Keeps coarse depth bounds per tile to skip prims that can't pass the depth test.  Ini-only.
+	bool bSoftwareRenderingTexCache;  // Samples frequently used CLUT and DXT textures from decoded copies.  Ini-only.
 	bool bHardwareTransform; // only used in the GLES backend
 	bool bSoftwareSkinning;
 	bool bVendorBugChecksEnabled;
@@ -204,6 +210,7 @@ struct Config {
 
 	bool bVertexCache;
 	bool bTextureBackoffCache;
+	bool bTextureHashPages;  // Rehashes only some 4KB pages of textures per check.  Ini-only.
 	bool bVertexDecoderJit;
 	bool bFullScreen;
 	bool bFullScreenMulti;
@@ -219,6 +226,9 @@ struct Config {
 	int iTexScalingLevel; // 0 = auto, 1 = off, 2 = 2x, ..., 5 = 5x
 	int iTexScalingType; // 0 = xBRZ, 1 = Hybrid
 	bool bTexDeposterize;
+	bool bTexScalingAsync;  // Shows a bilinear placeholder while scaling on a worker thread.  Ini-only.
+	bool bTexScalingDiskCache;  // Keeps scaled textures in the app cache between sessions.  Ini-only.
+	int iTexScalingDiskCacheMB;
 	bool bTexHardwareScaling;
 	int iFpsLimit1;
 	int iFpsLimit2;
@@ -96,6 +96,14 @@ static std::atomic<uint32_t> pendingNotifyMaxAddr2;
 static std::mutex pendingMutex;
 static int detailedOverride;
 
+static constexpr uint32_t WRITE_PAGE_SHIFT = 12;
+// User and kernel RAM (up to 64MB), followed by VRAM.
+static constexpr uint32_t RAM_WRITE_PAGES = 0x04000000 >> WRITE_PAGE_SHIFT;
+static constexpr uint32_t VRAM_WRITE_PAGES = 0x00200000 >> WRITE_PAGE_SHIFT;
+static std::atomic<uint32_t> writePageStamps[RAM_WRITE_PAGES + VRAM_WRITE_PAGES];
+// Bumped when a stamp is taken, rather than per write, so it doesn't wrap quickly.
+static std::atomic<uint32_t> writeStamp;
+
 MemSlabMap::MemSlabMap() {
 	Reset();
 }
@@ -428,6 +436,50 @@ static inline bool MergeRecentMemInfo(const PendingNotifyMem &info, size_t copyL
 	return false;
 }
 
+static inline std::atomic<uint32_t> *WritePageStamp(uint32_t page) {
+	const uint32_t addr = page << WRITE_PAGE_SHIFT;
+	if (addr >= 0x08000000 && addr < 0x0C000000)
+		return &writePageStamps[(addr - 0x08000000) >> WRITE_PAGE_SHIFT];
+	if (addr >= 0x04000000 && addr < 0x04200000)
+		return &writePageStamps[RAM_WRITE_PAGES + ((addr - 0x04000000) >> WRITE_PAGE_SHIFT)];
+	return nullptr;
+}
+
+static void MarkWrittenPages(uint32_t start, uint32_t size) {
+	const uint32_t stamp = writeStamp.load(std::memory_order_relaxed);
+	const uint32_t lastPage = (start + size - 1) >> WRITE_PAGE_SHIFT;
+	for (uint32_t page = start >> WRITE_PAGE_SHIFT; page <= lastPage; ++page) {
+		std::atomic<uint32_t> *pageStamp = WritePageStamp(page);
+		if (pageStamp)
+			pageStamp->store(stamp, std::memory_order_relaxed);
+	}
+}
+
+static void MarkAllPagesWritten() {
+	const uint32_t stamp = writeStamp.load(std::memory_order_relaxed);
+	for (auto &pageStamp : writePageStamps)
+		pageStamp.store(stamp, std::memory_order_relaxed);
+}
+
+uint32_t MemBlockWriteStamp() {
+	return ++writeStamp;
+}
+
+bool MemBlockWrittenSince(uint32_t start, uint32_t size, uint32_t stamp) {
+	if (size == 0)
+		return false;
+
+	start = NormalizeAddress(start);
+	const uint32_t lastPage = (start + size - 1) >> WRITE_PAGE_SHIFT;
+	for (uint32_t page = start >> WRITE_PAGE_SHIFT; page <= lastPage; ++page) {
+		const std::atomic<uint32_t> *pageStamp = WritePageStamp(page);
+		// Written with this stamp or later, allowing for wrap.
+		if (!pageStamp || (int32_t)(pageStamp->load(std::memory_order_relaxed) - stamp) >= 0)
+			return true;
+	}
+	return false;
+}
+
 void NotifyMemInfoPC(MemBlockFlags flags, uint32_t start, uint32_t size, uint32_t pc, const char *tagStr, size_t strLength) {
 	if (size == 0) {
 		return;
@@ -435,6 +487,10 @@ void NotifyMemInfoPC(MemBlockFlags flags, uint32_t start, uint32_t size, uint32_
 	// Clear the uncached and kernel bits.
 	start = NormalizeAddress(start);
 
+	if (flags & MemBlockFlags::WRITE) {
+		MarkWrittenPages(start, size);
+	}
+
 	bool needFlush = false;
 	// When the setting is off, we skip smaller info to keep things fast.
 	if (MemBlockInfoDetailed(size)) {
@@ -588,9 +644,14 @@ void MemBlockInfoShutdown() {
 	writeMap.Reset();
 	textureMap.Reset();
 	pendingNotifies.clear();
+	MarkAllPagesWritten();
 }
 
 void MemBlockInfoDoState(PointerWrap &p) {
+	// All of memory is replaced on load.
+	if (p.mode == PointerWrap::MODE_READ)
+		MarkAllPagesWritten();
+
 	auto s = p.Section("MemBlockInfo", 0, 1);
 	if (!s)
 		return;
@@ -72,6 +72,13 @@ std::string GetMemWriteTagAt(const char *prefix, uint32_t start, uint32_t size);
 // Same as above but allocation-free.
 size_t FormatMemWriteTagAt(char *buf, size_t sz, const char *prefix, uint32_t start, uint32_t size);
 
+// Notified writes per 4KB page of RAM and VRAM, for caches that want to skip rechecking unchanged memory.
+// CPU stores aren't notified, so this can only say memory might have changed, not that it hasn't.
+// Returns a stamp for MemBlockWrittenSince(), taken before reading the memory.
+uint32_t MemBlockWriteStamp();
+// True if anything in the range was notified as written after the stamp was taken, or it's not tracked.
+bool MemBlockWrittenSince(uint32_t start, uint32_t size, uint32_t stamp);
+
 void MemBlockInfoInit();
 void MemBlockInfoShutdown();
 void MemBlockInfoDoState(PointerWrap &p);
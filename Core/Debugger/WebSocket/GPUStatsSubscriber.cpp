@@ -20,6 +20,7 @@
 #include "Core/Debugger/WebSocket/GPUStatsSubscriber.h"
 #include "Core/HW/Display.h"
 #include "Core/System.h"
+#include "GPU/GPUInterface.h"
 
 struct CollectedStats {
 	float vps;
@@ -66,11 +67,49 @@ struct DebuggerGPUStatsEvent {
 	}
 };
 
+struct DebuggerGPUCountersEvent {
+	const GPUFrameCounters &c;
+	const std::string &ticket;
+
+	operator std::string() {
+		JsonWriter j;
+		j.begin();
+		j.writeString("event", "gpu.stats.counters");
+		if (!ticket.empty())
+			j.writeRaw("ticket", ticket);
+		j.pushDict("counters");
+		for (const auto &counter : c.counters)
+			j.writeFloat(counter.first.c_str(), (double)counter.second);
+		j.pop();
+		j.pushArray("flushes");
+		for (const auto &flush : c.flushes) {
+			j.pushDict();
+			j.writeString("reason", flush.reason);
+			j.writeInt("count", flush.count);
+			j.writeFloat("seconds", flush.seconds);
+			j.pop();
+		}
+		j.pop();
+		j.pushArray("threads");
+		for (const auto &thread : c.threads) {
+			j.pushDict();
+			j.writeFloat("busySeconds", thread.busySeconds);
+			j.writeInt("tiles", thread.tiles);
+			j.writeInt("steals", thread.steals);
+			j.pop();
+		}
+		j.pop();
+		j.end();
+		return j.str();
+	}
+};
+
 struct WebSocketGPUStatsState : public DebuggerSubscriber {
 	WebSocketGPUStatsState();
 	~WebSocketGPUStatsState();
 	void Get(DebuggerRequest &req);
 	void Feed(DebuggerRequest &req);
+	void Counters(DebuggerRequest &req);
 
 	void Broadcast(net::WebSocketServer *ws) override;
 
@@ -83,14 +122,22 @@ struct WebSocketGPUStatsState : public DebuggerSubscriber {
 	bool sendFeed_ = false;
 
 	std::string lastTicket_;
+	// Requests come from the websocket thread, flips from the emu thread.  Protects all the below.
 	std::mutex pendingLock_;
 	std::vector<CollectedStats> pendingStats_;
+
+	// Flips until we collect counters, since the first frame may have started without stats on.
+	int countersFlips_ = 0;
+	bool countersForced_ = false;
+	std::string countersTicket_;
+	std::vector<GPUFrameCounters> pendingCounters_;
 };
 
 DebuggerSubscriber *WebSocketGPUStatsInit(DebuggerEventHandlerMap &map) {
 	auto p = new WebSocketGPUStatsState();
 	map["gpu.stats.get"] = std::bind(&WebSocketGPUStatsState::Get, p, std::placeholders::_1);
 	map["gpu.stats.feed"] = std::bind(&WebSocketGPUStatsState::Feed, p, std::placeholders::_1);
+	map["gpu.stats.counters"] = std::bind(&WebSocketGPUStatsState::Counters, p, std::placeholders::_1);
 
 	return p;
 }
@@ -102,6 +149,8 @@ WebSocketGPUStatsState::WebSocketGPUStatsState() {
 WebSocketGPUStatsState::~WebSocketGPUStatsState() {
 	if (forced_)
 		Core_ForceDebugStats(false);
+	if (countersForced_)
+		Core_ForceDebugStats(false);
 	__DisplayForgetFlip(&WebSocketGPUStatsState::FlipForwarder, this);
 }
 
@@ -111,11 +160,22 @@ void WebSocketGPUStatsState::FlipForwarder(void *thiz) {
 }
 
 void WebSocketGPUStatsState::FlipListener() {
+	std::lock_guard<std::mutex> guard(pendingLock_);
+	if (countersFlips_ > 0 && --countersFlips_ == 0) {
+		GPUFrameCounters counters;
+		// Counters() already checked the backend supports these.
+		if (gpu && gpu->GetFrameCounters(counters))
+			pendingCounters_.push_back(std::move(counters));
+		if (countersForced_) {
+			Core_ForceDebugStats(false);
+			countersForced_ = false;
+		}
+	}
+
 	if (!sendNext_ && !sendFeed_)
 		return;
 
 	// Okay, collect the data (we'll actually send at next Broadcast.)
-	std::lock_guard<std::mutex> guard(pendingLock_);
 	pendingStats_.resize(pendingStats_.size() + 1);
 	CollectedStats &stats = pendingStats_[pendingStats_.size() - 1];
 
@@ -183,8 +243,42 @@ void WebSocketGPUStatsState::Feed(DebuggerRequest &req) {
 	}
 }
 
+// Get detailed counters for the next full frame (gpu.stats.counters)
+//
+// No parameters.
+//
+// Response (same event name):
+//  - counters: object with number properties, such as trianglesBinned, pixelsCovered, or pixelJitMisses.
+//  - flushes: array of objects with "reason", "count", and "seconds" properties.
+//  - threads: array of objects with "busySeconds", "tiles", and "steals" properties.
+//
+// Note: only some backends (currently software rendering) have counters, others respond with an error.
+// Note: stats are enabled until the response, which covers the first full frame after the request.
+void WebSocketGPUStatsState::Counters(DebuggerRequest &req) {
+	if (!PSP_IsInited())
+		return req.Fail("CPU not started");
+	if (PSP_CoreParameter().gpuCore != GPUCORE_SOFTWARE)
+		return req.Fail("Counters not supported by this GPU backend");
+
+	std::lock_guard<std::mutex> guard(pendingLock_);
+	if (!countersForced_) {
+		Core_ForceDebugStats(true);
+		countersForced_ = true;
+	}
+	countersFlips_ = 2;
+
+	const JsonNode *value = req.data.get("ticket");
+	countersTicket_ = value ? json_stringify(value) : "";
+}
+
 void WebSocketGPUStatsState::Broadcast(net::WebSocketServer *ws) {
 	std::lock_guard<std::mutex> guard(pendingLock_);
+	for (const GPUFrameCounters &counters : pendingCounters_) {
+		ws->Send(DebuggerGPUCountersEvent{ counters, countersTicket_ });
+		countersTicket_.clear();
+	}
+	pendingCounters_.clear();
+
 	if (lastTicket_.empty() && !sendFeed_) {
 		pendingStats_.clear();
 		return;
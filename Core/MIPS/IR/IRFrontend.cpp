@@ -221,7 +221,7 @@ MIPSOpcode IRFrontend::GetOffsetInstruction(int offset) {
 	return Memory::Read_Instruction(GetCompilerPC() + 4 * offset);
 }
 
-void IRFrontend::DoJit(u32 em_address, std::vector<IRInst> &instructions, u32 &mipsBytes, bool preload) {
+void IRFrontend::TranslateBlock(u32 em_address, bool preload) {
 	js.cancel = false;
 	js.preloading = preload;
 	js.blockStart = em_address;
@@ -253,23 +253,44 @@ void IRFrontend::DoJit(u32 em_address, std::vector<IRInst> &instructions, u32 &m
 		// Clear the instructions to signal this was not compiled.
 		ir.Clear();
 	}
+}
+
+bool IRFrontend::OptimizeIR(const IRWriter &in, IRWriter &out) {
+	static const IRPassFunc passes[] = {
+		&ApplyMemoryValidation,
+		&RemoveLoadStoreLeftRight,
+		&OptimizeFPMoves,
+		&PropagateConstants,
+		&PurgeTemps,
+		&VectorizeVFPU,
+		// &ReorderLoadStore,
+		// &MergeLoadStore,
+		// &ThreeOpToTwoOp,
+	};
+	static const IRPassFunc nativePasses[] = {
+		&ApplyMemoryValidation,
+		&RemoveLoadStoreLeftRight,
+		&OptimizeFPMoves,
+		&PropagateConstants,
+		&PurgeTemps,
+		&VectorizeVFPU,
+		&ThreeOpToTwoOp,
+	};
+
+	// Native backends work in two-operand form, like x86.
+	if (opts.optimizeForInterpreter)
+		return IRApplyPasses(passes, ARRAY_SIZE(passes), in, out, opts);
+	return IRApplyPasses(nativePasses, ARRAY_SIZE(nativePasses), in, out, opts);
+}
 
+void IRFrontend::DoJit(u32 em_address, std::vector<IRInst> &instructions, u32 &mipsBytes, bool preload) {
+	TranslateBlock(em_address, preload);
 	mipsBytes = js.compilerPC - em_address;
 
 	IRWriter simplified;
 	IRWriter *code = &ir;
 	if (!js.hadBreakpoints) {
-		static const IRPassFunc passes[] = {
-			&ApplyMemoryValidation,
-			&RemoveLoadStoreLeftRight,
-			&OptimizeFPMoves,
-			&PropagateConstants,
-			&PurgeTemps,
-			// &ReorderLoadStore,
-			// &MergeLoadStore,
-			// &ThreeOpToTwoOp,
-		};
-		if (IRApplyPasses(passes, ARRAY_SIZE(passes), ir, simplified, opts))
+		if (OptimizeIR(ir, simplified))
 			logBlocks = 1;
 		code = &simplified;
 		//if (ir.GetInstructions().size() >= 24)
@@ -362,4 +383,34 @@ void IRFrontend::CheckMemoryBreakpoint(int rs, int offset) {
 	}
 }
 
+bool IRFrontend::DoJitTrace(const std::vector<u32> &blockAddresses, std::vector<IRInst> &instructions) {
+	IRWriter trace;
+	for (size_t i = 0; i < blockAddresses.size(); ++i) {
+		TranslateBlock(blockAddresses[i], false);
+		if (js.cancel || js.hadBreakpoints)
+			return false;
+
+		const std::vector<IRInst> &insts = ir.GetInstructions();
+		size_t count = insts.size();
+		bool continues = i + 1 < blockAddresses.size();
+		if (continues) {
+			// Instead of exiting to the next block, just keep going into it.
+			if (count == 0 || insts[count - 1].op != IROp::ExitToConst || insts[count - 1].constant != blockAddresses[i + 1])
+				return false;
+			count--;
+		}
+		for (size_t j = 0; j < count; ++j)
+			trace.Write(insts[j]);
+		if (continues) {
+			// The block already paid its Downcount before its exits.  Leave when it runs out, like separate blocks would.
+			trace.Write(IROp::ExitToConstIfDowncountLtZ, trace.AddConstant(blockAddresses[i + 1]));
+		}
+	}
+
+	IRWriter simplified;
+	OptimizeIR(trace, simplified);
+	instructions = simplified.GetInstructions();
+	return true;
+}
+
 }  // namespace
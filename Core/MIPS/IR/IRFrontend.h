@@ -89,6 +89,9 @@ class IRFrontend : public MIPSFrontendInterface {
 	bool CheckRounding(u32 blockAddress);  // returns true if we need a do-over
 
 	void DoJit(u32 em_address, std::vector<IRInst> &instructions, u32 &mipsBytes, bool preload);
+	// Compiles blocks that exit into each other as one, keeping only their conditional exits.
+	// Returns false if the blocks don't chain together that way.
+	bool DoJitTrace(const std::vector<u32> &blockAddresses, std::vector<IRInst> &instructions);
 
 	void EatPrefix() override {
 		js.EatPrefix();
@@ -99,6 +102,9 @@ class IRFrontend : public MIPSFrontendInterface {
 	}
 
 private:
+	void TranslateBlock(u32 em_address, bool preload);
+	bool OptimizeIR(const IRWriter &in, IRWriter &out);
+
 	void RestoreRoundingMode(bool force = false);
 	void ApplyRoundingMode(bool force = false);
 	void UpdateRoundingMode();
@@ -206,6 +206,7 @@ enum class IROp : u8 {
 
 	ExitToConstIfFpTrue,
 	ExitToConstIfFpFalse,
+	ExitToConstIfDowncountLtZ,  // const, used between the blocks of a trace
 	ExitToPC,  // Used after a syscall to give us a way to do things before returning.
 
 	Syscall,
@@ -378,6 +379,8 @@ class IRWriter {
 struct IROptions {
 	uint32_t disableFlags;
 	bool unalignedLoadStore;
+	// When false, the IR is translated by a native backend and is shaped for that instead.
+	bool optimizeForInterpreter;
 };
 
 const IRMeta *GetIRMeta(IROp op);
@@ -61,6 +61,142 @@ alignas(16) static const uint32_t lowBytesMask[4] = {
 	0x000000FF, 0x000000FF, 0x000000FF, 0x000000FF,
 };
 
+alignas(16) static const uint32_t positiveNAN[4] = {
+	0x7FC00000, 0x7FC00000, 0x7FC00000, 0x7FC00000,
+};
+
+// The Vec4 ops are shared between the switch and the threaded handlers.
+// They're what the vectorizer pass produces from runs of scalar VFPU ops, so they need to give the same results.
+
+#if defined(_M_SSE)
+// inf * 0 is a positive NAN on the PSP (see FMul), but x86 gives a negative one.  NAN inputs pass through.
+static inline __m128 FixupMulNAN(__m128 result, __m128 a, __m128 b) {
+	__m128 fixup = _mm_andnot_ps(_mm_cmpunord_ps(a, b), _mm_cmpunord_ps(result, result));
+	return _mm_or_ps(_mm_andnot_ps(fixup, result), _mm_and_ps(fixup, _mm_load_ps((const float *)positiveNAN)));
+}
+#endif
+
+static inline float MulWithPSPNAN(float a, float b) {
+	if ((my_isinf(a) && b == 0.0f) || (my_isinf(b) && a == 0.0f)) {
+		float nan;
+		memcpy(&nan, &positiveNAN[0], sizeof(nan));
+		return nan;
+	}
+	return a * b;
+}
+
+static inline void IRVec4Mov(MIPSState *mips, const IRInst *inst) {
+#if defined(_M_SSE)
+	_mm_store_ps(&mips->f[inst->dest], _mm_load_ps(&mips->f[inst->src1]));
+#elif PPSSPP_ARCH(ARM64_NEON)
+	vst1q_f32(&mips->f[inst->dest], vld1q_f32(&mips->f[inst->src1]));
+#else
+	memcpy(&mips->f[inst->dest], &mips->f[inst->src1], 4 * sizeof(float));
+#endif
+}
+
+static inline void IRVec4Add(MIPSState *mips, const IRInst *inst) {
+#if defined(_M_SSE)
+	_mm_store_ps(&mips->f[inst->dest], _mm_add_ps(_mm_load_ps(&mips->f[inst->src1]), _mm_load_ps(&mips->f[inst->src2])));
+#elif PPSSPP_ARCH(ARM64_NEON)
+	vst1q_f32(&mips->f[inst->dest], vaddq_f32(vld1q_f32(&mips->f[inst->src1]), vld1q_f32(&mips->f[inst->src2])));
+#else
+	for (int i = 0; i < 4; i++)
+		mips->f[inst->dest + i] = mips->f[inst->src1 + i] + mips->f[inst->src2 + i];
+#endif
+}
+
+static inline void IRVec4Sub(MIPSState *mips, const IRInst *inst) {
+#if defined(_M_SSE)
+	_mm_store_ps(&mips->f[inst->dest], _mm_sub_ps(_mm_load_ps(&mips->f[inst->src1]), _mm_load_ps(&mips->f[inst->src2])));
+#elif PPSSPP_ARCH(ARM64_NEON)
+	vst1q_f32(&mips->f[inst->dest], vsubq_f32(vld1q_f32(&mips->f[inst->src1]), vld1q_f32(&mips->f[inst->src2])));
+#else
+	for (int i = 0; i < 4; i++)
+		mips->f[inst->dest + i] = mips->f[inst->src1 + i] - mips->f[inst->src2 + i];
+#endif
+}
+
+static inline void IRVec4Mul(MIPSState *mips, const IRInst *inst) {
+#if defined(_M_SSE)
+	__m128 a = _mm_load_ps(&mips->f[inst->src1]);
+	__m128 b = _mm_load_ps(&mips->f[inst->src2]);
+	_mm_store_ps(&mips->f[inst->dest], FixupMulNAN(_mm_mul_ps(a, b), a, b));
+#elif PPSSPP_ARCH(ARM64_NEON)
+	// ARM's default NAN is already the positive one.
+	vst1q_f32(&mips->f[inst->dest], vmulq_f32(vld1q_f32(&mips->f[inst->src1]), vld1q_f32(&mips->f[inst->src2])));
+#else
+	for (int i = 0; i < 4; i++)
+		mips->f[inst->dest + i] = MulWithPSPNAN(mips->f[inst->src1 + i], mips->f[inst->src2 + i]);
+#endif
+}
+
+static inline void IRVec4Div(MIPSState *mips, const IRInst *inst) {
+#if defined(_M_SSE)
+	_mm_store_ps(&mips->f[inst->dest], _mm_div_ps(_mm_load_ps(&mips->f[inst->src1]), _mm_load_ps(&mips->f[inst->src2])));
+#elif PPSSPP_ARCH(ARM64_NEON)
+	vst1q_f32(&mips->f[inst->dest], vdivq_f32(vld1q_f32(&mips->f[inst->src1]), vld1q_f32(&mips->f[inst->src2])));
+#else
+	for (int i = 0; i < 4; i++)
+		mips->f[inst->dest + i] = mips->f[inst->src1 + i] / mips->f[inst->src2 + i];
+#endif
+}
+
+static inline void IRVec4Scale(MIPSState *mips, const IRInst *inst) {
+#if defined(_M_SSE)
+	__m128 a = _mm_load_ps(&mips->f[inst->src1]);
+	__m128 b = _mm_set1_ps(mips->f[inst->src2]);
+	_mm_store_ps(&mips->f[inst->dest], FixupMulNAN(_mm_mul_ps(a, b), a, b));
+#elif PPSSPP_ARCH(ARM64_NEON)
+	vst1q_f32(&mips->f[inst->dest], vmulq_n_f32(vld1q_f32(&mips->f[inst->src1]), mips->f[inst->src2]));
+#else
+	// Read first, in case dest overlaps the scale.
+	float scale = mips->f[inst->src2];
+	for (int i = 0; i < 4; i++)
+		mips->f[inst->dest + i] = MulWithPSPNAN(mips->f[inst->src1 + i], scale);
+#endif
+}
+
+static inline void IRVec4Neg(MIPSState *mips, const IRInst *inst) {
+#if defined(_M_SSE)
+	_mm_store_ps(&mips->f[inst->dest], _mm_xor_ps(_mm_load_ps(&mips->f[inst->src1]), _mm_load_ps((const float *)signBits)));
+#elif PPSSPP_ARCH(ARM64_NEON)
+	vst1q_f32(&mips->f[inst->dest], vnegq_f32(vld1q_f32(&mips->f[inst->src1])));
+#else
+	for (int i = 0; i < 4; i++)
+		mips->f[inst->dest + i] = -mips->f[inst->src1 + i];
+#endif
+}
+
+static inline void IRVec4Abs(MIPSState *mips, const IRInst *inst) {
+#if defined(_M_SSE)
+	_mm_store_ps(&mips->f[inst->dest], _mm_and_ps(_mm_load_ps(&mips->f[inst->src1]), _mm_load_ps((const float *)noSignMask)));
+#elif PPSSPP_ARCH(ARM64_NEON)
+	vst1q_f32(&mips->f[inst->dest], vabsq_f32(vld1q_f32(&mips->f[inst->src1])));
+#else
+	for (int i = 0; i < 4; i++)
+		mips->f[inst->dest + i] = fabsf(mips->f[inst->src1 + i]);
+#endif
+}
+
+static inline void IRVec4ClampToZero(MIPSState *mips, const IRInst *inst) {
+#if defined(_M_SSE)
+	// Trickery: Expand the sign bit, and use andnot to zero negative values.
+	__m128i val = _mm_load_si128((const __m128i *)&mips->fi[inst->src1]);
+	__m128i mask = _mm_srai_epi32(val, 31);
+	val = _mm_andnot_si128(mask, val);
+	_mm_store_si128((__m128i *)&mips->fi[inst->dest], val);
+#elif PPSSPP_ARCH(ARM64_NEON)
+	int32x4_t val = vld1q_s32((const int32_t *)&mips->fi[inst->src1]);
+	vst1q_s32((int32_t *)&mips->fi[inst->dest], vmaxq_s32(val, vdupq_n_s32(0)));
+#else
+	for (int i = 0; i < 4; i++) {
+		u32 val = mips->fi[inst->src1 + i];
+		mips->fi[inst->dest + i] = (int)val >= 0 ? val : 0;
+	}
+#endif
+}
+
 u32 RunBreakpoint(u32 pc) {
 	// Should we skip this breakpoint?
 	if (CBreakPoints::CheckSkipFirst() == pc)
@@ -99,7 +235,7 @@ u32 RunValidateAddress(u32 pc, u32 addr, u32 isWrite) {
 }
 
 // We cannot use NEON on ARM32 here until we make it a hard dependency. We can, however, on ARM64.
-u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
+static u64 IRInterpretInstructions(MIPSState *mips, const IRInst *inst, int count, bool wholeBlock) {
 	const IRInst *end = inst + count;
 	while (inst != end) {
 		switch (inst->op) {
@@ -164,25 +300,25 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 		case IROp::ValidateAddress8:
 			if (RunValidateAddress<1>(mips->pc, mips->r[inst->src1] + inst->constant, inst->src2)) {
 				CoreTiming::ForceCheck();
-				return mips->pc;
+				return IRExitTo(mips->pc);
 			}
 		break;
 		case IROp::ValidateAddress16:
 			if (RunValidateAddress<2>(mips->pc, mips->r[inst->src1] + inst->constant, inst->src2)) {
 				CoreTiming::ForceCheck();
-				return mips->pc;
+				return IRExitTo(mips->pc);
 			}
 			break;
 		case IROp::ValidateAddress32:
 			if (RunValidateAddress<4>(mips->pc, mips->r[inst->src1] + inst->constant, inst->src2)) {
 				CoreTiming::ForceCheck();
-				return mips->pc;
+				return IRExitTo(mips->pc);
 			}
 			break;
 		case IROp::ValidateAddress128:
 			if (RunValidateAddress<16>(mips->pc, mips->r[inst->src1] + inst->constant, inst->src2)) {
 				CoreTiming::ForceCheck();
-				return mips->pc;
+				return IRExitTo(mips->pc);
 			}
 			break;
 
@@ -299,103 +435,36 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 		}
 
 		case IROp::Vec4Mov:
-		{
-#if defined(_M_SSE)
-			_mm_store_ps(&mips->f[inst->dest], _mm_load_ps(&mips->f[inst->src1]));
-#elif PPSSPP_ARCH(ARM64_NEON)
-			vst1q_f32(&mips->f[inst->dest], vld1q_f32(&mips->f[inst->src1]));
-#else
-			memcpy(&mips->f[inst->dest], &mips->f[inst->src1], 4 * sizeof(float));
-#endif
+			IRVec4Mov(mips, inst);
 			break;
-		}
 
 		case IROp::Vec4Add:
-		{
-#if defined(_M_SSE)
-			_mm_store_ps(&mips->f[inst->dest], _mm_add_ps(_mm_load_ps(&mips->f[inst->src1]), _mm_load_ps(&mips->f[inst->src2])));
-#elif PPSSPP_ARCH(ARM64_NEON)
-			vst1q_f32(&mips->f[inst->dest], vaddq_f32(vld1q_f32(&mips->f[inst->src1]), vld1q_f32(&mips->f[inst->src2])));
-#else
-			for (int i = 0; i < 4; i++)
-				mips->f[inst->dest + i] = mips->f[inst->src1 + i] + mips->f[inst->src2 + i];
-#endif
+			IRVec4Add(mips, inst);
 			break;
-		}
 
 		case IROp::Vec4Sub:
-		{
-#if defined(_M_SSE)
-			_mm_store_ps(&mips->f[inst->dest], _mm_sub_ps(_mm_load_ps(&mips->f[inst->src1]), _mm_load_ps(&mips->f[inst->src2])));
-#elif PPSSPP_ARCH(ARM64_NEON)
-			vst1q_f32(&mips->f[inst->dest], vsubq_f32(vld1q_f32(&mips->f[inst->src1]), vld1q_f32(&mips->f[inst->src2])));
-#else
-			for (int i = 0; i < 4; i++)
-				mips->f[inst->dest + i] = mips->f[inst->src1 + i] - mips->f[inst->src2 + i];
-#endif
+			IRVec4Sub(mips, inst);
 			break;
-		}
 
 		case IROp::Vec4Mul:
-		{
-#if defined(_M_SSE)
-			_mm_store_ps(&mips->f[inst->dest], _mm_mul_ps(_mm_load_ps(&mips->f[inst->src1]), _mm_load_ps(&mips->f[inst->src2])));
-#elif PPSSPP_ARCH(ARM64_NEON)
-			vst1q_f32(&mips->f[inst->dest], vmulq_f32(vld1q_f32(&mips->f[inst->src1]), vld1q_f32(&mips->f[inst->src2])));
-#else
-			for (int i = 0; i < 4; i++)
-				mips->f[inst->dest + i] = mips->f[inst->src1 + i] * mips->f[inst->src2 + i];
-#endif
+			IRVec4Mul(mips, inst);
 			break;
-		}
 
 		case IROp::Vec4Div:
-		{
-#if defined(_M_SSE)
-			_mm_store_ps(&mips->f[inst->dest], _mm_div_ps(_mm_load_ps(&mips->f[inst->src1]), _mm_load_ps(&mips->f[inst->src2])));
-#else
-			for (int i = 0; i < 4; i++)
-				mips->f[inst->dest + i] = mips->f[inst->src1 + i] / mips->f[inst->src2 + i];
-#endif
+			IRVec4Div(mips, inst);
 			break;
-		}
 
 		case IROp::Vec4Scale:
-		{
-#if defined(_M_SSE)
-			_mm_store_ps(&mips->f[inst->dest], _mm_mul_ps(_mm_load_ps(&mips->f[inst->src1]), _mm_set1_ps(mips->f[inst->src2])));
-#else
-			for (int i = 0; i < 4; i++)
-				mips->f[inst->dest + i] = mips->f[inst->src1 + i] * mips->f[inst->src2];
-#endif
+			IRVec4Scale(mips, inst);
 			break;
-		}
 
 		case IROp::Vec4Neg:
-		{
-#if defined(_M_SSE)
-			_mm_store_ps(&mips->f[inst->dest], _mm_xor_ps(_mm_load_ps(&mips->f[inst->src1]), _mm_load_ps((const float *)signBits)));
-#elif PPSSPP_ARCH(ARM64_NEON)
-			vst1q_f32(&mips->f[inst->dest], vnegq_f32(vld1q_f32(&mips->f[inst->src1])));
-#else
-			for (int i = 0; i < 4; i++)
-				mips->f[inst->dest + i] = -mips->f[inst->src1 + i];
-#endif
+			IRVec4Neg(mips, inst);
 			break;
-		}
 
 		case IROp::Vec4Abs:
-		{
-#if defined(_M_SSE)
-			_mm_store_ps(&mips->f[inst->dest], _mm_and_ps(_mm_load_ps(&mips->f[inst->src1]), _mm_load_ps((const float *)noSignMask)));
-#elif PPSSPP_ARCH(ARM64_NEON)
-			vst1q_f32(&mips->f[inst->dest], vabsq_f32(vld1q_f32(&mips->f[inst->src1])));
-#else
-			for (int i = 0; i < 4; i++)
-				mips->f[inst->dest + i] = fabsf(mips->f[inst->src1 + i]);
-#endif
+			IRVec4Abs(mips, inst);
 			break;
-		}
 
 		case IROp::Vec2Unpack16To31:
 		{
@@ -476,21 +545,8 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 		}
 
 		case IROp::Vec4ClampToZero:
-		{
-#if defined(_M_SSE)
-			// Trickery: Expand the sign bit, and use andnot to zero negative values.
-			__m128i val = _mm_load_si128((const __m128i *)&mips->fi[inst->src1]);
-			__m128i mask = _mm_srai_epi32(val, 31);
-			val = _mm_andnot_si128(mask, val);
-			_mm_store_si128((__m128i *)&mips->fi[inst->dest], val);
-#else
-			for (int i = 0; i < 4; i++) {
-				u32 val = mips->fi[inst->src1 + i];
-				mips->fi[inst->dest + i] = (int)val >= 0 ? val : 0;
-			}
-#endif
+			IRVec4ClampToZero(mips, inst);
 			break;
-		}
 
 		case IROp::Vec4DuplicateUpperBitsAndShift1:  // For vuc2i, the weird one.
 		{
@@ -932,34 +988,38 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 			break;
 
 		case IROp::ExitToConst:
-			return inst->constant;
+			return IRExitTo(inst->constant);
 
 		case IROp::ExitToReg:
-			return mips->r[inst->src1];
+			return IRExitTo(mips->r[inst->src1]);
 
 		case IROp::ExitToConstIfEq:
 			if (mips->r[inst->src1] == mips->r[inst->src2])
-				return inst->constant;
+				return IRExitTo(inst->constant);
 			break;
 		case IROp::ExitToConstIfNeq:
 			if (mips->r[inst->src1] != mips->r[inst->src2])
-				return inst->constant;
+				return IRExitTo(inst->constant);
 			break;
 		case IROp::ExitToConstIfGtZ:
 			if ((s32)mips->r[inst->src1] > 0)
-				return inst->constant;
+				return IRExitTo(inst->constant);
 			break;
 		case IROp::ExitToConstIfGeZ:
 			if ((s32)mips->r[inst->src1] >= 0)
-				return inst->constant;
+				return IRExitTo(inst->constant);
 			break;
 		case IROp::ExitToConstIfLtZ:
 			if ((s32)mips->r[inst->src1] < 0)
-				return inst->constant;
+				return IRExitTo(inst->constant);
 			break;
 		case IROp::ExitToConstIfLeZ:
 			if ((s32)mips->r[inst->src1] <= 0)
-				return inst->constant;
+				return IRExitTo(inst->constant);
+			break;
+		case IROp::ExitToConstIfDowncountLtZ:
+			if (mips->downcount < 0)
+				return IRExitTo(inst->constant);
 			break;
 
 		case IROp::Downcount:
@@ -985,7 +1045,7 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 		}
 
 		case IROp::ExitToPC:
-			return mips->pc;
+			return IRExitTo(mips->pc);
 
 		case IROp::Interpret:  // SLOW fallback. Can be made faster. Ideally should be removed but may be useful for debugging.
 		{
@@ -1005,7 +1065,7 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 
 		case IROp::Break:
 			Core_Break(mips->pc);
-			return mips->pc + 4;
+			return IRExitTo(mips->pc + 4);
 
 		case IROp::SetCtrlVFPU:
 			mips->vfpuCtrl[inst->dest] = inst->constant;
@@ -1022,14 +1082,14 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 		case IROp::Breakpoint:
 			if (RunBreakpoint(mips->pc)) {
 				CoreTiming::ForceCheck();
-				return mips->pc;
+				return IRExitTo(mips->pc);
 			}
 			break;
 
 		case IROp::MemoryCheck:
 			if (RunMemCheck(mips->pc, mips->r[inst->src1] + inst->constant)) {
 				CoreTiming::ForceCheck();
-				return mips->pc;
+				return IRExitTo(mips->pc);
 			}
 			break;
 
@@ -1054,6 +1114,238 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
 		inst++;
 	}
 
+	// If we got here, the block was badly constructed.
+	if (wholeBlock)
+		Crash();
+	return IR_CONTINUE;
+}
+
+u32 IRInterpret(MIPSState *mips, const IRInst *inst, int count) {
+	return (u32)IRInterpretInstructions(mips, inst, count, true);
+}
+
+u64 IRInterpretOne(MIPSState *mips, const IRInst *inst) {
+	return IRInterpretInstructions(mips, inst, 1, false);
+}
+
+// Threaded interpreter.  Each instruction is pre-decoded to a handler when the block is
+// finalized, so running it is an indirect call per instruction instead of a big switch.
+// Only the common ops have handlers, everything else goes through IRInterpret() one by one.
+
+#define IR_THREADED_OP(name, ...) \
+	static u64 IRThreaded_##name(MIPSState *mips, const IRInst *inst) { __VA_ARGS__; return IR_CONTINUE; }
+
+IR_THREADED_OP(SetConst, mips->r[inst->dest] = inst->constant)
+IR_THREADED_OP(SetConstF, memcpy(&mips->f[inst->dest], &inst->constant, 4))
+IR_THREADED_OP(Add, mips->r[inst->dest] = mips->r[inst->src1] + mips->r[inst->src2])
+IR_THREADED_OP(Sub, mips->r[inst->dest] = mips->r[inst->src1] - mips->r[inst->src2])
+IR_THREADED_OP(And, mips->r[inst->dest] = mips->r[inst->src1] & mips->r[inst->src2])
+IR_THREADED_OP(Or, mips->r[inst->dest] = mips->r[inst->src1] | mips->r[inst->src2])
+IR_THREADED_OP(Xor, mips->r[inst->dest] = mips->r[inst->src1] ^ mips->r[inst->src2])
+IR_THREADED_OP(Mov, mips->r[inst->dest] = mips->r[inst->src1])
+IR_THREADED_OP(AddConst, mips->r[inst->dest] = mips->r[inst->src1] + inst->constant)
+IR_THREADED_OP(SubConst, mips->r[inst->dest] = mips->r[inst->src1] - inst->constant)
+IR_THREADED_OP(AndConst, mips->r[inst->dest] = mips->r[inst->src1] & inst->constant)
+IR_THREADED_OP(OrConst, mips->r[inst->dest] = mips->r[inst->src1] | inst->constant)
+IR_THREADED_OP(XorConst, mips->r[inst->dest] = mips->r[inst->src1] ^ inst->constant)
+
+IR_THREADED_OP(ShlImm, mips->r[inst->dest] = mips->r[inst->src1] << (int)inst->src2)
+IR_THREADED_OP(ShrImm, mips->r[inst->dest] = mips->r[inst->src1] >> (int)inst->src2)
+IR_THREADED_OP(SarImm, mips->r[inst->dest] = (s32)mips->r[inst->src1] >> (int)inst->src2)
+IR_THREADED_OP(Shl, mips->r[inst->dest] = mips->r[inst->src1] << (mips->r[inst->src2] & 31))
+IR_THREADED_OP(Shr, mips->r[inst->dest] = mips->r[inst->src1] >> (mips->r[inst->src2] & 31))
+IR_THREADED_OP(Sar, mips->r[inst->dest] = (s32)mips->r[inst->src1] >> (mips->r[inst->src2] & 31))
+
+IR_THREADED_OP(Slt, mips->r[inst->dest] = (s32)mips->r[inst->src1] < (s32)mips->r[inst->src2])
+IR_THREADED_OP(SltU, mips->r[inst->dest] = mips->r[inst->src1] < mips->r[inst->src2])
+IR_THREADED_OP(SltConst, mips->r[inst->dest] = (s32)mips->r[inst->src1] < (s32)inst->constant)
+IR_THREADED_OP(SltUConst, mips->r[inst->dest] = mips->r[inst->src1] < inst->constant)
+IR_THREADED_OP(MovZ, if (mips->r[inst->src1] == 0) mips->r[inst->dest] = mips->r[inst->src2])
+IR_THREADED_OP(MovNZ, if (mips->r[inst->src1] != 0) mips->r[inst->dest] = mips->r[inst->src2])
+
+IR_THREADED_OP(MfLo, mips->r[inst->dest] = mips->lo)
+IR_THREADED_OP(MfHi, mips->r[inst->dest] = mips->hi)
+IR_THREADED_OP(Mult, s64 result = (s64)(s32)mips->r[inst->src1] * (s64)(s32)mips->r[inst->src2]; memcpy(&mips->lo, &result, 8))
+IR_THREADED_OP(MultU, u64 result = (u64)mips->r[inst->src1] * (u64)mips->r[inst->src2]; memcpy(&mips->lo, &result, 8))
+
+IR_THREADED_OP(Load8, mips->r[inst->dest] = Memory::ReadUnchecked_U8(mips->r[inst->src1] + inst->constant))
+IR_THREADED_OP(Load8Ext, mips->r[inst->dest] = SignExtend8ToU32(Memory::ReadUnchecked_U8(mips->r[inst->src1] + inst->constant)))
+IR_THREADED_OP(Load16, mips->r[inst->dest] = Memory::ReadUnchecked_U16(mips->r[inst->src1] + inst->constant))
+IR_THREADED_OP(Load16Ext, mips->r[inst->dest] = SignExtend16ToU32(Memory::ReadUnchecked_U16(mips->r[inst->src1] + inst->constant)))
+IR_THREADED_OP(Load32, mips->r[inst->dest] = Memory::ReadUnchecked_U32(mips->r[inst->src1] + inst->constant))
+IR_THREADED_OP(LoadFloat, mips->f[inst->dest] = Memory::ReadUnchecked_Float(mips->r[inst->src1] + inst->constant))
+IR_THREADED_OP(Store8, Memory::WriteUnchecked_U8(mips->r[inst->src3], mips->r[inst->src1] + inst->constant))
+IR_THREADED_OP(Store16, Memory::WriteUnchecked_U16(mips->r[inst->src3], mips->r[inst->src1] + inst->constant))
+IR_THREADED_OP(Store32, Memory::WriteUnchecked_U32(mips->r[inst->src3], mips->r[inst->src1] + inst->constant))
+IR_THREADED_OP(StoreFloat, Memory::WriteUnchecked_Float(mips->f[inst->src3], mips->r[inst->src1] + inst->constant))
+
+IR_THREADED_OP(FAdd, mips->f[inst->dest] = mips->f[inst->src1] + mips->f[inst->src2])
+IR_THREADED_OP(FSub, mips->f[inst->dest] = mips->f[inst->src1] - mips->f[inst->src2])
+IR_THREADED_OP(FDiv, mips->f[inst->dest] = mips->f[inst->src1] / mips->f[inst->src2])
+IR_THREADED_OP(FMov, mips->f[inst->dest] = mips->f[inst->src1])
+IR_THREADED_OP(FMovFromGPR, memcpy(&mips->f[inst->dest], &mips->r[inst->src1], 4))
+IR_THREADED_OP(FMovToGPR, memcpy(&mips->r[inst->dest], &mips->f[inst->src1], 4))
+
+IR_THREADED_OP(Vec4Mov, IRVec4Mov(mips, inst))
+IR_THREADED_OP(Vec4Add, IRVec4Add(mips, inst))
+IR_THREADED_OP(Vec4Sub, IRVec4Sub(mips, inst))
+IR_THREADED_OP(Vec4Mul, IRVec4Mul(mips, inst))
+IR_THREADED_OP(Vec4Div, IRVec4Div(mips, inst))
+IR_THREADED_OP(Vec4Scale, IRVec4Scale(mips, inst))
+IR_THREADED_OP(Vec4Neg, IRVec4Neg(mips, inst))
+IR_THREADED_OP(Vec4Abs, IRVec4Abs(mips, inst))
+
+static u64 IRThreaded_FMul(MIPSState *mips, const IRInst *inst) {
+	if ((my_isinf(mips->f[inst->src1]) && mips->f[inst->src2] == 0.0f) || (my_isinf(mips->f[inst->src2]) && mips->f[inst->src1] == 0.0f)) {
+		mips->fi[inst->dest] = 0x7fc00000;
+	} else {
+		mips->f[inst->dest] = mips->f[inst->src1] * mips->f[inst->src2];
+	}
+	return IR_CONTINUE;
+}
+
+IR_THREADED_OP(Downcount, mips->downcount -= inst->constant)
+IR_THREADED_OP(SetPC, mips->pc = mips->r[inst->src1])
+IR_THREADED_OP(SetPCConst, mips->pc = inst->constant)
+
+#undef IR_THREADED_OP
+
+static u64 IRThreaded_ExitToConst(MIPSState *mips, const IRInst *inst) {
+	return IRExitTo(inst->constant);
+}
+
+static u64 IRThreaded_ExitToReg(MIPSState *mips, const IRInst *inst) {
+	return IRExitTo(mips->r[inst->src1]);
+}
+
+static u64 IRThreaded_ExitToPC(MIPSState *mips, const IRInst *inst) {
+	return IRExitTo(mips->pc);
+}
+
+static u64 IRThreaded_ExitToConstIfEq(MIPSState *mips, const IRInst *inst) {
+	return mips->r[inst->src1] == mips->r[inst->src2] ? IRExitTo(inst->constant) : IR_CONTINUE;
+}
+
+static u64 IRThreaded_ExitToConstIfNeq(MIPSState *mips, const IRInst *inst) {
+	return mips->r[inst->src1] != mips->r[inst->src2] ? IRExitTo(inst->constant) : IR_CONTINUE;
+}
+
+static u64 IRThreaded_ExitToConstIfGtZ(MIPSState *mips, const IRInst *inst) {
+	return (s32)mips->r[inst->src1] > 0 ? IRExitTo(inst->constant) : IR_CONTINUE;
+}
+
+static u64 IRThreaded_ExitToConstIfGeZ(MIPSState *mips, const IRInst *inst) {
+	return (s32)mips->r[inst->src1] >= 0 ? IRExitTo(inst->constant) : IR_CONTINUE;
+}
+
+static u64 IRThreaded_ExitToConstIfLtZ(MIPSState *mips, const IRInst *inst) {
+	return (s32)mips->r[inst->src1] < 0 ? IRExitTo(inst->constant) : IR_CONTINUE;
+}
+
+static u64 IRThreaded_ExitToConstIfLeZ(MIPSState *mips, const IRInst *inst) {
+	return (s32)mips->r[inst->src1] <= 0 ? IRExitTo(inst->constant) : IR_CONTINUE;
+}
+
+static u64 IRThreaded_ExitToConstIfDowncountLtZ(MIPSState *mips, const IRInst *inst) {
+	return mips->downcount < 0 ? IRExitTo(inst->constant) : IR_CONTINUE;
+}
+
+static u64 IRThreaded_Generic(MIPSState *mips, const IRInst *inst) {
+	return IRInterpretOne(mips, inst);
+}
+
+struct IRThreadedFuncTable {
+	IRThreadedFuncTable() {
+		for (int i = 0; i < 256; ++i)
+			funcs[i] = &IRThreaded_Generic;
+
+#define IR_THREADED_FUNC(name) funcs[(int)IROp::name] = &IRThreaded_##name
+		IR_THREADED_FUNC(SetConst);
+		IR_THREADED_FUNC(SetConstF);
+		IR_THREADED_FUNC(Add);
+		IR_THREADED_FUNC(Sub);
+		IR_THREADED_FUNC(And);
+		IR_THREADED_FUNC(Or);
+		IR_THREADED_FUNC(Xor);
+		IR_THREADED_FUNC(Mov);
+		IR_THREADED_FUNC(AddConst);
+		IR_THREADED_FUNC(SubConst);
+		IR_THREADED_FUNC(AndConst);
+		IR_THREADED_FUNC(OrConst);
+		IR_THREADED_FUNC(XorConst);
+		IR_THREADED_FUNC(ShlImm);
+		IR_THREADED_FUNC(ShrImm);
+		IR_THREADED_FUNC(SarImm);
+		IR_THREADED_FUNC(Shl);
+		IR_THREADED_FUNC(Shr);
+		IR_THREADED_FUNC(Sar);
+		IR_THREADED_FUNC(Slt);
+		IR_THREADED_FUNC(SltU);
+		IR_THREADED_FUNC(SltConst);
+		IR_THREADED_FUNC(SltUConst);
+		IR_THREADED_FUNC(MovZ);
+		IR_THREADED_FUNC(MovNZ);
+		IR_THREADED_FUNC(MfLo);
+		IR_THREADED_FUNC(MfHi);
+		IR_THREADED_FUNC(Mult);
+		IR_THREADED_FUNC(MultU);
+		IR_THREADED_FUNC(Load8);
+		IR_THREADED_FUNC(Load8Ext);
+		IR_THREADED_FUNC(Load16);
+		IR_THREADED_FUNC(Load16Ext);
+		IR_THREADED_FUNC(Load32);
+		IR_THREADED_FUNC(LoadFloat);
+		IR_THREADED_FUNC(Store8);
+		IR_THREADED_FUNC(Store16);
+		IR_THREADED_FUNC(Store32);
+		IR_THREADED_FUNC(StoreFloat);
+		IR_THREADED_FUNC(FAdd);
+		IR_THREADED_FUNC(FSub);
+		IR_THREADED_FUNC(FMul);
+		IR_THREADED_FUNC(FDiv);
+		IR_THREADED_FUNC(FMov);
+		IR_THREADED_FUNC(FMovFromGPR);
+		IR_THREADED_FUNC(FMovToGPR);
+		IR_THREADED_FUNC(Vec4Mov);
+		IR_THREADED_FUNC(Vec4Add);
+		IR_THREADED_FUNC(Vec4Sub);
+		IR_THREADED_FUNC(Vec4Mul);
+		IR_THREADED_FUNC(Vec4Div);
+		IR_THREADED_FUNC(Vec4Scale);
+		IR_THREADED_FUNC(Vec4Neg);
+		IR_THREADED_FUNC(Vec4Abs);
+		IR_THREADED_FUNC(Downcount);
+		IR_THREADED_FUNC(SetPC);
+		IR_THREADED_FUNC(SetPCConst);
+		IR_THREADED_FUNC(ExitToConst);
+		IR_THREADED_FUNC(ExitToReg);
+		IR_THREADED_FUNC(ExitToPC);
+		IR_THREADED_FUNC(ExitToConstIfEq);
+		IR_THREADED_FUNC(ExitToConstIfNeq);
+		IR_THREADED_FUNC(ExitToConstIfGtZ);
+		IR_THREADED_FUNC(ExitToConstIfGeZ);
+		IR_THREADED_FUNC(ExitToConstIfLtZ);
+		IR_THREADED_FUNC(ExitToConstIfLeZ);
+		IR_THREADED_FUNC(ExitToConstIfDowncountLtZ);
+#undef IR_THREADED_FUNC
+	}
+
+	IRThreadedFunc funcs[256];
+};
+
+static const IRThreadedFuncTable threadedFuncTable;
+
+IRThreadedFunc IRGetThreadedFunc(IROp op) {
+	return threadedFuncTable.funcs[(int)op];
+}
+
+u32 IRInterpretThreaded(MIPSState *mips, const IRInst *inst, const IRThreadedFunc *funcs, int count) {
+	for (int i = 0; i < count; ++i) {
+		u64 result = funcs[i](mips, &inst[i]);
+		if (result != IR_CONTINUE)
+			return (u32)result;
+	}
+
 	// If we got here, the block was badly constructed.
 	Crash();
 	return 0;
@@ -4,6 +4,7 @@
 
 class MIPSState;
 struct IRInst;
+enum class IROp : u8;
 
 inline static u32 ReverseBits32(u32 v) {
 	// http://graphics.stanford.edu/~seander/bithacks.html#ReverseParallel
@@ -20,4 +21,19 @@ inline static u32 ReverseBits32(u32 v) {
 	return v;
 }
 
+// Single instructions return IR_CONTINUE, or IRExitTo(pc) to leave the block.  The exit needs its own
+// bit, since an exit to 0 (like a jump through a null pointer) must still leave and be reported.
+static const u64 IR_CONTINUE = 0;
+inline u64 IRExitTo(u32 pc) {
+	return (1ULL << 32) | pc;
+}
+
 u32 IRInterpret(MIPSState *ms, const IRInst *inst, int count);
+// Runs a single instruction from within a block.
+u64 IRInterpretOne(MIPSState *ms, const IRInst *inst);
+
+// Handler for one pre-decoded instruction.
+typedef u64 (*IRThreadedFunc)(MIPSState *ms, const IRInst *inst);
+
+IRThreadedFunc IRGetThreadedFunc(IROp op);
+u32 IRInterpretThreaded(MIPSState *ms, const IRInst *inst, const IRThreadedFunc *funcs, int count);
@@ -15,18 +15,24 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include <algorithm>
 #include <set>
 
 #include "ext/xxhash.h"
 #include "Common/Profiler/Profiler.h"
 
+#include "Common/File/DirListing.h"
+#include "Common/File/FileUtil.h"
 #include "Common/Log.h"
+#include "Common/MemoryUtil.h"
 #include "Common/Serialize/Serializer.h"
 #include "Common/StringUtils.h"
+#include "Common/Thread/ThreadManager.h"
 
 #include "Core/Config.h"
 #include "Core/Core.h"
 #include "Core/CoreTiming.h"
+#include "Core/ELF/ParamSFO.h"
 #include "Core/HLE/sceKernelMemory.h"
 #include "Core/MemMap.h"
 #include "Core/MIPS/MIPS.h"
@@ -39,21 +45,254 @@
 #include "Core/MIPS/IR/IRInterpreter.h"
 #include "Core/MIPS/JitCommon/JitCommon.h"
 #include "Core/Reporting.h"
+#include "Core/System.h"
+
+#if PPSSPP_ARCH(AMD64)
+#include "Core/MIPS/x86/IRToX86.h"
+#endif
 
 namespace MIPSComp {
 
-IRJit::IRJit(MIPSState *mipsState) : frontend_(mipsState->HasDefaultPrefix()), mips_(mipsState) {
+// A block entered this many times is considered hot, and we try to start a trace there.
+static const u32 TRACE_HOT_ENTRIES = 1000;
+static const size_t TRACE_MAX_BLOCKS = 8;
+static const u32 TRACE_MAX_BYTES = 0x1000;
+
+// Try at TRACE_HOT_ENTRIES, then back off (twice that, four times...) in case what follows wasn't hot yet.
+static inline bool ShouldTryTrace(u32 entries) {
+	if (entries % TRACE_HOT_ENTRIES != 0)
+		return false;
+	u32 n = entries / TRACE_HOT_ENTRIES;
+	return (n & (n - 1)) == 0;
+}
+
+static const u32 BLOCK_CACHE_MAGIC = 0x43425249;  // "IRBC"
+// Bump when the IR ops or what the frontend generates changes.
+static const u32 BLOCK_CACHE_VERSION = 2;
+
+enum : u32 {
+	BLOCK_CACHE_FLAG_INTERPRETER = 1,
+	BLOCK_CACHE_FLAG_DEFAULT_PREFIX = 2,
+	BLOCK_CACHE_FLAG_FAST_MEMORY = 4,
+	BLOCK_CACHE_FLAG_ACCURATE_VMMUL = 8,
+};
+
+// Settings the frontend and passes check while compiling.  These can change while running (with
+// the cache cleared), so they're checked when saving too.
+static u32 BlockCacheSettingFlags() {
+	u32 flags = 0;
+	if (g_Config.bFastMemory)
+		flags |= BLOCK_CACHE_FLAG_FAST_MEMORY;
+	if (PSP_CoreParameter().compat.flags().MoreAccurateVMMUL)
+		flags |= BLOCK_CACHE_FLAG_ACCURATE_VMMUL;
+	return flags;
+}
+
+struct IRBlockCacheHeader {
+	u32 magic;
+	u32 version;
+	u32 instSize;
+	u32 disableFlags;
+	u32 flags;
+	u32 numBlocks;
+	// Hash of PPSSPP_GIT_VERSION, since replacement function numbers may change between builds.
+	u64 buildHash;
+};
+
+struct IRBlockCacheEntry {
+	u32 address;
+	u32 size;
+	u64 hash;
+	u32 numInstructions;
+	u32 reserved;
+};
+
+static u64 MaxBlockCacheSize() {
+	return (u64)std::max(g_Config.iIRBlockCacheMB, 1) * 1024 * 1024;
+}
+
+// Deletes the least recently used block caches of other games until all of them fit.
+static void EvictBlockCaches(const Path &current) {
+	std::vector<File::FileInfo> files;
+	File::GetFilesInDir(current.NavigateUp(), &files, "irblockcache:");
+
+	u64 totalSize = 0;
+	std::vector<std::pair<u64, const File::FileInfo *>> byAge;
+	for (const auto &info : files) {
+		totalSize += info.size;
+		if (info.fullName != current)
+			byAge.push_back(std::make_pair(std::max(info.atime, info.mtime), &info));
+	}
+	std::sort(byAge.begin(), byAge.end());
+
+	const u64 maxSize = MaxBlockCacheSize();
+	for (const auto &it : byAge) {
+		if (totalSize <= maxSize)
+			break;
+		totalSize -= it.second->size;
+		File::Delete(it.second->fullName);
+	}
+}
+
+IRToNativeInterface *CreateIRToNative(MIPSState *mipsState) {
+#if PPSSPP_ARCH(AMD64)
+	return new IRToX86(mipsState);
+#else
+	return nullptr;
+#endif
+}
+
+class IRNativeCompileTask : public Task {
+public:
+	IRNativeCompileTask(IRJit *jit) : jit_(jit) {}
+
+	TaskType Type() const override {
+		return TaskType::CPU_COMPUTE;
+	}
+
+	void Run() override {
+		jit_->RunNativeWorker();
+	}
+
+private:
+	IRJit *jit_;
+};
+
+IRJit::IRJit(MIPSState *mipsState, bool useNative) : frontend_(mipsState->HasDefaultPrefix()), mips_(mipsState) {
 	// u32 size = 128 * 1024;
 	// blTrampolines_ = kernelMemory.Alloc(size, true, "trampoline");
 	InitIR();
 
+	if (useNative) {
+		native_ = CreateIRToNative(mipsState);
+		if (!native_)
+			WARN_LOG(JIT, "IRJit: No native IR backend for this CPU, interpreting IR instead");
+	}
+
 	IROptions opts{};
 	opts.disableFlags = g_Config.uJitDisableFlags;
 	opts.unalignedLoadStore = (opts.disableFlags & (uint32_t)JitDisable::LSU_UNALIGNED) == 0;
+	opts.optimizeForInterpreter = native_ == nullptr;
+	threaded_ = (opts.disableFlags & (uint32_t)JitDisable::IR_PREDECODE) == 0;
+	// Traces are the closest thing we have to block linking.
+	traces_ = (opts.disableFlags & (uint32_t)JitDisable::BLOCKLINK) == 0;
+	// Writing code while other code runs from the same space requires it to be writable and executable at once.
+	nativeOnThread_ = native_ && (opts.disableFlags & (uint32_t)JitDisable::IR_NATIVE_THREAD) == 0 && !PlatformIsWXExclusive() && g_threadManager.IsInitialized();
 	frontend_.SetOptions(opts);
+
+	// We're created before the game is loaded, but PARAM.SFO has already been read.
+	std::string discID = g_paramSFO.GetDiscID();
+	if (g_Config.bIRBlockCache && !discID.empty()) {
+		blockCacheFlags_ = (opts.optimizeForInterpreter ? BLOCK_CACHE_FLAG_INTERPRETER : 0) | (mipsState->HasDefaultPrefix() ? BLOCK_CACHE_FLAG_DEFAULT_PREFIX : 0);
+		File::CreateFullPath(GetSysDirectory(DIRECTORY_APP_CACHE));
+		blockCachePath_ = GetSysDirectory(DIRECTORY_APP_CACHE) / (discID + ".irblockcache");
+		LoadBlockCache(blockCachePath_);
+	}
 }
 
 IRJit::~IRJit() {
+	if (!blockCachePath_.empty())
+		SaveBlockCache(blockCachePath_);
+	WaitForNativeWorker();
+	delete native_;
+}
+
+void IRJit::LoadBlockCache(const Path &filename) {
+	FILE *f = File::OpenCFile(filename, "rb");
+	if (!f)
+		return;
+
+	IRBlockCacheHeader header{};
+	bool success = fread(&header, sizeof(header), 1, f) == 1;
+	if (!success || header.magic != BLOCK_CACHE_MAGIC || header.version != BLOCK_CACHE_VERSION || header.instSize != sizeof(IRInst)) {
+		WARN_LOG(JIT, "IRJit: Block cache version mismatch, ignoring");
+		fclose(f);
+		return;
+	}
+	if (header.disableFlags != g_Config.uJitDisableFlags || header.flags != (blockCacheFlags_ | BlockCacheSettingFlags()) || header.buildHash != XXH3_64bits(PPSSPP_GIT_VERSION, strlen(PPSSPP_GIT_VERSION))) {
+		INFO_LOG(JIT, "IRJit: Block cache was made with different options, ignoring");
+		fclose(f);
+		return;
+	}
+
+	std::vector<IRInst> instructions;
+	u32 loaded = 0;
+	for (u32 i = 0; i < header.numBlocks; ++i) {
+		IRBlockCacheEntry entry;
+		if (fread(&entry, sizeof(entry), 1, f) != 1 || entry.numInstructions == 0 || entry.numInstructions > IRInstArena::CHUNK_SIZE) {
+			ERROR_LOG(JIT, "IRJit: Block cache truncated or corrupt");
+			break;
+		}
+		instructions.resize(entry.numInstructions);
+		if (fread(&instructions[0], sizeof(IRInst), entry.numInstructions, f) != entry.numInstructions) {
+			ERROR_LOG(JIT, "IRJit: Block cache truncated");
+			break;
+		}
+		if (entry.size == 0 || (entry.size & 3) != 0 || !Memory::IsValidRange(entry.address, entry.size))
+			continue;
+
+		int block_num = blocks_.AllocateBlock(entry.address);
+		if ((block_num & ~MIPS_EMUHACK_VALUE_MASK) != 0)
+			break;
+		IRBlock *b = blocks_.GetBlock(block_num);
+		blocks_.SetBlockInstructions(block_num, instructions);
+		b->SetOriginalSize(entry.size);
+		b->SetHash(entry.hash);
+		// Not linked yet.  Compile() will find it with FindPreloadBlock() if the code still matches.
+		blocks_.FinalizeBlock(block_num, true);
+		loaded++;
+	}
+	fclose(f);
+
+	INFO_LOG(JIT, "IRJit: Loaded %d blocks from the block cache", loaded);
+}
+
+void IRJit::SaveBlockCache(const Path &filename) {
+	// Traces depend on how the game ran, so only plain blocks are worth keeping.
+	std::vector<int> saving;
+	u64 fileSize = sizeof(IRBlockCacheHeader);
+	const u64 maxSize = MaxBlockCacheSize();
+	for (int i = 0; i < blocks_.GetNumBlocks(); ++i) {
+		const IRBlock *b = blocks_.GetBlock(i);
+		u32 start, size;
+		b->GetRange(start, size);
+		if (start == 0 || b->IsTrace() || b->GetNumInstructions() == 0 || b->GetHash() == 0)
+			continue;
+		fileSize += sizeof(IRBlockCacheEntry) + b->GetNumInstructions() * sizeof(IRInst);
+		if (fileSize > maxSize)
+			break;
+		saving.push_back(i);
+	}
+	if (saving.empty())
+		return;
+
+	FILE *f = File::OpenCFile(filename, "wb");
+	if (!f)
+		return;
+
+	IRBlockCacheHeader header{};
+	header.magic = BLOCK_CACHE_MAGIC;
+	header.version = BLOCK_CACHE_VERSION;
+	header.instSize = sizeof(IRInst);
+	header.disableFlags = g_Config.uJitDisableFlags;
+	header.flags = blockCacheFlags_ | BlockCacheSettingFlags();
+	header.numBlocks = (u32)saving.size();
+	header.buildHash = XXH3_64bits(PPSSPP_GIT_VERSION, strlen(PPSSPP_GIT_VERSION));
+	fwrite(&header, sizeof(header), 1, f);
+
+	for (int i : saving) {
+		const IRBlock *b = blocks_.GetBlock(i);
+		IRBlockCacheEntry entry{};
+		b->GetRange(entry.address, entry.size);
+		entry.hash = b->GetHash();
+		entry.numInstructions = b->GetNumInstructions();
+		fwrite(&entry, sizeof(entry), 1, f);
+		fwrite(blocks_.GetBlockInstructionPtr(*b), sizeof(IRInst), entry.numInstructions, f);
+	}
+	fclose(f);
+
+	INFO_LOG(JIT, "IRJit: Saved %d blocks to the block cache", (int)saving.size());
+	EvictBlockCaches(filename);
 }
 
 void IRJit::DoState(PointerWrap &p) {
@@ -66,6 +305,15 @@ void IRJit::UpdateFCR31() {
 void IRJit::ClearCache() {
 	INFO_LOG(JIT, "IRJit: Clearing the cache!");
 	blocks_.Clear();
+	if (native_) {
+		// The worker must be done with the code space before we can clear it.
+		WaitForNativeWorker();
+		std::lock_guard<std::mutex> guard(nativeLock_);
+		nativeDone_.clear();
+		nativeFull_ = false;
+		nativeGeneration_++;
+		native_->ClearCode();
+	}
 }
 
 void IRJit::InvalidateCacheAt(u32 em_address, int length) {
@@ -75,8 +323,15 @@ void IRJit::InvalidateCacheAt(u32 em_address, int length) {
 void IRJit::Compile(u32 em_address) {
 	PROFILE_THIS_SCOPE("jitc");
 
-	if (g_Config.bPreloadFunctions) {
-		// Look to see if we've preloaded this block.
+	if (NativeIsFull()) {
+		INFO_LOG(JIT, "IRJit: Native code space full, clearing the cache");
+		ClearCache();
+	}
+	// Invalidation can happen while a block is running, so we reclaim its space here instead.
+	blocks_.CompactIfNeeded();
+
+	if (g_Config.bPreloadFunctions || !blockCachePath_.empty()) {
+		// Look to see if we've preloaded this block, or loaded it from the cache.
 		int block_num = blocks_.FindPreloadBlock(em_address);
 		if (block_num != -1) {
 			IRBlock *b = blocks_.GetBlock(block_num);
@@ -84,6 +339,7 @@ void IRJit::Compile(u32 em_address) {
 			b->Finalize(block_num);
 			if (b->IsValid()) {
 				// Success, we're done.
+				CompileNative(block_num);
 				return;
 			}
 		}
@@ -106,6 +362,8 @@ void IRJit::Compile(u32 em_address) {
 }
 
 bool IRJit::CompileBlock(u32 em_address, std::vector<IRInst> &instructions, u32 &mipsBytes, bool preload) {
+	// This always runs on the emu thread, even with nativeOnThread_.  The frontend reads guest
+	// memory and resolves emuhacks through blocks_, and neither is stable while the CPU runs.
 	frontend_.DoJit(em_address, instructions, mipsBytes, preload);
 	if (instructions.empty()) {
 		_dbg_assert_(preload);
@@ -120,21 +378,162 @@ bool IRJit::CompileBlock(u32 em_address, std::vector<IRInst> &instructions, u32
 	}
 
 	IRBlock *b = blocks_.GetBlock(block_num);
-	b->SetInstructions(instructions);
+	blocks_.SetBlockInstructions(block_num, instructions);
 	b->SetOriginalSize(mipsBytes);
-	if (preload) {
-		// Hash, then only update page stats, don't link yet.
+	// Hash before finalizing, so it's of the original code.  Only preloaded and disk cached blocks check it.
+	if (preload || !blockCachePath_.empty())
 		b->UpdateHash();
+	if (preload) {
+		// Only update page stats, don't link yet.
 		blocks_.FinalizeBlock(block_num, true);
 	} else {
 		// Overwrites the first instruction, and also updates stats.
-		// TODO: Should we always hash?  Then we can reuse blocks.
 		blocks_.FinalizeBlock(block_num);
+		CompileNative(block_num);
 	}
 
 	return true;
 }
 
+void IRJit::CompileNative(int block_num) {
+	IRBlock *b = blocks_.GetBlock(block_num);
+	if (!native_ || b->GetNativeEntry())
+		return;
+
+	if (!nativeOnThread_) {
+		// If this fails (out of space), we just keep interpreting the block until the next clear.
+		b->SetNativeEntry(native_->ConvertIRToNative(blocks_.GetBlockInstructionPtr(*b), b->GetNumInstructions()));
+		return;
+	}
+
+	// The arena may be compacted meanwhile, so the worker gets a copy.
+	const IRInst *instructions = blocks_.GetBlockInstructionPtr(*b);
+	std::lock_guard<std::mutex> guard(nativeLock_);
+	nativeQueue_.push_back(NativeRequest{ block_num, nativeGeneration_, std::vector<IRInst>(instructions, instructions + b->GetNumInstructions()) });
+	if (!nativeWorkerActive_) {
+		// Only one worker at a time, since there's only one code space.
+		nativeWorkerActive_ = true;
+		g_threadManager.EnqueueTask(new IRNativeCompileTask(this));
+	}
+}
+
+bool IRJit::NativeIsFull() {
+	if (!native_)
+		return false;
+	if (!nativeOnThread_)
+		return native_->IsFull();
+	// The worker tells us, since it's the one using up the space.
+	std::lock_guard<std::mutex> guard(nativeLock_);
+	return nativeFull_;
+}
+
+void IRJit::RunNativeWorker() {
+	std::unique_lock<std::mutex> guard(nativeLock_);
+	while (!nativeQueue_.empty()) {
+		NativeRequest request = std::move(nativeQueue_.front());
+		nativeQueue_.erase(nativeQueue_.begin());
+		if (nativeFull_)
+			continue;
+
+		guard.unlock();
+		const u8 *entry = native_->ConvertIRToNative(request.instructions.data(), (int)request.instructions.size());
+		guard.lock();
+
+		if (entry)
+			nativeDone_.push_back(NativeResult{ request.blockNum, request.generation, entry });
+		else
+			nativeFull_ = true;
+	}
+	nativeWorkerActive_ = false;
+	nativeCond_.notify_all();
+}
+
+void IRJit::ApplyNativeResults() {
+	std::lock_guard<std::mutex> guard(nativeLock_);
+	for (const NativeResult &result : nativeDone_) {
+		if (result.generation != nativeGeneration_)
+			continue;
+		// Might've been invalidated while compiling, then we just drop the code.
+		IRBlock *b = blocks_.GetBlock(result.blockNum);
+		if (b && b->GetNumInstructions() != 0 && !b->GetNativeEntry())
+			b->SetNativeEntry(result.entry);
+	}
+	nativeDone_.clear();
+}
+
+void IRJit::WaitForNativeWorker() {
+	std::unique_lock<std::mutex> guard(nativeLock_);
+	nativeQueue_.clear();
+	nativeCond_.wait(guard, [&] { return !nativeWorkerActive_; });
+}
+
+bool IRJit::TryFormTrace(int block_num) {
+	IRBlock *head = blocks_.GetBlock(block_num);
+	if (head->IsTrace() || !head->IsValid())
+		return false;
+
+	u32 headAddr, headSize;
+	head->GetRange(headAddr, headSize);
+	u32 traceEnd = headAddr + headSize;
+
+	// Follow the final exit of each block, as long as where it goes is about as hot.
+	// The block range has to cover all of the trace for invalidation, so only go forward.
+	std::vector<u32> addresses;
+	addresses.push_back(headAddr);
+	const IRBlock *b = head;
+	while (addresses.size() < TRACE_MAX_BLOCKS) {
+		const IRInst &last = blocks_.GetBlockInstructionPtr(*b)[b->GetNumInstructions() - 1];
+		if (last.op != IROp::ExitToConst)
+			break;
+		u32 target = last.constant;
+		if (target <= headAddr || std::find(addresses.begin(), addresses.end(), target) != addresses.end())
+			break;
+		int next_num = blocks_.GetBlockNumberFromStartAddress(target);
+		const IRBlock *next = blocks_.GetBlock(next_num);
+		if (!next || !next->IsValid() || next->IsTrace() || next->GetEntryCount() < head->GetEntryCount() / 2)
+			break;
+
+		u32 nextAddr, nextSize;
+		next->GetRange(nextAddr, nextSize);
+		if (nextAddr + nextSize - headAddr > TRACE_MAX_BYTES)
+			break;
+
+		traceEnd = std::max(traceEnd, nextAddr + nextSize);
+		addresses.push_back(target);
+		b = next;
+	}
+
+	if (addresses.size() < 2)
+		return false;
+
+	std::vector<IRInst> instructions;
+	if (!frontend_.DoJitTrace(addresses, instructions))
+		return false;
+	if (frontend_.CheckRounding(headAddr)) {
+		// Our assumptions are all wrong, the next compile will start over.
+		ClearCache();
+		return false;
+	}
+
+	int trace_num = blocks_.AllocateBlock(headAddr);
+	if ((trace_num & ~MIPS_EMUHACK_VALUE_MASK) != 0) {
+		// Out of block numbers, we'll just keep running the separate blocks.
+		return false;
+	}
+
+	// The trace takes over the head block's entry point.
+	blocks_.DestroyBlock(block_num);
+	IRBlock *trace = blocks_.GetBlock(trace_num);
+	trace->SetIsTrace();
+	blocks_.SetBlockInstructions(trace_num, instructions);
+	trace->SetOriginalSize(traceEnd - headAddr);
+	blocks_.FinalizeBlock(trace_num);
+	CompileNative(trace_num);
+
+	DEBUG_LOG(JIT, "IRJit: Formed trace at %08x from %d blocks, %d instructions", headAddr, (int)addresses.size(), (int)instructions.size());
+	return true;
+}
+
 void IRJit::CompileFunction(u32 start_address, u32 length) {
 	PROFILE_THIS_SCOPE("jitc");
 
@@ -180,6 +579,7 @@ void IRJit::CompileFunction(u32 start_address, u32 length) {
 			case IROp::ExitToConstIfLeZ:
 			case IROp::ExitToConstIfFpTrue:
 			case IROp::ExitToConstIfFpFalse:
+			case IROp::ExitToConstIfDowncountLtZ:
 				exit = inst.constant;
 				break;
 
@@ -221,14 +621,28 @@ void IRJit::RunLoopUntil(u64 globalticks) {
 		if (coreState != 0) {
 			break;
 		}
+		// Blocks compiled in the background start running natively here, between blocks.
+		if (nativeOnThread_)
+			ApplyNativeResults();
 		while (mips_->downcount >= 0) {
 			u32 inst = Memory::ReadUnchecked_U32(mips_->pc);
 			u32 opcode = inst & 0xFF000000;
 			if (opcode == MIPS_EMUHACK_OPCODE) {
 				u32 data = inst & 0xFFFFFF;
 				IRBlock *block = blocks_.GetBlock(data);
+				if (ShouldTryTrace(block->CountEntry()) && traces_) {
+					// Even if this fails, it might've cleared the cache or moved blocks, so dispatch again.
+					TryFormTrace(data);
+					continue;
+				}
 				u32 startPC = mips_->pc;
-				mips_->pc = IRInterpret(mips_, block->GetInstructions(), block->GetNumInstructions());
+				const u8 *nativeEntry = block->GetNativeEntry();
+				if (nativeEntry)
+					mips_->pc = native_->RunBlock(nativeEntry);
+				else if (threaded_)
+					mips_->pc = IRInterpretThreaded(mips_, blocks_.GetBlockInstructionPtr(*block), blocks_.GetBlockThreadedFuncs(*block), block->GetNumInstructions());
+				else
+					mips_->pc = IRInterpret(mips_, blocks_.GetBlockInstructionPtr(*block), block->GetNumInstructions());
 				if (!Memory::IsValidAddress(mips_->pc) || (mips_->pc & 3) != 0) {
 					Core_ExecException(mips_->pc, startPC, ExecExceptionType::JUMP);
 					break;
@@ -246,6 +660,10 @@ void IRJit::RunLoopUntil(u64 globalticks) {
 
 bool IRJit::DescribeCodePtr(const u8 *ptr, std::string &name) {
 	// Used in target disassembly viewer.
+	if (native_ && native_->CodeInRange(ptr)) {
+		name = "IRNative";
+		return true;
+	}
 	return false;
 }
 
@@ -268,6 +686,8 @@ void IRBlockCache::Clear() {
 	}
 	blocks_.clear();
 	byPage_.clear();
+	arena_.Reset();
+	arenaWasted_ = 0;
 }
 
 void IRBlockCache::InvalidateICache(u32 address, u32 length) {
@@ -281,9 +701,12 @@ void IRBlockCache::InvalidateICache(u32 address, u32 length) {
 
 		const std::vector<int> &blocksInPage = iter->second;
 		for (int i : blocksInPage) {
-			if (blocks_[i].OverlapsRange(address, length)) {
+			// Blocks not linked yet (preloaded or from the disk cache) are checked by hash before use.
+			// Module loads invalidate their whole range, so this keeps those blocks usable.
+			if (blocks_[i].IsValid() && blocks_[i].OverlapsRange(address, length)) {
 				// Not removing from the page, hopefully doesn't build up with small recompiles.
-				blocks_[i].Destroy(i);
+				// The block may still be running, so its instructions are reclaimed later.
+				DestroyBlock(i);
 			}
 		}
 	}
@@ -293,6 +716,7 @@ void IRBlockCache::FinalizeBlock(int i, bool preload) {
 	if (!preload) {
 		blocks_[i].Finalize(i);
 	}
+	arena_.Predecode(blocks_[i].GetInstructionOffset(), blocks_[i].GetNumInstructions());
 
 	u32 startAddr, size;
 	blocks_[i].GetRange(startAddr, size);
@@ -305,6 +729,62 @@ void IRBlockCache::FinalizeBlock(int i, bool preload) {
 	}
 }
 
+void IRBlockCache::CompactIfNeeded() {
+	// Not worth it until at least a chunk, and half the arena, is garbage.
+	if (arenaWasted_ < IRInstArena::CHUNK_SIZE || arenaWasted_ < arena_.Size() / 2)
+		return;
+
+	IRInstArena compacted;
+	std::vector<IRInst> insts;
+	for (IRBlock &b : blocks_) {
+		if (b.GetNumInstructions() == 0)
+			continue;
+		const IRInst *start = GetBlockInstructionPtr(b);
+		insts.assign(start, start + b.GetNumInstructions());
+		u32 offset = compacted.Add(insts);
+		compacted.Predecode(offset, (int)insts.size());
+		b.SetInstructions(offset, (int)insts.size());
+	}
+
+	INFO_LOG(JIT, "IRBlockCache: Compacted arena from %d to %d instructions", (int)arena_.Size(), (int)compacted.Size());
+	arena_.Swap(compacted);
+	arenaWasted_ = 0;
+}
+
+u32 IRInstArena::Add(const std::vector<IRInst> &insts) {
+	_assert_(insts.size() <= CHUNK_SIZE);
+	// Start a new chunk if it doesn't fit in what's left of this one.
+	if ((pos_ & CHUNK_MASK) + insts.size() > CHUNK_SIZE)
+		pos_ = (pos_ + CHUNK_MASK) & ~CHUNK_MASK;
+	if ((pos_ >> CHUNK_SHIFT) >= chunks_.size()) {
+		chunks_.push_back(new IRInst[CHUNK_SIZE]);
+		funcChunks_.push_back(new IRThreadedFunc[CHUNK_SIZE]);
+	}
+
+	u32 offset = pos_;
+	if (!insts.empty())
+		memcpy(chunks_[offset >> CHUNK_SHIFT] + (offset & CHUNK_MASK), &insts[0], sizeof(IRInst) * insts.size());
+	pos_ += (u32)insts.size();
+	return offset;
+}
+
+void IRInstArena::Predecode(u32 offset, int count) {
+	const IRInst *insts = Get(offset);
+	IRThreadedFunc *funcs = funcChunks_[offset >> CHUNK_SHIFT] + (offset & CHUNK_MASK);
+	for (int i = 0; i < count; ++i)
+		funcs[i] = IRGetThreadedFunc(insts[i].op);
+}
+
+void IRInstArena::Reset() {
+	for (IRInst *chunk : chunks_)
+		delete[] chunk;
+	for (IRThreadedFunc *chunk : funcChunks_)
+		delete[] chunk;
+	chunks_.clear();
+	funcChunks_.clear();
+	pos_ = 0;
+}
+
 u32 IRBlockCache::AddressToPage(u32 addr) const {
 	// Use relatively small pages since basic blocks are typically small.
 	return (addr & 0x3FFFFFFF) >> 10;
@@ -376,8 +856,9 @@ JitBlockDebugInfo IRBlockCache::GetBlockDebugInfo(int blockNum) const {
 		debugInfo.origDisasm.push_back(mipsDis);
 	}
 
+	const IRInst *instructions = GetBlockInstructionPtr(ir);
 	for (int i = 0; i < ir.GetNumInstructions(); i++) {
-		IRInst inst = ir.GetInstructions()[i];
+		IRInst inst = instructions[i];
 		char buffer[256];
 		DisassembleIR(buffer, sizeof(buffer), inst);
 		debugInfo.irDisasm.push_back(buffer);
@@ -468,6 +949,8 @@ void IRBlock::Destroy(int number) {
 
 		// Let's mark this invalid so we don't try to clear it again.
 		origAddr_ = 0;
+		// Leaves the instructions in the arena as garbage, until it's compacted.
+		numInstructions_ = 0;
 	}
 }
 
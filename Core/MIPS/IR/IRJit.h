@@ -17,15 +17,19 @@
 
 #pragma once
 
+#include <condition_variable>
 #include <cstring>
+#include <mutex>
 #include <unordered_map>
 
 #include "Common/CommonTypes.h"
 #include "Common/CPUDetect.h"
+#include "Common/File/Path.h"
 #include "Core/MIPS/JitCommon/JitBlockCache.h"
 #include "Core/MIPS/JitCommon/JitCommon.h"
 #include "Core/MIPS/IR/IRRegCache.h"
 #include "Core/MIPS/IR/IRInst.h"
+#include "Core/MIPS/IR/IRInterpreter.h"
 #include "Core/MIPS/IR/IRFrontend.h"
 #include "Core/MIPS/MIPSVFPUUtils.h"
 
@@ -35,34 +39,77 @@
 
 namespace MIPSComp {
 
-// TODO : Use arena allocators. For now let's just malloc.
+// Translates finished IR blocks into host code. Implemented per architecture, see CreateIRToNative().
+class IRToNativeInterface {
+public:
+	virtual ~IRToNativeInterface() {}
+
+	// Returns the entry point of the generated code, or nullptr if the block couldn't be compiled.
+	virtual const u8 *ConvertIRToNative(const IRInst *instructions, int count) = 0;
+	// Runs a block returned by ConvertIRToNative(), and returns the next PC.
+	virtual u32 RunBlock(const u8 *entry) = 0;
+
+	virtual void ClearCode() = 0;
+	virtual bool IsFull() const = 0;
+	virtual bool CodeInRange(const u8 *ptr) const = 0;
+	virtual const u8 *GetCrashHandler() const = 0;
+};
+
+// Returns nullptr if there's no IR backend for this CPU.
+IRToNativeInterface *CreateIRToNative(MIPSState *mipsState);
+
+// Holds the instructions of all IR blocks, so they don't each need their own allocation.
+// Memory is handed out from fixed size chunks that never move, since blocks may be added
+// (e.g. by function preloading during a syscall) while another block is being interpreted.
+class IRInstArena {
+public:
+	IRInstArena() {}
+	IRInstArena(const IRInstArena &) = delete;
+	~IRInstArena() {
+		Reset();
+	}
+
+	// Returns an offset to pass to Get().  A block never crosses a chunk boundary.
+	u32 Add(const std::vector<IRInst> &insts);
+	const IRInst *Get(u32 offset) const {
+		return chunks_[offset >> CHUNK_SHIFT] + (offset & CHUNK_MASK);
+	}
+	// Fills in the threaded interpreter handlers for already added instructions.
+	void Predecode(u32 offset, int count);
+	const IRThreadedFunc *GetThreadedFuncs(u32 offset) const {
+		return funcChunks_[offset >> CHUNK_SHIFT] + (offset & CHUNK_MASK);
+	}
+	void Reset();
+	void Swap(IRInstArena &other) {
+		chunks_.swap(other.chunks_);
+		funcChunks_.swap(other.funcChunks_);
+		std::swap(pos_, other.pos_);
+	}
+	u32 Size() const { return pos_; }
+
+	static const int CHUNK_SHIFT = 16;
+	static const u32 CHUNK_SIZE = 1 << CHUNK_SHIFT;
+	static const u32 CHUNK_MASK = CHUNK_SIZE - 1;
+
+private:
+	std::vector<IRInst *> chunks_;
+	// Parallel to chunks_, so the pre-decoded form shares offsets with the instructions.
+	std::vector<IRThreadedFunc *> funcChunks_;
+	u32 pos_ = 0;
+};
+
 class IRBlock {
 public:
-	IRBlock() : instr_(nullptr), numInstructions_(0), origAddr_(0), origSize_(0) {}
-	IRBlock(u32 emAddr) : instr_(nullptr), numInstructions_(0), origAddr_(emAddr), origSize_(0) {}
-	IRBlock(IRBlock &&b) {
-		instr_ = b.instr_;
-		numInstructions_ = b.numInstructions_;
-		origAddr_ = b.origAddr_;
-		origSize_ = b.origSize_;
-		origFirstOpcode_ = b.origFirstOpcode_;
-		hash_ = b.hash_;
-		b.instr_ = nullptr;
-	}
-
-	~IRBlock() {
-		delete[] instr_;
-	}
-
-	void SetInstructions(const std::vector<IRInst> &inst) {
-		instr_ = new IRInst[inst.size()];
-		numInstructions_ = (u16)inst.size();
-		if (!inst.empty()) {
-			memcpy(instr_, &inst[0], sizeof(IRInst) * inst.size());
-		}
+	IRBlock() {}
+	IRBlock(u32 emAddr) : origAddr_(emAddr) {}
+
+	// The instructions themselves live in IRBlockCache's arena.
+	void SetInstructions(u32 offset, int count) {
+		instOffset_ = offset;
+		numInstructions_ = (u16)count;
 	}
 
-	const IRInst *GetInstructions() const { return instr_; }
+	u32 GetInstructionOffset() const { return instOffset_; }
 	int GetNumInstructions() const { return numInstructions_; }
 	MIPSOpcode GetOriginalFirstOp() const { return origFirstOpcode_; }
 	bool HasOriginalFirstOp() const;
@@ -77,8 +124,22 @@ class IRBlock {
 	bool HashMatches() const {
 		return origAddr_ && hash_ == CalculateHash();
 	}
+	// For blocks loaded from the disk cache, checked against memory by HashMatches() before use.
+	void SetHash(u64 hash) {
+		hash_ = hash;
+	}
+	u64 GetHash() const { return hash_; }
 	bool OverlapsRange(u32 addr, u32 size) const;
 
+	// Returns the new count.  Used to find hot blocks to start traces from.
+	u32 CountEntry() { return ++entryCount_; }
+	u32 GetEntryCount() const { return entryCount_; }
+	bool IsTrace() const { return isTrace_; }
+	void SetIsTrace() { isTrace_ = true; }
+
+	const u8 *GetNativeEntry() const { return nativeEntry_; }
+	void SetNativeEntry(const u8 *entry) { nativeEntry_ = entry; }
+
 	void GetRange(u32 &start, u32 &size) const {
 		start = origAddr_;
 		size = origSize_;
@@ -90,11 +151,14 @@ class IRBlock {
 private:
 	u64 CalculateHash() const;
 
-	IRInst *instr_;
-	u16 numInstructions_;
-	u32 origAddr_;
-	u32 origSize_;
+	u32 instOffset_ = 0;
+	u16 numInstructions_ = 0;
+	u32 origAddr_ = 0;
+	u32 origSize_ = 0;
 	u64 hash_ = 0;
+	u32 entryCount_ = 0;
+	bool isTrace_ = false;
+	const u8 *nativeEntry_ = nullptr;
 	MIPSOpcode origFirstOpcode_ = MIPSOpcode(0x68FFFFFF);
 };
 
@@ -104,6 +168,8 @@ class IRBlockCache : public JitBlockCacheDebugInterface {
 	void Clear();
 	void InvalidateICache(u32 address, u32 length);
 	void FinalizeBlock(int i, bool preload = false);
+	// Only safe when no block is running, since it moves instructions around in the arena.
+	void CompactIfNeeded();
 	int GetNumBlocks() const override { return (int)blocks_.size(); }
 	int AllocateBlock(int emAddr) {
 		blocks_.push_back(IRBlock(emAddr));
@@ -117,6 +183,25 @@ class IRBlockCache : public JitBlockCacheDebugInterface {
 		}
 	}
 
+	void DestroyBlock(int i) {
+		arenaWasted_ += blocks_[i].GetNumInstructions();
+		blocks_[i].Destroy(i);
+	}
+
+	void SetBlockInstructions(int i, const std::vector<IRInst> &insts) {
+		blocks_[i].SetInstructions(arena_.Add(insts), (int)insts.size());
+	}
+	const IRInst *GetBlockInstructionPtr(const IRBlock &block) const {
+		if (block.GetNumInstructions() == 0)
+			return nullptr;
+		return arena_.Get(block.GetInstructionOffset());
+	}
+	const IRThreadedFunc *GetBlockThreadedFuncs(const IRBlock &block) const {
+		if (block.GetNumInstructions() == 0)
+			return nullptr;
+		return arena_.GetThreadedFuncs(block.GetInstructionOffset());
+	}
+
 	int FindPreloadBlock(u32 em_address);
 
 	std::vector<u32> SaveAndClearEmuHackOps();
@@ -131,11 +216,14 @@ class IRBlockCache : public JitBlockCacheDebugInterface {
 
 	std::vector<IRBlock> blocks_;
 	std::unordered_map<u32, std::vector<int>> byPage_;
+	IRInstArena arena_;
+	// Instructions in the arena belonging to destroyed blocks.
+	u32 arenaWasted_ = 0;
 };
 
 class IRJit : public JitInterface {
 public:
-	IRJit(MIPSState *mipsState);
+	IRJit(MIPSState *mipsState, bool useNative = false);
 	~IRJit();
 
 	void DoState(PointerWrap &p) override;
@@ -161,23 +249,69 @@ class IRJit : public JitInterface {
 	void UpdateFCR31() override;
 
 	bool CodeInRange(const u8 *ptr) const override {
-		return false;
+		return native_ && native_->CodeInRange(ptr);
 	}
 
 	const u8 *GetDispatcher() const override { return nullptr; }
-	const u8 *GetCrashHandler() const override { return nullptr; }
+	const u8 *GetCrashHandler() const override { return native_ ? native_->GetCrashHandler() : nullptr; }
 
 	void LinkBlock(u8 *exitPoint, const u8 *checkedEntry) override;
 	void UnlinkBlock(u8 *checkedEntry, u32 originalAddress) override;
 
 private:
 	bool CompileBlock(u32 em_address, std::vector<IRInst> &instructions, u32 &mipsBytes, bool preload);
+	void CompileNative(int block_num);
+	bool NativeIsFull();
+	// These are for compiling native code on a worker thread.
+	void RunNativeWorker();
+	void ApplyNativeResults();
+	void WaitForNativeWorker();
+	bool TryFormTrace(int block_num);
 	bool ReplaceJalTo(u32 dest);
 
+	// Blocks from the cache are added like preloaded ones, and only used when their hash matches.
+	void LoadBlockCache(const Path &filename);
+	void SaveBlockCache(const Path &filename);
+
 	JitOptions jo;
 
 	IRFrontend frontend_;
 	IRBlockCache blocks_;
+	// Use the pre-decoded form when interpreting, unless disabled (JitDisable::IR_PREDECODE.)
+	bool threaded_ = true;
+	// Recompile hot paths across blocks as traces, unless disabled (JitDisable::BLOCKLINK.)
+	bool traces_ = true;
+	// Only set when running IR through a native backend (CPUCore::JIT_IR.)
+	IRToNativeInterface *native_ = nullptr;
+
+	// Unless disabled (JitDisable::IR_NATIVE_THREAD), native code is generated on a worker.
+	// Blocks are interpreted until their code is ready, then it's picked up at a safe point.
+	// Only the IR -> native step moves: MIPS -> IR translation stays on the emu thread (see
+	// CompileBlock), as do the JitBlockCache backends, which emit and link in place.
+	struct NativeRequest {
+		int blockNum;
+		u32 generation;
+		std::vector<IRInst> instructions;
+	};
+	struct NativeResult {
+		int blockNum;
+		u32 generation;
+		const u8 *entry;
+	};
+	bool nativeOnThread_ = false;
+	std::mutex nativeLock_;
+	std::condition_variable nativeCond_;
+	// All below are protected by nativeLock_.
+	std::vector<NativeRequest> nativeQueue_;
+	std::vector<NativeResult> nativeDone_;
+	bool nativeWorkerActive_ = false;
+	bool nativeFull_ = false;
+	// Bumped on clear, so results for blocks from before can be dropped.
+	u32 nativeGeneration_ = 0;
+	friend class IRNativeCompileTask;
+	// Empty if the block cache is disabled, or there's no game.
+	Path blockCachePath_;
+	u32 blockCacheFlags_ = 0;
 
 	MIPSState *mips_;
 
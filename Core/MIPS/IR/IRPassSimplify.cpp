@@ -6,6 +6,7 @@
 #include "Common/Data/Convert/SmallDataConvert.h"
 #include "Common/Log.h"
 #include "Core/Config.h"
+#include "Core/MemMap.h"
 #include "Core/MIPS/IR/IRInterpreter.h"
 #include "Core/MIPS/IR/IRPassSimplify.h"
 #include "Core/MIPS/IR/IRRegCache.h"
@@ -84,6 +85,27 @@ IROp ShiftToShiftImm(IROp op) {
 	}
 }
 
+static u32 ValidateAddressSize(IROp op) {
+	switch (op) {
+	case IROp::ValidateAddress8: return 1;
+	case IROp::ValidateAddress16: return 2;
+	case IROp::ValidateAddress32: return 4;
+	case IROp::ValidateAddress128: return 16;
+	default:
+		_assert_msg_(false, "Invalid ValidateAddressSize for op %d", (int)op);
+		return 0;
+	}
+}
+
+// Whether a constant address would always pass validation, so the check can be dropped.
+// Blocks may be kept on disk, so this avoids relying on the RAM size, which can differ.
+static bool IsAlwaysValidRange(u32 addr, u32 size) {
+	if ((addr & (size - 1)) != 0)
+		return false;
+	// Only the first 32MB of RAM, VRAM, and scratchpad are valid no matter what.
+	return Memory::IsValidRange(addr, size) && ((addr & 0x3FFFFFFF) < 0x08000000 || ((addr + size - 1) & 0x3E000000) == 0x08000000);
+}
+
 bool IRApplyPasses(const IRPassFunc *passes, size_t c, const IRWriter &in, IRWriter &out, const IROptions &opts) {
 	if (c == 1) {
 		return passes[0](in, out, opts);
@@ -628,7 +650,12 @@ bool PropagateConstants(const IRWriter &in, IRWriter &out, const IROptions &opts
 		case IROp::ValidateAddress32:
 		case IROp::ValidateAddress128:
 			if (gpr.IsImm(inst.src1)) {
-				out.Write(inst.op, inst.dest, 0, out.AddConstant(gpr.GetImm(inst.src1) + inst.constant));
+				u32 addr = gpr.GetImm(inst.src1) + inst.constant;
+				// The load or store that follows can access memory directly, without any check.
+				if (IsAlwaysValidRange(addr, ValidateAddressSize(inst.op)))
+					break;
+				// Keep src2, it says whether this is a write.
+				out.Write({ inst.op, { inst.dest }, MIPS_REG_ZERO, inst.src2, addr });
 			} else {
 				gpr.MapIn(inst.src1);
 				goto doDefault;
@@ -745,6 +772,7 @@ bool PropagateConstants(const IRWriter &in, IRWriter &out, const IROptions &opts
 		case IROp::ExitToConstIfGtZ:
 		case IROp::ExitToConstIfLeZ:
 		case IROp::ExitToConstIfLtZ:
+		case IROp::ExitToConstIfDowncountLtZ:
 		case IROp::Breakpoint:
 		case IROp::MemoryCheck:
 		default:
@@ -1496,3 +1524,108 @@ bool ApplyMemoryValidation(const IRWriter &in, IRWriter &out, const IROptions &o
 	}
 	return logBlocks;
 }
+
+// Checks for four scalar ops, one per lane of an aligned VFPU vector, and writes a Vec4 op for them.
+// These come from prefixed or temp-using VFPU ops, which IRCompVFPU splits into lanes.
+static bool VectorizeLanes(const IRInst *insts, IRWriter &out) {
+	const IROp op = insts[0].op;
+	IROp vecOp;
+	switch (op) {
+	case IROp::FAdd: vecOp = IROp::Vec4Add; break;
+	case IROp::FSub: vecOp = IROp::Vec4Sub; break;
+	case IROp::FMul: vecOp = IROp::Vec4Mul; break;
+	case IROp::FDiv: vecOp = IROp::Vec4Div; break;
+	case IROp::FNeg: vecOp = IROp::Vec4Neg; break;
+	case IROp::FAbs: vecOp = IROp::Vec4Abs; break;
+	case IROp::FMov: vecOp = IROp::Vec4Mov; break;
+	default:
+		return false;
+	}
+	const bool binary = op == IROp::FAdd || op == IROp::FSub || op == IROp::FMul || op == IROp::FDiv;
+
+	// FPU regs are rarely used this way, and not worth the trouble.
+	const int dest = insts[0].dest & ~3;
+	if (dest < 32)
+		return false;
+	// The lanes can come in any order, but each exactly once.
+	int lanes[4];
+	u8 seen = 0;
+	for (int i = 0; i < 4; ++i) {
+		if (insts[i].op != op || (insts[i].dest & ~3) != dest)
+			return false;
+		lanes[i] = insts[i].dest & 3;
+		seen |= 1 << lanes[i];
+	}
+	if (seen != 0xF)
+		return false;
+
+	// Sources must be aligned vectors too, at the same lane.
+	auto sameLanes = [&](bool useSrc2, int &base) {
+		base = (useSrc2 ? insts[0].src2 : insts[0].src1) - lanes[0];
+		if ((base & 3) != 0)
+			return false;
+		for (int i = 1; i < 4; ++i) {
+			if ((useSrc2 ? insts[i].src2 : insts[i].src1) != base + lanes[i])
+				return false;
+		}
+		return true;
+	};
+
+	int src1, src2;
+	if (op == IROp::FMov && !sameLanes(false, src1)) {
+		// Might be a swizzle from a single vector, like the S/T prefixes produce.
+		src1 = insts[0].src1 & ~3;
+		u8 shuffle = 0;
+		for (int i = 0; i < 4; ++i) {
+			if ((insts[i].src1 & ~3) != src1)
+				return false;
+			shuffle |= (insts[i].src1 & 3) << (lanes[i] * 2);
+		}
+		// The lanes would be overwritten while still being read.
+		if (src1 == dest)
+			return false;
+		out.Write(IROp::Vec4Shuffle, dest, src1, shuffle);
+		return true;
+	}
+	if (op != IROp::FMov && !sameLanes(false, src1))
+		return false;
+
+	if (binary && !sameLanes(true, src2)) {
+		// A scalar multiplied into each lane is a Vec4Scale.
+		if (op != IROp::FMul)
+			return false;
+		for (int i = 1; i < 4; ++i) {
+			if (insts[i].src2 != insts[0].src2)
+				return false;
+		}
+		// The scalar would change partway through.
+		if ((insts[0].src2 & ~3) == dest)
+			return false;
+		out.Write(IROp::Vec4Scale, dest, src1, insts[0].src2);
+		return true;
+	}
+
+	// Aligned vectors are either the same as dest or disjoint, so lanes never read another lane's result.
+	if (binary)
+		out.Write(vecOp, dest, src1, src2);
+	else
+		out.Write(vecOp, dest, src1);
+	return true;
+}
+
+bool VectorizeVFPU(const IRWriter &in, IRWriter &out, const IROptions &opts) {
+	CONDITIONAL_DISABLE;
+
+	bool logBlocks = false;
+	const std::vector<IRInst> &insts = in.GetInstructions();
+	const int n = (int)insts.size();
+	for (int i = 0; i < n; ) {
+		if (i + 4 <= n && VectorizeLanes(&insts[i], out)) {
+			i += 4;
+			continue;
+		}
+		out.Write(insts[i]);
+		i++;
+	}
+	return logBlocks;
+}
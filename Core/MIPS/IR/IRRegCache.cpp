@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cstring>
 #include "Core/MIPS/IR/IRRegCache.h"
 #include "Core/MIPS/IR/IRInst.h"
@@ -65,3 +66,189 @@ void IRRegCache::MapDirtyInIn(int rd, int rs, int rt) {
 	Flush(rt);
 }
 
+
+namespace {
+
+struct IRRegAccess {
+	u8 reg;
+	// 1 for singles.  Vector operands (2 or 4 lanes) always stay in memory.
+	u8 lanes;
+	bool fpr;
+	bool read;
+	bool write;
+};
+
+// Returns the registers an instruction uses, with a register used twice merged into one access.
+int GetRegAccesses(const IRInst &inst, IRRegAccess accesses[3]) {
+	const IRMeta *meta = GetIRMeta(inst.op);
+	int n = 0;
+	auto add = [&](char type, u8 reg, bool read, bool write) {
+		IRRegAccess access{ reg, 1, false, read, write };
+		switch (type) {
+		case 'G':
+			if (reg >= IRREG_VFPU_CTRL_BASE)
+				return;
+			break;
+		case 'F': access.fpr = true; break;
+		case 'V': access.fpr = true; access.lanes = 4; break;
+		case '2': access.fpr = true; access.lanes = 2; break;
+		default:
+			return;
+		}
+		for (int i = 0; i < n; ++i) {
+			IRRegAccess &other = accesses[i];
+			if (other.reg == reg && other.fpr == access.fpr && other.lanes == access.lanes) {
+				other.read = other.read || read;
+				other.write = other.write || write;
+				return;
+			}
+		}
+		accesses[n++] = access;
+	};
+
+	const bool destRead = (meta->flags & (IRFLAG_SRC3 | IRFLAG_SRC3DST)) != 0;
+	const bool destWrite = (meta->flags & IRFLAG_SRC3) == 0;
+	add(meta->types[0], inst.dest, destRead, destWrite);
+	if (meta->types[0] != 0) {
+		add(meta->types[1], inst.src1, true, false);
+		if (meta->types[1] != 0)
+			add(meta->types[2], inst.src2, true, false);
+	}
+	return n;
+}
+
+bool IsVectorLane(const IRRegAccess *accesses, int n, u8 reg) {
+	for (int i = 0; i < n; ++i) {
+		if (accesses[i].fpr && accesses[i].lanes > 1 && reg >= accesses[i].reg && reg < accesses[i].reg + accesses[i].lanes)
+			return true;
+	}
+	return false;
+}
+
+}  // namespace
+
+void IRBlockRegAlloc::Allocate(const IRInst *insts, int count, const IRRegAllocConfig &config) {
+	intervals_.clear();
+
+	// First, liveness.  Walking backward, a register is live if it's read (or exited with) before it's written.
+	// We only need to know this right after the instructions that use it, where runs may end.
+	std::vector<bool> liveAfter(count * 3);
+	bool liveGPR[256], liveFPR[256];
+	// Everything is live at the end of the block.
+	std::fill(liveGPR, liveGPR + 256, true);
+	std::fill(liveFPR, liveFPR + 256, true);
+	for (int i = count - 1; i >= 0; --i) {
+		IRRegAccess accesses[3];
+		int n = GetRegAccesses(insts[i], accesses);
+		for (int j = 0; j < n; ++j)
+			liveAfter[i * 3 + j] = accesses[j].fpr ? liveFPR[accesses[j].reg] : liveGPR[accesses[j].reg];
+
+		if (config.flushesAll(insts[i]) || (GetIRMeta(insts[i].op)->flags & IRFLAG_EXIT) != 0) {
+			std::fill(liveGPR, liveGPR + 256, true);
+			std::fill(liveFPR, liveFPR + 256, true);
+			continue;
+		}
+
+		for (int j = 0; j < n; ++j) {
+			bool *live = accesses[j].fpr ? liveFPR : liveGPR;
+			if (accesses[j].write && !accesses[j].read) {
+				for (int lane = 0; lane < accesses[j].lanes; ++lane)
+					live[(accesses[j].reg + lane) & 0xFF] = false;
+			}
+		}
+		for (int j = 0; j < n; ++j) {
+			bool *live = accesses[j].fpr ? liveFPR : liveGPR;
+			if (accesses[j].read) {
+				for (int lane = 0; lane < accesses[j].lanes; ++lane)
+					live[(accesses[j].reg + lane) & 0xFF] = true;
+			}
+		}
+	}
+
+	// Now build the runs.  Each open run is extended until something forces the register to memory.
+	int openGPR[256], openFPR[256];
+	std::vector<bool> written;
+	std::vector<bool> liveAfterEnd;
+	std::fill(openGPR, openGPR + 256, -1);
+	std::fill(openFPR, openFPR + 256, -1);
+	for (int i = 0; i < count; ++i) {
+		if (config.flushesAll(insts[i])) {
+			std::fill(openGPR, openGPR + 256, -1);
+			std::fill(openFPR, openFPR + 256, -1);
+			continue;
+		}
+
+		IRRegAccess accesses[3];
+		int n = GetRegAccesses(insts[i], accesses);
+		for (int j = 0; j < n; ++j) {
+			if (accesses[j].lanes > 1) {
+				for (int lane = 0; lane < accesses[j].lanes; ++lane)
+					openFPR[(accesses[j].reg + lane) & 0xFF] = -1;
+			}
+		}
+
+		for (int j = 0; j < n; ++j) {
+			const IRRegAccess &access = accesses[j];
+			// A single that's also part of a vector here has to go through memory too.
+			if (access.lanes > 1 || (access.fpr && IsVectorLane(accesses, n, access.reg)))
+				continue;
+
+			int &open = access.fpr ? openFPR[access.reg] : openGPR[access.reg];
+			if (open == -1) {
+				open = (int)intervals_.size();
+				intervals_.push_back(IRRegInterval{ i, i, access.reg, access.fpr, -1, access.read, false });
+				written.push_back(false);
+				liveAfterEnd.push_back(true);
+			}
+			intervals_[open].end = i;
+			if (access.write)
+				written[open] = true;
+			liveAfterEnd[open] = liveAfter[i * 3 + j];
+		}
+	}
+
+	for (size_t i = 0; i < intervals_.size(); ++i)
+		intervals_[i].store = written[i] && liveAfterEnd[i];
+
+	ScanIntervals(false, config.numGPRs);
+	ScanIntervals(true, config.numFPRs);
+}
+
+void IRBlockRegAlloc::ScanIntervals(bool fpr, int numHostRegs) {
+	// Active intervals by index, kept sorted by end.
+	std::vector<int> active;
+	std::vector<s8> freeRegs;
+	for (int r = numHostRegs - 1; r >= 0; --r)
+		freeRegs.push_back((s8)r);
+
+	for (int i = 0; i < (int)intervals_.size(); ++i) {
+		IRRegInterval &cur = intervals_[i];
+		if (cur.fpr != fpr)
+			continue;
+
+		// Expire anything that ended before this starts.
+		while (!active.empty() && intervals_[active.front()].end < cur.start) {
+			freeRegs.push_back(intervals_[active.front()].hostReg);
+			active.erase(active.begin());
+		}
+
+		if (!freeRegs.empty()) {
+			cur.hostReg = freeRegs.back();
+			freeRegs.pop_back();
+		} else if (!active.empty() && intervals_[active.back()].end > cur.end) {
+			// Leave whatever lives longest in memory, it's used least densely.
+			IRRegInterval &spill = intervals_[active.back()];
+			cur.hostReg = spill.hostReg;
+			spill.hostReg = -1;
+			active.pop_back();
+		} else {
+			cur.hostReg = -1;
+			continue;
+		}
+
+		auto pos = std::upper_bound(active.begin(), active.end(), i, [&](int a, int b) {
+			return intervals_[a].end < intervals_[b].end;
+		});
+		active.insert(pos, i);
+	}
+}
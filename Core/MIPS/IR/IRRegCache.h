@@ -2,6 +2,9 @@
 
 // IRRegCache is only to perform pre-constant folding. This is worth it to get cleaner
 // IR.
+// IRBlockRegAlloc is for native backends, and assigns host registers for a whole block.
+
+#include <vector>
 
 #include "Common/CommonTypes.h"
 #include "Core/MIPS/MIPS.h"
@@ -16,6 +19,7 @@ struct RegIR {
 };
 
 class IRWriter;
+struct IRInst;
 
 // Transient
 class IRRegCache {
@@ -45,3 +49,41 @@ class IRRegCache {
 	RegIR reg_[TOTAL_MAPPABLE_MIPSREGS];
 	IRWriter *ir_;
 };
+
+struct IRRegAllocConfig {
+	int numGPRs;
+	int numFPRs;
+	// Instructions the backend runs some other way, with all registers in MIPSState.
+	bool (*flushesAll)(const IRInst &inst);
+};
+
+// A run of instructions where an IR register stays in the same place.
+struct IRRegInterval {
+	int start;
+	// The last instruction in the run that uses the register.
+	int end;
+	u8 reg;
+	bool fpr;
+	// Index into the backend's registers, or -1 to leave it in MIPSState.
+	s8 hostReg;
+	// The first use reads it, so it has to be loaded.
+	bool load;
+	// Written in the run, and read (or exited with) before being written again afterward.
+	bool store;
+};
+
+// Liveness analysis and linear scan allocation over a block.  GPRs from IRREG_VFPU_CTRL_BASE up
+// are left in MIPSState, as are the lanes of vector operands, which end any run of those lanes.
+// Conditional exits don't end runs, the backend is expected to write back dirty registers there.
+class IRBlockRegAlloc {
+public:
+	void Allocate(const IRInst *insts, int count, const IRRegAllocConfig &config);
+
+	// Sorted by start.
+	const std::vector<IRRegInterval> &GetIntervals() const { return intervals_; }
+
+private:
+	void ScanIntervals(bool fpr, int numHostRegs);
+
+	std::vector<IRRegInterval> intervals_;
+};
@@ -113,11 +113,10 @@ void JitBlockCache::Shutdown() {
 // This clears the JIT cache. It's called from JitCache.cpp when the JIT cache
 // is full and when saving and loading states.
 void JitBlockCache::Clear() {
-	block_map_.clear();
-	proxyBlockMap_.clear();
+	block_map_.Clear();
 	for (int i = 0; i < num_blocks_; i++)
 		DestroyBlock(i, DestroyType::CLEAR);
-	links_to_.clear();
+	links_to_.Clear();
 	num_blocks_ = 0;
 
 	blockMemRanges_[JITBLOCK_RANGE_SCRATCH] = std::make_pair(0xFFFFFFFF, 0x00000000);
@@ -198,7 +197,6 @@ void JitBlockCache::ProxyBlock(u32 rootAddress, u32 startAddress, u32 size, cons
 	// Make binary searches and stuff work ok
 	b.normalEntry = codePtr;
 	b.checkedEntry = codePtr;
-	proxyBlockMap_.emplace(startAddress, num_blocks_);
 	AddBlockMap(num_blocks_);
 
 	num_blocks_++; //commit the current block
@@ -209,7 +207,7 @@ void JitBlockCache::AddBlockMap(int block_num) {
 	// Convert the logical address to a physical address for the block map
 	// Yeah, this'll work fine for PSP too I think.
 	u32 pAddr = b.originalAddress & 0x1FFFFFFF;
-	block_map_[std::make_pair(pAddr + 4 * b.originalSize, pAddr)] = block_num;
+	block_map_.Add(block_num, pAddr, pAddr + 4 * b.originalSize);
 }
 
 void JitBlockCache::RemoveBlockMap(int block_num) {
@@ -218,19 +216,8 @@ void JitBlockCache::RemoveBlockMap(int block_num) {
 		return;
 	}
 
-	const u32 pAddr = b.originalAddress & 0x1FFFFFFF;
-	auto it = block_map_.find(std::make_pair(pAddr + 4 * b.originalSize, pAddr));
-	if (it != block_map_.end() && it->second == (u32)block_num) {
-		block_map_.erase(it);
-	} else {
-		// It wasn't in there, or it has the wrong key.  Let's search...
-		for (auto it = block_map_.begin(); it != block_map_.end(); ++it) {
-			if (it->second == (u32)block_num) {
-				block_map_.erase(it);
-				break;
-			}
-		}
-	}
+	// The map remembers the range it was added with, even if originalSize changed since.
+	block_map_.Remove(block_num);
 }
 
 static void ExpandRange(std::pair<u32, u32> &range, u32 newStart, u32 newEnd) {
@@ -253,7 +240,10 @@ void JitBlockCache::FinalizeBlock(int block_num, bool block_link) {
 	if (block_link) {
 		for (int i = 0; i < MAX_JIT_BLOCK_EXITS; i++) {
 			if (b.exitAddress[i] != INVALID_EXIT) {
-				links_to_.emplace(b.exitAddress[i], block_num);
+				std::vector<int> &sources = links_to_.Get(b.exitAddress[i]);
+				// Exits are often to the same page, only need to list the block once.
+				if (sources.empty() || sources.back() != block_num)
+					sources.push_back(block_num);
 			}
 		}
 
@@ -352,12 +342,14 @@ int JitBlockCache::GetBlockNumberFromStartAddress(u32 addr, bool realBlocksOnly)
 	int bl = GetBlockNumberFromEmuHackOp(inst);
 	if (bl < 0) {
 		if (!realBlocksOnly) {
-			// Wasn't an emu hack op, look through proxyBlockMap_.
-			auto range = proxyBlockMap_.equal_range(addr);
-			for (auto it = range.first; it != range.second; ++it) {
-				const int blockIndex = it->second;
-				if (blocks_[blockIndex].originalAddress == addr && !blocks_[blockIndex].proxyFor && !blocks_[blockIndex].invalid)
-					return blockIndex;
+			// Wasn't an emu hack op, look for a pure proxy block in the page.
+			const std::vector<int> *inPage = block_map_.GetPage(addr);
+			if (inPage) {
+				for (int blockIndex : *inPage) {
+					const JitBlock &pb = blocks_[blockIndex];
+					if (pb.originalAddress == addr && pb.IsPureProxy() && !pb.proxyFor && !pb.invalid)
+						return blockIndex;
+				}
 			}
 		}
 		return -1;
@@ -434,27 +426,45 @@ void JitBlockCache::LinkBlockExits(int i) {
 	}
 }
 
+static bool BlockExitsTo(const JitBlock &b, u32 addr) {
+	for (int e = 0; e < MAX_JIT_BLOCK_EXITS; e++) {
+		if (b.exitAddress[e] == addr)
+			return true;
+	}
+	return false;
+}
+
+// Invalid blocks never link again, so we can forget them while walking.
+static void PruneInvalidSources(std::vector<int> &sources, const JitBlock *blocks) {
+	sources.erase(std::remove_if(sources.begin(), sources.end(), [&](int i) {
+		return blocks[i].invalid;
+	}), sources.end());
+}
+
 void JitBlockCache::LinkBlock(int i) {
 	LinkBlockExits(i);
 	JitBlock &b = blocks_[i];
-	// equal_range(b) returns pair<iterator,iterator> representing the range
-	// of element with key b
-	auto ppp = links_to_.equal_range(b.originalAddress);
-	if (ppp.first == ppp.second)
+	std::vector<int> *sources = links_to_.Find(b.originalAddress);
+	if (!sources)
 		return;
-	for (auto iter = ppp.first; iter != ppp.second; ++iter) {
-		// INFO_LOG(JIT, "Linking block %i to block %i", iter->second, i);
-		LinkBlockExits(iter->second);
+	PruneInvalidSources(*sources, blocks_);
+	for (int source : *sources) {
+		// The list is for the whole page, so check it actually exits here.
+		if (BlockExitsTo(blocks_[source], b.originalAddress)) {
+			// INFO_LOG(JIT, "Linking block %i to block %i", source, i);
+			LinkBlockExits(source);
+		}
 	}
 }
 
 void JitBlockCache::UnlinkBlock(int i) {
 	JitBlock &b = blocks_[i];
-	auto ppp = links_to_.equal_range(b.originalAddress);
-	if (ppp.first == ppp.second)
+	std::vector<int> *sources = links_to_.Find(b.originalAddress);
+	if (!sources)
 		return;
-	for (auto iter = ppp.first; iter != ppp.second; ++iter) {
-		JitBlock &sourceBlock = blocks_[iter->second];
+	PruneInvalidSources(*sources, blocks_);
+	for (int source : *sources) {
+		JitBlock &sourceBlock = blocks_[source];
 		for (int e = 0; e < MAX_JIT_BLOCK_EXITS; e++) {
 			if (sourceBlock.exitAddress[e] == b.originalAddress)
 				sourceBlock.linkStatus[e] = false;
@@ -527,14 +537,6 @@ void JitBlockCache::DestroyBlock(int block_num, DestroyType type) {
 		delete b->proxyFor;
 		b->proxyFor = 0;
 	}
-	auto range = proxyBlockMap_.equal_range(b->originalAddress);
-	for (auto it = range.first; it != range.second; ++it) {
-		if (it->second == block_num) {
-			// Found it.  Delete and bail.
-			proxyBlockMap_.erase(it);
-			break;
-		}
-	}
 
 	// TODO: Handle the case when there's a proxy block and a regular JIT block at the same location.
 	// In this case we probably "leak" the proxy block currently (no memory leak but it'll stay enabled).
@@ -587,25 +589,14 @@ void JitBlockCache::InvalidateICache(u32 address, const u32 length) {
 		return;
 	}
 
-	// Blocks may start and end in overlapping ways, and destroying one invalidates iterators.
-	// So after destroying one, we start over.
-	do {
-	restart:
-		auto next = block_map_.lower_bound(std::make_pair(pAddr, 0));
-		auto last = block_map_.upper_bound(std::make_pair(pEnd + MAX_BLOCK_INSTRUCTIONS, 0));
-		// Note that if next is end(), last will be end() too (equal.)
-		for (; next != last; ++next) {
-			const u32 blockStart = next->first.second;
-			const u32 blockEnd = next->first.first;
-			if (blockStart < pEnd && blockEnd > pAddr) {
-				DestroyBlock(next->second, DestroyType::INVALIDATE);
-				// Our iterator is now invalid.  Break and search again.
-				// Most of the time there shouldn't be a bunch of matching blocks.
-				goto restart;
-			}
-		}
-		// We got here - it wasn't in the map at all (or anymore.)
-	} while (false);
+	// Destroying a block changes the map (and may destroy others, through proxies), so collect first.
+	invalidateBlocks_.clear();
+	block_map_.FindOverlapping(pAddr, pEnd, invalidateBlocks_);
+	for (int block_num : invalidateBlocks_) {
+		// Might've been destroyed already as a proxy root.
+		if (!blocks_[block_num].invalid)
+			DestroyBlock(block_num, DestroyType::INVALIDATE);
+	}
 }
 
 void JitBlockCache::InvalidateChangedBlocks() {
@@ -630,6 +621,104 @@ void JitBlockCache::InvalidateChangedBlocks() {
 	}
 }
 
+JitPageLists::~JitPageLists() {
+	for (std::vector<int> *table : tables_)
+		delete[] table;
+}
+
+std::vector<int> &JitPageLists::Get(u32 addr) {
+	const u32 page = AddressToPage(addr);
+	std::vector<int> *&table = tables_[page >> TABLE_SHIFT];
+	if (!table)
+		table = new std::vector<int>[TABLE_SIZE];
+	return table[page & (TABLE_SIZE - 1)];
+}
+
+std::vector<int> *JitPageLists::Find(u32 addr) {
+	const u32 page = AddressToPage(addr);
+	std::vector<int> *table = tables_[page >> TABLE_SHIFT];
+	if (!table || table[page & (TABLE_SIZE - 1)].empty())
+		return nullptr;
+	return &table[page & (TABLE_SIZE - 1)];
+}
+
+const std::vector<int> *JitPageLists::Find(u32 addr) const {
+	return const_cast<JitPageLists *>(this)->Find(addr);
+}
+
+void JitPageLists::Clear() {
+	for (std::vector<int> *table : tables_) {
+		if (!table)
+			continue;
+		for (int i = 0; i < TABLE_SIZE; ++i)
+			table[i].clear();
+	}
+}
+
+static u32 LastAddressInRange(u32 start, u32 end) {
+	// Empty blocks still go in their first page, and we don't wrap around the top.
+	if (end <= start)
+		return start;
+	return std::min(end - 1, (u32)0x1FFFFFFF);
+}
+
+void JitBlockRangeMap::Add(int block_num, u32 start, u32 end) {
+	if (block_num < (int)ranges_.size() && ranges_[block_num].mapped)
+		Remove(block_num);
+	if (block_num >= (int)ranges_.size())
+		ranges_.resize(block_num + 1, Range{ 0, 0, false });
+	ranges_[block_num] = Range{ start, end, true };
+
+	const u32 last = JitPageLists::AddressToPage(LastAddressInRange(start, end));
+	for (u32 page = JitPageLists::AddressToPage(start); page <= last; ++page)
+		pages_.Get(page << JitPageLists::PAGE_SHIFT).push_back(block_num);
+}
+
+bool JitBlockRangeMap::Remove(int block_num) {
+	if (block_num >= (int)ranges_.size() || !ranges_[block_num].mapped)
+		return false;
+
+	Range &range = ranges_[block_num];
+	const u32 last = JitPageLists::AddressToPage(LastAddressInRange(range.start, range.end));
+	for (u32 page = JitPageLists::AddressToPage(range.start); page <= last; ++page) {
+		std::vector<int> &inPage = pages_.Get(page << JitPageLists::PAGE_SHIFT);
+		auto it = std::find(inPage.begin(), inPage.end(), block_num);
+		if (it != inPage.end()) {
+			// Order doesn't matter, so avoid shifting everything down.
+			*it = inPage.back();
+			inPage.pop_back();
+		}
+	}
+	range.mapped = false;
+	return true;
+}
+
+void JitBlockRangeMap::Clear() {
+	pages_.Clear();
+	ranges_.clear();
+}
+
+void JitBlockRangeMap::FindOverlapping(u32 start, u32 end, std::vector<int> &results) const {
+	if (end <= start)
+		return;
+
+	const u32 first = JitPageLists::AddressToPage(start);
+	const u32 last = JitPageLists::AddressToPage(LastAddressInRange(start, end));
+	for (u32 page = first; page <= last; ++page) {
+		const std::vector<int> *inPage = pages_.Find(page << JitPageLists::PAGE_SHIFT);
+		if (!inPage)
+			continue;
+		for (int block_num : *inPage) {
+			const Range &range = ranges_[block_num];
+			if (range.start >= end || range.end <= start)
+				continue;
+			// Blocks are listed in every page they touch, only report them from the first one we look at.
+			if (JitPageLists::AddressToPage(std::max(range.start, start)) == page)
+				results.push_back(block_num);
+		}
+	}
+}
+
 int JitBlockCache::GetBlockExitSize() {
 #if PPSSPP_ARCH(ARM)
 	// Will depend on the sequence found to encode the destination address.
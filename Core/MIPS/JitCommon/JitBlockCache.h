@@ -113,6 +113,66 @@ class JitBlockCacheDebugInterface {
 	virtual ~JitBlockCacheDebugInterface() {}
 };
 
+// Lists of block numbers for each 4KB page of (physical) PSP memory.
+// Pages are kept in a two level table, allocated as code shows up, instead of node based containers.
+class JitPageLists {
+public:
+	JitPageLists() {}
+	JitPageLists(const JitPageLists &) = delete;
+	~JitPageLists();
+
+	std::vector<int> &Get(u32 addr);
+	// Returns nullptr if nothing was ever added to the page.
+	std::vector<int> *Find(u32 addr);
+	const std::vector<int> *Find(u32 addr) const;
+	// Empties all lists, but keeps the memory around.
+	void Clear();
+
+	static u32 AddressToPage(u32 addr) {
+		const u32 page = (addr & 0x1FFFFFFF) >> PAGE_SHIFT;
+		return page < NUM_TABLES * TABLE_SIZE ? page : NUM_TABLES * TABLE_SIZE - 1;
+	}
+
+	enum {
+		PAGE_SHIFT = 12,
+		TABLE_SHIFT = 8,
+		TABLE_SIZE = 1 << TABLE_SHIFT,
+		// Covers 0x00000000 - 0x1FFFFFFF, the same as the masked addresses used for blocks.
+		NUM_TABLES = 0x20000000 >> (PAGE_SHIFT + TABLE_SHIFT),
+	};
+
+private:
+	std::vector<int> *tables_[NUM_TABLES]{};
+};
+
+// Finds blocks by the range of (physical) PSP memory they cover.
+class JitBlockRangeMap {
+public:
+	// A block can only be in the map once.  Adding it again replaces its range.
+	void Add(int block_num, u32 start, u32 end);
+	// Returns false if the block wasn't in the map.
+	bool Remove(int block_num);
+	void Clear();
+
+	// Appends each block overlapping [start, end), once each.
+	void FindOverlapping(u32 start, u32 end, std::vector<int> &results) const;
+	// All blocks touching the page with addr, or nullptr.
+	const std::vector<int> *GetPage(u32 addr) const {
+		return pages_.Find(addr);
+	}
+
+private:
+	struct Range {
+		u32 start;
+		u32 end;
+		bool mapped;
+	};
+
+	JitPageLists pages_;
+	// Indexed by block number.
+	std::vector<Range> ranges_;
+};
+
 class JitBlockCache : public JitBlockCacheDebugInterface {
 public:
 	JitBlockCache(MIPSState *mipsState, CodeBlockCommon *codeBlock);
@@ -185,11 +245,14 @@ class JitBlockCache : public JitBlockCacheDebugInterface {
 
 	CodeBlockCommon *codeBlock_;
 	JitBlock *blocks_;
-	std::unordered_multimap<u32, int> proxyBlockMap_;
 
 	int num_blocks_;
-	std::unordered_multimap<u32, int> links_to_;
-	std::map<std::pair<u32,u32>, u32> block_map_; // (end_addr, start_addr) -> number
+	// Blocks that may exit to an address, by page of that address.  Stale entries are pruned lazily.
+	JitPageLists links_to_;
+	// Physical start to end of each block, including pure proxies.
+	JitBlockRangeMap block_map_;
+	// Scratch space for InvalidateICache.
+	std::vector<int> invalidateBlocks_;
 
 	enum {
 		JITBLOCK_RANGE_SCRATCH = 0,
@@ -201,6 +201,9 @@ namespace MIPSComp {
 		LSU_FPU = 0x4000,
 		LSU_VFPU = 0x8000,
 
+		IR_PREDECODE = 0x00010000,
+		IR_NATIVE_THREAD = 0x00020000,
+
 		SIMD = 0x00100000,
 		BLOCKLINK = 0x00200000,
 		POINTERIFY = 0x00400000,
@@ -1,13 +1,71 @@
 #include "ppsspp_config.h"
-#if PPSSPP_ARCH(X86) || PPSSPP_ARCH(AMD64)
+#if PPSSPP_ARCH(AMD64)
 
+#include <cstddef>
+#include <cstring>
+#include <emmintrin.h>
+
+#include "Common/ABI.h"
+#include "Common/CPUDetect.h"
+#include "Common/Log.h"
+#include "Core/Core.h"
+#include "Core/MemMap.h"
+#include "Core/MIPS/MIPS.h"
+#include "Core/MIPS/IR/IRInterpreter.h"
+#include "Core/MIPS/IR/IRRegCache.h"
 #include "Core/MIPS/x86/IRToX86.h"
 
 namespace MIPSComp {
 
-// Initial attempt at converting IR directly to x86.
+using namespace Gen;
+
+// Converts IR directly to x86-64, one block at a time.
 // This is intended to be an easy way to benefit from the IR with the current infrastructure.
 // Later tries may go across multiple blocks and a different representation.
+//
+// Register usage inside a block:
+//   RBX - Base pointer of memory
+//   R14 - Pointer to mips->r[0], so all IR registers are reachable with a displacement.
+//   RAX, RCX, RDX, XMM0, XMM1 - Scratch.
+//   XMM13-XMM15 - FPRs the allocator left in memory, for one instruction at a time.
+//   Everything else - IR registers, allocated for the whole block by IRBlockRegAlloc.
+
+static const X64Reg MEMBASEREG = RBX;
+static const X64Reg CTXREG = R14;
+
+static const X64Reg gprAllocOrder[] = { RBP, R12, R13, R15, RSI, RDI, R8, R9, R10, R11 };
+static const X64Reg fprAllocOrder[] = {
+	XMM2, XMM3, XMM4, XMM5, XMM6, XMM7, XMM8, XMM9,
+	XMM10, XMM11, XMM12,
+};
+
+static const int CODE_SIZE = 1024 * 1024 * 16;
+// If we have less than this much space left, we clear the cache before compiling more.
+static const int MIN_SPACE_LEFT = 0x10000;
+// Generous worst case for one IR instruction: loading and spilling its registers, the longest op
+// sequences, and an exit writing back every allocated register.  Checked before each instruction.
+static const int MAX_INST_SIZE = 1024;
+
+#define IRSTATE_VAR(x) MDisp(CTXREG, (int)(offsetof(MIPSState, x) - offsetof(MIPSState, r[0])))
+
+static OpArg IRGPRArg(int r) {
+	return MDisp(CTXREG, r * 4);
+}
+
+static OpArg IRFPRArg(int f) {
+	return MDisp(CTXREG, (int)(offsetof(MIPSState, f[0]) - offsetof(MIPSState, r[0])) + f * 4);
+}
+
+static bool SameReg(const OpArg &a, const OpArg &b) {
+	return a.IsSimpleReg() && b.IsSimpleReg() && a.GetSimpleReg() == b.GetSimpleReg();
+}
+
+// Runs a single instruction the native backend doesn't handle.  Returns IR_CONTINUE or IRExitTo(pc).
+static u64 DoIRInst(u64 value) {
+	IRInst inst;
+	memcpy(&inst, &value, sizeof(inst));
+	return IRInterpretOne(currentMIPS, &inst);
+}
 
 struct GPRMapping {
 	Gen::OpArg dest;
@@ -21,73 +79,478 @@ struct FPRMapping {
 	Gen::OpArg src2;
 };
 
+// Ops with a case in ConvertIRToNative().  Everything else is run through DoIRInst().
+static bool IsNativeOp(IROp op) {
+	switch (op) {
+	case IROp::Nop:
+	case IROp::SetConst:
+	case IROp::SetConstF:
+	case IROp::Add:
+	case IROp::Sub:
+	case IROp::And:
+	case IROp::Or:
+	case IROp::Xor:
+	case IROp::AddConst:
+	case IROp::SubConst:
+	case IROp::AndConst:
+	case IROp::OrConst:
+	case IROp::XorConst:
+	case IROp::Shl:
+	case IROp::Shr:
+	case IROp::Sar:
+	case IROp::Ror:
+	case IROp::ShlImm:
+	case IROp::ShrImm:
+	case IROp::SarImm:
+	case IROp::RorImm:
+	case IROp::Slt:
+	case IROp::SltU:
+	case IROp::SltConst:
+	case IROp::SltUConst:
+	case IROp::MovZ:
+	case IROp::MovNZ:
+	case IROp::Max:
+	case IROp::Min:
+	case IROp::Mov:
+	case IROp::Neg:
+	case IROp::Not:
+	case IROp::BSwap16:
+	case IROp::BSwap32:
+	case IROp::Ext8to32:
+	case IROp::Ext16to32:
+	case IROp::Clz:
+	case IROp::MtLo:
+	case IROp::MtHi:
+	case IROp::MfLo:
+	case IROp::MfHi:
+	case IROp::Mult:
+	case IROp::MultU:
+	case IROp::Madd:
+	case IROp::MaddU:
+	case IROp::Msub:
+	case IROp::MsubU:
+	case IROp::Load8:
+	case IROp::Load8Ext:
+	case IROp::Load16:
+	case IROp::Load16Ext:
+	case IROp::Load32:
+	case IROp::Store8:
+	case IROp::Store16:
+	case IROp::Store32:
+	case IROp::LoadFloat:
+	case IROp::StoreFloat:
+	case IROp::LoadVec4:
+	case IROp::StoreVec4:
+	case IROp::Vec4Init:
+	case IROp::Vec4Shuffle:
+	case IROp::Vec4Mov:
+	case IROp::Vec4Neg:
+	case IROp::Vec4Abs:
+	case IROp::Vec4ClampToZero:
+	case IROp::Vec4Add:
+	case IROp::Vec4Sub:
+	case IROp::Vec4Mul:
+	case IROp::Vec4Div:
+	case IROp::Vec4Scale:
+	case IROp::Vec4Dot:
+	case IROp::FAdd:
+	case IROp::FSub:
+	case IROp::FMul:
+	case IROp::FDiv:
+	case IROp::FMov:
+	case IROp::FAbs:
+	case IROp::FNeg:
+	case IROp::FSqrt:
+	case IROp::FCvtSW:
+	case IROp::FCmp:
+	case IROp::FMovFromGPR:
+	case IROp::FMovToGPR:
+	case IROp::FpCondToReg:
+	case IROp::VfpuCtrlToReg:
+	case IROp::SetCtrlVFPU:
+	case IROp::SetCtrlVFPUReg:
+	case IROp::SetCtrlVFPUFReg:
+	case IROp::ZeroFpCond:
+	case IROp::RestoreRoundingMode:
+	case IROp::ApplyRoundingMode:
+	case IROp::UpdateRoundingMode:
+	case IROp::ExitToConst:
+	case IROp::ExitToReg:
+	case IROp::ExitToPC:
+	case IROp::ExitToConstIfEq:
+	case IROp::ExitToConstIfNeq:
+	case IROp::ExitToConstIfGtZ:
+	case IROp::ExitToConstIfGeZ:
+	case IROp::ExitToConstIfLtZ:
+	case IROp::ExitToConstIfLeZ:
+	case IROp::ExitToConstIfDowncountLtZ:
+	case IROp::Downcount:
+	case IROp::SetPC:
+	case IROp::SetPCConst:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool FlushesAll(const IRInst &inst) {
+	return !IsNativeOp(inst.op);
+}
 
-class GreedyRegallocGPR {
+// FPRs left in memory by the allocator are loaded into these around each instruction,
+// since most FP code here needs a register.  XMM0 and XMM1 stay free for scratch.
+static const X64Reg fprTemps[] = { XMM13, XMM14, XMM15 };
+
+// Follows the allocation from IRBlockRegAlloc as the instructions are emitted.
+// Loads happen when a run starts, and stores when it ends (if the value is still needed),
+// or at exits for anything dirty.
+class IRToX86RegCache {
 public:
-	GPRMapping Map(IRInst inst, const IRMeta &meta);
+	IRToX86RegCache(XEmitter *emit, const IRBlockRegAlloc &alloc) : emit_(emit), intervals_(alloc.GetIntervals()) {
+		dirty_.resize(intervals_.size());
+		for (int i = 0; i < 256; ++i) {
+			gprs_[i] = -1;
+			fprs_[i] = -1;
+		}
+	}
+
+	void StartInst(int instNum);
+	GPRMapping MapGPR(const IRInst &inst, const IRMeta &meta);
+	FPRMapping MapFPR(const IRInst &inst, const IRMeta &meta);
+	void EndInst(int instNum);
+
+	// Writes back dirty registers but keeps the mappings, for exit paths.
+	void EmitWriteback();
 
 private:
-	
+	OpArg GPRArg(int r) const {
+		if (r < IRREG_VFPU_CTRL_BASE && gprs_[r] != -1 && intervals_[gprs_[r]].hostReg != -1)
+			return R(gprAllocOrder[intervals_[gprs_[r]].hostReg]);
+		return IRGPRArg(r);
+	}
+	OpArg FPRArg(int f, bool read, bool write);
+	void Store(int index);
+
+	XEmitter *emit_;
+	const std::vector<IRRegInterval> &intervals_;
+	size_t nextInterval_ = 0;
+	// Index of the current interval for each IR register, or -1.
+	int gprs_[256];
+	int fprs_[256];
+	std::vector<int> active_;
+	std::vector<bool> dirty_;
+
+	struct FPRTemp {
+		int ir;
+		bool write;
+	};
+	FPRTemp temps_[3];
+	int numTemps_ = 0;
 };
 
+void IRToX86RegCache::StartInst(int instNum) {
+	numTemps_ = 0;
+	while (nextInterval_ < intervals_.size() && intervals_[nextInterval_].start == instNum) {
+		const IRRegInterval &interval = intervals_[nextInterval_];
+		(interval.fpr ? fprs_ : gprs_)[interval.reg] = (int)nextInterval_;
+		active_.push_back((int)nextInterval_);
+		if (interval.load && interval.hostReg != -1) {
+			if (interval.fpr)
+				emit_->MOVSS(fprAllocOrder[interval.hostReg], IRFPRArg(interval.reg));
+			else
+				emit_->MOV(32, R(gprAllocOrder[interval.hostReg]), IRGPRArg(interval.reg));
+		}
+		nextInterval_++;
+	}
+}
 
-GPRMapping GreedyRegallocGPR::Map(IRInst inst, const IRMeta &meta) {
+GPRMapping IRToX86RegCache::MapGPR(const IRInst &inst, const IRMeta &meta) {
 	GPRMapping mapping;
-	if (meta.types[0] == 'G') {
+	if (meta.types[1] == 'G')
+		mapping.src1 = GPRArg(inst.src1);
+	if (meta.types[2] == 'G')
+		mapping.src2 = GPRArg(inst.src2);
+	else if (meta.types[2] == 'C')
+		mapping.src2 = Imm32(inst.constant);
 
+	if (meta.types[0] == 'G') {
+		mapping.dest = GPRArg(inst.dest);
+		if ((meta.flags & IRFLAG_SRC3) == 0 && inst.dest < IRREG_VFPU_CTRL_BASE && gprs_[inst.dest] != -1)
+			dirty_[gprs_[inst.dest]] = true;
 	}
-	// etc..
 	return mapping;
 }
 
-// Every 4 registers can also be mapped into an SSE register.
-// When changing from single to vec4 mapping, we'll just flush, for now.
-class GreedyRegallocFPR {
-public:
-	FPRMapping Map(IRInst inst, const IRMeta &meta);
-};
+static int FPRTypeLanes(char type) {
+	switch (type) {
+	case 'V': return 4;
+	case '2': return 2;
+	default: return 0;
+	}
+}
 
-FPRMapping GreedyRegallocFPR::Map(IRInst inst, const IRMeta &meta) {
+OpArg IRToX86RegCache::FPRArg(int f, bool read, bool write) {
+	if (fprs_[f] != -1 && intervals_[fprs_[f]].hostReg != -1) {
+		if (write)
+			dirty_[fprs_[f]] = true;
+		return R(fprAllocOrder[intervals_[fprs_[f]].hostReg]);
+	}
+
+	// Stays in memory, so borrow a temp just for this instruction.
+	for (int i = 0; i < numTemps_; ++i) {
+		if (temps_[i].ir == f) {
+			temps_[i].write = temps_[i].write || write;
+			return R(fprTemps[i]);
+		}
+	}
+	_assert_msg_(numTemps_ < 3, "IRToX86: Ran out of FPR temps");
+	temps_[numTemps_] = FPRTemp{ f, write };
+	if (read)
+		emit_->MOVSS(fprTemps[numTemps_], IRFPRArg(f));
+	return R(fprTemps[numTemps_++]);
+}
+
+FPRMapping IRToX86RegCache::MapFPR(const IRInst &inst, const IRMeta &meta) {
 	FPRMapping mapping;
+	if (meta.types[1] == 'F')
+		mapping.src1 = FPRArg(inst.src1, true, false);
+	else if (FPRTypeLanes(meta.types[1]))
+		mapping.src1 = IRFPRArg(inst.src1);
+	if (meta.types[2] == 'F')
+		mapping.src2 = FPRArg(inst.src2, true, false);
+	else if (FPRTypeLanes(meta.types[2]))
+		mapping.src2 = IRFPRArg(inst.src2);
 
+	if (meta.types[0] == 'F') {
+		bool isSource = (meta.flags & IRFLAG_SRC3) != 0;
+		mapping.dest = FPRArg(inst.dest, isSource, !isSource);
+	} else if (FPRTypeLanes(meta.types[0])) {
+		mapping.dest = IRFPRArg(inst.dest);
+	}
 	return mapping;
 }
 
+void IRToX86RegCache::Store(int index) {
+	const IRRegInterval &interval = intervals_[index];
+	if (interval.hostReg == -1 || !dirty_[index])
+		return;
+	if (interval.fpr)
+		emit_->MOVSS(IRFPRArg(interval.reg), fprAllocOrder[interval.hostReg]);
+	else
+		emit_->MOV(32, IRGPRArg(interval.reg), R(gprAllocOrder[interval.hostReg]));
+}
 
-// This requires that ThreeOpToTwoOp has been run as the last pass.
-void IRToX86::ConvertIRToNative(const IRInst *instructions, int count, const u32 *constants) {
-	// Set up regcaches
-	using namespace Gen;
+void IRToX86RegCache::EndInst(int instNum) {
+	for (int i = 0; i < numTemps_; ++i) {
+		if (temps_[i].write)
+			emit_->MOVSS(IRFPRArg(temps_[i].ir), fprTemps[i]);
+	}
+	numTemps_ = 0;
+
+	for (size_t i = 0; i < active_.size(); ) {
+		const IRRegInterval &interval = intervals_[active_[i]];
+		if (interval.end != instNum) {
+			++i;
+			continue;
+		}
+		// Values overwritten before anyone looks at them again don't need to go back.
+		if (interval.store)
+			Store(active_[i]);
+		(interval.fpr ? fprs_ : gprs_)[interval.reg] = -1;
+		active_[i] = active_.back();
+		active_.pop_back();
+	}
+}
+
+void IRToX86RegCache::EmitWriteback() {
+	for (int index : active_)
+		Store(index);
+}
 
-	GreedyRegallocGPR gprAlloc;
-	GreedyRegallocFPR fprAlloc;
+// Laid out at the start of the code space, so it's always RIP-reachable.
+struct IRToX86Constants {
+	u32 signBits[4];
+	u32 noSignMask[4];
+	u32 positiveNAN[4];
+	float vec4Init[8][4];
+};
+
+static const IRToX86Constants constantValues = {
+	{ 0x80000000, 0x80000000, 0x80000000, 0x80000000 },
+	{ 0x7FFFFFFF, 0x7FFFFFFF, 0x7FFFFFFF, 0x7FFFFFFF },
+	{ 0x7FC00000, 0x7FC00000, 0x7FC00000, 0x7FC00000 },
+	{
+		{ 0.0f, 0.0f, 0.0f, 0.0f },
+		{ 1.0f, 1.0f, 1.0f, 1.0f },
+		{ -1.0f, -1.0f, -1.0f, -1.0f },
+		{ 1.0f, 0.0f, 0.0f, 0.0f },
+		{ 0.0f, 1.0f, 0.0f, 0.0f },
+		{ 0.0f, 0.0f, 1.0f, 0.0f },
+		{ 0.0f, 0.0f, 0.0f, 1.0f },
+	},
+};
+
+IRToX86::IRToX86(MIPSState *mipsState) : mips_(mipsState) {
+	AllocCodeSpace(CODE_SIZE);
+	GenerateFixedCode();
+}
+
+IRToX86::~IRToX86() {
+	FreeCodeSpace();
+}
+
+void IRToX86::GenerateFixedCode() {
+	BeginWrite(GetMemoryProtectPageSize());
+	AlignCodePage();
+
+	constants_ = AlignCode16();
+	const u32 *constantWords = (const u32 *)&constantValues;
+	for (size_t i = 0; i < sizeof(constantValues) / 4; ++i)
+		Write32(constantWords[i]);
+
+	enterBlock_ = (EnterFunc)AlignCode16();
+	ABI_PushAllCalleeSavedRegsAndAdjustStack();
+	MOV(64, R(RAX), ImmPtr(&Memory::base));
+	MOV(64, R(MEMBASEREG), MatR(RAX));
+	MOV(64, R(CTXREG), ImmPtr(&mips_->r[0]));
+	JMPptr(R(ABI_PARAM1));
+
+	// Blocks jump here with the next PC in EAX.
+	exitBlock_ = AlignCode16();
+	ABI_PopAllCalleeSavedRegsAndAdjustStack();
+	RET();
+
+	// The fault handler redirects bad memory accesses here.
+	crashHandler_ = AlignCode16();
+	MOV(64, R(RAX), ImmPtr((const void *)&coreState));
+	MOV(32, MatR(RAX), Imm32(CORE_RUNTIME_ERROR));
+	// Make sure IRJit leaves its dispatch loop, so CoreTiming sees the new state.
+	MOV(32, IRSTATE_VAR(downcount), Imm32(-1));
+	MOV(32, R(EAX), IRSTATE_VAR(pc));
+	JMP(exitBlock_, true);
+
+	// Let's spare the pre-generated code from unprotect-reprotect.
+	endOfFixedCode_ = AlignCodePage();
+	EndWrite();
+}
+
+void IRToX86::ClearCode() {
+	ClearCodeSpace((int)(endOfFixedCode_ - GetBasePtr()));
+	full_ = false;
+}
+
+bool IRToX86::IsFull() const {
+	return full_ || GetSpaceLeft() < MIN_SPACE_LEFT;
+}
+
+u32 IRToX86::RunBlock(const u8 *entry) {
+	return enterBlock_(entry);
+}
+
+// This requires that ThreeOpToTwoOp has been run as the last pass, though it's not needed for correctness.
+const u8 *IRToX86::ConvertIRToNative(const IRInst *instructions, int count) {
+	if (IsFull())
+		return nullptr;
+
+	BeginWrite(count * 32);
+	const size_t startOffset = GetOffset(GetCodePtr());
+	const u8 *start = AlignCode16();
+
+	const IRToX86Constants *consts = (const IRToX86Constants *)constants_;
+	IRRegAllocConfig allocConfig{ (int)ARRAY_SIZE(gprAllocOrder), (int)ARRAY_SIZE(fprAllocOrder), &FlushesAll };
+	IRBlockRegAlloc alloc;
+	alloc.Allocate(instructions, count, allocConfig);
+	IRToX86RegCache regs(this, alloc);
+
+	auto exitToEAX = [&]() {
+		regs.EmitWriteback();
+		JMP(exitBlock_, true);
+	};
+	auto exitToConst = [&](u32 pc) {
+		MOV(32, R(EAX), Imm32(pc));
+		exitToEAX();
+	};
+	// Computes the result in dest if possible, or EAX if dest is in memory or aliased with src2.
+	auto pickTarget = [&](const OpArg &dest, const OpArg &src1, const OpArg &src2) {
+		if (dest.IsSimpleReg() && (!SameReg(dest, src2) || SameReg(dest, src1)))
+			return dest.GetSimpleReg();
+		return EAX;
+	};
+	auto finishTarget = [&](const OpArg &dest, X64Reg target) {
+		if (!SameReg(dest, R(target)))
+			MOV(32, dest, R(target));
+	};
+	// Address for loads and stores, in RAX.
+	auto computeAddress = [&](const IRInst &inst, const OpArg &base) {
+		if (inst.src1 == MIPS_REG_ZERO) {
+			MOV(32, R(EAX), Imm32(inst.constant));
+		} else if (base.IsSimpleReg()) {
+			LEA(32, EAX, MDisp(base.GetSimpleReg(), (int)inst.constant));
+		} else {
+			MOV(32, R(EAX), base);
+			if (inst.constant != 0)
+				ADD(32, R(EAX), Imm32(inst.constant));
+		}
+#ifdef MASKED_PSP_MEMORY
+		AND(32, R(EAX), Imm32(Memory::MEMVIEW32_MASK));
+#endif
+		return MComplex(MEMBASEREG, RAX, SCALE_1, 0);
+	};
+	auto fallback = [&](const IRInst &inst) {
+		// The allocator already made sure everything is in MIPSState around these.
+		_dbg_assert_msg_(!IsNativeOp(inst.op), "IRToX86: Native op %d fell back", (int)inst.op);
+		u64 value;
+		memcpy(&value, &inst, sizeof(value));
+		MOV(64, R(ABI_PARAM1), Imm64(value));
+		ABI_CallFunction((const void *)&DoIRInst);
+		// The exit PC is in EAX, with a bit above it set, so an exit to 0 still exits.
+		TEST(64, R(RAX), R(RAX));
+		// Everything was flushed, so we can exit directly.
+		FixupBranch skip = J_CC(CC_Z);
+		JMP(exitBlock_, true);
+		SetJumpTarget(skip);
+	};
 
 	// Loop through all the instructions, emitting code as we go.
-	// Note that we do need to implement them all - fallbacks are not permitted.
+	// Anything not handled natively is run through the interpreter, one instruction at a time.
+	bool endedBlock = false;
 	for (int i = 0; i < count; i++) {
-		const IRInst *inst = &instructions[i];
-		const IRMeta &meta = *GetIRMeta(inst->op);
-		GPRMapping gpr = gprAlloc.Map(*inst, meta);
-		FPRMapping fpr = fprAlloc.Map(*inst, meta);
+		if (GetSpaceLeft() < MAX_INST_SIZE) {
+			// Out of space partway through, so throw away what we wrote.  The block stays interpreted.
+			ResetCodePtr(startOffset);
+			EndWrite();
+			full_ = true;
+			return nullptr;
+		}
 
-		bool symmetric = false;
-		switch (inst->op) {
+		const IRInst &inst = instructions[i];
+		const IRMeta &meta = *GetIRMeta(inst.op);
+		GPRMapping gpr;
+		FPRMapping fpr;
+		regs.StartInst(i);
+		if (IsNativeOp(inst.op)) {
+			gpr = regs.MapGPR(inst, meta);
+			fpr = regs.MapFPR(inst, meta);
+		}
+		endedBlock = false;
+
+		switch (inst.op) {
 		case IROp::Nop:
-			_assert_(false);
 			break;
 
 			// Output-only
 		case IROp::SetConst:
-			code_->MOV(32, gpr.dest, Imm32(constants[inst->src1]));
+			MOV(32, gpr.dest, Imm32(inst.constant));
 			break;
 		case IROp::SetConstF:
-			code_->MOV(32, gpr.dest, Imm32(constants[inst->src1]));
+			MOV(32, R(EAX), Imm32(inst.constant));
+			MOVD_xmm(fpr.dest.GetSimpleReg(), R(EAX));
 			break;
 
 			// Add gets to be special cased because we have LEA.
 		case IROp::Add:
-			if (gpr.dest.IsSimpleReg() && gpr.src1.IsSimpleReg() && gpr.src2.IsSimpleReg()) {
-				code_->LEA(32, gpr.dest.GetSimpleReg(), MRegSum(gpr.src1.GetSimpleReg(), gpr.src2.GetSimpleReg()));
+			if (gpr.dest.IsSimpleReg() && gpr.src1.IsSimpleReg() && gpr.src2.IsSimpleReg() && !SameReg(gpr.dest, gpr.src1) && !SameReg(gpr.dest, gpr.src2)) {
+				LEA(32, gpr.dest.GetSimpleReg(), MRegSum(gpr.src1.GetSimpleReg(), gpr.src2.GetSimpleReg()));
 				break;
 			}
 			// Else fall through.
@@ -97,78 +560,224 @@ void IRToX86::ConvertIRToNative(const IRInst *instructions, int count, const u32
 		case IROp::And:
 		case IROp::Or:
 		case IROp::Xor:
-			if (inst->src1 != inst->dest) {
-				code_->MOV(32, gpr.dest, gpr.src1);
+		case IROp::AddConst:
+		case IROp::SubConst:
+		case IROp::AndConst:
+		case IROp::OrConst:
+		case IROp::XorConst:
+		{
+			if (inst.op == IROp::AddConst && gpr.dest.IsSimpleReg() && gpr.src1.IsSimpleReg() && !SameReg(gpr.dest, gpr.src1)) {
+				LEA(32, gpr.dest.GetSimpleReg(), MDisp(gpr.src1.GetSimpleReg(), (int)inst.constant));
+				break;
 			}
-			// Emit directly
-			switch (inst->op) {
-			case IROp::Add: code_->ADD(32, gpr.dest, gpr.src2); break;
-			case IROp::Sub: code_->SUB(32, gpr.dest, gpr.src2); break;
-			case IROp::And: code_->AND(32, gpr.dest, gpr.src2); break;
-			case IROp::Or: code_->OR(32, gpr.dest, gpr.src2); break;
-			case IROp::Xor: code_->XOR(32, gpr.dest, gpr.src2); break;
+			X64Reg target = pickTarget(gpr.dest, gpr.src1, gpr.src2);
+			if (!SameReg(R(target), gpr.src1))
+				MOV(32, R(target), gpr.src1);
+			switch (inst.op) {
+			case IROp::Add: case IROp::AddConst: ADD(32, R(target), gpr.src2); break;
+			case IROp::Sub: case IROp::SubConst: SUB(32, R(target), gpr.src2); break;
+			case IROp::And: case IROp::AndConst: AND(32, R(target), gpr.src2); break;
+			case IROp::Or: case IROp::OrConst: OR(32, R(target), gpr.src2); break;
+			case IROp::Xor: case IROp::XorConst: XOR(32, R(target), gpr.src2); break;
+			default: break;
 			}
+			finishTarget(gpr.dest, target);
 			break;
+		}
 
 			// Variable shifts.
 		case IROp::Shl:
 		case IROp::Shr:
 		case IROp::Sar:
 		case IROp::Ror:
+		{
+			// x86 masks the count to 5 bits, same as MIPS.
+			MOV(32, R(ECX), gpr.src2);
+			X64Reg target = gpr.dest.IsSimpleReg() ? gpr.dest.GetSimpleReg() : EAX;
+			if (!SameReg(R(target), gpr.src1))
+				MOV(32, R(target), gpr.src1);
+			switch (inst.op) {
+			case IROp::Shl: SHL(32, R(target), R(CL)); break;
+			case IROp::Shr: SHR(32, R(target), R(CL)); break;
+			case IROp::Sar: SAR(32, R(target), R(CL)); break;
+			case IROp::Ror: ROR(32, R(target), R(CL)); break;
+			default: break;
+			}
+			finishTarget(gpr.dest, target);
+			break;
+		}
+
+			// 2-op arithmetic with immediate
+		case IROp::ShlImm:
+		case IROp::ShrImm:
+		case IROp::SarImm:
+		case IROp::RorImm:
+		{
+			X64Reg target = gpr.dest.IsSimpleReg() ? gpr.dest.GetSimpleReg() : EAX;
+			if (!SameReg(R(target), gpr.src1))
+				MOV(32, R(target), gpr.src1);
+			if (inst.src2 != 0) {
+				switch (inst.op) {
+				case IROp::ShlImm: SHL(32, R(target), Imm8(inst.src2)); break;
+				case IROp::ShrImm: SHR(32, R(target), Imm8(inst.src2)); break;
+				case IROp::SarImm: SAR(32, R(target), Imm8(inst.src2)); break;
+				case IROp::RorImm: ROR(32, R(target), Imm8(inst.src2)); break;
+				default: break;
+				}
+			}
+			finishTarget(gpr.dest, target);
+			break;
+		}
 
 		case IROp::Slt:
 		case IROp::SltU:
+		case IROp::SltConst:
+		case IROp::SltUConst:
+		{
+			OpArg lhs = gpr.src1;
+			if (!lhs.IsSimpleReg() && !gpr.src2.IsSimpleReg() && !gpr.src2.IsImm()) {
+				MOV(32, R(ECX), lhs);
+				lhs = R(ECX);
+			}
+			XOR(32, R(EAX), R(EAX));
+			CMP(32, lhs, gpr.src2);
+			bool isSigned = inst.op == IROp::Slt || inst.op == IROp::SltConst;
+			SETcc(isSigned ? CC_L : CC_B, R(EAX));
+			MOV(32, gpr.dest, R(EAX));
+			break;
+		}
+
 		case IROp::MovZ:
 		case IROp::MovNZ:
+		{
+			CMP(32, gpr.src1, Imm8(0));
+			CCFlags cc = inst.op == IROp::MovZ ? CC_Z : CC_NZ;
+			if (gpr.dest.IsSimpleReg()) {
+				CMOVcc(32, gpr.dest.GetSimpleReg(), gpr.src2, cc);
+			} else {
+				MOV(32, R(EAX), gpr.dest);
+				CMOVcc(32, EAX, gpr.src2, cc);
+				MOV(32, gpr.dest, R(EAX));
+			}
+			break;
+		}
+
 		case IROp::Max:
 		case IROp::Min:
+		{
+			X64Reg target = pickTarget(gpr.dest, gpr.src1, gpr.src2);
+			if (!SameReg(R(target), gpr.src1))
+				MOV(32, R(target), gpr.src1);
+			CMP(32, R(target), gpr.src2);
+			CMOVcc(32, target, gpr.src2, inst.op == IROp::Max ? CC_L : CC_G);
+			finishTarget(gpr.dest, target);
 			break;
-
-			// 2-op arithmetic with constant
-		case IROp::AddConst:
-		case IROp::SubConst:
-		case IROp::AndConst:
-		case IROp::OrConst:
-		case IROp::XorConst:
-		case IROp::SltConst:
-		case IROp::SltUConst:
-
-			// 2-op arithmetic with immediate
-		case IROp::ShlImm:
-		case IROp::ShrImm:
-		case IROp::SarImm:
-		case IROp::RorImm:
+		}
 
 			// 2-op arithmetic
 		case IROp::Mov:
-			code_->MOV(32, gpr.dest, gpr.src1);
+			if (gpr.dest.IsSimpleReg() || gpr.src1.IsSimpleReg()) {
+				if (!SameReg(gpr.dest, gpr.src1))
+					MOV(32, gpr.dest, gpr.src1);
+			} else {
+				MOV(32, R(EAX), gpr.src1);
+				MOV(32, gpr.dest, R(EAX));
+			}
 			break;
 
 		case IROp::Neg:
 		case IROp::Not:
-		case IROp::Ext8to32:
-		case IROp::Ext16to32:
-		case IROp::ReverseBits:
 		case IROp::BSwap16:
 		case IROp::BSwap32:
+		{
+			X64Reg target = gpr.dest.IsSimpleReg() ? gpr.dest.GetSimpleReg() : EAX;
+			if (!SameReg(R(target), gpr.src1))
+				MOV(32, R(target), gpr.src1);
+			switch (inst.op) {
+			case IROp::Neg: NEG(32, R(target)); break;
+			case IROp::Not: NOT(32, R(target)); break;
+			case IROp::BSwap32: BSWAP(32, target); break;
+			case IROp::BSwap16:
+				// Swapping all four bytes and rotating gives us each half swapped.
+				BSWAP(32, target);
+				ROR(32, R(target), Imm8(16));
+				break;
+			default: break;
+			}
+			finishTarget(gpr.dest, target);
+			break;
+		}
+
+		case IROp::Ext8to32:
+		case IROp::Ext16to32:
+		{
+			X64Reg target = gpr.dest.IsSimpleReg() ? gpr.dest.GetSimpleReg() : EAX;
+			MOVSX(32, inst.op == IROp::Ext8to32 ? 8 : 16, target, gpr.src1);
+			finishTarget(gpr.dest, target);
+			break;
+		}
+
 		case IROp::Clz:
-			if (inst->dest != inst->src1) {
-				code_->NEG(32, gpr.dest); break;
+		{
+			X64Reg target = gpr.dest.IsSimpleReg() ? gpr.dest.GetSimpleReg() : EAX;
+			if (cpu_info.bLZCNT) {
+				LZCNT(32, target, gpr.src1);
+			} else {
+				// BSR leaves the destination undefined for zero, so pick 63 (^ 31 = 32) in that case.
+				MOV(32, R(ECX), Imm32(63));
+				BSR(32, EDX, gpr.src1);
+				CMOVcc(32, EDX, R(ECX), CC_Z);
+				XOR(32, R(EDX), Imm8(31));
+				MOV(32, R(target), R(EDX));
 			}
+			finishTarget(gpr.dest, target);
 			break;
-				// Multiplier control
+		}
+
+			// Multiplier control
 		case IROp::MtLo:
+			MOV(32, R(EAX), gpr.src1);
+			MOV(32, IRSTATE_VAR(lo), R(EAX));
+			break;
 		case IROp::MtHi:
+			MOV(32, R(EAX), gpr.src1);
+			MOV(32, IRSTATE_VAR(hi), R(EAX));
+			break;
 		case IROp::MfLo:
+			MOV(32, R(EAX), IRSTATE_VAR(lo));
+			MOV(32, gpr.dest, R(EAX));
+			break;
 		case IROp::MfHi:
+			MOV(32, R(EAX), IRSTATE_VAR(hi));
+			MOV(32, gpr.dest, R(EAX));
+			break;
+
 		case IROp::Mult:
 		case IROp::MultU:
 		case IROp::Madd:
 		case IROp::MaddU:
 		case IROp::Msub:
 		case IROp::MsubU:
-		case IROp::Div:
-		case IROp::DivU:
+		{
+			bool isSigned = inst.op == IROp::Mult || inst.op == IROp::Madd || inst.op == IROp::Msub;
+			// lo and hi are next to each other, so we can treat them as one 64-bit value.
+			if (isSigned) {
+				MOVSX(64, 32, RAX, gpr.src1);
+				MOVSX(64, 32, RDX, gpr.src2);
+			} else {
+				MOV(32, R(EAX), gpr.src1);
+				MOV(32, R(EDX), gpr.src2);
+			}
+			IMUL(64, RAX, R(RDX));
+			if (inst.op == IROp::Madd || inst.op == IROp::MaddU) {
+				ADD(64, IRSTATE_VAR(lo), R(RAX));
+			} else if (inst.op == IROp::Msub || inst.op == IROp::MsubU) {
+				SUB(64, IRSTATE_VAR(lo), R(RAX));
+			} else {
+				MOV(64, IRSTATE_VAR(lo), R(RAX));
+			}
+			break;
+		}
 
 			// Memory access
 		case IROp::Load8:
@@ -176,124 +785,372 @@ void IRToX86::ConvertIRToNative(const IRInst *instructions, int count, const u32
 		case IROp::Load16:
 		case IROp::Load16Ext:
 		case IROp::Load32:
-		case IROp::LoadFloat:
+		{
+			OpArg addr = computeAddress(inst, gpr.src1);
+			X64Reg target = gpr.dest.IsSimpleReg() ? gpr.dest.GetSimpleReg() : EAX;
+			switch (inst.op) {
+			case IROp::Load8: MOVZX(32, 8, target, addr); break;
+			case IROp::Load8Ext: MOVSX(32, 8, target, addr); break;
+			case IROp::Load16: MOVZX(32, 16, target, addr); break;
+			case IROp::Load16Ext: MOVSX(32, 16, target, addr); break;
+			case IROp::Load32: MOV(32, R(target), addr); break;
+			default: break;
+			}
+			finishTarget(gpr.dest, target);
+			break;
+		}
+
 		case IROp::Store8:
 		case IROp::Store16:
 		case IROp::Store32:
+		{
+			// For stores, the value (src3) is in the dest slot.
+			OpArg value = gpr.dest;
+			if (!value.IsSimpleReg()) {
+				MOV(32, R(ECX), value);
+				value = R(ECX);
+			}
+			OpArg addr = computeAddress(inst, gpr.src1);
+			int bits = inst.op == IROp::Store8 ? 8 : (inst.op == IROp::Store16 ? 16 : 32);
+			MOV(bits, addr, value);
+			break;
+		}
+
+		case IROp::LoadFloat:
+			MOVSS(fpr.dest.GetSimpleReg(), computeAddress(inst, gpr.src1));
+			break;
 		case IROp::StoreFloat:
+			MOVSS(computeAddress(inst, gpr.src1), fpr.dest.GetSimpleReg());
+			break;
+
 		case IROp::LoadVec4:
+			MOVUPS(XMM0, computeAddress(inst, gpr.src1));
+			MOVAPS(fpr.dest, XMM0);
+			break;
 		case IROp::StoreVec4:
+			MOVAPS(XMM0, fpr.dest);
+			MOVUPS(computeAddress(inst, gpr.src1), XMM0);
+			break;
 
 			// Output-only SIMD functions
 		case IROp::Vec4Init:
+			MOVAPS(XMM0, M(consts->vec4Init[inst.src1]));
+			MOVAPS(fpr.dest, XMM0);
+			break;
 		case IROp::Vec4Shuffle:
+			MOVAPS(XMM0, fpr.src1);
+			SHUFPS(XMM0, R(XMM0), inst.src2);
+			MOVAPS(fpr.dest, XMM0);
+			break;
 
 			// 2-op SIMD functions
 		case IROp::Vec4Mov:
-			code_->MOVAPS(fpr.dest.GetSimpleReg(), fpr.src1);
+			MOVAPS(XMM0, fpr.src1);
+			MOVAPS(fpr.dest, XMM0);
 			break;
 		case IROp::Vec4Neg:
+			MOVAPS(XMM0, fpr.src1);
+			XORPS(XMM0, M(consts->signBits));
+			MOVAPS(fpr.dest, XMM0);
+			break;
 		case IROp::Vec4Abs:
+			MOVAPS(XMM0, fpr.src1);
+			ANDPS(XMM0, M(consts->noSignMask));
+			MOVAPS(fpr.dest, XMM0);
 			break;
 		case IROp::Vec4ClampToZero:
-			code_->PXOR(XMM0, R(XMM0));
-			code_->PMAXSW(XMM0, fpr.src1);
-			code_->MOVAPD(fpr.dest, XMM0);
+			// Expand the sign bit, and use andnot to zero negative values.
+			MOVDQA(XMM0, fpr.src1);
+			MOVDQA(XMM1, R(XMM0));
+			PSRAD(XMM1, 31);
+			PANDN(XMM1, R(XMM0));
+			MOVDQA(fpr.dest, XMM1);
 			break;
-		case IROp::Vec4DuplicateUpperBitsAndShift1:
-		case IROp::Vec2ClampToZero:
 
 			// 3-op SIMD functions
 		case IROp::Vec4Add:
 		case IROp::Vec4Sub:
-		case IROp::Vec4Mul:
 		case IROp::Vec4Div:
+			MOVAPS(XMM0, fpr.src1);
+			switch (inst.op) {
+			case IROp::Vec4Add: ADDPS(XMM0, fpr.src2); break;
+			case IROp::Vec4Sub: SUBPS(XMM0, fpr.src2); break;
+			case IROp::Vec4Div: DIVPS(XMM0, fpr.src2); break;
+			default: break;
+			}
+			MOVAPS(fpr.dest, XMM0);
+			break;
 
+		case IROp::Vec4Mul:
 		case IROp::Vec4Scale:
-		case IROp::Vec4Dot:
+			if (inst.op == IROp::Vec4Mul) {
+				MOVAPS(XMM0, fpr.src1);
+				MULPS(XMM0, fpr.src2);
+				MOVAPS(XMM1, fpr.src1);
+				CMPPS(XMM1, fpr.src2, CMP_ORD);
+			} else {
+				MOVAPS(XMM1, fpr.src2);
+				SHUFPS(XMM1, R(XMM1), 0);
+				MOVAPS(XMM0, fpr.src1);
+				MULPS(XMM0, R(XMM1));
+				CMPPS(XMM1, fpr.src1, CMP_ORD);
+			}
+			// Like FMul, inf * 0 lanes (NAN out of non-NAN inputs) need the PSP's positive NAN.
+			// The vector operands are always in memory, so dest holds the product meanwhile.
+			MOVAPS(fpr.dest, XMM0);
+			CMPPS(XMM0, R(XMM0), CMP_UNORD);
+			ANDPS(XMM1, R(XMM0));
+			MOVAPS(XMM0, R(XMM1));
+			ANDNPS(XMM0, fpr.dest);
+			ANDPS(XMM1, M(consts->positiveNAN));
+			ORPS(XMM0, R(XMM1));
+			MOVAPS(fpr.dest, XMM0);
+			break;
 
-			// Pack-unpack
-		case IROp::Vec2Unpack16To31:
-		case IROp::Vec2Unpack16To32:
-		case IROp::Vec4Unpack8To32:
-		case IROp::Vec2Pack32To16:
-		case IROp::Vec2Pack31To16:
-		case IROp::Vec4Pack32To8:
-		case IROp::Vec4Pack31To8:
-
-		case IROp::FCmpVfpuBit:
-		case IROp::FCmpVfpuAggregate:
-		case IROp::FCmovVfpuCC:
-
-			// Trancendental functions (non-simd)
-		case IROp::FSin:
-		case IROp::FCos:
-		case IROp::FRSqrt:
-		case IROp::FRecip:
-		case IROp::FAsin:
+		case IROp::Vec4Dot:
+			// Add in the same order as the interpreter, to get the same rounding.
+			MOVAPS(XMM1, fpr.src1);
+			MULPS(XMM1, fpr.src2);
+			MOVAPS(XMM0, R(XMM1));
+			for (int lane = 1; lane < 4; ++lane) {
+				SHUFPS(XMM1, R(XMM1), _MM_SHUFFLE(0, 3, 2, 1));
+				ADDSS(XMM0, R(XMM1));
+			}
+			MOVAPS(fpr.dest, XMM0);
+			break;
 
 			// 3-Op FP
 		case IROp::FAdd:
 		case IROp::FSub:
 		case IROp::FMul:
 		case IROp::FDiv:
-		case IROp::FMin:
-		case IROp::FMax:
+		{
+			X64Reg dest = fpr.dest.GetSimpleReg();
+			X64Reg target = SameReg(fpr.dest, fpr.src2) && !SameReg(fpr.dest, fpr.src1) ? XMM0 : dest;
+			// For FMul, check the inputs for NAN before target (possibly src1) is overwritten.
+			// Neither MOVAPS nor MULSS change the flags.
+			if (inst.op == IROp::FMul)
+				UCOMISS(fpr.src1.GetSimpleReg(), fpr.src2);
+			if (target != fpr.src1.GetSimpleReg())
+				MOVAPS(target, fpr.src1);
+			switch (inst.op) {
+			case IROp::FAdd: ADDSS(target, fpr.src2); break;
+			case IROp::FSub: SUBSS(target, fpr.src2); break;
+			case IROp::FMul: MULSS(target, fpr.src2); break;
+			case IROp::FDiv: DIVSS(target, fpr.src2); break;
+			default: break;
+			}
+			if (inst.op == IROp::FMul) {
+				// inf * 0 is a positive NAN on the PSP, but negative on x86.
+				// Only if the inputs were both non-NAN, since those NANs just get passed through.
+				FixupBranch inputNAN = J_CC(CC_P);
+				UCOMISS(target, R(target));
+				FixupBranch notNAN = J_CC(CC_NP);
+				MOV(32, R(EAX), Imm32(0x7FC00000));
+				MOVD_xmm(target, R(EAX));
+				SetJumpTarget(inputNAN);
+				SetJumpTarget(notNAN);
+			}
+			if (target != dest)
+				MOVAPS(dest, R(target));
+			break;
+		}
 
 			// 2-Op FP
 		case IROp::FMov:
+			if (!SameReg(fpr.dest, fpr.src1))
+				MOVAPS(fpr.dest.GetSimpleReg(), fpr.src1);
+			break;
 		case IROp::FAbs:
-		case IROp::FSqrt:
+			if (!SameReg(fpr.dest, fpr.src1))
+				MOVAPS(fpr.dest.GetSimpleReg(), fpr.src1);
+			ANDPS(fpr.dest.GetSimpleReg(), M(consts->noSignMask));
+			break;
 		case IROp::FNeg:
-		case IROp::FSat0_1:
-		case IROp::FSatMinus1_1:
-		case IROp::FSign:
-		case IROp::FCeil:
-		case IROp::FFloor:
-		case IROp::FCmp:
+			if (!SameReg(fpr.dest, fpr.src1))
+				MOVAPS(fpr.dest.GetSimpleReg(), fpr.src1);
+			XORPS(fpr.dest.GetSimpleReg(), M(consts->signBits));
+			break;
+		case IROp::FSqrt:
+			SQRTSS(fpr.dest.GetSimpleReg(), fpr.src1);
+			break;
+
 		case IROp::FCvtSW:
-		case IROp::FCvtWS:
-		case IROp::FRound:
-		case IROp::FTrunc:
+			MOVD_xmm(R(EAX), fpr.src1.GetSimpleReg());
+			CVTSI2SS(fpr.dest.GetSimpleReg(), R(EAX));
+			break;
+
+		case IROp::FCmp:
+		{
+			// Compare the same way around as the mode names, unless noted.
+			X64Reg lhs = fpr.src1.GetSimpleReg();
+			X64Reg rhs = fpr.src2.GetSimpleReg();
+			XOR(32, R(EAX), R(EAX));
+			switch (inst.dest) {
+			case IRFpCompareMode::False:
+				break;
+			case IRFpCompareMode::EitherUnordered:
+				UCOMISS(lhs, R(rhs));
+				SETcc(CC_P, R(EAX));
+				break;
+			case IRFpCompareMode::EqualOrdered:
+				UCOMISS(lhs, R(rhs));
+				SETcc(CC_E, R(EAX));
+				SETcc(CC_NP, R(ECX));
+				AND(8, R(EAX), R(ECX));
+				break;
+			case IRFpCompareMode::EqualUnordered:
+				UCOMISS(lhs, R(rhs));
+				SETcc(CC_E, R(EAX));
+				break;
+			case IRFpCompareMode::LessOrdered:
+				// Swapped: rhs > lhs, which is false when unordered.
+				UCOMISS(rhs, R(lhs));
+				SETcc(CC_A, R(EAX));
+				break;
+			case IRFpCompareMode::LessUnordered:
+				UCOMISS(lhs, R(rhs));
+				SETcc(CC_B, R(EAX));
+				break;
+			case IRFpCompareMode::LessEqualOrdered:
+				// Swapped: rhs >= lhs, which is false when unordered.
+				UCOMISS(rhs, R(lhs));
+				SETcc(CC_AE, R(EAX));
+				break;
+			case IRFpCompareMode::LessEqualUnordered:
+				UCOMISS(lhs, R(rhs));
+				SETcc(CC_BE, R(EAX));
+				break;
+			}
+			MOV(32, IRSTATE_VAR(fpcond), R(EAX));
+			break;
+		}
 
 			// Cross moves
 		case IROp::FMovFromGPR:
+			MOVD_xmm(fpr.dest.GetSimpleReg(), gpr.src1);
+			break;
 		case IROp::FMovToGPR:
+			MOVD_xmm(gpr.dest, fpr.src1.GetSimpleReg());
+			break;
 		case IROp::FpCondToReg:
+			MOV(32, R(EAX), IRSTATE_VAR(fpcond));
+			MOV(32, gpr.dest, R(EAX));
+			break;
 		case IROp::VfpuCtrlToReg:
+			MOV(32, R(EAX), IRGPRArg(IRREG_VFPU_CTRL_BASE + inst.src1));
+			MOV(32, gpr.dest, R(EAX));
+			break;
 
 			// VFPU flag/control
 		case IROp::SetCtrlVFPU:
+			MOV(32, IRGPRArg(IRREG_VFPU_CTRL_BASE + inst.dest), Imm32(inst.constant));
+			break;
 		case IROp::SetCtrlVFPUReg:
+			MOV(32, R(EAX), gpr.src1);
+			MOV(32, IRGPRArg(IRREG_VFPU_CTRL_BASE + inst.dest), R(EAX));
+			break;
 		case IROp::SetCtrlVFPUFReg:
+			MOVD_xmm(IRGPRArg(IRREG_VFPU_CTRL_BASE + inst.dest), fpr.src1.GetSimpleReg());
+			break;
 		case IROp::ZeroFpCond:
+			MOV(32, IRSTATE_VAR(fpcond), Imm32(0));
+			break;
+
+			// The interpreter doesn't implement these yet, so neither do we, to match.
+		case IROp::RestoreRoundingMode:
+		case IROp::ApplyRoundingMode:
+		case IROp::UpdateRoundingMode:
+			break;
 
 			// Block Exits
 		case IROp::ExitToConst:
+			exitToConst(inst.constant);
+			endedBlock = true;
+			break;
 		case IROp::ExitToReg:
+			MOV(32, R(EAX), gpr.src1);
+			exitToEAX();
+			endedBlock = true;
+			break;
+		case IROp::ExitToPC:
+			MOV(32, R(EAX), IRSTATE_VAR(pc));
+			exitToEAX();
+			endedBlock = true;
+			break;
+
 		case IROp::ExitToConstIfEq:
 		case IROp::ExitToConstIfNeq:
 		case IROp::ExitToConstIfGtZ:
 		case IROp::ExitToConstIfGeZ:
 		case IROp::ExitToConstIfLtZ:
 		case IROp::ExitToConstIfLeZ:
-		case IROp::ExitToPC:
+		{
+			// The constant is in the dest slot, and the registers are in src1/src2.
+			CCFlags skipCC;
+			if (inst.op == IROp::ExitToConstIfEq || inst.op == IROp::ExitToConstIfNeq) {
+				OpArg lhs = gpr.src1;
+				if (!lhs.IsSimpleReg() && !gpr.src2.IsSimpleReg()) {
+					MOV(32, R(ECX), lhs);
+					lhs = R(ECX);
+				}
+				CMP(32, lhs, gpr.src2);
+				skipCC = inst.op == IROp::ExitToConstIfEq ? CC_NE : CC_E;
+			} else {
+				CMP(32, gpr.src1, Imm8(0));
+				switch (inst.op) {
+				case IROp::ExitToConstIfGtZ: skipCC = CC_LE; break;
+				case IROp::ExitToConstIfGeZ: skipCC = CC_L; break;
+				case IROp::ExitToConstIfLtZ: skipCC = CC_GE; break;
+				default: skipCC = CC_G; break;
+				}
+			}
+			FixupBranch skip = J_CC(skipCC, true);
+			exitToConst(inst.constant);
+			SetJumpTarget(skip);
+			break;
+		}
+		case IROp::ExitToConstIfDowncountLtZ:
+		{
+			CMP(32, IRSTATE_VAR(downcount), Imm8(0));
+			FixupBranch skip = J_CC(CC_GE, true);
+			exitToConst(inst.constant);
+			SetJumpTarget(skip);
+			break;
+		}
 
 			// Utilities
 		case IROp::Downcount:
+			SUB(32, IRSTATE_VAR(downcount), Imm32(inst.constant));
+			break;
 		case IROp::SetPC:
+			MOV(32, R(EAX), gpr.src1);
+			MOV(32, IRSTATE_VAR(pc), R(EAX));
+			break;
 		case IROp::SetPCConst:
-		case IROp::Syscall:
-		case IROp::Interpret:  // SLOW fallback. Can be made faster.
-		case IROp::CallReplacement:
-		case IROp::Break:
+			MOV(32, IRSTATE_VAR(pc), Imm32(inst.constant));
+			break;
+
 		default:
+			// Division (for the edge cases), VFPU pack/compare ops, transcendentals, rounding
+			// conversions, syscalls, replacements, breakpoints, and memory validation.
+			fallback(inst);
+			// Break always returns a PC, so the fallback already exited.
+			endedBlock = inst.op == IROp::Break;
 			break;
-			}
 		}
+		regs.EndInst(i);
 	}
 
+	if (!endedBlock) {
+		// If we got here, the block was badly constructed.
+		INT3();
+	}
+
+	EndWrite();
+	return start;
+}
 
 }  // namespace
 
-#endif // PPSSPP_ARCH(X86) || PPSSPP_ARCH(AMD64)
+#endif // PPSSPP_ARCH(AMD64)
@@ -1,23 +1,49 @@
-#include "Core/MIPS/IR/IRInst.h"
+#pragma once
+
+#include "ppsspp_config.h"
 #include "Common/x64Emitter.h"
+#include "Core/MIPS/IR/IRInst.h"
+#include "Core/MIPS/IR/IRJit.h"
 
 namespace MIPSComp {
 
-class IRToNativeInterface {
+#if PPSSPP_ARCH(AMD64)
+
+// Translates blocks of IR (as produced by IRFrontend, after ThreeOpToTwoOp) to x86-64.
+// Blocks are entered through a small thunk and return the next PC, so IRJit still does the dispatching.
+class IRToX86 : public Gen::XCodeBlock, public IRToNativeInterface {
 public:
-	virtual ~IRToNativeInterface() {}
+	IRToX86(MIPSState *mipsState);
+	~IRToX86();
 
-	virtual void ConvertIRToNative(const IRInst *instructions, int count, const u32 *constants) = 0;
-};
+	const u8 *ConvertIRToNative(const IRInst *instructions, int count) override;
+	u32 RunBlock(const u8 *entry) override;
 
-
-class IRToX86 : public IRToNativeInterface {
-public:
-	void SetCodeBlock(Gen::XCodeBlock *code) { code_ = code; }
-	void ConvertIRToNative(const IRInst *instructions, int count, const u32 *constants) override;
+	void ClearCode() override;
+	bool IsFull() const override;
+	bool CodeInRange(const u8 *ptr) const override {
+		return IsInSpace(ptr);
+	}
+	const u8 *GetCrashHandler() const override {
+		return crashHandler_;
+	}
 
 private:
-	Gen::XCodeBlock *code_;
+	void GenerateFixedCode();
+
+	MIPSState *mips_;
+
+	typedef u32 (*EnterFunc)(const u8 *entry);
+	EnterFunc enterBlock_ = nullptr;
+	const u8 *exitBlock_ = nullptr;
+	const u8 *crashHandler_ = nullptr;
+
+	const u8 *constants_ = nullptr;
+	const u8 *endOfFixedCode_ = nullptr;
+	// Set when a block didn't fit, until the next ClearCode().
+	bool full_ = false;
 };
 
+#endif
+
 }  // namespace
@@ -0,0 +1,339 @@
+// Copyright (c) 2022- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include "ppsspp_config.h"
+#include <algorithm>
+#include <cstring>
+#include <zstd.h>
+
+#if PPSSPP_PLATFORM(WINDOWS)
+#if !PPSSPP_PLATFORM(UWP)
+#include "Common/CommonWindows.h"
+#endif
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "ext/xxhash.h"
+#include "Common/File/FileUtil.h"
+#include "Common/Log.h"
+#include "Common/StringUtils.h"
+#include "Core/ReplacementPack.h"
+
+static const u32 PACK_MAGIC = 0x50545050;  // PPTP
+static const u32 PACK_VERSION = 1;
+static const u64 PACK_ALIGN = 16;
+static const int PACK_COMPRESSION_LEVEL = 9;
+// Keeps w * h * 4 well within 64 bits.
+static const u32 PACK_MAX_IMAGE_SIZE = 0x10000;
+
+struct ReplacementPackHeader {
+	u32 magic;
+	u32 version;
+	u32 count;
+	u32 reserved;
+};
+
+static_assert(sizeof(ReplacementPack::Entry) == 32, "Pack entries are written as is");
+
+static const u8 *MapFile(const Path &filename, size_t *size) {
+#if PPSSPP_PLATFORM(WINDOWS) && !PPSSPP_PLATFORM(UWP)
+	HANDLE file = CreateFileW(filename.ToWString().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return nullptr;
+
+	const u8 *base = nullptr;
+	LARGE_INTEGER fileSize;
+	if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0 && (u64)fileSize.QuadPart <= (u64)SIZE_MAX) {
+		HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping) {
+			base = (const u8 *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			*size = (size_t)fileSize.QuadPart;
+			// The view keeps the file open.
+			CloseHandle(mapping);
+		}
+	}
+	CloseHandle(file);
+	return base;
+#elif PPSSPP_PLATFORM(WINDOWS)
+	return nullptr;
+#else
+	int fd = filename.Type() == PathType::CONTENT_URI ? File::OpenFD(filename, File::OPEN_READ) : open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		return nullptr;
+
+	const u8 *base = nullptr;
+	struct stat st;
+	if (fstat(fd, &st) == 0 && st.st_size > 0 && (u64)st.st_size <= (u64)SIZE_MAX) {
+		void *ptr = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		if (ptr != MAP_FAILED) {
+			base = (const u8 *)ptr;
+			*size = (size_t)st.st_size;
+		}
+	}
+	// The mapping keeps the file open.
+	close(fd);
+	return base;
+#endif
+}
+
+static void UnmapFile(const u8 *base, size_t size) {
+#if PPSSPP_PLATFORM(WINDOWS) && !PPSSPP_PLATFORM(UWP)
+	UnmapViewOfFile(base);
+#elif !PPSSPP_PLATFORM(WINDOWS)
+	munmap((void *)base, size);
+#endif
+}
+
+ReplacementPack::~ReplacementPack() {
+	if (base_ && !owned_)
+		UnmapFile(base_, size_);
+}
+
+static bool ValidEntryFormat(const ReplacementPack::Entry &entry) {
+	switch (entry.format) {
+	case ReplacementPack::Format::FILE:
+		return true;
+
+	case ReplacementPack::Format::RGBA8:
+	case ReplacementPack::Format::RGBA8_ZSTD:
+		break;
+
+	default:
+		return false;
+	}
+
+	if (entry.w == 0 || entry.h == 0 || entry.w > PACK_MAX_IMAGE_SIZE || entry.h > PACK_MAX_IMAGE_SIZE)
+		return false;
+	// Same limit as the writer, which also keeps the decoded size within a 32-bit size_t.
+	const u64 decodedSize = (u64)entry.w * entry.h * 4;
+	if (decodedSize > 0xFFFFFFFFULL)
+		return false;
+	// Uncompressed images get used straight from the pack, so they must be exactly the right size.
+	return entry.format != ReplacementPack::Format::RGBA8 || entry.size == decodedSize;
+}
+
+std::shared_ptr<ReplacementPack> ReplacementPack::Open(const Path &filename) {
+	std::shared_ptr<ReplacementPack> pack(new ReplacementPack());
+	pack->base_ = MapFile(filename, &pack->size_);
+	if (!pack->base_) {
+		// Some platforms can't map files, so just read it all in.
+		pack->owned_.reset(File::ReadLocalFile(filename, &pack->size_));
+		pack->base_ = pack->owned_.get();
+		if (!pack->base_)
+			return nullptr;
+	}
+
+	ReplacementPackHeader header;
+	if (pack->size_ < sizeof(header)) {
+		ERROR_LOG(G3D, "Texture pack too small: %s", filename.c_str());
+		return nullptr;
+	}
+	memcpy(&header, pack->base_, sizeof(header));
+	if (header.magic != PACK_MAGIC || header.version != PACK_VERSION) {
+		ERROR_LOG(G3D, "Unsupported texture pack: %s", filename.c_str());
+		return nullptr;
+	}
+	if (header.count > (pack->size_ - sizeof(header)) / sizeof(Entry)) {
+		ERROR_LOG(G3D, "Texture pack index truncated: %s", filename.c_str());
+		return nullptr;
+	}
+
+	pack->entries_ = (const Entry *)(pack->base_ + sizeof(header));
+	pack->count_ = header.count;
+
+	// Check everything once, so lookups can trust the index.
+	for (size_t i = 0; i < pack->count_; ++i) {
+		const Entry &entry = pack->entries_[i];
+		bool sorted = i == 0 || pack->entries_[i - 1].nameHash < entry.nameHash;
+		if (!sorted || entry.offset > pack->size_ || entry.size > pack->size_ - entry.offset || !ValidEntryFormat(entry)) {
+			ERROR_LOG(G3D, "Texture pack index damaged: %s", filename.c_str());
+			return nullptr;
+		}
+	}
+
+	INFO_LOG(G3D, "Opened texture pack with %d files: %s", (int)pack->count_, filename.c_str());
+	return pack;
+}
+
+u64 ReplacementPack::HashName(const std::string &name) {
+	std::string normalized = name;
+	for (char &c : normalized) {
+		if (c == '\\')
+			c = '/';
+		else if (c >= 'A' && c <= 'Z')
+			c = c - 'A' + 'a';
+	}
+	return XXH3_64bits(normalized.data(), normalized.size());
+}
+
+const ReplacementPack::Entry *ReplacementPack::Find(const std::string &name) const {
+	const u64 nameHash = HashName(name);
+	const Entry *end = entries_ + count_;
+	const Entry *entry = std::lower_bound(entries_, end, nameHash, [](const Entry &e, u64 h) {
+		return e.nameHash < h;
+	});
+	if (entry == end || entry->nameHash != nameHash)
+		return nullptr;
+	return entry;
+}
+
+bool ReplacementPack::ReadFile(const std::string &name, std::string *out) const {
+	const Entry *entry = Find(name);
+	if (!entry || entry->format != Format::FILE)
+		return false;
+	out->assign((const char *)Data(entry), entry->size);
+	return true;
+}
+
+bool ReplacementPack::Decode(const Entry *entry, u8 *out, int rowPitch) const {
+	const size_t rowSize = (size_t)entry->w * 4;
+	const size_t decodedSize = rowSize * entry->h;
+	const u8 *src = Data(entry);
+
+	std::unique_ptr<u8[]> temp;
+	if (entry->format == Format::RGBA8_ZSTD) {
+		if ((size_t)rowPitch == rowSize)
+			return ZSTD_decompress(out, decodedSize, src, entry->size) == decodedSize;
+
+		temp.reset(new u8[decodedSize]);
+		if (ZSTD_decompress(temp.get(), decodedSize, src, entry->size) != decodedSize)
+			return false;
+		src = temp.get();
+	} else if (entry->format != Format::RGBA8 || entry->size != decodedSize) {
+		return false;
+	}
+
+	for (u32 y = 0; y < entry->h; ++y)
+		memcpy(out + rowPitch * y, src + rowSize * y, rowSize);
+	return true;
+}
+
+ReplacementPackWriter::~ReplacementPackWriter() {
+	if (fp_) {
+		fclose(fp_);
+		File::Delete(filename_.WithReplacedExtension(".tmp"));
+	}
+}
+
+bool ReplacementPackWriter::Begin(const Path &filename, size_t maxCount) {
+	filename_ = filename;
+	maxCount_ = maxCount;
+	entries_.clear();
+	entries_.reserve(maxCount);
+
+	// Write to a temporary, so a partial pack is never used.
+	fp_ = File::OpenCFile(filename_.WithReplacedExtension(".tmp"), "wb");
+	if (!fp_)
+		return false;
+
+	// Zeros for now, the header and index are written at the end.
+	pos_ = sizeof(ReplacementPackHeader) + maxCount * sizeof(ReplacementPack::Entry);
+	std::vector<u8> zeros((size_t)pos_);
+	return fwrite(zeros.data(), 1, zeros.size(), fp_) == zeros.size();
+}
+
+bool ReplacementPackWriter::AddFile(const std::string &name, const void *data, size_t size) {
+	ReplacementPack::Entry entry{};
+	entry.format = ReplacementPack::Format::FILE;
+	entry.size = (u32)size;
+	return Add(name, entry, data);
+}
+
+bool ReplacementPackWriter::AddImage(const std::string &name, const u8 *rgba, int w, int h, u8 alpha) {
+	// Open() would reject the whole pack otherwise.  The uncompressed size must fit an entry, too.
+	if (w <= 0 || h <= 0 || (u32)w > PACK_MAX_IMAGE_SIZE || (u32)h > PACK_MAX_IMAGE_SIZE || (u64)w * h * 4 > 0xFFFFFFFFULL) {
+		ERROR_LOG(G3D, "Texture too large for texture pack: %s", name.c_str());
+		return false;
+	}
+
+	ReplacementPack::Entry entry{};
+	entry.w = w;
+	entry.h = h;
+	entry.alpha = alpha;
+
+	const size_t size = (size_t)w * h * 4;
+	std::vector<u8> compressed(ZSTD_compressBound(size));
+	size_t compressedSize = ZSTD_compress(compressed.data(), compressed.size(), rgba, size, PACK_COMPRESSION_LEVEL);
+	// Not worth decompressing if it barely helps.
+	if (!ZSTD_isError(compressedSize) && compressedSize < size - size / 8) {
+		entry.format = ReplacementPack::Format::RGBA8_ZSTD;
+		entry.size = (u32)compressedSize;
+		return Add(name, entry, compressed.data());
+	}
+
+	entry.format = ReplacementPack::Format::RGBA8;
+	entry.size = (u32)size;
+	return Add(name, entry, rgba);
+}
+
+bool ReplacementPackWriter::Add(const std::string &name, ReplacementPack::Entry entry, const void *data) {
+	std::lock_guard<std::mutex> guard(lock_);
+	if (!fp_ || entries_.size() >= maxCount_)
+		return false;
+
+	static const u8 zeros[PACK_ALIGN]{};
+	const size_t padding = (size_t)((PACK_ALIGN - (pos_ & (PACK_ALIGN - 1))) & (PACK_ALIGN - 1));
+	if (fwrite(zeros, 1, padding, fp_) != padding || fwrite(data, 1, entry.size, fp_) != entry.size) {
+		ERROR_LOG(G3D, "Failed to write %s to texture pack", name.c_str());
+		return false;
+	}
+
+	entry.nameHash = ReplacementPack::HashName(name);
+	entry.offset = pos_ + padding;
+	pos_ = entry.offset + entry.size;
+	entries_.push_back(entry);
+	return true;
+}
+
+bool ReplacementPackWriter::Finish() {
+	if (!fp_)
+		return false;
+
+	std::stable_sort(entries_.begin(), entries_.end(), [](const ReplacementPack::Entry &a, const ReplacementPack::Entry &b) {
+		return a.nameHash < b.nameHash;
+	});
+	// Names differing only by case are the same file.  Hash collisions are unlikely enough to ignore.
+	auto dupes = std::unique(entries_.begin(), entries_.end(), [](const ReplacementPack::Entry &a, const ReplacementPack::Entry &b) {
+		return a.nameHash == b.nameHash;
+	});
+	if (dupes != entries_.end()) {
+		WARN_LOG(G3D, "Texture pack: ignoring %d files with duplicate names", (int)(entries_.end() - dupes));
+		entries_.erase(dupes, entries_.end());
+	}
+
+	ReplacementPackHeader header{ PACK_MAGIC, PACK_VERSION, (u32)entries_.size() };
+	bool success = fseek(fp_, 0, SEEK_SET) == 0;
+	success = success && fwrite(&header, sizeof(header), 1, fp_) == 1;
+	success = success && fwrite(entries_.data(), sizeof(ReplacementPack::Entry), entries_.size(), fp_) == entries_.size();
+	success = fclose(fp_) == 0 && success;
+	fp_ = nullptr;
+
+	// Renaming won't replace an existing file on Windows or with content URIs.
+	const Path tempFilename = filename_.WithReplacedExtension(".tmp");
+	if (success && File::Exists(filename_))
+		success = File::Delete(filename_);
+	if (!success || !File::Rename(tempFilename, filename_)) {
+		ERROR_LOG(G3D, "Failed to write texture pack: %s", filename_.c_str());
+		File::Delete(tempFilename);
+		return false;
+	}
+	return true;
+}
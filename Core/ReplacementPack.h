@@ -0,0 +1,103 @@
+// Copyright (c) 2022- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/File/Path.h"
+
+// A texture replacement folder in a single file, used through a memory map.  A sorted index of
+// name hashes comes first, so finding a file is a binary search.  Images are stored already decoded
+// to RGBA8, zstd compressed if that helps, so loading one is at most a decompress.
+class ReplacementPack {
+public:
+	enum class Format : u8 {
+		// Anything else, like textures.ini, stored as is.
+		FILE = 0,
+		RGBA8 = 1,
+		RGBA8_ZSTD = 2,
+	};
+
+	struct Entry {
+		u64 nameHash;
+		u64 offset;
+		u32 size;
+		u32 w;
+		u32 h;
+		Format format;
+		// A ReplacedTextureAlpha value.
+		u8 alpha;
+		u16 reserved;
+	};
+
+	~ReplacementPack();
+
+	static std::shared_ptr<ReplacementPack> Open(const Path &filename);
+	// Names are relative to the textures folder, and case insensitive like in textures.zip.
+	static u64 HashName(const std::string &name);
+
+	const Entry *Find(const std::string &name) const;
+	const u8 *Data(const Entry *entry) const {
+		return base_ + entry->offset;
+	}
+	bool ReadFile(const std::string &name, std::string *out) const;
+	// Writes an image entry as RGBA8, with rowPitch bytes between rows.
+	bool Decode(const Entry *entry, u8 *out, int rowPitch) const;
+
+private:
+	ReplacementPack() {}
+
+	const u8 *base_ = nullptr;
+	size_t size_ = 0;
+	const Entry *entries_ = nullptr;
+	size_t count_ = 0;
+	// Only when we couldn't map the file.
+	std::unique_ptr<u8[]> owned_;
+};
+
+// Writes data as it comes, so only the index has to be kept in memory.
+class ReplacementPackWriter {
+public:
+	~ReplacementPackWriter();
+
+	// Reserves space for the index, so this needs to know the most files that will be added.
+	bool Begin(const Path &filename, size_t maxCount);
+	// These are thread safe, so images can be compressed in parallel.
+	bool AddFile(const std::string &name, const void *data, size_t size);
+	bool AddImage(const std::string &name, const u8 *rgba, int w, int h, u8 alpha);
+	bool Finish();
+
+	size_t Count() const {
+		return entries_.size();
+	}
+
+private:
+	bool Add(const std::string &name, ReplacementPack::Entry entry, const void *data);
+
+	FILE *fp_ = nullptr;
+	Path filename_;
+	std::mutex lock_;
+	std::vector<ReplacementPack::Entry> entries_;
+	size_t maxCount_ = 0;
+	u64 pos_ = 0;
+};
@@ -34,6 +34,7 @@
 #include "Common/Data/Format/ZIMLoad.h"
 #include "Common/Data/Text/I18n.h"
 #include "Common/Data/Text/Parsers.h"
+#include "Common/File/DirListing.h"
 #include "Common/File/FileUtil.h"
 #include "Common/StringUtils.h"
 #include "Common/Thread/ParallelLoop.h"
@@ -50,6 +51,9 @@
 
 static const std::string INI_FILENAME = "textures.ini";
 static const std::string ZIP_FILENAME = "textures.zip";
+static const std::string PACK_FILENAME = "textures.ppk";
+// Where GeneratePack() writes, since textures.ppk may still be mapped.
+static const std::string NEW_PACK_FILENAME = "textures.new.ppk";
 static const std::string NEW_TEXTURE_DIR = "new/";
 static const int VERSION = 1;
 static const int MAX_MIP_LEVELS = 12;  // 12 should be plenty, 8 is the max mip levels supported by the PSP.
@@ -90,6 +94,7 @@ void TextureReplacer::NotifyConfigChanged() {
 		if (zip_)
 			zip_close(zip_);
 		zip_ = nullptr;
+		pack_.reset();
 		Decimate(ReplacerDecimateMode::ALL);
 	}
 
@@ -98,6 +103,31 @@ void TextureReplacer::NotifyConfigChanged() {
 	}
 }
 
+void TextureReplacer::NotifyTextureCacheCleared() {
+	if (!newPackPending_)
+		return;
+
+	// Waits for any replacements still loading.
+	cache_.clear();
+	levelCache_.clear();
+	if (enabled_)
+		enabled_ = LoadIni();
+}
+
+bool TextureReplacer::InstallNewPack() {
+	// Windows won't rename over an existing file, and neither will content URIs.
+	const Path packFilename = basePath_ / PACK_FILENAME;
+	if (File::Exists(packFilename) && !File::Delete(packFilename)) {
+		ERROR_LOG(G3D, "Could not replace texture pack: %s", packFilename.c_str());
+		return false;
+	}
+	if (!File::Rename(basePath_ / NEW_PACK_FILENAME, packFilename)) {
+		ERROR_LOG(G3D, "Could not install new texture pack: %s", packFilename.c_str());
+		return false;
+	}
+	return true;
+}
+
 static struct zip *ZipOpenPath(Path fileName) {
 	int error = 0;
 	if (fileName.Type() == PathType::CONTENT_URI) {
@@ -136,6 +166,15 @@ static bool LoadIniZip(IniFile &ini, zip *z, const std::string &filename) {
 	return ini.Load(sstream);
 }
 
+static bool LoadIniPack(IniFile &ini, const ReplacementPack &pack, const std::string &filename) {
+	std::string inistr;
+	if (!pack.ReadFile(filename, &inistr))
+		return false;
+
+	std::stringstream sstream(inistr);
+	return ini.Load(sstream);
+}
+
 bool TextureReplacer::LoadIni() {
 	// TODO: Use crc32c?
 	hash_ = ReplacedTextureHash::QUICK;
@@ -154,12 +193,32 @@ bool TextureReplacer::LoadIni() {
 	if (zip_)
 		zip_close(zip_);
 	zip_ = nullptr;
+	pack_.reset();
+
+	// Cached levels keep the old pack mapped, so a new one has to wait until those are gone.
+	newPackPending_ = false;
+	if (File::Exists(basePath_ / NEW_PACK_FILENAME)) {
+		if (cache_.empty() && levelCache_.empty())
+			InstallNewPack();
+		else
+			newPackPending_ = true;
+	}
 
 	IniFile ini;
 	bool iniLoaded = false;
 
-	// First, check for textures.zip, which is used to reduce IO.
-	zip *z = ZipOpenPath(basePath_ / ZIP_FILENAME);
+	// Prefer textures.ppk, which has everything ready to use.
+	const Path packFilename = basePath_ / PACK_FILENAME;
+	if (File::Exists(packFilename)) {
+		pack_ = ReplacementPack::Open(packFilename);
+		if (pack_) {
+			// The ini is optional here, since the pack has all the files.
+			iniLoaded = LoadIniPack(ini, *pack_, INI_FILENAME);
+		}
+	}
+
+	// Otherwise, check for textures.zip, which is used to reduce IO.
+	zip *z = pack_ ? nullptr : ZipOpenPath(basePath_ / ZIP_FILENAME);
 	if (z) {
 		iniLoaded = LoadIniZip(ini, z, INI_FILENAME);
 		// Require the zip have textures.ini to use it.
@@ -172,7 +231,7 @@ bool TextureReplacer::LoadIni() {
 		}
 	}
 
-	if (!iniLoaded) {
+	if (!iniLoaded && !pack_) {
 		iniLoaded = ini.LoadFromVFS((basePath_ / INI_FILENAME).ToString());
 	}
 
@@ -186,7 +245,9 @@ bool TextureReplacer::LoadIni() {
 		if (ini.GetOrCreateSection("games")->Get(gameID_.c_str(), &overrideFilename, "")) {
 			if (!overrideFilename.empty() && overrideFilename != INI_FILENAME) {
 				IniFile overrideIni;
-				if (zip_)
+				if (pack_)
+					iniLoaded = LoadIniPack(overrideIni, *pack_, overrideFilename);
+				else if (zip_)
 					iniLoaded = LoadIniZip(overrideIni, zip_, overrideFilename);
 				else
 					iniLoaded = overrideIni.LoadFromVFS((basePath_ / overrideFilename).ToString());
@@ -500,7 +561,9 @@ void TextureReplacer::PopulateReplacement(ReplacedTexture *result, u64 cachekey,
 
 		bool good;
 		bool logError = hashfile != HashName(cachekey, hash, i) + ".png";
-		if (zip_) {
+		if (pack_) {
+			good = PopulateLevelFromPack(level, hashfile, !logError);
+		} else if (zip_) {
 			level.z = zip_;
 			level.zi = zip_name_locate(zip_, hashfile.c_str(), ZIP_FL_NOCASE);
 			good = PopulateLevelFromZip(level, !logError);
@@ -662,6 +725,27 @@ bool TextureReplacer::PopulateLevelFromZip(ReplacedTextureLevel &level, bool ign
 	return good;
 }
 
+bool TextureReplacer::PopulateLevelFromPack(ReplacedTextureLevel &level, const std::string &hashfile, bool ignoreError) {
+	const ReplacementPack::Entry *entry = pack_->Find(hashfile);
+	if (!entry || entry->format == ReplacementPack::Format::FILE) {
+		if (!ignoreError)
+			ERROR_LOG(G3D, "Error opening replacement texture file '%s' in textures.ppk", hashfile.c_str());
+		return false;
+	}
+
+	level.w = entry->w;
+	level.h = entry->h;
+	level.pack = pack_;
+	level.packEntry = entry;
+	return true;
+}
+
+// Uncompressed and not padded, so Load() can copy straight from the pack.  Open() checked the size.
+static bool IsPackDirect(const ReplacedTextureLevel &info) {
+	const ReplacementPack::Entry *entry = info.packEntry;
+	return entry && entry->format == ReplacementPack::Format::RGBA8 && entry->w == (u32)info.w && entry->h == (u32)info.h;
+}
+
 static bool WriteTextureToPNG(png_imagep image, const Path &filename, int convert_to_8bit, const void *buffer, png_int_32 row_stride, const void *colormap) {
 	FILE *fp = File::OpenCFile(filename, "wb");
 	if (!fp) {
@@ -1064,6 +1148,30 @@ void ReplacedTexture::PrepareData(int level) {
 	if (!out.empty())
 		return;
 
+	if (info.packEntry) {
+		const ReplacementPack::Entry *entry = info.packEntry;
+		if (!IsPackDirect(info)) {
+			// Any padding for hashranges is left zero.
+			out.resize(info.w * info.h * 4);
+			if (entry->w > (u32)info.w || entry->h > (u32)info.h || !info.pack->Decode(entry, &out[0], info.w * 4)) {
+				ERROR_LOG(G3D, "Could not load texture replacement: %s - bad data in textures.ppk", info.file.c_str());
+				out.clear();
+				return;
+			}
+		} else {
+			// Fault it in now, rather than during upload.
+			const volatile u8 *data = info.pack->Data(entry);
+			for (u32 i = 0; i < entry->size; i += 4096)
+				data[i];
+		}
+
+		// The pack already checked the alpha.
+		if (entry->alpha == CHECKALPHA_ANY || level == 0) {
+			alphaStatus_ = ReplacedTextureAlpha(entry->alpha);
+		}
+		return;
+	}
+
 	FILE *fp = nullptr;
 	zip_file_t *zf = nullptr;
 	ReplacedImageType imageType;
@@ -1260,17 +1368,23 @@ bool ReplacedTexture::Load(int level, void *out, int rowPitch) {
 	const ReplacedTextureLevel &info = levels_[level];
 	const std::vector<uint8_t> &data = levelData_[level]->data;
 
-	if (data.empty())
+	const uint8_t *src = nullptr;
+	if (IsPackDirect(info)) {
+		src = info.pack->Data(info.packEntry);
+	} else if (!data.empty()) {
+		_assert_msg_(data.size() == info.w * info.h * 4, "Data has wrong size");
+		src = &data[0];
+	} else {
 		return false;
-	_assert_msg_(data.size() == info.w * info.h * 4, "Data has wrong size");
+	}
 
 	if (rowPitch == info.w * 4) {
-		ParallelMemcpy(&g_threadManager, out, &data[0], info.w * 4 * info.h);
+		ParallelMemcpy(&g_threadManager, out, src, info.w * 4 * info.h);
 	} else {
 		const int MIN_LINES_PER_THREAD = 4;
 		ParallelRangeLoop(&g_threadManager, [&](int l, int h) {
 			for (int y = l; y < h; ++y) {
-				memcpy((uint8_t *)out + rowPitch * y, &data[0] + info.w * 4 * y, info.w * 4);
+				memcpy((uint8_t *)out + rowPitch * y, src + info.w * 4 * y, info.w * 4);
 			}
 		}, 0, info.h, MIN_LINES_PER_THREAD);
 	}
@@ -1331,3 +1445,106 @@ bool TextureReplacer::GenerateIni(const std::string &gameID, Path &generatedFile
 	}
 	return File::Exists(generatedFilename);
 }
+
+static void ListPackFiles(const Path &dir, const std::string &prefix, std::vector<std::string> &names) {
+	std::vector<File::FileInfo> files;
+	File::GetFilesInDir(dir, &files);
+	for (const auto &info : files) {
+		const std::string name = prefix + info.name;
+		if (info.isDirectory) {
+			// Textures being dumped aren't part of the pack.
+			if (prefix.empty() && name + "/" == NEW_TEXTURE_DIR)
+				continue;
+			ListPackFiles(info.fullName, name + "/", names);
+			continue;
+		}
+
+		const std::string ext = info.fullName.GetFileExtension();
+		if (ext == ".png" || ext == ".zim" || ext == ".ini")
+			names.push_back(name);
+	}
+}
+
+// Returns false only if writing failed.  Images that can't be read are skipped, as they wouldn't load anyway.
+static bool AddPackFile(ReplacementPackWriter &writer, const Path &dir, const std::string &name) {
+	const Path filename = dir / name;
+	size_t size = 0;
+	std::unique_ptr<uint8_t[]> data(File::ReadLocalFile(filename, &size));
+	if (!data) {
+		WARN_LOG(G3D, "Texture pack: could not read %s", filename.c_str());
+		return true;
+	}
+
+	ReplacedImageType imageType = size >= 4 ? Identify(data.get()) : ReplacedImageType::INVALID;
+	if (imageType == ReplacedImageType::ZIM) {
+		int w, h, flags;
+		uint8_t *image = nullptr;
+		if (!LoadZIMPtr(data.get(), size, &w, &h, &flags, &image) || (flags & ZIM_FORMAT_MASK) != ZIM_RGBA8888) {
+			free(image);
+			WARN_LOG(G3D, "Texture pack: unsupported ZIM %s", filename.c_str());
+			return true;
+		}
+
+		CheckAlphaResult alpha = CheckAlpha32Rect((const u32 *)image, w, w, h, 0xFF000000);
+		bool success = writer.AddImage(name, image, w, h, (u8)alpha);
+		free(image);
+		return success;
+	} else if (imageType == ReplacedImageType::PNG) {
+		png_image png = {};
+		png.version = PNG_IMAGE_VERSION;
+		if (!png_image_begin_read_from_memory(&png, data.get(), size)) {
+			WARN_LOG(G3D, "Texture pack: could not load %s - %s", filename.c_str(), png.message);
+			return true;
+		}
+
+		const bool hasAlpha = (png.format & PNG_FORMAT_FLAG_ALPHA) != 0;
+		png.format = PNG_FORMAT_RGBA;
+		std::vector<uint8_t> image(png.width * png.height * 4);
+		if (!png_image_finish_read(&png, nullptr, &image[0], png.width * 4, nullptr)) {
+			WARN_LOG(G3D, "Texture pack: could not load %s - %s", filename.c_str(), png.message);
+			png_image_free(&png);
+			return true;
+		}
+		png_image_free(&png);
+
+		CheckAlphaResult alpha = hasAlpha ? CheckAlpha32Rect((const u32 *)&image[0], png.width, png.width, png.height, 0xFF000000) : CHECKALPHA_FULL;
+		return writer.AddImage(name, &image[0], png.width, png.height, (u8)alpha);
+	} else if (name.size() > 4 && strcasecmp(name.c_str() + name.size() - 4, ".ini") == 0) {
+		return writer.AddFile(name, data.get(), size);
+	}
+
+	WARN_LOG(G3D, "Texture pack: unsupported format %s", filename.c_str());
+	return true;
+}
+
+bool TextureReplacer::GeneratePack(const std::string &gameID, Path &generatedFilename) {
+	if (gameID.empty())
+		return false;
+
+	Path texturesDirectory = GetSysDirectory(DIRECTORY_TEXTURES) / gameID;
+	std::vector<std::string> names;
+	ListPackFiles(texturesDirectory, "", names);
+	if (names.empty())
+		return false;
+
+	// The running game may have the current pack mapped, so this gets swapped in on the next reload.
+	generatedFilename = texturesDirectory / PACK_FILENAME;
+	ReplacementPackWriter writer;
+	if (!writer.Begin(texturesDirectory / NEW_PACK_FILENAME, names.size()))
+		return false;
+
+	// Decoding and compressing dominate, so spread them out.  The writer keeps order irrelevant.
+	std::atomic<bool> failed{};
+	ParallelRangeLoop(&g_threadManager, [&](int l, int h) {
+		for (int i = l; i < h && !failed; ++i) {
+			if (!AddPackFile(writer, texturesDirectory, names[i]))
+				failed = true;
+		}
+	}, 0, (int)names.size(), 1);
+
+	if (failed || !writer.Finish())
+		return false;
+
+	NOTICE_LOG(G3D, "Created texture pack with %d of %d files: %s", (int)writer.Count(), (int)names.size(), (texturesDirectory / NEW_PACK_FILENAME).c_str());
+	return true;
+}
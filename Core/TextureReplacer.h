@@ -18,6 +18,7 @@
 #pragma once
 
 #include "ppsspp_config.h"
+#include <memory>
 #include <mutex>
 #include <string>
 #include <unordered_map>
@@ -29,6 +30,7 @@
 #include "Common/File/Path.h"
 #include "Common/GPU/DataFormat.h"
 
+#include "Core/ReplacementPack.h"
 #include "GPU/Common/TextureDecoder.h"
 #include "GPU/ge_constants.h"
 
@@ -61,6 +63,9 @@ struct ReplacedTextureLevel {
 	// To be able to reload, we need to be able to reopen, unfortunate we can't use zip_file_t.
 	zip *z = nullptr;
 	int64_t zi = -1;
+	// Or from textures.ppk, which stays mapped while any level uses it.
+	std::shared_ptr<ReplacementPack> pack;
+	const ReplacementPack::Entry *packEntry = nullptr;
 
 	bool operator ==(const ReplacedTextureLevel &other) const {
 		if (w != other.w || h != other.h || fmt != other.fmt)
@@ -240,6 +245,8 @@ class TextureReplacer {
 
 	void Init();
 	void NotifyConfigChanged();
+	// Call once nothing refers to a ReplacedTexture anymore.  Lets a newly generated pack replace the old one.
+	void NotifyTextureCacheCleared();
 
 	inline bool Enabled() {
 		return enabled_;
@@ -262,6 +269,8 @@ class TextureReplacer {
 	void Decimate(ReplacerDecimateMode mode);
 
 	static bool GenerateIni(const std::string &gameID, Path &generatedFilename);
+	// Converts textures.ini and the images in the game's folder into textures.ppk.
+	static bool GeneratePack(const std::string &gameID, Path &generatedFilename);
 	static bool IniExists(const std::string &gameID);
 
 protected:
@@ -277,6 +286,8 @@ class TextureReplacer {
 	void PopulateReplacement(ReplacedTexture *result, u64 cachekey, u32 hash, int w, int h);
 	bool PopulateLevelFromPath(ReplacedTextureLevel &level, bool ignoreError);
 	bool PopulateLevelFromZip(ReplacedTextureLevel &level, bool ignoreError);
+	bool PopulateLevelFromPack(ReplacedTextureLevel &level, const std::string &hashfile, bool ignoreError);
+	bool InstallNewPack();
 
 	bool enabled_ = false;
 	bool allowVideo_ = false;
@@ -290,6 +301,9 @@ class TextureReplacer {
 	Path basePath_;
 	ReplacedTextureHash hash_ = ReplacedTextureHash::QUICK;
 	zip *zip_ = nullptr;
+	std::shared_ptr<ReplacementPack> pack_;
+	// A new pack is waiting for the old one to be unused.
+	bool newPackPending_ = false;
 
 	typedef std::pair<int, int> WidthHeightPair;
 	std::unordered_map<u64, WidthHeightPair> hashranges_;
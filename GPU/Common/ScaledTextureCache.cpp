@@ -0,0 +1,291 @@
+// Copyright (c) 2022- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <zstd.h>
+
+#include "ext/xxhash.h"
+#include "Common/File/DirListing.h"
+#include "Common/File/FileUtil.h"
+#include "Common/Log.h"
+#include "Common/StringUtils.h"
+#include "Common/Thread/ThreadManager.h"
+#include "Core/Config.h"
+#include "Core/System.h"
+#include "Core/ThreadPools.h"
+#include "GPU/Common/ScaledTextureCache.h"
+
+static const u32 SCALED_MAGIC = 0x54534350;  // PCST
+// Bump if the scalers change their output.
+static const u32 SCALED_VERSION = 1;
+static const int SCALED_COMPRESSION_LEVEL = 6;
+
+struct ScaledTextureHeader {
+	u32 magic;
+	u32 version;
+	u32 width;
+	u32 height;
+	u64 key;
+};
+
+struct ScaledTextureCache::Index {
+	struct File {
+		uint64_t size;
+		uint64_t lastUsed;
+		// Still being written, so not found yet.
+		bool pending;
+	};
+
+	std::mutex lock;
+	std::unordered_map<uint64_t, File> files;
+	uint64_t totalSize = 0;
+	bool scanned = false;
+	Path dir;
+
+	Path Filename(uint64_t key) const {
+		return dir / StringFromFormat("%016llx.ppst", (unsigned long long)key);
+	}
+
+	// Call with the lock held, returns files to delete after unlocking.
+	std::vector<uint64_t> Evict(uint64_t maxSize) {
+		std::vector<uint64_t> evicted;
+		if (totalSize <= maxSize)
+			return evicted;
+
+		std::vector<std::pair<uint64_t, uint64_t>> byAge;
+		for (const auto &it : files) {
+			if (!it.second.pending)
+				byAge.push_back(std::make_pair(it.second.lastUsed, it.first));
+		}
+		std::sort(byAge.begin(), byAge.end());
+
+		// Go a bit under, so we don't do this again on the next write.
+		const uint64_t target = maxSize - maxSize / 8;
+		for (const auto &it : byAge) {
+			if (totalSize <= target)
+				break;
+			auto file = files.find(it.second);
+			totalSize -= file->second.size;
+			files.erase(file);
+			evicted.push_back(it.second);
+		}
+		return evicted;
+	}
+};
+
+static uint64_t MaxCacheSize() {
+	return (uint64_t)std::max(g_Config.iTexScalingDiskCacheMB, 1) * 1024 * 1024;
+}
+
+class ScaledTextureScanTask : public Task {
+public:
+	ScaledTextureScanTask(const std::shared_ptr<ScaledTextureCache::Index> &index) : index_(index) {}
+
+	TaskType Type() const override {
+		return TaskType::IO_BLOCKING;
+	}
+
+	void Run() override {
+		std::vector<File::FileInfo> files;
+		File::GetFilesInDir(index_->dir, &files, "ppst:tmp:");
+
+		// Nothing is saved until the scan is done, so any temporaries are left from a crash.
+		int tempCount = 0;
+		for (const auto &info : files) {
+			if (endsWithNoCase(info.name, ".tmp")) {
+				File::Delete(info.fullName);
+				tempCount++;
+			}
+		}
+
+		std::vector<uint64_t> evicted;
+		{
+			std::lock_guard<std::mutex> guard(index_->lock);
+			for (const auto &info : files) {
+				if (endsWithNoCase(info.name, ".tmp"))
+					continue;
+				uint64_t key = strtoull(info.name.c_str(), nullptr, 16);
+				// Not everyone has access times, so take whichever is newer.
+				index_->files[key] = { info.size, std::max(info.atime, info.mtime), false };
+				index_->totalSize += info.size;
+			}
+			// The cap might have been lowered.
+			evicted = index_->Evict(MaxCacheSize());
+			index_->scanned = true;
+		}
+		for (uint64_t key : evicted)
+			File::Delete(index_->Filename(key));
+
+		INFO_LOG(G3D, "Scaled texture cache: %d files, %d MB", (int)files.size() - tempCount, (int)(index_->totalSize / (1024 * 1024)));
+	}
+
+private:
+	std::shared_ptr<ScaledTextureCache::Index> index_;
+};
+
+class ScaledTextureSaveTask : public Task {
+public:
+	ScaledTextureSaveTask(const std::shared_ptr<ScaledTextureCache::Index> &index, uint64_t key, const u32 *scaled, int w, int h)
+		: index_(index), key_(key), data_(scaled, scaled + w * h), w_(w), h_(h) {}
+
+	TaskType Type() const override {
+		return TaskType::CPU_COMPUTE;  // Also I/O blocking but dominated by compute
+	}
+
+	void Run() override {
+		uint64_t size = Write();
+
+		std::vector<uint64_t> evicted;
+		{
+			std::lock_guard<std::mutex> guard(index_->lock);
+			auto file = index_->files.find(key_);
+			if (file == index_->files.end())
+				return;
+			if (size == 0) {
+				index_->files.erase(file);
+				return;
+			}
+
+			file->second.size = size;
+			file->second.pending = false;
+			index_->totalSize += size;
+			evicted = index_->Evict(MaxCacheSize());
+		}
+		for (uint64_t key : evicted)
+			File::Delete(index_->Filename(key));
+	}
+
+private:
+	uint64_t Write() {
+		const size_t srcSize = data_.size() * sizeof(u32);
+		std::vector<u8> buf(sizeof(ScaledTextureHeader) + ZSTD_compressBound(srcSize));
+
+		ScaledTextureHeader header{ SCALED_MAGIC, SCALED_VERSION, (u32)w_, (u32)h_, key_ };
+		memcpy(buf.data(), &header, sizeof(header));
+		size_t compressedSize = ZSTD_compress(buf.data() + sizeof(header), buf.size() - sizeof(header), data_.data(), srcSize, SCALED_COMPRESSION_LEVEL);
+		if (ZSTD_isError(compressedSize))
+			return 0;
+
+		// Write to a temporary, so a partial file is never found.
+		const Path filename = index_->Filename(key_);
+		const Path tempFilename = filename.WithReplacedExtension(".tmp");
+		const size_t size = sizeof(header) + compressedSize;
+		if (!File::WriteDataToFile(false, buf.data(), (unsigned int)size, tempFilename) || !File::Rename(tempFilename, filename)) {
+			File::Delete(tempFilename);
+			return 0;
+		}
+		return size;
+	}
+
+	std::shared_ptr<ScaledTextureCache::Index> index_;
+	uint64_t key_;
+	std::vector<u32> data_;
+	int w_;
+	int h_;
+};
+
+ScaledTextureCache::ScaledTextureCache() : index_(std::make_shared<Index>()) {
+}
+
+ScaledTextureCache::~ScaledTextureCache() {
+}
+
+uint64_t ScaledTextureCache::Key(const u32 *src, int width, int height, int factor) {
+	// Everything that affects the output, besides the source itself.
+	const uint64_t seed = (uint64_t)width | ((uint64_t)height << 16) | ((uint64_t)factor << 32) | ((uint64_t)g_Config.iTexScalingType << 40) | ((uint64_t)g_Config.bTexDeposterize << 48) | ((uint64_t)SCALED_VERSION << 56);
+	return XXH3_64bits_withSeed(src, width * height * sizeof(u32), seed);
+}
+
+bool ScaledTextureCache::Ready() {
+	if (!g_Config.bTexScalingDiskCache)
+		return false;
+
+	if (!scanStarted_) {
+		scanStarted_ = true;
+		index_->dir = GetSysDirectory(DIRECTORY_APP_CACHE) / "ScaledTextures";
+		File::CreateFullPath(index_->dir);
+		g_threadManager.EnqueueTask(new ScaledTextureScanTask(index_));
+		return false;
+	}
+
+	std::lock_guard<std::mutex> guard(index_->lock);
+	return index_->scanned;
+}
+
+bool ScaledTextureCache::Find(uint64_t key, u32 *out, int width, int height, int factor) {
+	if (!Ready())
+		return false;
+
+	{
+		std::lock_guard<std::mutex> guard(index_->lock);
+		auto file = index_->files.find(key);
+		if (file == index_->files.end() || file->second.pending)
+			return false;
+		file->second.lastUsed = (uint64_t)time(nullptr);
+	}
+
+	const Path filename = index_->Filename(key);
+	const int scaledW = width * factor;
+	const int scaledH = height * factor;
+	const size_t scaledSize = scaledW * scaledH * sizeof(u32);
+
+	size_t size = 0;
+	u8 *data = File::ReadLocalFile(filename, &size);
+	bool success = false;
+	if (data && size > sizeof(ScaledTextureHeader)) {
+		ScaledTextureHeader header;
+		memcpy(&header, data, sizeof(header));
+		if (header.magic == SCALED_MAGIC && header.version == SCALED_VERSION && header.key == key && header.width == (u32)scaledW && header.height == (u32)scaledH) {
+			size_t decompressedSize = ZSTD_decompress(out, scaledSize, data + sizeof(header), size - sizeof(header));
+			success = decompressedSize == scaledSize;
+		}
+	}
+	delete[] data;
+
+	if (!success) {
+		// Deleted or damaged, so forget about it.  We'll write it again after scaling.
+		WARN_LOG(G3D, "Scaled texture cache: discarding bad file %s", filename.c_str());
+		std::lock_guard<std::mutex> guard(index_->lock);
+		auto file = index_->files.find(key);
+		if (file != index_->files.end() && !file->second.pending) {
+			index_->totalSize -= file->second.size;
+			index_->files.erase(file);
+			File::Delete(filename);
+		}
+	}
+	return success;
+}
+
+void ScaledTextureCache::Store(uint64_t key, const u32 *scaled, int width, int height, int factor) {
+	if (!Ready())
+		return;
+
+	{
+		std::lock_guard<std::mutex> guard(index_->lock);
+		auto file = index_->files.find(key);
+		if (file != index_->files.end())
+			return;
+		index_->files[key] = { 0, (uint64_t)time(nullptr), true };
+	}
+
+	g_threadManager.EnqueueTask(new ScaledTextureSaveTask(index_, key, scaled, width * factor, height * factor));
+}
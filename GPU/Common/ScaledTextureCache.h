@@ -0,0 +1,50 @@
+// Copyright (c) 2022- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include "Common/CommonTypes.h"
+
+// Keeps upscaled textures on disk between sessions, so xBRZ and friends only run once per texture.
+// Files are zstd compressed and keyed by the decoded source and scaling settings, with a size cap
+// enforced by evicting the least recently used.  Writes and the initial directory scan are done on
+// worker threads, so nothing is found until the scan finishes.
+class ScaledTextureCache {
+public:
+	ScaledTextureCache();
+	~ScaledTextureCache();
+
+	// Identifies the result of scaling this source with the current settings.
+	static uint64_t Key(const u32 *src, int width, int height, int factor);
+
+	// On a hit, fills out with the scaled size, which is width * factor by height * factor.
+	bool Find(uint64_t key, u32 *out, int width, int height, int factor);
+	// Copies the scaled texture and writes it in the background.
+	void Store(uint64_t key, const u32 *scaled, int width, int height, int factor);
+
+private:
+	struct Index;
+	friend class ScaledTextureScanTask;
+	friend class ScaledTextureSaveTask;
+	bool Ready();
+
+	// Shared with worker tasks, which might finish after we're gone.
+	std::shared_ptr<Index> index_;
+	bool scanStarted_ = false;
+};
@@ -18,6 +18,9 @@
 #include "ppsspp_config.h"
 
 #include <algorithm>
+#include <atomic>
+
+#include "ext/xxhash.h"
 
 #include "Common/Common.h"
 #include "Common/Data/Convert/ColorConv.h"
@@ -25,12 +28,14 @@
 #include "Common/Profiler/Profiler.h"
 #include "Common/MemoryUtil.h"
 #include "Common/StringUtils.h"
+#include "Common/Thread/ParallelLoop.h"
 #include "Common/TimeUtil.h"
 #include "Common/Math/math_util.h"
 #include "Core/Config.h"
 #include "Core/Debugger/MemBlockInfo.h"
 #include "Core/Reporting.h"
 #include "Core/System.h"
+#include "Core/ThreadPools.h"
 #include "GPU/Common/FramebufferManagerCommon.h"
 #include "GPU/Common/TextureCacheCommon.h"
 #include "GPU/Common/TextureDecoder.h"
@@ -496,8 +501,15 @@ TexCacheEntry *TextureCacheCommon::SetTexture() {
 			}
 		}
 
-		if (match && (entry->status & TexCacheEntry::STATUS_TO_SCALE) && standardScaleFactor_ != 1 && texelsScaledThisFrame_ < TEXCACHE_MAX_TEXELS_SCALED) {
-			if ((entry->status & TexCacheEntry::STATUS_CHANGE_FREQUENT) == 0) {
+		if (match && (entry->status & TexCacheEntry::STATUS_TO_SCALE) && standardScaleFactor_ != 1) {
+			auto job = scaleJobs_.find(entry);
+			if (job != scaleJobs_.end()) {
+				// Scaling in the background, so reload once to swap it in.
+				if (job->second->IsReady()) {
+					match = false;
+					reason = "scaled";
+				}
+			} else if (texelsScaledThisFrame_ < TEXCACHE_MAX_TEXELS_SCALED && (entry->status & TexCacheEntry::STATUS_CHANGE_FREQUENT) == 0) {
 				// INFO_LOG(G3D, "Reloading texture to do the scaling we skipped..");
 				match = false;
 				reason = "scaling";
@@ -773,6 +785,7 @@ void TextureCacheCommon::Decimate(bool forcePressure) {
 			// In low memory mode, we kill them all since secondary cache is disabled.
 			if (lowMemoryMode_ || iter->second->lastFrame + TEXTURE_SECOND_KILL_AGE < gpuStats.numFlips) {
 				ReleaseTexture(iter->second.get(), true);
+				scaleJobs_.erase(iter->second.get());
 				secondCacheSizeEstimate_ -= EstimateTexMemoryUsage(iter->second.get());
 				secondCache_.erase(iter++);
 			} else {
@@ -1534,6 +1547,9 @@ static inline void ConvertFormatToRGBA8888(GEPaletteFormat format, u32 *dst, con
 	ConvertFormatToRGBA8888(GETextureFormat(format), dst, src, numPixels);
 }
 
+// Small textures aren't worth the overhead of threads.
+static const int DXT_MIN_BLOCK_ROWS_PER_THREAD = 16;
+
 template <typename DXTBlock, int n>
 static CheckAlphaResult DecodeDXTBlocks(uint8_t *out, int outPitch, uint32_t texaddr, const uint8_t *texptr,
 	int w, int h, int bufw, bool reverseColors) {
@@ -1551,26 +1567,49 @@ static CheckAlphaResult DecodeDXTBlocks(uint8_t *out, int outPitch, uint32_t tex
 		h = (((int)limited / sizeof(DXTBlock)) / (bufw / 4)) * 4;
 	}
 
-	u32 alphaSum = 1;
-	for (int y = 0; y < h; y += 4) {
-		u32 blockIndex = (y / 4) * (bufw / 4);
-		int blockHeight = std::min(h - y, 4);
-		for (int x = 0; x < minw; x += 4) {
-			int blockWidth = std::min(minw - x, 4);
-			switch (n) {
-			case 1:
-				DecodeDXT1Block(dst + outPitch32 * y + x, (const DXT1Block *)src + blockIndex, outPitch32, blockWidth, blockHeight, &alphaSum);
-				break;
-			case 3:
-				DecodeDXT3Block(dst + outPitch32 * y + x, (const DXT3Block *)src + blockIndex, outPitch32, blockWidth, blockHeight);
-				break;
-			case 5:
-				DecodeDXT5Block(dst + outPitch32 * y + x, (const DXT5Block *)src + blockIndex, outPitch32, blockWidth, blockHeight);
-				break;
+	std::atomic<u32> alphaSum(1);
+	// Each range is a set of block rows.
+	ParallelRangeLoop(&g_threadManager, [&](int l, int u) {
+		u32 rangeAlphaSum = 1;
+		for (int y = l * 4; y < u * 4 && y < h; y += 4) {
+			u32 blockIndex = (y / 4) * (bufw / 4);
+			int blockHeight = std::min(h - y, 4);
+			int x = 0;
+			if (blockHeight == 4) {
+				// The full blocks can go several at a time.
+				int count = minw / 4;
+				switch (n) {
+				case 1:
+					DecodeDXT1Blocks(dst + outPitch32 * y, (const DXT1Block *)src + blockIndex, outPitch32, count, &rangeAlphaSum);
+					break;
+				case 3:
+					DecodeDXT3Blocks(dst + outPitch32 * y, (const DXT3Block *)src + blockIndex, outPitch32, count);
+					break;
+				case 5:
+					DecodeDXT5Blocks(dst + outPitch32 * y, (const DXT5Block *)src + blockIndex, outPitch32, count);
+					break;
+				}
+				x = count * 4;
+				blockIndex += count;
+			}
+			for (; x < minw; x += 4) {
+				int blockWidth = std::min(minw - x, 4);
+				switch (n) {
+				case 1:
+					DecodeDXT1Block(dst + outPitch32 * y + x, (const DXT1Block *)src + blockIndex, outPitch32, blockWidth, blockHeight, &rangeAlphaSum);
+					break;
+				case 3:
+					DecodeDXT3Block(dst + outPitch32 * y + x, (const DXT3Block *)src + blockIndex, outPitch32, blockWidth, blockHeight);
+					break;
+				case 5:
+					DecodeDXT5Block(dst + outPitch32 * y + x, (const DXT5Block *)src + blockIndex, outPitch32, blockWidth, blockHeight);
+					break;
+				}
+				blockIndex++;
 			}
-			blockIndex++;
 		}
-	}
+		alphaSum &= rangeAlphaSum;
+	}, 0, (h + 3) / 4, DXT_MIN_BLOCK_ROWS_PER_THREAD);
 
 	if (reverseColors) {
 		ReverseColors(out, out, GE_TFMT_8888, outPitch32 * h);
@@ -2012,7 +2051,7 @@ void TextureCacheCommon::ApplyTexture() {
 			// Update the hash on the texture.
 			int w = gstate.getTextureWidth(0);
 			int h = gstate.getTextureHeight(0);
-			entry->fullhash = QuickTexHash(replacer_, entry->addr, entry->bufw, w, h, GETextureFormat(entry->format), entry);
+			entry->fullhash = QuickTexHash(replacer_, entry->addr, entry->bufw, w, h, GETextureFormat(entry->format), entry, false);
 
 			// TODO: Here we could check the secondary cache; maybe the texture is in there?
 			// We would need to abort the build if so.
@@ -2393,10 +2432,13 @@ void TextureCacheCommon::Clear(bool delete_them) {
 		INFO_LOG(G3D, "Texture cached cleared from %i textures", (int)(cache_.size() + secondCache_.size()));
 		cache_.clear();
 		secondCache_.clear();
+		scaleJobs_.clear();
 		cacheSizeEstimate_ = 0;
 		secondCacheSizeEstimate_ = 0;
 	}
 	videos_.clear();
+	// No entry points at a replacement anymore.
+	replacer_.NotifyTextureCacheCleared();
 
 	if (dynamicClutFbo_) {
 		dynamicClutFbo_->Release();
@@ -2410,6 +2452,8 @@ void TextureCacheCommon::Clear(bool delete_them) {
 
 void TextureCacheCommon::DeleteTexture(TexCache::iterator it) {
 	ReleaseTexture(it->second.get(), true);
+	// Cancels it, if it hasn't started yet.
+	scaleJobs_.erase(it->second.get());
 	cacheSizeEstimate_ -= EstimateTexMemoryUsage(it->second.get());
 	cache_.erase(it);
 }
@@ -2429,7 +2473,7 @@ bool TextureCacheCommon::CheckFullHash(TexCacheEntry *entry, bool &doDelete) {
 	u32 fullhash;
 	{
 		PROFILE_THIS_SCOPE("texhash");
-		fullhash = QuickTexHash(replacer_, entry->addr, entry->bufw, w, h, GETextureFormat(entry->format), entry);
+		fullhash = QuickTexHash(replacer_, entry->addr, entry->bufw, w, h, GETextureFormat(entry->format), entry, true);
 	}
 
 	if (fullhash == entry->fullhash) {
@@ -2480,6 +2524,8 @@ bool TextureCacheCommon::CheckFullHash(TexCacheEntry *entry, bool &doDelete) {
 				auto oldIter = secondCache_.find(secondKey);
 				if (oldIter != secondCache_.end()) {
 					ReleaseTexture(oldIter->second.get(), true);
+					// The entry is about to be freed, so a job for it must not outlive it.
+					scaleJobs_.erase(oldIter->second.get());
 				}
 
 				// Archive the entire texture entry as is, since we'll use its params if it is seen again.
@@ -2498,6 +2544,76 @@ bool TextureCacheCommon::CheckFullHash(TexCacheEntry *entry, bool &doDelete) {
 	return false;
 }
 
+u32 TextureCacheCommon::QuickTexHash(TextureReplacer &replacer, u32 addr, int bufw, int w, int h, GETextureFormat format, TexCacheEntry *entry, bool incremental) {
+	if (replacer.Enabled()) {
+		return replacer.ComputeHash(addr, bufw, w, h, format, entry->maxSeenV);
+	}
+
+	if (h == 512 && entry->maxSeenV < 512 && entry->maxSeenV != 0) {
+		h = (int)entry->maxSeenV;
+	}
+
+	const u32 sizeInRAM = (textureBitsPerPixel[format] * bufw * h) / 8;
+	if (!Memory::IsValidAddress(addr + sizeInRAM)) {
+		gpuStats.numTextureDataBytesHashed += sizeInRAM;
+		return 0;
+	}
+
+	if (g_Config.bTextureHashPages) {
+		return PageTexHash(entry, addr, sizeInRAM, incremental);
+	}
+
+	gpuStats.numTextureDataBytesHashed += sizeInRAM;
+	return StableQuickTexHash(Memory::GetPointerUnchecked(addr), sizeInRAM);
+}
+
+u32 TextureCacheCommon::PageTexHash(TexCacheEntry *entry, u32 addr, u32 sizeInRAM, bool incremental) {
+	// Take this first, so writes while we're hashing are caught next time.
+	const u32 stamp = MemBlockWriteStamp();
+	const u8 *data = Memory::GetPointerUnchecked(addr);
+
+	// Pages are aligned in memory, to line up with write notifications.
+	const u32 end = addr + sizeInRAM;
+	const u32 firstPage = addr / TEXCACHE_HASH_PAGE_SIZE;
+	const u32 numPages = (end + TEXCACHE_HASH_PAGE_SIZE - 1) / TEXCACHE_HASH_PAGE_SIZE - firstPage;
+	auto pageRange = [&](u32 i, u32 &start, u32 &size) {
+		start = std::max(addr, (firstPage + i) * TEXCACHE_HASH_PAGE_SIZE);
+		size = std::min(end, (firstPage + i + 1) * TEXCACHE_HASH_PAGE_SIZE) - start;
+	};
+	auto hashPage = [&](u32 i) {
+		u32 start, size;
+		pageRange(i, start, size);
+		entry->pageHashes[i] = XXH3_64bits(data + (start - addr), size);
+		gpuStats.numTextureDataBytesHashed += size;
+	};
+
+	// Only trust pages we checked recently, since CPU writes would otherwise take many checks to find.
+	const bool reuse = incremental && entry->pageHashes.size() == numPages && entry->pageHashBytes == sizeInRAM && entry->pageHashFrame + 1 >= gpuStats.numFlips;
+	if (!reuse) {
+		entry->pageHashes.resize(numPages);
+		entry->pageHashBytes = sizeInRAM;
+		entry->pageHashNext = 0;
+		for (u32 i = 0; i < numPages; ++i)
+			hashPage(i);
+	} else {
+		// CPU writes aren't notified, so also rehash a share of the other pages each time.
+		const u32 perPass = (numPages + TEXCACHE_HASH_PAGE_PASSES - 1) / TEXCACHE_HASH_PAGE_PASSES;
+		const u32 next = entry->pageHashNext;
+		for (u32 i = 0; i < numPages; ++i) {
+			u32 start, size;
+			pageRange(i, start, size);
+			const bool inPass = (i + numPages - next) % numPages < perPass;
+			if (inPass || MemBlockWrittenSince(start, size, entry->pageHashStamp))
+				hashPage(i);
+		}
+		entry->pageHashNext = (next + perPass) % numPages;
+	}
+
+	entry->pageHashStamp = stamp;
+	entry->pageHashFrame = gpuStats.numFlips;
+	return (u32)XXH3_64bits(entry->pageHashes.data(), numPages * sizeof(u64));
+}
+
 void TextureCacheCommon::Invalidate(u32 addr, int size, GPUInvalidationType type) {
 	// They could invalidate inside the texture, let's just give a bit of leeway.
 	// TODO: Keep track of the largest texture size in bytes, and use that instead of this
@@ -2705,7 +2821,8 @@ bool TextureCacheCommon::PrepareBuildTexture(BuildTexturePlan &plan, TexCacheEnt
 	}
 
 	if (plan.scaleFactor != 1) {
-		if (texelsScaledThisFrame_ >= TEXCACHE_MAX_TEXELS_SCALED && plan.slowScaler) {
+		// When scaling in the background, the placeholder is cheap enough not to need a budget.
+		if (texelsScaledThisFrame_ >= TEXCACHE_MAX_TEXELS_SCALED && plan.slowScaler && !g_Config.bTexScalingAsync) {
 			entry->status |= TexCacheEntry::STATUS_TO_SCALE;
 			plan.scaleFactor = 1;
 		} else {
@@ -2849,7 +2966,7 @@ void TextureCacheCommon::LoadTextureLevel(TexCacheEntry &entry, uint8_t *data, i
 
 		if (scaleFactor > 1) {
 			// Note that this updates w and h!
-			scaler_.ScaleAlways((u32 *)data, pixelData, w, h, scaleFactor);
+			ScaleTextureLevel(entry, (u32 *)data, pixelData, w, h, scaleFactor);
 			pixelData = (u32 *)data;
 
 			decPitch = w * 4;
@@ -2881,6 +2998,49 @@ void TextureCacheCommon::LoadTextureLevel(TexCacheEntry &entry, uint8_t *data, i
 	}
 }
 
+void TextureCacheCommon::ScaleTextureLevel(TexCacheEntry &entry, u32 *out, u32 *src, int &w, int &h, int factor) {
+	// Flat textures are quicker to scale than to load.
+	const bool useDiskCache = g_Config.bTexScalingDiskCache && !scaler_.IsEmptyOrFlat(src, w * h);
+	const uint64_t diskKey = useDiskCache ? ScaledTextureCache::Key(src, w, h, factor) : 0;
+	if (useDiskCache && scaledDiskCache_.Find(diskKey, out, w, h, factor)) {
+		w *= factor;
+		h *= factor;
+		scaleJobs_.erase(&entry);
+		entry.status &= ~TexCacheEntry::STATUS_TO_SCALE;
+		return;
+	}
+
+	if (!g_Config.bTexScalingAsync) {
+		const int srcW = w;
+		const int srcH = h;
+		scaler_.ScaleAlways(out, src, w, h, factor);
+		if (useDiskCache)
+			scaledDiskCache_.Store(diskKey, out, srcW, srcH, factor);
+		return;
+	}
+
+	auto job = scaleJobs_.find(&entry);
+	if (job != scaleJobs_.end() && job->second->Matches(w, h, factor, entry.fullhash)) {
+		if (job->second->IsReady()) {
+			if (useDiskCache)
+				scaledDiskCache_.Store(diskKey, job->second->Data(), w, h, factor);
+			w *= factor;
+			h *= factor;
+			memcpy(out, job->second->Data(), w * h * sizeof(u32));
+			scaleJobs_.erase(job);
+			entry.status &= ~TexCacheEntry::STATUS_TO_SCALE;
+			return;
+		}
+	} else {
+		// This also cancels any job for older contents.
+		scaleJobs_[&entry].reset(new TextureScaleJob(src, w, h, factor, entry.fullhash));
+	}
+
+	// SetTexture() will reload once the job is ready.
+	scaler_.ScalePlaceholder(out, src, w, h, factor);
+	entry.status |= TexCacheEntry::STATUS_TO_SCALE;
+}
+
 CheckAlphaResult TextureCacheCommon::CheckCLUTAlpha(const uint8_t *pixelData, GEPaletteFormat clutFormat, int w) {
 	switch (clutFormat) {
 	case GE_CMODE_16BIT_ABGR4444:
@@ -20,6 +20,7 @@
 #include <map>
 #include <vector>
 #include <memory>
+#include <unordered_map>
 
 #include "Common/CommonTypes.h"
 #include "Common/MemoryUtil.h"
@@ -28,6 +29,7 @@
 #include "GPU/GPU.h"
 #include "GPU/Common/GPUDebugInterface.h"
 #include "GPU/Common/TextureDecoder.h"
+#include "GPU/Common/ScaledTextureCache.h"
 #include "GPU/Common/TextureScalerCommon.h"
 #include "GPU/Common/TextureShaderCommon.h"
 
@@ -39,6 +41,11 @@ enum FramebufferNotification {
 	NOTIFY_FB_DESTROYED,
 };
 
+// With bTextureHashPages, texture data is hashed in pages of this size.
+#define TEXCACHE_HASH_PAGE_SIZE 4096
+// Pages without write notifications are still rehashed in turn, a full pass every this many checks.
+#define TEXCACHE_HASH_PAGE_PASSES 4
+
 // Changes more frequent than this will be considered "frequent" and prevent texture scaling.
 #define TEXCACHE_FRAME_CHANGE_FREQUENT 6
 // Note: only used when hash backoff is disabled.
@@ -178,6 +185,13 @@ struct TexCacheEntry {
 	u32 cluthash;
 	u16 maxSeenV;
 
+	// With bTextureHashPages, a hash per 4KB page of sizeInRAM bytes, so checks can skip some.
+	std::vector<u64> pageHashes;
+	u32 pageHashBytes;
+	u32 pageHashStamp;
+	u32 pageHashNext;
+	int pageHashFrame;
+
 	TexStatus GetHashStatus() {
 		return TexStatus(status & STATUS_MASK);
 	}
@@ -377,6 +391,8 @@ class TextureCacheCommon {
 
 	// Return value is mapData normally, but could be another buffer allocated with AllocateAlignedMemory.
 	void LoadTextureLevel(TexCacheEntry &entry, uint8_t *mapData, int mapRowPitch, ReplacedTexture &replaced, int srcLevel, int scaleFactor, Draw::DataFormat dstFmt, TexDecodeFlags texDecFlags);
+	// Like scaler_.ScaleAlways(), but may give a quick placeholder and finish scaling in the background.
+	void ScaleTextureLevel(TexCacheEntry &entry, u32 *out, u32 *src, int &w, int &h, int factor);
 
 	template <typename T>
 	inline const T *GetCurrentClut() {
@@ -410,26 +426,9 @@ class TextureCacheCommon {
 
 	static CheckAlphaResult CheckCLUTAlpha(const uint8_t *pixelData, GEPaletteFormat clutFmt, int w);
 
-	inline u32 QuickTexHash(TextureReplacer &replacer, u32 addr, int bufw, int w, int h, GETextureFormat format, const TexCacheEntry *entry) const {
-		if (replacer.Enabled()) {
-			return replacer.ComputeHash(addr, bufw, w, h, format, entry->maxSeenV);
-		}
-
-		if (h == 512 && entry->maxSeenV < 512 && entry->maxSeenV != 0) {
-			h = (int)entry->maxSeenV;
-		}
-
-		const u32 sizeInRAM = (textureBitsPerPixel[format] * bufw * h) / 8;
-		const u32 *checkp = (const u32 *)Memory::GetPointer(addr);
-
-		gpuStats.numTextureDataBytesHashed += sizeInRAM;
-
-		if (Memory::IsValidAddress(addr + sizeInRAM)) {
-			return StableQuickTexHash(checkp, sizeInRAM);
-		} else {
-			return 0;
-		}
-	}
+	// If incremental, page hashing may only rehash the pages that are likely to have changed.
+	u32 QuickTexHash(TextureReplacer &replacer, u32 addr, int bufw, int w, int h, GETextureFormat format, TexCacheEntry *entry, bool incremental);
+	u32 PageTexHash(TexCacheEntry *entry, u32 addr, u32 sizeInRAM, bool incremental);
 
 	static inline u32 MiniHash(const u32 *ptr) {
 		return ptr[0];
@@ -440,6 +439,9 @@ class TextureCacheCommon {
 
 	TextureReplacer replacer_;
 	TextureScalerCommon scaler_;
+	// Background scaling in progress or done, removed when used or when the entry is deleted.
+	std::unordered_map<const TexCacheEntry *, std::unique_ptr<TextureScaleJob>> scaleJobs_;
+	ScaledTextureCache scaledDiskCache_;
 	FramebufferManagerCommon *framebufferManager_;
 	TextureShaderCache *textureShaderCache_;
 	ShaderManagerCommon *shaderManager_;
@@ -442,7 +442,6 @@ static inline int mix_2_3(int c1, int c2) {
 	return (c1 + c1 + c2) / 3;
 }
 
-// This could probably be done faster by decoding two or four blocks at a time with SSE/NEON.
 void DXTDecoder::DecodeColors(const DXT1Block *src, bool ignore1bitAlpha) {
 	u16 c1 = src->color1;
 	u16 c2 = src->color2;
@@ -507,6 +506,21 @@ void DXTDecoder::DecodeAlphaDXT5(const DXT5Block *src) {
 	}
 }
 
+// Same as DecodeAlphaDXT5(), but already shifted into place.
+static inline void DecodeDXT5AlphaPalette(const DXT5Block *src, u32 alpha[8]) {
+	alpha[0] = (u32)src->alpha1 << 24;
+	alpha[1] = (u32)src->alpha2 << 24;
+	if (src->alpha1 > src->alpha2) {
+		for (int i = 1; i <= 6; ++i)
+			alpha[i + 1] = (u32)lerp8(src, i) << 24;
+	} else {
+		for (int i = 1; i <= 4; ++i)
+			alpha[i + 1] = (u32)lerp6(src, i) << 24;
+		alpha[6] = 0;
+		alpha[7] = 0xFF000000;
+	}
+}
+
 void DXTDecoder::WriteColorsDXT1(u32 *dst, const DXT1Block *src, int pitch, int width, int height) {
 	bool anyColor3 = false;
 	for (int y = 0; y < height; y++) {
@@ -618,7 +632,7 @@ uint32_t GetDXT5Texel(const DXT5Block *src, int x, int y) {
 	return color | (lerp6(src, alphaIndex - 1) << 24);
 }
 
-// This could probably be done faster by decoding two or four blocks at a time with SSE/NEON.
+// See DecodeDXT1Blocks() and friends for faster decoding of whole rows.
 void DecodeDXT1Block(u32 *dst, const DXT1Block *src, int pitch, int width, int height, u32 *alpha) {
 	DXTDecoder dxt;
 	dxt.DecodeColors(src, false);
@@ -664,6 +678,257 @@ inline u32 NEONReduce16And(uint16x8_t value) {
 }
 #endif
 
+#if defined(_M_SSE) || PPSSPP_ARCH(ARM_NEON)
+// Helpers so the block loops below can be shared between SSE2 and NEON.
+#ifdef _M_SSE
+typedef __m128i DXTVec;
+
+static inline DXTVec DXTSet(u32 a, u32 b, u32 c, u32 d) {
+	return _mm_setr_epi32(a, b, c, d);
+}
+static inline DXTVec DXTOr(DXTVec a, DXTVec b) {
+	return _mm_or_si128(a, b);
+}
+static inline DXTVec DXTAnd(DXTVec a, DXTVec b) {
+	return _mm_and_si128(a, b);
+}
+static inline DXTVec DXTSelect(DXTVec mask, DXTVec a, DXTVec b) {
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+static inline void DXTStore(u32 *dst, DXTVec v) {
+	_mm_storeu_si128((__m128i *)dst, v);
+}
+static inline u32 DXTReduceAnd(DXTVec v) {
+	return SSEReduce32And(v);
+}
+
+// Colors for four blocks, one per lane.  Returns each block's four colors in out.
+static inline void DXTDecodeColors4(const u32 c1s[4], const u32 c2s[4], u32 alpha, DXTVec out[4]) {
+	const __m128i c1 = _mm_loadu_si128((const __m128i *)c1s);
+	const __m128i c2 = _mm_loadu_si128((const __m128i *)c2s);
+	const __m128i mask5 = _mm_set1_epi32(0xF8);
+	const __m128i mask6 = _mm_set1_epi32(0xFC);
+	const __m128i r1 = _mm_and_si128(_mm_srli_epi32(c1, 8), mask5);
+	const __m128i g1 = _mm_and_si128(_mm_srli_epi32(c1, 3), mask6);
+	const __m128i b1 = _mm_and_si128(_mm_slli_epi32(c1, 3), mask5);
+	const __m128i r2 = _mm_and_si128(_mm_srli_epi32(c2, 8), mask5);
+	const __m128i g2 = _mm_and_si128(_mm_srli_epi32(c2, 3), mask6);
+	const __m128i b2 = _mm_and_si128(_mm_slli_epi32(c2, 3), mask5);
+	// Both are 16-bit, so a signed compare works.
+	const __m128i gt = _mm_cmpgt_epi32(c1, c2);
+	const __m128i a = _mm_set1_epi32(alpha);
+
+	auto pack = [](__m128i r, __m128i g, __m128i b) {
+		return _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)), _mm_slli_epi32(b, 16));
+	};
+	// Same as mix_2_3(): (x * 21846) >> 16 is exact for x / 3 up to 765.
+	const __m128i third = _mm_set1_epi32(21846);
+	auto mix = [&](__m128i x, __m128i y) {
+		return _mm_mulhi_epu16(_mm_add_epi32(_mm_add_epi32(x, x), y), third);
+	};
+	auto avg = [](__m128i x, __m128i y) {
+		return _mm_srli_epi32(_mm_add_epi32(x, y), 1);
+	};
+
+	const __m128i p0 = _mm_or_si128(pack(r1, g1, b1), a);
+	const __m128i p1 = _mm_or_si128(pack(r2, g2, b2), a);
+	const __m128i p2 = _mm_or_si128(DXTSelect(gt, pack(mix(r1, r2), mix(g1, g2), mix(b1, b2)), pack(avg(r1, r2), avg(g1, g2), avg(b1, b2))), a);
+	const __m128i p3 = _mm_and_si128(gt, _mm_or_si128(pack(mix(r2, r1), mix(g2, g1), mix(b2, b1)), a));
+
+	// Transpose to one block per register.
+	const __m128i t0 = _mm_unpacklo_epi32(p0, p1);
+	const __m128i t1 = _mm_unpacklo_epi32(p2, p3);
+	const __m128i t2 = _mm_unpackhi_epi32(p0, p1);
+	const __m128i t3 = _mm_unpackhi_epi32(p2, p3);
+	out[0] = _mm_unpacklo_epi64(t0, t1);
+	out[1] = _mm_unpackhi_epi64(t0, t1);
+	out[2] = _mm_unpacklo_epi64(t2, t3);
+	out[3] = _mm_unpackhi_epi64(t2, t3);
+}
+
+// Picks one of the block's colors for each of the four 2-bit indices in line.
+static inline DXTVec DXTSelectColors(DXTVec colors, u8 line) {
+	// Moves each lane's index to bits 14-15 of the low half, dropping the rest.
+	const __m128i idx = _mm_mullo_epi16(_mm_set1_epi32(line), _mm_setr_epi32(1 << 14, 1 << 12, 1 << 10, 1 << 8));
+	const __m128i m0 = _mm_srai_epi32(_mm_slli_epi32(idx, 17), 31);
+	const __m128i m1 = _mm_srai_epi32(_mm_slli_epi32(idx, 16), 31);
+	const __m128i lo = DXTSelect(m0, _mm_shuffle_epi32(colors, _MM_SHUFFLE(1, 1, 1, 1)), _mm_shuffle_epi32(colors, _MM_SHUFFLE(0, 0, 0, 0)));
+	const __m128i hi = DXTSelect(m0, _mm_shuffle_epi32(colors, _MM_SHUFFLE(3, 3, 3, 3)), _mm_shuffle_epi32(colors, _MM_SHUFFLE(2, 2, 2, 2)));
+	return DXTSelect(m1, hi, lo);
+}
+
+// DXT3 alpha for a line, with the four 4-bit values in line.
+static inline DXTVec DXTAlpha4(u16 line) {
+	const __m128i a = _mm_mullo_epi16(_mm_set1_epi32(line), _mm_setr_epi32(1 << 12, 1 << 8, 1 << 4, 1));
+	return _mm_and_si128(_mm_slli_epi32(a, 16), _mm_set1_epi32(0xF0000000));
+}
+#else
+typedef uint32x4_t DXTVec;
+
+static inline DXTVec DXTSet(u32 a, u32 b, u32 c, u32 d) {
+	const u32 v[4] = { a, b, c, d };
+	return vld1q_u32(v);
+}
+static inline DXTVec DXTOr(DXTVec a, DXTVec b) {
+	return vorrq_u32(a, b);
+}
+static inline DXTVec DXTAnd(DXTVec a, DXTVec b) {
+	return vandq_u32(a, b);
+}
+static inline DXTVec DXTSelect(DXTVec mask, DXTVec a, DXTVec b) {
+	return vbslq_u32(mask, a, b);
+}
+static inline void DXTStore(u32 *dst, DXTVec v) {
+	vst1q_u32(dst, v);
+}
+static inline u32 DXTReduceAnd(DXTVec v) {
+	return NEONReduce32And(v);
+}
+
+static inline void DXTDecodeColors4(const u32 c1s[4], const u32 c2s[4], u32 alpha, DXTVec out[4]) {
+	const uint32x4_t c1 = vld1q_u32(c1s);
+	const uint32x4_t c2 = vld1q_u32(c2s);
+	const uint32x4_t mask5 = vdupq_n_u32(0xF8);
+	const uint32x4_t mask6 = vdupq_n_u32(0xFC);
+	const uint32x4_t r1 = vandq_u32(vshrq_n_u32(c1, 8), mask5);
+	const uint32x4_t g1 = vandq_u32(vshrq_n_u32(c1, 3), mask6);
+	const uint32x4_t b1 = vandq_u32(vshlq_n_u32(c1, 3), mask5);
+	const uint32x4_t r2 = vandq_u32(vshrq_n_u32(c2, 8), mask5);
+	const uint32x4_t g2 = vandq_u32(vshrq_n_u32(c2, 3), mask6);
+	const uint32x4_t b2 = vandq_u32(vshlq_n_u32(c2, 3), mask5);
+	const uint32x4_t gt = vcgtq_u32(c1, c2);
+	const uint32x4_t a = vdupq_n_u32(alpha);
+
+	auto pack = [](uint32x4_t r, uint32x4_t g, uint32x4_t b) {
+		return vorrq_u32(vorrq_u32(r, vshlq_n_u32(g, 8)), vshlq_n_u32(b, 16));
+	};
+	// Same as mix_2_3(): (x * 21846) >> 16 is exact for x / 3 up to 765.
+	auto mix = [](uint32x4_t x, uint32x4_t y) {
+		return vshrq_n_u32(vmulq_n_u32(vaddq_u32(vaddq_u32(x, x), y), 21846), 16);
+	};
+	auto avg = [](uint32x4_t x, uint32x4_t y) {
+		return vshrq_n_u32(vaddq_u32(x, y), 1);
+	};
+
+	uint32x4x4_t p;
+	p.val[0] = vorrq_u32(pack(r1, g1, b1), a);
+	p.val[1] = vorrq_u32(pack(r2, g2, b2), a);
+	p.val[2] = vorrq_u32(vbslq_u32(gt, pack(mix(r1, r2), mix(g1, g2), mix(b1, b2)), pack(avg(r1, r2), avg(g1, g2), avg(b1, b2))), a);
+	p.val[3] = vandq_u32(gt, vorrq_u32(pack(mix(r2, r1), mix(g2, g1), mix(b2, b1)), a));
+
+	// Interleaving on store gives one block per register.
+	u32 colors[16];
+	vst4q_u32(colors, p);
+	for (int i = 0; i < 4; ++i)
+		out[i] = vld1q_u32(colors + i * 4);
+}
+
+static inline DXTVec DXTSelectColors(DXTVec colors, u8 line) {
+	static const int32_t shifts[4] = { 0, -2, -4, -6 };
+	const uint32x4_t idx = vshlq_u32(vdupq_n_u32(line), vld1q_s32(shifts));
+	const uint32x4_t m0 = vtstq_u32(idx, vdupq_n_u32(1));
+	const uint32x4_t m1 = vtstq_u32(idx, vdupq_n_u32(2));
+	const uint32x2_t low = vget_low_u32(colors);
+	const uint32x2_t high = vget_high_u32(colors);
+	const uint32x4_t lo = vbslq_u32(m0, vdupq_lane_u32(low, 1), vdupq_lane_u32(low, 0));
+	const uint32x4_t hi = vbslq_u32(m0, vdupq_lane_u32(high, 1), vdupq_lane_u32(high, 0));
+	return vbslq_u32(m1, hi, lo);
+}
+
+static inline DXTVec DXTAlpha4(u16 line) {
+	static const int32_t shifts[4] = { 0, -4, -8, -12 };
+	return vshlq_n_u32(vshlq_u32(vdupq_n_u32(line), vld1q_s32(shifts)), 28);
+}
+#endif
+
+template <typename DXTBlock>
+static inline void DXTDecodeBlockColors4(const DXTBlock *src, const DXT1Block *(*getColor)(const DXTBlock *), u32 alpha, DXTVec out[4]) {
+	u32 c1s[4], c2s[4];
+	for (int i = 0; i < 4; ++i) {
+		const DXT1Block *color = getColor(src + i);
+		c1s[i] = color->color1;
+		c2s[i] = color->color2;
+	}
+	DXTDecodeColors4(c1s, c2s, alpha, out);
+}
+
+static const DXT1Block *DXT1Color(const DXT1Block *src) {
+	return src;
+}
+static const DXT1Block *DXT3Color(const DXT3Block *src) {
+	return &src->color;
+}
+static const DXT1Block *DXT5Color(const DXT5Block *src) {
+	return &src->color;
+}
+#endif
+
+void DecodeDXT1Blocks(u32 *dst, const DXT1Block *src, int pitch, int count, u32 *alpha) {
+	int i = 0;
+#if defined(_M_SSE) || PPSSPP_ARCH(ARM_NEON)
+	DXTVec alphaMask = DXTSet(0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF);
+	for (; i + 4 <= count; i += 4) {
+		DXTVec colors[4];
+		DXTDecodeBlockColors4(src + i, &DXT1Color, 0xFF000000, colors);
+		for (int b = 0; b < 4; ++b) {
+			u32 *d = dst + (i + b) * 4;
+			for (int y = 0; y < 4; ++y) {
+				DXTVec c = DXTSelectColors(colors[b], src[i + b].lines[y]);
+				DXTStore(d + y * pitch, c);
+				alphaMask = DXTAnd(alphaMask, c);
+			}
+		}
+	}
+	// Only color 3 can be transparent, and only when color1 <= color2.
+	if ((DXTReduceAnd(alphaMask) >> 24) != 0xFF)
+		*alpha = 0;
+#endif
+	for (; i < count; ++i)
+		DecodeDXT1Block(dst + i * 4, src + i, pitch, 4, 4, alpha);
+}
+
+void DecodeDXT3Blocks(u32 *dst, const DXT3Block *src, int pitch, int count) {
+	int i = 0;
+#if defined(_M_SSE) || PPSSPP_ARCH(ARM_NEON)
+	for (; i + 4 <= count; i += 4) {
+		DXTVec colors[4];
+		DXTDecodeBlockColors4(src + i, &DXT3Color, 0, colors);
+		for (int b = 0; b < 4; ++b) {
+			const DXT3Block &block = src[i + b];
+			u32 *d = dst + (i + b) * 4;
+			for (int y = 0; y < 4; ++y)
+				DXTStore(d + y * pitch, DXTOr(DXTSelectColors(colors[b], block.color.lines[y]), DXTAlpha4(block.alphaLines[y])));
+		}
+	}
+#endif
+	for (; i < count; ++i)
+		DecodeDXT3Block(dst + i * 4, src + i, pitch, 4, 4);
+}
+
+void DecodeDXT5Blocks(u32 *dst, const DXT5Block *src, int pitch, int count) {
+	int i = 0;
+#if defined(_M_SSE) || PPSSPP_ARCH(ARM_NEON)
+	for (; i + 4 <= count; i += 4) {
+		DXTVec colors[4];
+		DXTDecodeBlockColors4(src + i, &DXT5Color, 0, colors);
+		for (int b = 0; b < 4; ++b) {
+			const DXT5Block &block = src[i + b];
+			u32 a[8];
+			DecodeDXT5AlphaPalette(&block, a);
+			u64 alphadata = ((u64)(u16)block.alphadata1 << 32) | (u32)block.alphadata2;
+			u32 *d = dst + (i + b) * 4;
+			for (int y = 0; y < 4; ++y) {
+				DXTVec alphas = DXTSet(a[alphadata & 7], a[(alphadata >> 3) & 7], a[(alphadata >> 6) & 7], a[(alphadata >> 9) & 7]);
+				DXTStore(d + y * pitch, DXTOr(DXTSelectColors(colors[b], block.color.lines[y]), alphas));
+				alphadata >>= 12;
+			}
+		}
+	}
+#endif
+	for (; i < count; ++i)
+		DecodeDXT5Block(dst + i * 4, src + i, pitch, 4, 4);
+}
+
 // TODO: SSE/SIMD
 // At least on x86, compiler actually SIMDs these pretty well.
 void CopyAndSumMask16(u16 *dst, const u16 *src, int width, u32 *outMask) {
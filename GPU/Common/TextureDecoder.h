@@ -69,6 +69,11 @@ void DecodeDXT1Block(u32 *dst, const DXT1Block *src, int pitch, int width, int h
 void DecodeDXT3Block(u32 *dst, const DXT3Block *src, int pitch, int width, int height);
 void DecodeDXT5Block(u32 *dst, const DXT5Block *src, int pitch, int width, int height);
 
+// Decodes count full 4x4 blocks left to right, several at a time where SIMD is available.
+void DecodeDXT1Blocks(u32 *dst, const DXT1Block *src, int pitch, int count, u32 *alpha);
+void DecodeDXT3Blocks(u32 *dst, const DXT3Block *src, int pitch, int count);
+void DecodeDXT5Blocks(u32 *dst, const DXT5Block *src, int pitch, int count);
+
 uint32_t GetDXT1Texel(const DXT1Block *src, int x, int y);
 uint32_t GetDXT3Texel(const DXT3Block *src, int x, int y);
 uint32_t GetDXT5Texel(const DXT5Block *src, int x, int y);
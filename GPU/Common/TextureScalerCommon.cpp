@@ -17,6 +17,7 @@
 
 #include <cstddef>
 #include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <cstring>
 #include <cmath>
@@ -28,6 +29,7 @@
 #include "Common/Log.h"
 #include "Common/CommonFuncs.h"
 #include "Common/Thread/ParallelLoop.h"
+#include "Common/Thread/ThreadManager.h"
 #include "Core/ThreadPools.h"
 #include "Common/CPUDetect.h"
 #include "ext/xbrz/xbrz.h"
@@ -588,7 +590,7 @@ void dbgPGM(int w, int h, u32* pixels, const char* prefix = "dbg") { // 1 compon
 
 /////////////////////////////////////// Texture Scaler
 
-TextureScalerCommon::TextureScalerCommon() {
+TextureScalerCommon::TextureScalerCommon(bool threaded) : threaded_(threaded) {
 	// initBicubicWeights() used to be here.
 }
 
@@ -606,6 +608,10 @@ bool TextureScalerCommon::IsEmptyOrFlat(const u32 *data, int pixels) const {
 }
 
 void TextureScalerCommon::ScaleAlways(u32 *out, u32 *src, int &width, int &height, int factor) {
+	ScaleAlways(out, src, width, height, factor, g_Config.iTexScalingType, g_Config.bTexDeposterize);
+}
+
+void TextureScalerCommon::ScaleAlways(u32 *out, u32 *src, int &width, int &height, int factor, int scalingType, bool deposterize) {
 	if (IsEmptyOrFlat(src, width * height)) {
 		// This means it was a flat texture.  Vulkan wants the size up front, so we need to make it happen.
 		u32 pixel = *src;
@@ -623,11 +629,15 @@ void TextureScalerCommon::ScaleAlways(u32 *out, u32 *src, int &width, int &heigh
 			}
 		}
 	} else {
-		ScaleInto(out, src, width, height, factor);
+		ScaleInto(out, src, width, height, factor, scalingType, deposterize);
 	}
 }
 
 bool TextureScalerCommon::ScaleInto(u32 *outputBuf, u32 *src, int &width, int &height, int factor) {
+	return ScaleInto(outputBuf, src, width, height, factor, g_Config.iTexScalingType, g_Config.bTexDeposterize);
+}
+
+bool TextureScalerCommon::ScaleInto(u32 *outputBuf, u32 *src, int &width, int &height, int factor, int scalingType, bool deposterize) {
 #ifdef SCALING_MEASURE_TIME
 	double t_start = time_now_d();
 #endif
@@ -635,14 +645,14 @@ bool TextureScalerCommon::ScaleInto(u32 *outputBuf, u32 *src, int &width, int &h
 	u32 *inputBuf = src;
 
 	// deposterize
-	if (g_Config.bTexDeposterize) {
+	if (deposterize) {
 		bufDeposter.resize(width * height);
 		DePosterize(inputBuf, bufDeposter.data(), width, height);
 		inputBuf = bufDeposter.data();
 	}
 
 	// scale 
-	switch (g_Config.iTexScalingType) {
+	switch (scalingType) {
 	case XBRZ:
 		ScaleXBRZ(factor, inputBuf, outputBuf, width, height);
 		break;
@@ -656,7 +666,7 @@ bool TextureScalerCommon::ScaleInto(u32 *outputBuf, u32 *src, int &width, int &h
 		ScaleHybrid(factor, inputBuf, outputBuf, width, height, true);
 		break;
 	default:
-		ERROR_LOG(G3D, "Unknown scaling type: %d", g_Config.iTexScalingType);
+		ERROR_LOG(G3D, "Unknown scaling type: %d", scalingType);
 	}
 
 	// update values accordingly
@@ -692,26 +702,40 @@ bool TextureScalerCommon::Scale(u32* &data, int &width, int &height, int factor)
 	return false;
 }
 
+void TextureScalerCommon::ScalePlaceholder(u32 *out, u32 *src, int &width, int &height, int factor) {
+	ScaleBilinear(factor, src, out, width, height);
+	width *= factor;
+	height *= factor;
+}
+
 const int MIN_LINES_PER_THREAD = 4;
 
+void TextureScalerCommon::RangeLoop(const std::function<void(int, int)> &loop, int lower, int upper) {
+	// Nesting parallel loops inside a task could wait on our own thread's queue.
+	if (threaded_)
+		ParallelRangeLoop(&g_threadManager, loop, lower, upper, MIN_LINES_PER_THREAD);
+	else
+		loop(lower, upper);
+}
+
 void TextureScalerCommon::ScaleXBRZ(int factor, u32* source, u32* dest, int width, int height) {
 	xbrz::ScalerCfg cfg;
-	ParallelRangeLoop(&g_threadManager, std::bind(&xbrz::scale, factor, source, dest, width, height, xbrz::ColorFormat::ARGB, cfg, std::placeholders::_1, std::placeholders::_2), 0, height, MIN_LINES_PER_THREAD);
+	RangeLoop(std::bind(&xbrz::scale, factor, source, dest, width, height, xbrz::ColorFormat::ARGB, cfg, std::placeholders::_1, std::placeholders::_2), 0, height);
 }
 
 void TextureScalerCommon::ScaleBilinear(int factor, u32* source, u32* dest, int width, int height) {
 	bufTmp1.resize(width * height * factor);
 	u32 *tmpBuf = bufTmp1.data();
-	ParallelRangeLoop(&g_threadManager, std::bind(&bilinearH, factor, source, tmpBuf, width, std::placeholders::_1, std::placeholders::_2), 0, height, MIN_LINES_PER_THREAD);
-	ParallelRangeLoop(&g_threadManager, std::bind(&bilinearV, factor, tmpBuf, dest, width, 0, height, std::placeholders::_1, std::placeholders::_2), 0, height, MIN_LINES_PER_THREAD);
+	RangeLoop(std::bind(&bilinearH, factor, source, tmpBuf, width, std::placeholders::_1, std::placeholders::_2), 0, height);
+	RangeLoop(std::bind(&bilinearV, factor, tmpBuf, dest, width, 0, height, std::placeholders::_1, std::placeholders::_2), 0, height);
 }
 
 void TextureScalerCommon::ScaleBicubicBSpline(int factor, u32* source, u32* dest, int width, int height) {
-	ParallelRangeLoop(&g_threadManager,std::bind(&scaleBicubicBSpline, factor, source, dest, width, height, std::placeholders::_1, std::placeholders::_2), 0, height, MIN_LINES_PER_THREAD);
+	RangeLoop(std::bind(&scaleBicubicBSpline, factor, source, dest, width, height, std::placeholders::_1, std::placeholders::_2), 0, height);
 }
 
 void TextureScalerCommon::ScaleBicubicMitchell(int factor, u32* source, u32* dest, int width, int height) {
-	ParallelRangeLoop(&g_threadManager,std::bind(&scaleBicubicMitchell, factor, source, dest, width, height, std::placeholders::_1, std::placeholders::_2), 0, height, MIN_LINES_PER_THREAD);
+	RangeLoop(std::bind(&scaleBicubicMitchell, factor, source, dest, width, height, std::placeholders::_1, std::placeholders::_2), 0, height);
 }
 
 void TextureScalerCommon::ScaleHybrid(int factor, u32* source, u32* dest, int width, int height, bool bicubic) {
@@ -728,8 +752,8 @@ void TextureScalerCommon::ScaleHybrid(int factor, u32* source, u32* dest, int wi
 	bufTmp2.resize(width*height*factor*factor);
 	bufTmp3.resize(width*height*factor*factor);
 
-	ParallelRangeLoop(&g_threadManager,std::bind(&generateDistanceMask, source, bufTmp1.data(), width, height, std::placeholders::_1, std::placeholders::_2), 0, height, MIN_LINES_PER_THREAD);
-	ParallelRangeLoop(&g_threadManager,std::bind(&convolve3x3, bufTmp1.data(), bufTmp2.data(), KERNEL_SPLAT, width, height, std::placeholders::_1, std::placeholders::_2), 0, height, MIN_LINES_PER_THREAD);
+	RangeLoop(std::bind(&generateDistanceMask, source, bufTmp1.data(), width, height, std::placeholders::_1, std::placeholders::_2), 0, height);
+	RangeLoop(std::bind(&convolve3x3, bufTmp1.data(), bufTmp2.data(), KERNEL_SPLAT, width, height, std::placeholders::_1, std::placeholders::_2), 0, height);
 	ScaleBilinear(factor, bufTmp2.data(), bufTmp3.data(), width, height);
 	// mask C is now in bufTmp3
 
@@ -742,13 +766,88 @@ void TextureScalerCommon::ScaleHybrid(int factor, u32* source, u32* dest, int wi
 
 	// Now we can mix it all together
 	// The factor 8192 was found through practical testing on a variety of textures
-	ParallelRangeLoop(&g_threadManager,std::bind(&mix, dest, bufTmp2.data(), bufTmp3.data(), 8192, width*factor, std::placeholders::_1, std::placeholders::_2), 0, height*factor, MIN_LINES_PER_THREAD);
+	RangeLoop(std::bind(&mix, dest, bufTmp2.data(), bufTmp3.data(), 8192, width*factor, std::placeholders::_1, std::placeholders::_2), 0, height*factor);
 }
 
 void TextureScalerCommon::DePosterize(u32* source, u32* dest, int width, int height) {
 	bufTmp3.resize(width*height);
-	ParallelRangeLoop(&g_threadManager,std::bind(&deposterizeH, source, bufTmp3.data(), width, std::placeholders::_1, std::placeholders::_2), 0, height, MIN_LINES_PER_THREAD);
-	ParallelRangeLoop(&g_threadManager,std::bind(&deposterizeV, bufTmp3.data(), dest, width, height, std::placeholders::_1, std::placeholders::_2), 0, height, MIN_LINES_PER_THREAD);
-	ParallelRangeLoop(&g_threadManager,std::bind(&deposterizeH, dest, bufTmp3.data(), width, std::placeholders::_1, std::placeholders::_2), 0, height, MIN_LINES_PER_THREAD);
-	ParallelRangeLoop(&g_threadManager,std::bind(&deposterizeV, bufTmp3.data(), dest, width, height, std::placeholders::_1, std::placeholders::_2), 0, height, MIN_LINES_PER_THREAD);
+	RangeLoop(std::bind(&deposterizeH, source, bufTmp3.data(), width, std::placeholders::_1, std::placeholders::_2), 0, height);
+	RangeLoop(std::bind(&deposterizeV, bufTmp3.data(), dest, width, height, std::placeholders::_1, std::placeholders::_2), 0, height);
+	RangeLoop(std::bind(&deposterizeH, dest, bufTmp3.data(), width, std::placeholders::_1, std::placeholders::_2), 0, height);
+	RangeLoop(std::bind(&deposterizeV, bufTmp3.data(), dest, width, height, std::placeholders::_1, std::placeholders::_2), 0, height);
+}
+
+/////////////////////////////////////// Background scaling
+
+struct TextureScaleJob::State {
+	std::vector<u32> src;
+	std::vector<u32> out;
+	int width;
+	int height;
+	int factor;
+	int scalingType;
+	bool deposterize;
+	std::atomic<bool> cancelled{};
+	std::atomic<bool> done{};
+};
+
+class TextureScaleTask : public Task {
+public:
+	TextureScaleTask(const std::shared_ptr<TextureScaleJob::State> &state) : state_(state) {}
+
+	TaskType Type() const override {
+		return TaskType::CPU_COMPUTE;
+	}
+
+	void Run() override {
+		State &state = *state_;
+		if (!state.cancelled) {
+			// A scaler per task, since they keep temporary buffers.
+			TextureScalerCommon scaler(false);
+			int w = state.width;
+			int h = state.height;
+			state.out.resize(w * h * state.factor * state.factor);
+			scaler.ScaleAlways(state.out.data(), state.src.data(), w, h, state.factor, state.scalingType, state.deposterize);
+		}
+		// The source is no longer needed, even if the job is kept around.
+		state.src.clear();
+		state.src.shrink_to_fit();
+		state.done = true;
+	}
+
+private:
+	typedef TextureScaleJob::State State;
+	std::shared_ptr<State> state_;
+};
+
+TextureScaleJob::TextureScaleJob(const u32 *src, int width, int height, int factor, u32 hash)
+	: state_(std::make_shared<State>()), width_(width), height_(height), factor_(factor), hash_(hash) {
+	scalingType_ = g_Config.iTexScalingType;
+	deposterize_ = g_Config.bTexDeposterize;
+	state_->src.assign(src, src + width * height);
+	state_->width = width;
+	state_->height = height;
+	state_->factor = factor;
+	state_->scalingType = scalingType_;
+	state_->deposterize = deposterize_;
+	g_threadManager.EnqueueTask(new TextureScaleTask(state_));
+}
+
+TextureScaleJob::~TextureScaleJob() {
+	// If it's already running, the task keeps the state alive until it's done.
+	state_->cancelled = true;
+}
+
+bool TextureScaleJob::Matches(int width, int height, int factor, u32 hash) const {
+	if (scalingType_ != g_Config.iTexScalingType || deposterize_ != g_Config.bTexDeposterize)
+		return false;
+	return width_ == width && height_ == height && factor_ == factor && hash_ == hash;
+}
+
+bool TextureScaleJob::IsReady() const {
+	return state_->done && !state_->cancelled;
+}
+
+const u32 *TextureScaleJob::Data() const {
+	return state_->out.data();
 }
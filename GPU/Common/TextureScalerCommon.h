@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <functional>
+#include <memory>
 #include "Common/CommonTypes.h"
 #include "Common/MemoryUtil.h"
 
@@ -27,12 +29,21 @@ static const int MIN_TEXSCALE_LINES_PER_THREAD = 4;
 // They will of course not unflip during the operation so be aware of that).
 class TextureScalerCommon {
 public:
-	TextureScalerCommon();
+	// If threaded is false, everything runs on the calling thread (i.e. when already on a worker.)
+	TextureScalerCommon(bool threaded = true);
 	~TextureScalerCommon();
 
 	void ScaleAlways(u32 *out, u32 *src, int &width, int &height, int factor);
+	// With settings captured beforehand, since g_Config shouldn't be read from a worker.
+	void ScaleAlways(u32 *out, u32 *src, int &width, int &height, int factor, int scalingType, bool deposterize);
 	bool Scale(u32 *&data, int &width, int &height, int factor);
 	bool ScaleInto(u32 *out, u32 *src, int &width, int &height, int factor);
+	bool ScaleInto(u32 *out, u32 *src, int &width, int &height, int factor, int scalingType, bool deposterize);
+	// Plain bilinear, quick enough to show until a TextureScaleJob is ready.
+	void ScalePlaceholder(u32 *out, u32 *src, int &width, int &height, int factor);
+
+	// Flat textures don't need any real scaling.
+	bool IsEmptyOrFlat(const u32 *data, int pixels) const;
 
 	enum { XBRZ = 0, HYBRID = 1, BICUBIC = 2, HYBRID_BICUBIC = 3 };
 
@@ -45,10 +56,37 @@ class TextureScalerCommon {
 
 	void DePosterize(u32* source, u32* dest, int width, int height);
 
-	bool IsEmptyOrFlat(const u32 *data, int pixels) const;
+	void RangeLoop(const std::function<void(int, int)> &loop, int lower, int upper);
+
+	bool threaded_;
 
 	// depending on the factor and texture sizes, these can get pretty large 
 	// maximum is (100 MB total for a 512 by 512 texture with scaling factor 5 and hybrid scaling)
 	// of course, scaling factor 5 is totally silly anyway
 	SimpleBuf<u32> bufDeposter, bufOutput, bufTmp1, bufTmp2, bufTmp3;
 };
+
+// Scales a copy of a texture on a worker thread, with the current scaling settings.
+// Destroying the job cancels it if it hasn't started yet, and never waits.
+class TextureScaleJob {
+public:
+	TextureScaleJob(const u32 *src, int width, int height, int factor, u32 hash);
+	~TextureScaleJob();
+
+	bool IsReady() const;
+	// True if this was started from the same texture contents and size, with the current settings.
+	bool Matches(int width, int height, int factor, u32 hash) const;
+	// Only valid once ready.  The scaled size is width * factor by height * factor.
+	const u32 *Data() const;
+
+private:
+	struct State;
+	std::shared_ptr<State> state_;
+	friend class TextureScaleTask;
+	int width_;
+	int height_;
+	int factor_;
+	u32 hash_;
+	int scalingType_;
+	bool deposterize_;
+};
@@ -254,6 +254,10 @@ class GPUCommon : public GPUInterface, public GPUDebugInterface {
 	bool FramebufferDirty() override;
 	bool FramebufferReallyDirty() override;
 
+	bool GetFrameCounters(GPUFrameCounters &counters) override {
+		return false;
+	}
+
 	typedef void (GPUCommon::*CmdFunc)(u32 op, u32 diff);
 
 	void GetReportingInfo(std::string &primaryInfo, std::string &fullInfo) override {
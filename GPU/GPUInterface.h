@@ -135,6 +135,25 @@ struct FramebufferInfo {
 	void* fbo;
 };
 
+// Detailed counters for the last frame, for tuning.  Only some backends have these.
+struct GPUFrameCounters {
+	struct Flush {
+		std::string reason;
+		int count;
+		double seconds;
+	};
+	struct Thread {
+		double busySeconds;
+		int tiles;
+		int steals;
+	};
+
+	// Name and value pairs, always in the same order for a backend.
+	std::vector<std::pair<std::string, int64_t>> counters;
+	std::vector<Flush> flushes;
+	std::vector<Thread> threads;
+};
+
 struct DisplayListStackEntry {
 	u32 pc;
 	u32 offsetAddr;
@@ -230,6 +249,8 @@ class GPUInterface {
 
 	// Tells the GPU to update the gpuStats structure.
 	virtual void GetStats(char *buffer, size_t bufsize) = 0;
+	// Returns false if the backend doesn't collect detailed counters.
+	virtual bool GetFrameCounters(GPUFrameCounters &counters) = 0;
 
 	// Invalidate any cached content sourced from the specified range.
 	// If size = -1, invalidate everything.
@@ -15,12 +15,15 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include <algorithm>
 #include <atomic>
 #include <condition_variable>
 #include <mutex>
 #include "Common/Profiler/Profiler.h"
 #include "Common/Thread/ThreadManager.h"
 #include "Common/TimeUtil.h"
+#include "Core/Config.h"
+#include "Core/MemMap.h"
 #include "Core/System.h"
 #include "GPU/Common/TextureDecoder.h"
 #include "GPU/Software/BinManager.h"
@@ -67,38 +70,42 @@ struct BinWaitable : public Waitable {
 	std::condition_variable cond_;
 };
 
-static inline void DrawBinItem(const BinItem &item, const RasterizerState &state) {
+static inline void DrawBinItem(const BinItem &item, const BinCoords &range, const RasterizerState &state) {
 	switch (item.type) {
 	case BinItemType::TRIANGLE:
-		DrawTriangle(item.v0, item.v1, item.v2, item.range, state);
+		DrawTriangle(item.v0, item.v1, item.v2, range, state);
 		break;
 
 	case BinItemType::CLEAR_RECT:
-		ClearRectangle(item.v0, item.v1, item.range, state);
+		ClearRectangle(item.v0, item.v1, range, state);
 		break;
 
 	case BinItemType::RECT:
-		DrawRectangle(item.v0, item.v1, item.range, state);
+		DrawRectangle(item.v0, item.v1, range, state);
 		break;
 
 	case BinItemType::SPRITE:
-		DrawSprite(item.v0, item.v1, item.range, state);
+		DrawSprite(item.v0, item.v1, range, state);
 		break;
 
 	case BinItemType::LINE:
-		DrawLine(item.v0, item.v1, item.range, state);
+		DrawLine(item.v0, item.v1, range, state);
 		break;
 
 	case BinItemType::POINT:
-		DrawPoint(item.v0, item.range, state);
+		DrawPoint(item.v0, range, state);
 		break;
 	}
 }
 
+static inline void DrawBinItem(const BinItem &item, const RasterizerState &state) {
+	DrawBinItem(item, item.range, state);
+}
+
 class DrawBinItemsTask : public Task {
 public:
-	DrawBinItemsTask(BinWaitable *notify, BinManager::BinItemQueue &items, std::atomic<bool> &status, const BinManager::BinStateQueue &states)
-		: notify_(notify), items_(items), status_(status), states_(states) {
+	DrawBinItemsTask(BinWaitable *notify, BinManager::BinItemQueue &items, std::atomic<bool> &status, const BinManager::BinStateQueue &states, std::atomic<double> &busyTime)
+		: notify_(notify), items_(items), status_(status), states_(states), busyTime_(busyTime) {
 	}
 
 	TaskType Type() const override {
@@ -106,10 +113,13 @@ class DrawBinItemsTask : public Task {
 	}
 
 	void Run() override {
+		double st = coreCollectDebugStats ? time_now_d() : 0.0;
 		ProcessItems();
 		status_ = false;
 		// In case of any atomic issues, do another pass.
 		ProcessItems();
+		if (coreCollectDebugStats)
+			busyTime_ = busyTime_ + (time_now_d() - st);
 		notify_->Drain();
 	}
 
@@ -130,9 +140,85 @@ class DrawBinItemsTask : public Task {
 	BinManager::BinItemQueue &items_;
 	std::atomic<bool> &status_;
 	const BinManager::BinStateQueue &states_;
+	std::atomic<double> &busyTime_;
+};
+
+class DrawBinTilesTask : public Task {
+public:
+	DrawBinTilesTask(BinManager &binner, int index)
+		: binner_(binner), index_(index) {
+	}
+
+	TaskType Type() const override {
+		return TaskType::CPU_COMPUTE;
+	}
+
+	void Run() override {
+		BinTileWorker &self = binner_.tileWorkers_[index_];
+		double st = coreCollectDebugStats ? time_now_d() : 0.0;
+
+		int tile;
+		while ((tile = TakeOwn(self)) != -1)
+			DrawTile(tile);
+
+		// Out of our own work, so help the others, starting with our neighbor.
+		for (int i = 1; i < binner_.numTileWorkers_; ++i) {
+			BinTileWorker &victim = binner_.tileWorkers_[(index_ + i) % binner_.numTileWorkers_];
+			while ((tile = Steal(victim)) != -1) {
+				self.steals++;
+				DrawTile(tile);
+			}
+		}
+
+		if (coreCollectDebugStats)
+			self.busyTime = self.busyTime + (time_now_d() - st);
+		binner_.waitable_->Drain();
+	}
+
+	void Release() override {
+		// Don't delete, this is statically allocated.
+	}
+
+private:
+	static int TakeOwn(BinTileWorker &worker) {
+		std::lock_guard<std::mutex> guard(worker.lock);
+		return worker.front < worker.back ? worker.front++ : -1;
+	}
+
+	static int Steal(BinTileWorker &worker) {
+		std::lock_guard<std::mutex> guard(worker.lock);
+		return worker.front < worker.back ? --worker.back : -1;
+	}
+
+	void DrawTile(int batchIndex) {
+		const int tile = binner_.batchTiles_[batchIndex];
+		const int tx = tile % BinManager::TILES_X;
+		const int ty = tile / BinManager::TILES_X;
+		BinCoords tileRange;
+		tileRange.x1 = tx * BinManager::TILE_WIDTH * SCREEN_SCALE_FACTOR;
+		tileRange.y1 = ty * BinManager::TILE_HEIGHT * SCREEN_SCALE_FACTOR;
+		tileRange.x2 = tileRange.x1 + BinManager::TILE_WIDTH * SCREEN_SCALE_FACTOR - 1;
+		tileRange.y2 = tileRange.y1 + BinManager::TILE_HEIGHT * SCREEN_SCALE_FACTOR - 1;
+
+		// Items are in queue order, so overlapping prims still draw in order.
+		for (uint16_t index : binner_.tileItems_[tile]) {
+			const BinItem &item = binner_.queue_[index];
+			DrawBinItem(item, tileRange.Intersect(item.range), binner_.states_[item.stateIndex]);
+		}
+		binner_.tileWorkers_[index_].tiles++;
+	}
+
+	BinManager &binner_;
+	int index_;
 };
 
 constexpr int BinManager::MAX_POSSIBLE_TASKS;
+constexpr int BinManager::TILE_WIDTH;
+constexpr int BinManager::TILE_HEIGHT;
+constexpr int BinManager::TILES_X;
+constexpr int BinManager::TILES_Y;
+constexpr int BinManager::DEPTH_TILE_SIZE;
+constexpr int BinManager::DEPTH_TILES;
 
 BinManager::BinManager() {
 	queueRange_.x1 = 0x7FFFFFFF;
@@ -148,11 +234,13 @@ BinManager::BinManager() {
 	for (int i = 0; i < maxInitTasks; ++i) {
 		taskQueues_[i].Setup();
 		for (DrawBinItemsTask *&task : taskLists_[i].tasks)
-			task = new DrawBinItemsTask(waitable_, taskQueues_[i], taskStatus_[i], states_);
+			task = new DrawBinItemsTask(waitable_, taskQueues_[i], taskStatus_[i], states_, tileWorkers_[i].busyTime);
+		tileTasks_[i] = new DrawBinTilesTask(*this, i);
 	}
 	states_.Setup();
 	cluts_.Setup();
 	queue_.Setup();
+	ResetDepthBounds();
 }
 
 BinManager::~BinManager() {
@@ -161,29 +249,43 @@ BinManager::~BinManager() {
 	for (int i = 0; i < MAX_POSSIBLE_TASKS; ++i) {
 		for (DrawBinItemsTask *task : taskLists_[i].tasks)
 			delete task;
+		delete tileTasks_[i];
 	}
 }
 
 void BinManager::UpdateState() {
 	PROFILE_THIS_SCOPE("bin_state");
-	if (HasDirty(SoftDirty::PIXEL_ALL | SoftDirty::SAMPLER_ALL | SoftDirty::RAST_ALL)) {
+	// If funcs finished compiling in the background, the current state may still be using fallbacks.
+	const int jitCompileCount = Rasterizer::JitCompileCount() + Sampler::JitCompileCount();
+	if (lastFlipstats_ != gpuStats.numFlips) {
+		lastFlipstats_ = gpuStats.numFlips;
+		ResetStats();
+
+		// The CPU may have written depth without telling us, so start over each frame.
+		if (depthBoundsKnown_)
+			ResetDepthBounds();
+		// Same for textures, which get rehashed when next used.
+		textureCache_.Decimate(gpuStats.numFlips);
+		if (states_.Size() != 0 && State().texDecoded)
+			SetDirty(SoftDirty::SAMPLER_BASIC);
+	}
+
+	bool newState = false;
+	if (HasDirty(SoftDirty::PIXEL_ALL | SoftDirty::SAMPLER_ALL | SoftDirty::RAST_ALL) || jitCompileCount != lastJitCompileCount_) {
 		if (states_.Full())
 			Flush("states");
+		lastJitCompileCount_ = jitCompileCount;
 		creatingState_ = true;
 		stateIndex_ = (uint16_t)states_.Push(RasterizerState());
 		// When new funcs are compiled, we need to flush if WX exclusive.
 		ComputeRasterizerState(&states_[stateIndex_], this);
 		states_[stateIndex_].samplerID.cached.clut = cluts_[clutIndex_].readable;
 		creatingState_ = false;
+		newState = true;
 
 		ClearDirty(SoftDirty::PIXEL_ALL | SoftDirty::SAMPLER_ALL | SoftDirty::RAST_ALL);
 	}
 
-	if (lastFlipstats_ != gpuStats.numFlips) {
-		lastFlipstats_ = gpuStats.numFlips;
-		ResetStats();
-	}
-
 	const auto &state = State();
 	const bool hadDepth = pendingWrites_[1].base != 0;
 
@@ -204,6 +306,7 @@ void BinManager::UpdateState() {
 
 		// Okay, now update what's pending.
 		MarkPendingWrites(state);
+		UpdateDepthBoundsTarget(state);
 
 		ClearDirty(SoftDirty::BINNER_RANGE);
 	} else if (pendingOverlap_) {
@@ -242,10 +345,31 @@ void BinManager::UpdateState() {
 		}
 		ClearDirty(SoftDirty::BINNER_OVERLAP);
 	}
+
+	// Last, since the pending writes now include this draw's target.
+	if (newState && g_Config.bSoftwareRenderingTexCache)
+		ApplyTextureCache(states_[stateIndex_]);
+}
+
+void BinManager::ApplyTextureCache(RasterizerState &state) {
+	// Can't decode a texture earlier draws haven't finished writing yet.
+	if (!state.enableTextures || HasTextureWrite(state))
+		return;
+
+	const DecodedTexture *decoded = textureCache_.Lookup(state, gpuStats.numFlips);
+	if (decoded)
+		Rasterizer::ApplyDecodedTexture(&state, decoded->texptr, decoded->texbufw, this);
+}
+
+void BinManager::InvalidateTextures(uint32_t addr, uint32_t size) {
+	// If the current state is using an old copy, make sure it's looked up again.
+	if (textureCache_.Invalidate(addr, size) && states_.Size() != 0 && State().texDecoded)
+		SetDirty(SoftDirty::SAMPLER_BASIC);
 }
 
 bool BinManager::HasTextureWrite(const RasterizerState &state) {
-	if (!state.enableTextures)
+	// A decoded copy isn't affected by later writes.
+	if (!state.enableTextures || state.texDecoded)
 		return false;
 
 	const uint8_t textureBits = textureBitsPerPixel[state.samplerID.texfmt];
@@ -295,7 +419,7 @@ bool BinManager::IsExactSelfRender(const Rasterizer::RasterizerState &state, con
 }
 
 void BinManager::MarkPendingReads(const Rasterizer::RasterizerState &state) {
-	if (!state.enableTextures)
+	if (!state.enableTextures || state.texDecoded)
 		return;
 
 	const uint8_t textureBits = textureBitsPerPixel[state.samplerID.texfmt];
@@ -359,6 +483,190 @@ inline void BinDirtyRange::Expand(uint32_t newBase, uint32_t bpp, uint32_t strid
 	widthBytes = strideBytes;
 }
 
+void BinManager::UpdateDepthBoundsTarget(const RasterizerState &state) {
+	constexpr uint32_t mirrorMask = 0x041FFFFF;
+	const uint32_t depthAddr = gstate.getDepthBufAddress() & mirrorMask;
+	const uint32_t depthStride = gstate.DepthBufStride();
+	if (depthAddr != depthBoundsAddr_ || depthStride != depthBoundsStride_) {
+		depthBoundsAddr_ = depthAddr;
+		depthBoundsStride_ = depthStride;
+		if (depthBoundsKnown_)
+			ResetDepthBounds();
+	}
+
+	// We don't know what values color writes leave in depth, so we can't trust any bounds.
+	const uint32_t bpp = state.pixelID.FBFormat() == GE_FORMAT_8888 ? 4 : 2;
+	const uint32_t fbAddr = gstate.getFrameBufAddress() & mirrorMask;
+	const uint32_t fbStart = fbAddr + gstate.getScissorY1() * gstate.FrameBufStride() * bpp;
+	const uint32_t fbEnd = fbAddr + (std::min(gstate.getScissorY2(), gstate.getRegionY2()) + 1) * gstate.FrameBufStride() * bpp;
+	const uint32_t depthEnd = depthAddr + depthStride * 2 * 1024;
+	depthBoundsAliased_ = fbStart < depthEnd && fbEnd > depthAddr;
+}
+
+void BinManager::ResetDepthBounds() {
+	for (BinDepthBounds &bounds : depthBounds_) {
+		bounds.minZ = 0;
+		bounds.maxZ = 0xFFFF;
+	}
+	depthBoundsKnown_ = false;
+}
+
+void BinManager::InvalidateDepthBounds(uint32_t addr, uint32_t size) {
+	if (!depthBoundsKnown_ || size == 0 || !Memory::IsVRAMAddress(addr))
+		return;
+
+	const uint32_t rowBytes = depthBoundsStride_ * 2;
+	if (rowBytes == 0) {
+		ResetDepthBounds();
+		return;
+	}
+
+	// The depth buffer may run off the end of VRAM into the next mirror, so check there too.
+	constexpr uint32_t mirrorMask = 0x041FFFFF;
+	const uint32_t start = addr & mirrorMask;
+	const uint32_t depthEnd = depthBoundsAddr_ + rowBytes * 1024;
+	for (uint32_t mirror : { 0U, 0x00200000U }) {
+		const uint32_t writeStart = std::max(start + mirror, depthBoundsAddr_);
+		const uint32_t writeEnd = std::min(start + mirror + size, depthEnd);
+		if (writeStart >= writeEnd)
+			continue;
+
+		const int ty1 = (writeStart - depthBoundsAddr_) / rowBytes / DEPTH_TILE_SIZE;
+		const int ty2 = (writeEnd - 1 - depthBoundsAddr_) / rowBytes / DEPTH_TILE_SIZE;
+		for (int i = ty1 * DEPTH_TILES; i < (ty2 + 1) * DEPTH_TILES; ++i) {
+			depthBounds_[i].minZ = 0;
+			depthBounds_[i].maxZ = 0xFFFF;
+		}
+	}
+}
+
+static inline bool DepthBoundsFail(GEComparison func, const BinDepthBounds &bounds, uint16_t minZ, uint16_t maxZ) {
+	switch (func) {
+	case GE_COMP_NEVER:
+		return true;
+	case GE_COMP_EQUAL:
+		return maxZ < bounds.minZ || minZ > bounds.maxZ;
+	case GE_COMP_LESS:
+		return minZ >= bounds.maxZ;
+	case GE_COMP_LEQUAL:
+		return minZ > bounds.maxZ;
+	case GE_COMP_GREATER:
+		return maxZ <= bounds.minZ;
+	case GE_COMP_GEQUAL:
+		return maxZ < bounds.minZ;
+	default:
+		return false;
+	}
+}
+
+static inline void PadDepthRange(uint16_t &minZ, uint16_t &maxZ) {
+	// Interpolated Z is truncated, so allow for rounding either way.
+	if (minZ > 0)
+		minZ--;
+	if (maxZ < 0xFFFF)
+		maxZ++;
+}
+
+bool BinManager::CullByDepthBounds(const RasterizerState &state, BinCoords &range, uint16_t minZ, uint16_t maxZ) {
+	if (!depthBoundsKnown_ || depthBoundsAliased_ || !g_Config.bSoftwareRenderingHiZ)
+		return false;
+
+	const PixelFuncID &pixelID = state.pixelID;
+	const GEComparison func = pixelID.DepthTestFunc();
+	if (pixelID.clearMode || func == GE_COMP_ALWAYS || func == GE_COMP_NOTEQUAL)
+		return false;
+	// Pixels that fail stencil or depth can still write stencil.
+	if (pixelID.stencilTest && (pixelID.SFail() != GE_STENCILOP_KEEP || pixelID.ZFail() != GE_STENCILOP_KEEP))
+		return false;
+
+	PadDepthRange(minZ, maxZ);
+
+	constexpr int tileScreenSize = DEPTH_TILE_SIZE * SCREEN_SCALE_FACTOR;
+	int passX1 = DEPTH_TILES, passY1 = DEPTH_TILES;
+	int passX2 = -1, passY2 = -1;
+	for (int ty = range.y1 / tileScreenSize; ty <= range.y2 / tileScreenSize; ++ty) {
+		for (int tx = range.x1 / tileScreenSize; tx <= range.x2 / tileScreenSize; ++tx) {
+			if (DepthBoundsFail(func, depthBounds_[ty * DEPTH_TILES + tx], minZ, maxZ))
+				continue;
+			passX1 = std::min(passX1, tx);
+			passY1 = std::min(passY1, ty);
+			passX2 = std::max(passX2, tx);
+			passY2 = std::max(passY2, ty);
+		}
+	}
+
+	if (passX2 == -1) {
+		depthCulled_++;
+		return true;
+	}
+
+	BinCoords passRange;
+	passRange.x1 = passX1 * tileScreenSize;
+	passRange.y1 = passY1 * tileScreenSize;
+	passRange.x2 = (passX2 + 1) * tileScreenSize - 1;
+	passRange.y2 = (passY2 + 1) * tileScreenSize - 1;
+	const BinCoords trimmed = range.Intersect(passRange);
+	if (trimmed.x1 != range.x1 || trimmed.y1 != range.y1 || trimmed.x2 != range.x2 || trimmed.y2 != range.y2) {
+		depthTrimmed_++;
+		range = trimmed;
+	}
+	return false;
+}
+
+void BinManager::WidenDepthBounds(const RasterizerState &state, const BinCoords &range, uint16_t minZ, uint16_t maxZ) {
+	// When nothing is known, every tile already covers any value.
+	if (!depthBoundsKnown_)
+		return;
+	if (depthBoundsAliased_) {
+		ResetDepthBounds();
+		return;
+	}
+	if (!state.pixelID.depthWrite)
+		return;
+
+	PadDepthRange(minZ, maxZ);
+
+	constexpr int tileScreenSize = DEPTH_TILE_SIZE * SCREEN_SCALE_FACTOR;
+	for (int ty = range.y1 / tileScreenSize; ty <= range.y2 / tileScreenSize; ++ty) {
+		for (int tx = range.x1 / tileScreenSize; tx <= range.x2 / tileScreenSize; ++tx) {
+			BinDepthBounds &bounds = depthBounds_[ty * DEPTH_TILES + tx];
+			bounds.minZ = std::min(bounds.minZ, minZ);
+			bounds.maxZ = std::max(bounds.maxZ, maxZ);
+		}
+	}
+}
+
+void BinManager::ClearDepthBounds(const RasterizerState &state, const BinCoords &range, const VertexData &v0, const VertexData &v1) {
+	const uint16_t z = v1.screenpos.z;
+	if (!state.pixelID.DepthClear() || depthBoundsAliased_ || !g_Config.bSoftwareRenderingHiZ) {
+		WidenDepthBounds(state, range, z, z);
+		return;
+	}
+
+	// Pixels this clear definitely writes, see ClearRectangle().  Rounded in, to be safe.
+	const int x1 = std::max((std::min(v0.screenpos.x, v1.screenpos.x) + SCREEN_SCALE_FACTOR - 1) / SCREEN_SCALE_FACTOR, range.x1 / SCREEN_SCALE_FACTOR);
+	const int y1 = std::max((std::min(v0.screenpos.y, v1.screenpos.y) + SCREEN_SCALE_FACTOR - 1) / SCREEN_SCALE_FACTOR, range.y1 / SCREEN_SCALE_FACTOR);
+	const int x2 = std::min(std::max(v0.screenpos.x, v1.screenpos.x) / SCREEN_SCALE_FACTOR - 1, range.x2 / SCREEN_SCALE_FACTOR);
+	const int y2 = std::min(std::max(v0.screenpos.y, v1.screenpos.y) / SCREEN_SCALE_FACTOR - 1, range.y2 / SCREEN_SCALE_FACTOR);
+
+	constexpr int tileScreenSize = DEPTH_TILE_SIZE * SCREEN_SCALE_FACTOR;
+	for (int ty = range.y1 / tileScreenSize; ty <= range.y2 / tileScreenSize; ++ty) {
+		for (int tx = range.x1 / tileScreenSize; tx <= range.x2 / tileScreenSize; ++tx) {
+			BinDepthBounds &bounds = depthBounds_[ty * DEPTH_TILES + tx];
+			const int px = tx * DEPTH_TILE_SIZE;
+			const int py = ty * DEPTH_TILE_SIZE;
+			if (px >= x1 && py >= y1 && px + DEPTH_TILE_SIZE - 1 <= x2 && py + DEPTH_TILE_SIZE - 1 <= y2) {
+				bounds.minZ = z;
+				bounds.maxZ = z;
+				depthBoundsKnown_ = true;
+			} else if (depthBoundsKnown_) {
+				bounds.minZ = std::min(bounds.minZ, z);
+				bounds.maxZ = std::max(bounds.maxZ, z);
+			}
+		}
+	}
+}
+
 void BinManager::UpdateClut(const void *src) {
 	PROFILE_THIS_SCOPE("bin_clut");
 	if (cluts_.Full())
@@ -368,87 +676,132 @@ void BinManager::UpdateClut(const void *src) {
 }
 
 void BinManager::AddTriangle(const VertexData &v0, const VertexData &v1, const VertexData &v2) {
-	Vec2<int> d01((int)v0.screenpos.x - (int)v1.screenpos.x, (int)v0.screenpos.y - (int)v1.screenpos.y);
-	Vec2<int> d02((int)v0.screenpos.x - (int)v2.screenpos.x, (int)v0.screenpos.y - (int)v2.screenpos.y);
-	Vec2<int> d12((int)v1.screenpos.x - (int)v2.screenpos.x, (int)v1.screenpos.y - (int)v2.screenpos.y);
-
-	// Drop primitives which are not in CCW order by checking the cross product.
-	static_assert(SCREEN_SCALE_FACTOR <= 16, "Fails if scale factor is too high");
-	if (d01.x * d02.y - d01.y * d02.x < 0)
-		return;
-	// If all points have identical coords, we'll have 0 weights and not skip properly, so skip here.
-	if ((d01.x == 0 && d02.x == 0) || (d01.y == 0 && d02.y == 0))
+	if (IsCulledTriangle(v0, v1, v2)) {
+		backfaceCulled_++;
 		return;
+	}
 
 	// Was it fully outside the scissor?
-	const BinCoords range = Range(v0, v1, v2);
-	if (range.Invalid())
+	BinCoords range = Range(v0, v1, v2);
+	if (range.Invalid()) {
+		scissorCulled_++;
 		return;
+	}
 
-	if (queue_.Full())
+	// Or entirely behind what's already drawn?
+	const uint16_t minZ = std::min(std::min(v0.screenpos.z, v1.screenpos.z), v2.screenpos.z);
+	const uint16_t maxZ = std::max(std::max(v0.screenpos.z, v1.screenpos.z), v2.screenpos.z);
+	if (CullByDepthBounds(states_[stateIndex_], range, minZ, maxZ))
+		return;
+
+	if (queue_.Full()) {
+		queueFullDrains_++;
 		Drain();
+	}
+	binned_[(int)BinItemType::TRIANGLE]++;
 	queue_.Push(BinItem{ BinItemType::TRIANGLE, stateIndex_, range, v0, v1, v2 });
 	CalculateRasterStateFlags(&states_[stateIndex_], v0, v1, v2);
+	WidenDepthBounds(states_[stateIndex_], range, minZ, maxZ);
 	Expand(range);
 }
 
 void BinManager::AddClearRect(const VertexData &v0, const VertexData &v1) {
 	const BinCoords range = Range(v0, v1);
-	if (range.Invalid())
+	if (range.Invalid()) {
+		scissorCulled_++;
 		return;
+	}
 
-	if (queue_.Full())
+	if (queue_.Full()) {
+		queueFullDrains_++;
 		Drain();
+	}
+	binned_[(int)BinItemType::CLEAR_RECT]++;
 	queue_.Push(BinItem{ BinItemType::CLEAR_RECT, stateIndex_, range, v0, v1 });
 	CalculateRasterStateFlags(&states_[stateIndex_], v0, v1, true);
+	ClearDepthBounds(states_[stateIndex_], range, v0, v1);
 	Expand(range);
 }
 
 void BinManager::AddRect(const VertexData &v0, const VertexData &v1) {
-	const BinCoords range = Range(v0, v1);
-	if (range.Invalid())
+	BinCoords range = Range(v0, v1);
+	if (range.Invalid()) {
+		scissorCulled_++;
+		return;
+	}
+
+	const uint16_t minZ = std::min(v0.screenpos.z, v1.screenpos.z);
+	const uint16_t maxZ = std::max(v0.screenpos.z, v1.screenpos.z);
+	if (CullByDepthBounds(states_[stateIndex_], range, minZ, maxZ))
 		return;
 
-	if (queue_.Full())
+	if (queue_.Full()) {
+		queueFullDrains_++;
 		Drain();
+	}
+	binned_[(int)BinItemType::RECT]++;
 	queue_.Push(BinItem{ BinItemType::RECT, stateIndex_, range, v0, v1 });
 	CalculateRasterStateFlags(&states_[stateIndex_], v0, v1, true);
+	WidenDepthBounds(states_[stateIndex_], range, minZ, maxZ);
 	Expand(range);
 }
 
 void BinManager::AddSprite(const VertexData &v0, const VertexData &v1) {
-	const BinCoords range = Range(v0, v1);
-	if (range.Invalid())
+	BinCoords range = Range(v0, v1);
+	if (range.Invalid()) {
+		scissorCulled_++;
+		return;
+	}
+
+	const uint16_t minZ = std::min(v0.screenpos.z, v1.screenpos.z);
+	const uint16_t maxZ = std::max(v0.screenpos.z, v1.screenpos.z);
+	if (CullByDepthBounds(states_[stateIndex_], range, minZ, maxZ))
 		return;
 
-	if (queue_.Full())
+	if (queue_.Full()) {
+		queueFullDrains_++;
 		Drain();
+	}
+	binned_[(int)BinItemType::SPRITE]++;
 	queue_.Push(BinItem{ BinItemType::SPRITE, stateIndex_, range, v0, v1 });
 	CalculateRasterStateFlags(&states_[stateIndex_], v0, v1, true);
+	WidenDepthBounds(states_[stateIndex_], range, minZ, maxZ);
 	Expand(range);
 }
 
 void BinManager::AddLine(const VertexData &v0, const VertexData &v1) {
 	const BinCoords range = Range(v0, v1);
-	if (range.Invalid())
+	if (range.Invalid()) {
+		scissorCulled_++;
 		return;
+	}
 
-	if (queue_.Full())
+	if (queue_.Full()) {
+		queueFullDrains_++;
 		Drain();
+	}
+	binned_[(int)BinItemType::LINE]++;
 	queue_.Push(BinItem{ BinItemType::LINE, stateIndex_, range, v0, v1 });
 	CalculateRasterStateFlags(&states_[stateIndex_], v0, v1, false);
+	WidenDepthBounds(states_[stateIndex_], range, std::min(v0.screenpos.z, v1.screenpos.z), std::max(v0.screenpos.z, v1.screenpos.z));
 	Expand(range);
 }
 
 void BinManager::AddPoint(const VertexData &v0) {
 	const BinCoords range = Range(v0);
-	if (range.Invalid())
+	if (range.Invalid()) {
+		scissorCulled_++;
 		return;
+	}
 
-	if (queue_.Full())
+	if (queue_.Full()) {
+		queueFullDrains_++;
 		Drain();
+	}
+	binned_[(int)BinItemType::POINT]++;
 	queue_.Push(BinItem{ BinItemType::POINT, stateIndex_, range, v0 });
 	CalculateRasterStateFlags(&states_[stateIndex_], v0);
+	WidenDepthBounds(states_[stateIndex_], range, v0.screenpos.z, v0.screenpos.z);
 	Expand(range);
 }
 
@@ -457,6 +810,10 @@ void BinManager::Drain(bool flushing) {
 
 	// If the waitable has fully drained, we can update our binning decisions.
 	if (!tasksSplit_ || waitable_->Empty()) {
+		// Any tile batch is done drawing, so release its items first.
+		for (; tileBatchSize_ > 0; --tileBatchSize_)
+			queue_.SkipNext();
+
 		int w2 = (queueRange_.x2 - queueRange_.x1 + (SCREEN_SCALE_FACTOR * 2 - 1)) / (SCREEN_SCALE_FACTOR * 2);
 		int h2 = (queueRange_.y2 - queueRange_.y1 + (SCREEN_SCALE_FACTOR * 2 - 1)) / (SCREEN_SCALE_FACTOR * 2);
 
@@ -473,7 +830,11 @@ void BinManager::Drain(bool flushing) {
 		}
 
 		taskRanges_.clear();
-		if (h2 >= 18 && w2 >= h2 * 4) {
+		useTiles_ = false;
+		if (h2 >= 18 && w2 >= 18 && maxTasks_ > 1 && g_Config.bSoftwareRenderingTileStealing) {
+			// Split into small tiles instead, so idle threads can take work from busy ones.
+			useTiles_ = true;
+		} else if (h2 >= 18 && w2 >= h2 * 4) {
 			int bin_w = std::max(4, (w2 + maxTasks_ - 1) / maxTasks_) * SCREEN_SCALE_FACTOR * 2;
 			taskRanges_.push_back(BinCoords{ tl.x, tl.y, queueRange_.x1 + bin_w - 1, br.y - 1 });
 			for (int x = queueRange_.x1 + bin_w; x <= queueRange_.x2; x += bin_w) {
@@ -496,7 +857,9 @@ void BinManager::Drain(bool flushing) {
 	OptimizePendingStates(pendingStateIndex_, stateIndex_);
 	pendingStateIndex_ = stateIndex_;
 
-	if (taskRanges_.size() <= 1) {
+	if (useTiles_) {
+		DrainTiles(flushing);
+	} else if (taskRanges_.size() <= 1) {
 		PROFILE_THIS_SCOPE("bin_drain_single");
 		while (!queue_.Empty()) {
 			const BinItem &item = queue_.PeekNext();
@@ -514,8 +877,10 @@ void BinManager::Drain(bool flushing) {
 
 				if (taskQueues_[i].NearFull()) {
 					// This shouldn't often happen, but if it does, wait for space.
-					if (taskQueues_[i].Full())
+					if (taskQueues_[i].Full()) {
+						threadWaits_++;
 						waitable_->Wait();
+					}
 					// If we're not flushing and not near full, let's just continue later.
 					// Near full means we'd drain on next prim, so better to finish it now.
 					else if (!flushing && !queue_.NearFull())
@@ -550,6 +915,72 @@ void BinManager::Drain(bool flushing) {
 	}
 }
 
+void BinManager::DrainTiles(bool flushing) {
+	if (!waitable_->Empty()) {
+		// Let the last batch keep drawing unless we're out of room.
+		if (!flushing && !queue_.Full())
+			return;
+		if (!flushing)
+			threadWaits_++;
+		waitable_->Wait();
+	}
+
+	for (; tileBatchSize_ > 0; --tileBatchSize_)
+		queue_.SkipNext();
+	if (queue_.Empty())
+		return;
+
+	// Leave room to keep queueing while this batch draws, unless we're flushing anyway.
+	int count = (int)queue_.Size();
+	if (!flushing)
+		count = std::min(count, QUEUED_PRIMS / 2);
+
+	for (uint16_t tile : batchTiles_)
+		tileItems_[tile].clear();
+	batchTiles_.clear();
+
+	const int tileW = TILE_WIDTH * SCREEN_SCALE_FACTOR;
+	const int tileH = TILE_HEIGHT * SCREEN_SCALE_FACTOR;
+	for (int i = 0; i < count; ++i) {
+		size_t index = queue_.head_ + i;
+		if (index >= QUEUED_PRIMS)
+			index -= QUEUED_PRIMS;
+		const BinCoords &range = queue_[index].range;
+
+		const int tx2 = std::min(range.x2 / tileW, TILES_X - 1);
+		const int ty2 = std::min(range.y2 / tileH, TILES_Y - 1);
+		for (int ty = range.y1 / tileH; ty <= ty2; ++ty) {
+			for (int tx = range.x1 / tileW; tx <= tx2; ++tx) {
+				std::vector<uint16_t> &items = tileItems_[ty * TILES_X + tx];
+				if (items.empty())
+					batchTiles_.push_back((uint16_t)(ty * TILES_X + tx));
+				items.push_back((uint16_t)index);
+			}
+		}
+	}
+	tileBatchSize_ = count;
+
+	// Give each thread a contiguous span of tiles, which keeps neighboring tiles' cache lines together.
+	std::sort(batchTiles_.begin(), batchTiles_.end());
+	const int numTiles = (int)batchTiles_.size();
+	numTileWorkers_ = std::min(maxTasks_, numTiles);
+	for (int i = 0; i < numTileWorkers_; ++i) {
+		BinTileWorker &worker = tileWorkers_[i];
+		std::lock_guard<std::mutex> guard(worker.lock);
+		worker.front = numTiles * i / numTileWorkers_;
+		worker.back = numTiles * (i + 1) / numTileWorkers_;
+	}
+
+	for (int i = 0; i < numTileWorkers_; ++i) {
+		waitable_->Fill();
+		g_threadManager.EnqueueTaskOnThread(i, tileTasks_[i], true);
+		enqueues_++;
+	}
+
+	tileBatches_++;
+	mostThreads_ = std::max(mostThreads_, numTileWorkers_);
+}
+
 void BinManager::Flush(const char *reason) {
 	if (queueRange_.x1 == 0x7FFFFFFF)
 		return;
@@ -561,6 +992,7 @@ void BinManager::Flush(const char *reason) {
 	waitable_->Wait();
 	taskRanges_.clear();
 	tasksSplit_ = false;
+	tileBatchSize_ = 0;
 
 	queue_.Reset();
 	while (states_.Size() > 1)
@@ -568,18 +1000,28 @@ void BinManager::Flush(const char *reason) {
 	while (cluts_.Size() > 1)
 		cluts_.SkipNext();
 
-	Rasterizer::FlushJit();
-	Sampler::FlushJit();
+	// Both need to run, they each may clear.
+	const bool pixelCleared = Rasterizer::FlushJit();
+	const bool samplerCleared = Sampler::FlushJit();
+	// The state we kept might still be drawn with, but its funcs may point into cleared code.
+	if ((pixelCleared || samplerCleared) && states_.Size() != 0)
+		RefreshRasterizerFuncs(&states_[stateIndex_]);
 
 	queueRange_.x1 = 0x7FFFFFFF;
 	queueRange_.y1 = 0x7FFFFFFF;
 	queueRange_.x2 = 0;
 	queueRange_.y2 = 0;
 
-	for (auto &pending : pendingWrites_)
+	for (auto &pending : pendingWrites_) {
+		if (pending.base != 0)
+			InvalidateTextures(pending.base, pending.strideBytes * pending.height);
 		pending.base = 0;
+	}
 	pendingOverlap_ = false;
 	pendingReads_.clear();
+	// Nothing is drawing now, so old decoded textures can go.
+	if (states_.Size() != 0)
+		textureCache_.FreeRetired(State());
 
 	// We'll need to set the pending writes and reads again, since we just flushed it.
 	dirty_ |= SoftDirty::BINNER_RANGE | SoftDirty::BINNER_OVERLAP;
@@ -587,6 +1029,7 @@ void BinManager::Flush(const char *reason) {
 	if (coreCollectDebugStats) {
 		double et = time_now_d();
 		flushReasonTimes_[reason] += et - st;
+		flushReasonCounts_[reason]++;
 		if (et - st > slowestFlushTime_) {
 			slowestFlushTime_ = et - st;
 			slowestFlushReason_ = reason;
@@ -694,12 +1137,77 @@ void BinManager::GetStats(char *buffer, size_t bufsize) {
 		"Slowest frame flush: %s (%0.4f)\n"
 		"Slowest recent flush: %s (%0.4f)\n"
 		"Total flush time: %0.4f (%05.2f%%, last 2: %05.2f%%)\n"
-		"Thread enqueues: %d, count %d",
+		"Thread enqueues: %d, count %d\n"
+		"Tile batches: %d\n"
+		"Depth bounds: %d culled, %d trimmed\n"
+		"Decoded textures: %d decoded, %d hits, %d KB",
 		slowestFlushReason_, slowestFlushTime_,
 		slowestTotalReason, slowestTotalTime,
 		slowestRecentReason, slowestRecentTime,
 		allTotal, allTotal * (6000.0 / 1.001), recentTotal * (3000.0 / 1.001),
-		enqueues_, mostThreads_);
+		enqueues_, mostThreads_, tileBatches_,
+		depthCulled_, depthTrimmed_,
+		textureCache_.Decodes(), textureCache_.Hits(), (int)(textureCache_.Bytes() / 1024));
+
+	if (tileBatches_ == 0)
+		return;
+
+	// Utilization is relative to a 60 FPS frame, like the flush times.
+	int maxThreads = std::min(g_threadManager.GetNumLooperThreads(), MAX_POSSIBLE_TASKS);
+	for (int i = 0; i < maxThreads; ++i) {
+		size_t len = strlen(buffer);
+		if (len + 1 >= bufsize)
+			break;
+		const BinTileWorker &worker = tileWorkers_[i];
+		snprintf(buffer + len, bufsize - len, "\nThread %d: %05.2f%%, %d tiles, %d steals", i, worker.busyTime * (6000.0 / 1.001), (int)worker.tiles, (int)worker.steals);
+	}
+}
+
+void BinManager::GetFrameCounters(GPUFrameCounters &counters) {
+	int pixelJitHits, pixelJitMisses, samplerJitHits, samplerJitMisses;
+	Rasterizer::JitLookupCounts(&pixelJitHits, &pixelJitMisses);
+	Sampler::JitLookupCounts(&samplerJitHits, &samplerJitMisses);
+	int64_t pixelsCovered, pixelsEarlyRejected;
+	Rasterizer::PixelCounts(&pixelsCovered, &pixelsEarlyRejected);
+
+	counters.counters = {
+		{ "trianglesBinned", binned_[(int)BinItemType::TRIANGLE] },
+		{ "clearRectsBinned", binned_[(int)BinItemType::CLEAR_RECT] },
+		{ "rectsBinned", binned_[(int)BinItemType::RECT] },
+		{ "spritesBinned", binned_[(int)BinItemType::SPRITE] },
+		{ "linesBinned", binned_[(int)BinItemType::LINE] },
+		{ "pointsBinned", binned_[(int)BinItemType::POINT] },
+		{ "primsCulledBackface", backfaceCulled_ },
+		{ "primsCulledScissor", scissorCulled_ },
+		{ "primsCulledDepthBounds", depthCulled_ },
+		{ "primsTrimmedDepthBounds", depthTrimmed_ },
+		// Only triangles and rectangles, and only while debug stats are on.
+		{ "pixelsCovered", pixelsCovered - pixelsCoveredStart_ },
+		{ "pixelsRejectedEarlyZ", pixelsEarlyRejected - pixelsEarlyRejectedStart_ },
+		{ "pixelJitHits", pixelJitHits - pixelJitHitsStart_ },
+		{ "pixelJitMisses", pixelJitMisses - pixelJitMissesStart_ },
+		{ "samplerJitHits", samplerJitHits - samplerJitHitsStart_ },
+		{ "samplerJitMisses", samplerJitMisses - samplerJitMissesStart_ },
+		{ "queueFullDrains", queueFullDrains_ },
+		{ "threadWaits", threadWaits_ },
+		{ "threadEnqueues", enqueues_ },
+		{ "tileBatches", tileBatches_ },
+		{ "texturesDecoded", textureCache_.Decodes() },
+		{ "decodedTextureHits", textureCache_.Hits() },
+	};
+
+	counters.flushes.clear();
+	for (auto &it : flushReasonCounts_) {
+		auto time = flushReasonTimes_.find(it.first);
+		counters.flushes.push_back(GPUFrameCounters::Flush{ it.first, it.second, time != flushReasonTimes_.end() ? time->second : 0.0 });
+	}
+
+	counters.threads.clear();
+	int maxThreads = std::min(g_threadManager.GetNumLooperThreads(), MAX_POSSIBLE_TASKS);
+	for (int i = 0; i < maxThreads; ++i) {
+		const BinTileWorker &worker = tileWorkers_[i];
+		counters.threads.push_back(GPUFrameCounters::Thread{ worker.busyTime, worker.tiles, worker.steals });
+	}
 }
 
 void BinManager::ResetStats() {
@@ -709,6 +1217,25 @@ void BinManager::ResetStats() {
 	slowestFlushTime_ = 0.0;
 	enqueues_ = 0;
 	mostThreads_ = 0;
+	tileBatches_ = 0;
+	depthCulled_ = 0;
+	depthTrimmed_ = 0;
+	for (int &count : binned_)
+		count = 0;
+	backfaceCulled_ = 0;
+	scissorCulled_ = 0;
+	queueFullDrains_ = 0;
+	threadWaits_ = 0;
+	flushReasonCounts_.clear();
+	textureCache_.ResetStats();
+	Rasterizer::JitLookupCounts(&pixelJitHitsStart_, &pixelJitMissesStart_);
+	Sampler::JitLookupCounts(&samplerJitHitsStart_, &samplerJitMissesStart_);
+	Rasterizer::PixelCounts(&pixelsCoveredStart_, &pixelsEarlyRejectedStart_);
+	for (BinTileWorker &worker : tileWorkers_) {
+		worker.tiles = 0;
+		worker.steals = 0;
+		worker.busyTime = 0.0;
+	}
 }
 
 inline BinCoords BinCoords::Intersect(const BinCoords &range) const {
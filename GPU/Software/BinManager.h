@@ -18,11 +18,16 @@
 #pragma once
 
 #include <atomic>
+#include <mutex>
 #include <unordered_map>
+#include <vector>
+#include "GPU/GPUInterface.h"
 #include "GPU/Software/Rasterizer.h"
+#include "GPU/Software/TextureDecodeCache.h"
 
 struct BinWaitable;
 class DrawBinItemsTask;
+class DrawBinTilesTask;
 
 enum class BinItemType : uint8_t {
 	TRIANGLE,
@@ -180,6 +185,25 @@ struct BinDirtyRange {
 	void Expand(uint32_t newBase, uint32_t bpp, uint32_t stride, const DrawingCoords &tl, const DrawingCoords &br);
 };
 
+// Coarse range of the values in a tile of the depth buffer, as of the prims binned so far.
+struct BinDepthBounds {
+	uint16_t minZ;
+	uint16_t maxZ;
+};
+
+// In tile mode, each thread owns a span of the batch's tiles, and takes from the front.
+// Threads that run out steal from the back of another thread's span.
+struct BinTileWorker {
+	std::mutex lock;
+	int front = 0;
+	int back = 0;
+
+	// Stats, reset each frame.  Only the owning thread writes these.
+	std::atomic<int> tiles{};
+	std::atomic<int> steals{};
+	std::atomic<double> busyTime{};
+};
+
 class BinManager {
 public:
 	BinManager();
@@ -193,6 +217,8 @@ class BinManager {
 	}
 
 	void AddTriangle(const VertexData &v0, const VertexData &v1, const VertexData &v2);
+	// True if AddTriangle() would drop this for its winding or for being degenerate.
+	static inline bool IsCulledTriangle(const VertexData &v0, const VertexData &v1, const VertexData &v2);
 	void AddClearRect(const VertexData &v0, const VertexData &v1);
 	void AddRect(const VertexData &v0, const VertexData &v1);
 	void AddSprite(const VertexData &v0, const VertexData &v1);
@@ -204,8 +230,13 @@ class BinManager {
 	bool HasPendingWrite(uint32_t start, uint32_t stride, uint32_t w, uint32_t h);
 	// Assumes you've also checked for a write (writes are partial so are automatically reads.)
 	bool HasPendingRead(uint32_t start, uint32_t stride, uint32_t w, uint32_t h);
+	// Call when something other than drawing (CPU, block transfer) writes to VRAM.
+	void InvalidateDepthBounds(uint32_t addr, uint32_t size);
+	// Call when anything writes to memory textures may be decoded from.
+	void InvalidateTextures(uint32_t addr, uint32_t size);
 
 	void GetStats(char *buffer, size_t bufsize);
+	void GetFrameCounters(GPUFrameCounters &counters);
 	void ResetStats();
 
 	void SetDirty(SoftDirty flags) {
@@ -239,6 +270,16 @@ class BinManager {
 	typedef BinQueue<BinClut, QUEUED_CLUTS> BinClutQueue;
 	typedef BinQueue<BinItem, QUEUED_PRIMS> BinItemQueue;
 
+	// Tiles used for work stealing, in pixels.  Small enough to balance, big enough to keep prim setup cheap.
+	static constexpr int TILE_WIDTH = 64;
+	static constexpr int TILE_HEIGHT = 32;
+	static constexpr int TILES_X = 1024 / TILE_WIDTH;
+	static constexpr int TILES_Y = 1024 / TILE_HEIGHT;
+
+	// Depth bounds are kept per square tile of this many pixels.
+	static constexpr int DEPTH_TILE_SIZE = 16;
+	static constexpr int DEPTH_TILES = 1024 / DEPTH_TILE_SIZE;
+
 private:
 	BinStateQueue states_;
 	BinClutQueue cluts_;
@@ -257,26 +298,71 @@ class BinManager {
 	std::atomic<bool> taskStatus_[MAX_POSSIBLE_TASKS];
 	BinWaitable *waitable_ = nullptr;
 
+	// Tile mode: queue_ items are drawn in place, a batch at a time, by threads claiming whole tiles.
+	// Within a tile, items are always drawn in queue order, and batches never overlap.
+	bool useTiles_ = false;
+	int tileBatchSize_ = 0;
+	int numTileWorkers_ = 0;
+	std::vector<uint16_t> tileItems_[TILES_X * TILES_Y];
+	std::vector<uint16_t> batchTiles_;
+	BinTileWorker tileWorkers_[MAX_POSSIBLE_TASKS];
+	DrawBinTilesTask *tileTasks_[MAX_POSSIBLE_TASKS]{};
+
 	BinDirtyRange pendingWrites_[2]{};
 	std::unordered_map<uint32_t, BinDirtyRange> pendingReads_;
 
+	// Only tracked for the current depth buffer, and reset whenever it changes.
+	BinDepthBounds depthBounds_[DEPTH_TILES * DEPTH_TILES];
+	uint32_t depthBoundsAddr_ = 0;
+	uint32_t depthBoundsStride_ = 0;
+	// False when every tile is the full range, so there's nothing to check.
+	bool depthBoundsKnown_ = false;
+	// True when the framebuffer overlaps the depth buffer, so color writes change depth.
+	bool depthBoundsAliased_ = false;
+
+	TextureDecodeCache textureCache_;
+
 	bool pendingOverlap_ = false;
 	bool creatingState_ = false;
+	int lastJitCompileCount_ = 0;
 	uint16_t pendingStateIndex_ = 0;
 
 	std::unordered_map<const char *, double> flushReasonTimes_;
 	std::unordered_map<const char *, double> lastFlushReasonTimes_;
+	std::unordered_map<const char *, int> flushReasonCounts_;
 	const char *slowestFlushReason_ = nullptr;
 	double slowestFlushTime_ = 0.0;
 	int lastFlipstats_ = 0;
 	int enqueues_ = 0;
 	int mostThreads_ = 0;
+	int tileBatches_ = 0;
+	int depthCulled_ = 0;
+	int depthTrimmed_ = 0;
+	int binned_[(int)BinItemType::POINT + 1]{};
+	int backfaceCulled_ = 0;
+	int scissorCulled_ = 0;
+	int queueFullDrains_ = 0;
+	int threadWaits_ = 0;
+	// Running totals at the start of the frame, for counters kept outside the binner.
+	int pixelJitHitsStart_ = 0;
+	int pixelJitMissesStart_ = 0;
+	int samplerJitHitsStart_ = 0;
+	int samplerJitMissesStart_ = 0;
+	int64_t pixelsCoveredStart_ = 0;
+	int64_t pixelsEarlyRejectedStart_ = 0;
 
 	void MarkPendingReads(const Rasterizer::RasterizerState &state);
 	void MarkPendingWrites(const Rasterizer::RasterizerState &state);
 	bool HasTextureWrite(const Rasterizer::RasterizerState &state);
+	void ApplyTextureCache(Rasterizer::RasterizerState &state);
 	bool IsExactSelfRender(const Rasterizer::RasterizerState &state, const BinItem &item);
 	void OptimizePendingStates(uint16_t first, uint16_t last);
+	void DrainTiles(bool flushing);
+	void UpdateDepthBoundsTarget(const Rasterizer::RasterizerState &state);
+	void ResetDepthBounds();
+	bool CullByDepthBounds(const Rasterizer::RasterizerState &state, BinCoords &range, uint16_t minZ, uint16_t maxZ);
+	void WidenDepthBounds(const Rasterizer::RasterizerState &state, const BinCoords &range, uint16_t minZ, uint16_t maxZ);
+	void ClearDepthBounds(const Rasterizer::RasterizerState &state, const BinCoords &range, const VertexData &v0, const VertexData &v1);
 	BinCoords Scissor(BinCoords range);
 	BinCoords Range(const VertexData &v0, const VertexData &v1, const VertexData &v2);
 	BinCoords Range(const VertexData &v0, const VertexData &v1);
@@ -284,4 +370,19 @@ class BinManager {
 	void Expand(const BinCoords &range);
 
 	friend class DrawBinItemsTask;
+	friend class DrawBinTilesTask;
 };
+
+inline bool BinManager::IsCulledTriangle(const VertexData &v0, const VertexData &v1, const VertexData &v2) {
+	Vec2<int> d01((int)v0.screenpos.x - (int)v1.screenpos.x, (int)v0.screenpos.y - (int)v1.screenpos.y);
+	Vec2<int> d02((int)v0.screenpos.x - (int)v2.screenpos.x, (int)v0.screenpos.y - (int)v2.screenpos.y);
+
+	// Drop primitives which are not in CCW order by checking the cross product.
+	static_assert(SCREEN_SCALE_FACTOR <= 16, "Fails if scale factor is too high");
+	if (d01.x * d02.y - d01.y * d02.x < 0)
+		return true;
+	// If all points have identical coords, we'll have 0 weights and not skip properly, so skip here.
+	if ((d01.x == 0 && d02.x == 0) || (d01.y == 0 && d02.y == 0))
+		return true;
+	return false;
+}
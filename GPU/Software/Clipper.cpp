@@ -313,9 +313,10 @@ void ProcessLine(const ClipVertexData &v0, const ClipVertexData &v1, BinManager
 		binner.AddLine(data[0].v, data[1].v);
 }
 
-void ProcessTriangle(const ClipVertexData &v0, const ClipVertexData &v1, const ClipVertexData &v2, const ClipVertexData &provoking, BinManager &binner) {
+template <typename T>
+static void ProcessTriangleInternal(const ClipVertexData &v0, const ClipVertexData &v1, const ClipVertexData &v2, const ClipVertexData &provoking, bool throughMode, T &binner) {
 	int mask = 0;
-	if (!binner.State().throughMode) {
+	if (!throughMode) {
 		// If any verts were outside range, throw the entire prim away.
 		if (v0.OutsideRange() || v1.OutsideRange() || v2.OutsideRange())
 			return;
@@ -419,4 +420,26 @@ void ProcessTriangle(const ClipVertexData &v0, const ClipVertexData &v1, const C
 	}
 }
 
+void ProcessTriangle(const ClipVertexData &v0, const ClipVertexData &v1, const ClipVertexData &v2, const ClipVertexData &provoking, BinManager &binner) {
+	ProcessTriangleInternal(v0, v1, v2, provoking, binner.State().throughMode, binner);
+}
+
+void ProcessTriangle(const ClipVertexData &v0, const ClipVertexData &v1, const ClipVertexData &v2, const ClipVertexData &provoking, ClippedTriangles &out) {
+	ProcessTriangleInternal(v0, v1, v2, provoking, false, out);
+}
+
+void ClippedTriangles::AddTriangle(const VertexData &v0, const VertexData &v1, const VertexData &v2) {
+	// The binner would cull these anyway, but it's cheaper to do it here on the thread.
+	if (BinManager::IsCulledTriangle(v0, v1, v2))
+		return;
+	verts.push_back(v0);
+	verts.push_back(v1);
+	verts.push_back(v2);
+}
+
+void ClippedTriangles::Send(BinManager &binner) const {
+	for (size_t i = 0; i + 2 < verts.size(); i += 3)
+		binner.AddTriangle(verts[i + 0], verts[i + 1], verts[i + 2]);
+}
+
 } // namespace
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <vector>
 #include "TransformUnit.h"
 
 struct PixelFuncID;
@@ -26,9 +27,23 @@ class BinManager;
 
 namespace Clipper {
 
+// Collects clipped triangles in order, so clipping can happen off the GPU thread.
+// Send() then passes them to the binner, which must happen in the original order.
+struct ClippedTriangles {
+	void Reset() {
+		verts.clear();
+	}
+	void AddTriangle(const VertexData &v0, const VertexData &v1, const VertexData &v2);
+	void Send(BinManager &binner) const;
+
+	std::vector<VertexData> verts;
+};
+
 void ProcessPoint(const ClipVertexData &v0, BinManager &binner);
 void ProcessLine(const ClipVertexData &v0, const ClipVertexData &v1, BinManager &binner);
 void ProcessTriangle(const ClipVertexData &v0, const ClipVertexData &v1, const ClipVertexData &v2, const ClipVertexData &provoking, BinManager &binner);
+// Only valid for transformed (not through mode) triangles.
+void ProcessTriangle(const ClipVertexData &v0, const ClipVertexData &v1, const ClipVertexData &v2, const ClipVertexData &provoking, ClippedTriangles &out);
 void ProcessRect(const ClipVertexData &v0, const ClipVertexData &v1, BinManager &binner);
 
 }
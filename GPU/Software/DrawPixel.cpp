@@ -18,6 +18,7 @@
 #include <mutex>
 #include "Common/Common.h"
 #include "Common/Data/Convert/ColorConv.h"
+#include "Common/Thread/ThreadManager.h"
 #include "Core/Config.h"
 #include "GPU/GPUState.h"
 #include "GPU/Software/BinManager.h"
@@ -37,8 +38,8 @@ void Init() {
 	jitCache = new PixelJitCache();
 }
 
-void FlushJit() {
-	jitCache->Flush();
+bool FlushJit() {
+	return jitCache->Flush();
 }
 
 void Shutdown() {
@@ -46,6 +47,22 @@ void Shutdown() {
 	jitCache = nullptr;
 }
 
+int JitCompileCount() {
+	return jitCache->CompileCount();
+}
+
+void JitLookupCounts(int *hits, int *misses) {
+	jitCache->LookupCounts(hits, misses);
+}
+
+std::vector<PixelFuncID> GetCompiledJitIDs() {
+	return jitCache->GetCompiledIDs();
+}
+
+void PrecompileJit(const std::vector<PixelFuncID> &ids) {
+	jitCache->Precompile(ids);
+}
+
 bool DescribeCodePtr(const u8 *ptr, std::string &name) {
 	if (!jitCache->IsInSpace(ptr)) {
 		return false;
@@ -708,6 +725,350 @@ void SOFTRAST_CALL DrawSinglePixel(int x, int y, int z, int fog, Vec4IntArg colo
 	SetPixelColor(fbFormat, pixelID.cached.framebufStride, x, y, new_color, old_color, targetWriteMask);
 }
 
+#if defined(_M_SSE)
+// The quad path below keeps each channel of four pixels in its own register, with one pixel per 32-bit lane.
+
+static inline __m128i QuadComparePassed(GEComparison func, __m128i v, __m128i ref) {
+	const __m128i all = _mm_set1_epi32(-1);
+	switch (func) {
+	case GE_COMP_NEVER:
+		return _mm_setzero_si128();
+
+	case GE_COMP_ALWAYS:
+		return all;
+
+	case GE_COMP_EQUAL:
+		return _mm_cmpeq_epi32(v, ref);
+
+	case GE_COMP_NOTEQUAL:
+		return _mm_xor_si128(_mm_cmpeq_epi32(v, ref), all);
+
+	case GE_COMP_LESS:
+		return _mm_cmplt_epi32(v, ref);
+
+	case GE_COMP_LEQUAL:
+		return _mm_xor_si128(_mm_cmpgt_epi32(v, ref), all);
+
+	case GE_COMP_GREATER:
+		return _mm_cmpgt_epi32(v, ref);
+
+	case GE_COMP_GEQUAL:
+		return _mm_xor_si128(_mm_cmplt_epi32(v, ref), all);
+	}
+	return all;
+}
+
+// Source and dest factors only differ in what OTHERCOLOR refers to, so this handles both.
+static inline __m128i QuadBlendFactor(PixelBlendFactor factor, __m128i other, __m128i srcA, __m128i dstA, uint32_t fix) {
+	const __m128i full = _mm_set1_epi32(255);
+	switch (factor) {
+	case PixelBlendFactor::OTHERCOLOR:
+		return other;
+
+	case PixelBlendFactor::INVOTHERCOLOR:
+		return _mm_sub_epi32(full, other);
+
+	case PixelBlendFactor::SRCALPHA:
+		return srcA;
+
+	case PixelBlendFactor::INVSRCALPHA:
+		return _mm_sub_epi32(full, srcA);
+
+	case PixelBlendFactor::DSTALPHA:
+		return dstA;
+
+	case PixelBlendFactor::INVDSTALPHA:
+		return _mm_sub_epi32(full, dstA);
+
+	case PixelBlendFactor::DOUBLESRCALPHA:
+		return _mm_add_epi32(srcA, srcA);
+
+	case PixelBlendFactor::DOUBLEINVSRCALPHA:
+		// The upper 16 bits are zero, so a 16-bit min is safe.
+		return _mm_sub_epi32(full, _mm_min_epi16(_mm_add_epi32(srcA, srcA), full));
+
+	case PixelBlendFactor::DOUBLEDSTALPHA:
+		return _mm_add_epi32(dstA, dstA);
+
+	case PixelBlendFactor::DOUBLEINVDSTALPHA:
+		return _mm_sub_epi32(full, _mm_min_epi16(_mm_add_epi32(dstA, dstA), full));
+
+	case PixelBlendFactor::FIX:
+	default:
+		// All other factors (> 10) are treated as FIX.
+		return _mm_set1_epi32(fix);
+
+	case PixelBlendFactor::ZERO:
+		return _mm_setzero_si128();
+
+	case PixelBlendFactor::ONE:
+		return full;
+	}
+}
+
+// Same as AlphaBlendingResult: ((c * 2 + 1) * (f * 2 + 1)) / 1024, using 4 bits of decimal so mulhi does the shift.
+static inline __m128i QuadBlendMul(__m128i c, __m128i f) {
+	const __m128i half = _mm_set1_epi32(1 << 3);
+	return _mm_mulhi_epi16(_mm_add_epi32(_mm_slli_epi32(c, 4), half), _mm_add_epi32(_mm_slli_epi32(f, 4), half));
+}
+
+static inline __m128i QuadClampToZero(__m128i v) {
+	return _mm_andnot_si128(_mm_srai_epi32(v, 31), v);
+}
+
+static inline __m128i QuadBlendChannel(GEBlendMode eq, __m128i s, __m128i d, __m128i sf, __m128i df) {
+	switch (eq) {
+	case GE_BLENDMODE_MUL_AND_ADD:
+		return _mm_add_epi32(QuadBlendMul(s, sf), QuadBlendMul(d, df));
+
+	case GE_BLENDMODE_MUL_AND_SUBTRACT:
+		return QuadClampToZero(_mm_sub_epi32(QuadBlendMul(s, sf), QuadBlendMul(d, df)));
+
+	case GE_BLENDMODE_MUL_AND_SUBTRACT_REVERSE:
+		return QuadClampToZero(_mm_sub_epi32(QuadBlendMul(d, df), QuadBlendMul(s, sf)));
+
+	case GE_BLENDMODE_MIN:
+		return _mm_min_epi16(s, d);
+
+	case GE_BLENDMODE_MAX:
+		return _mm_max_epi16(s, d);
+
+	case GE_BLENDMODE_ABSDIFF:
+	{
+		const __m128i diff = _mm_sub_epi32(s, d);
+		const __m128i sign = _mm_srai_epi32(diff, 31);
+		return _mm_sub_epi32(_mm_xor_si128(diff, sign), sign);
+	}
+
+	default:
+		return s;
+	}
+}
+
+// Takes the low 16 bits of each lane, and places the four values in the low 64 bits.
+static inline __m128i QuadPack16(__m128i v) {
+	v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(3, 3, 2, 0));
+	v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(3, 3, 2, 0));
+	return _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 2, 0));
+}
+
+static inline __m128i QuadLoad16(const u16 *row0, const u16 *row1) {
+	u32 v0, v1;
+	memcpy(&v0, row0, sizeof(v0));
+	memcpy(&v1, row1, sizeof(v1));
+	return _mm_unpacklo_epi32(_mm_cvtsi32_si128(v0), _mm_cvtsi32_si128(v1));
+}
+
+static inline void QuadStore16(u16 *row0, u16 *row1, __m128i packed) {
+	const u32 v0 = _mm_cvtsi128_si32(packed);
+	const u32 v1 = _mm_cvtsi128_si32(_mm_srli_si128(packed, 4));
+	memcpy(row0, &v0, sizeof(v0));
+	memcpy(row1, &v1, sizeof(v1));
+}
+
+// Matches DrawSinglePixel<false, fbFormat> for ids accepted by GetQuadFunc().
+template <GEBufferFormat fbFormat>
+void SOFTRAST_CALL DrawQuadPixels(int x, int y, const Vec4<int> &z, const Vec4<int> &fog, const Vec4<int> *colors, const Vec4<int> &mask, const PixelFuncID &pixelID) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i byteMask = _mm_set1_epi32(0xFF);
+	__m128i keep = _mm_cmpgt_epi32(mask.ivec, _mm_set1_epi32(-1));
+
+	// Clamp to 0-255 and then split into channels.
+	const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(colors[0].ivec, colors[1].ivec), _mm_packs_epi32(colors[2].ivec, colors[3].ivec));
+	__m128i r = _mm_and_si128(packed, byteMask);
+	__m128i g = _mm_and_si128(_mm_srli_epi32(packed, 8), byteMask);
+	__m128i b = _mm_and_si128(_mm_srli_epi32(packed, 16), byteMask);
+	const __m128i a = _mm_srli_epi32(packed, 24);
+
+	if (pixelID.applyDepthRange && !pixelID.earlyZChecks) {
+		const __m128i below = _mm_cmplt_epi32(z.ivec, _mm_set1_epi32(pixelID.cached.minz));
+		const __m128i above = _mm_cmpgt_epi32(z.ivec, _mm_set1_epi32(pixelID.cached.maxz));
+		keep = _mm_andnot_si128(_mm_or_si128(below, above), keep);
+	}
+
+	if (pixelID.AlphaTestFunc() != GE_COMP_ALWAYS) {
+		__m128i alpha = a;
+		if (pixelID.hasAlphaTestMask)
+			alpha = _mm_and_si128(alpha, _mm_set1_epi32(pixelID.cached.alphaTestMask));
+		keep = _mm_and_si128(keep, QuadComparePassed(pixelID.AlphaTestFunc(), alpha, _mm_set1_epi32(pixelID.alphaTestRef)));
+	}
+
+	if (_mm_movemask_epi8(keep) == 0)
+		return;
+
+	if (pixelID.applyFog) {
+		// The products fit in 16 bits, and the upper halves of each lane are zero.
+		const u32 fogColor = pixelID.cached.fogColor;
+		const __m128i invFog = _mm_sub_epi32(_mm_set1_epi32(255), fog.ivec);
+		const __m128i roundup = _mm_set1_epi32(255);
+		auto applyFog = [&](__m128i c, u32 fc) {
+			const __m128i mixed = _mm_add_epi32(_mm_mullo_epi16(c, fog.ivec), _mm_mullo_epi16(_mm_set1_epi32(fc & 0xFF), invFog));
+			return _mm_srli_epi32(_mm_add_epi32(mixed, roundup), 8);
+		};
+		r = applyFog(r, fogColor);
+		g = applyFog(g, fogColor >> 8);
+		b = applyFog(b, fogColor >> 16);
+	}
+
+	const bool depthTest = !pixelID.earlyZChecks && pixelID.DepthTestFunc() != GE_COMP_ALWAYS;
+	if (depthTest || pixelID.depthWrite) {
+		const int depthStride = pixelID.cached.depthbufStride;
+		u16 *depth0 = depthbuf.Get16Ptr(x, y, depthStride);
+		u16 *depth1 = depthbuf.Get16Ptr(x, y + 1, depthStride);
+		const __m128i oldDepth = QuadLoad16(depth0, depth1);
+
+		if (depthTest) {
+			const __m128i newZ = _mm_and_si128(z.ivec, _mm_set1_epi32(0xFFFF));
+			keep = _mm_and_si128(keep, QuadComparePassed(pixelID.DepthTestFunc(), newZ, _mm_unpacklo_epi16(oldDepth, zero)));
+			if (_mm_movemask_epi8(keep) == 0)
+				return;
+		}
+
+		if (pixelID.depthWrite) {
+			const __m128i keep16 = _mm_packs_epi32(keep, keep);
+			const __m128i newDepth = QuadPack16(z.ivec);
+			QuadStore16(depth0, depth1, _mm_or_si128(_mm_and_si128(keep16, newDepth), _mm_andnot_si128(keep16, oldDepth)));
+		}
+	}
+
+	// One old pixel per lane, still in the framebuffer format.
+	const int fbStride = pixelID.cached.framebufStride;
+	__m128i old;
+	if (fbFormat == GE_FORMAT_8888) {
+		const __m128i row0 = _mm_loadl_epi64((const __m128i *)fb.Get32Ptr(x, y, fbStride));
+		const __m128i row1 = _mm_loadl_epi64((const __m128i *)fb.Get32Ptr(x, y + 1, fbStride));
+		old = _mm_unpacklo_epi64(row0, row1);
+	} else {
+		old = _mm_unpacklo_epi16(QuadLoad16(fb.Get16Ptr(x, y, fbStride), fb.Get16Ptr(x, y + 1, fbStride)), zero);
+	}
+
+	if (pixelID.alphaBlend) {
+		// Expand the dest the same way GetPixelColor() does.
+		__m128i dr, dg, db, da;
+		if (fbFormat == GE_FORMAT_565) {
+			const __m128i r5 = _mm_and_si128(old, _mm_set1_epi32(0x1F));
+			const __m128i g6 = _mm_and_si128(_mm_srli_epi32(old, 5), _mm_set1_epi32(0x3F));
+			const __m128i b5 = _mm_srli_epi32(old, 11);
+			dr = _mm_or_si128(_mm_slli_epi32(r5, 3), _mm_srli_epi32(r5, 2));
+			dg = _mm_or_si128(_mm_slli_epi32(g6, 2), _mm_srli_epi32(g6, 4));
+			db = _mm_or_si128(_mm_slli_epi32(b5, 3), _mm_srli_epi32(b5, 2));
+			da = zero;
+		} else if (fbFormat == GE_FORMAT_5551) {
+			const __m128i mask5 = _mm_set1_epi32(0x1F);
+			const __m128i r5 = _mm_and_si128(old, mask5);
+			const __m128i g5 = _mm_and_si128(_mm_srli_epi32(old, 5), mask5);
+			const __m128i b5 = _mm_and_si128(_mm_srli_epi32(old, 10), mask5);
+			dr = _mm_or_si128(_mm_slli_epi32(r5, 3), _mm_srli_epi32(r5, 2));
+			dg = _mm_or_si128(_mm_slli_epi32(g5, 3), _mm_srli_epi32(g5, 2));
+			db = _mm_or_si128(_mm_slli_epi32(b5, 3), _mm_srli_epi32(b5, 2));
+			da = _mm_and_si128(_mm_srai_epi32(_mm_slli_epi32(old, 16), 31), byteMask);
+		} else if (fbFormat == GE_FORMAT_4444) {
+			const __m128i mask4 = _mm_set1_epi32(0x0F);
+			const __m128i r4 = _mm_and_si128(old, mask4);
+			const __m128i g4 = _mm_and_si128(_mm_srli_epi32(old, 4), mask4);
+			const __m128i b4 = _mm_and_si128(_mm_srli_epi32(old, 8), mask4);
+			const __m128i a4 = _mm_srli_epi32(old, 12);
+			dr = _mm_or_si128(_mm_slli_epi32(r4, 4), r4);
+			dg = _mm_or_si128(_mm_slli_epi32(g4, 4), g4);
+			db = _mm_or_si128(_mm_slli_epi32(b4, 4), b4);
+			da = _mm_or_si128(_mm_slli_epi32(a4, 4), a4);
+		} else {
+			dr = _mm_and_si128(old, byteMask);
+			dg = _mm_and_si128(_mm_srli_epi32(old, 8), byteMask);
+			db = _mm_and_si128(_mm_srli_epi32(old, 16), byteMask);
+			da = _mm_srli_epi32(old, 24);
+		}
+
+		const PixelBlendFactor srcFactor = pixelID.AlphaBlendSrc();
+		const PixelBlendFactor dstFactor = pixelID.AlphaBlendDst();
+		const u32 fixA = pixelID.cached.alphaBlendSrc;
+		const u32 fixB = pixelID.cached.alphaBlendDst;
+		const GEBlendMode eq = pixelID.AlphaBlendEq();
+
+		const __m128i sfr = QuadBlendFactor(srcFactor, dr, a, da, fixA & 0xFF);
+		const __m128i sfg = QuadBlendFactor(srcFactor, dg, a, da, (fixA >> 8) & 0xFF);
+		const __m128i sfb = QuadBlendFactor(srcFactor, db, a, da, (fixA >> 16) & 0xFF);
+		const __m128i dfr = QuadBlendFactor(dstFactor, r, a, da, fixB & 0xFF);
+		const __m128i dfg = QuadBlendFactor(dstFactor, g, a, da, (fixB >> 8) & 0xFF);
+		const __m128i dfb = QuadBlendFactor(dstFactor, b, a, da, (fixB >> 16) & 0xFF);
+
+		r = QuadBlendChannel(eq, r, dr, sfr, dfr);
+		g = QuadBlendChannel(eq, g, dg, sfg, dfg);
+		b = QuadBlendChannel(eq, b, db, sfb, dfb);
+	}
+
+	if (pixelID.dithering) {
+		const int8_t *row0 = &pixelID.cached.ditherMatrix[(y & 3) * 4];
+		const int8_t *row1 = &pixelID.cached.ditherMatrix[((y + 1) & 3) * 4];
+		const __m128i dither = _mm_set_epi32(row1[(x + 1) & 3], row1[x & 3], row0[(x + 1) & 3], row0[x & 3]);
+		r = _mm_add_epi32(r, dither);
+		g = _mm_add_epi32(g, dither);
+		b = _mm_add_epi32(b, dither);
+	}
+
+	// Clamp like ToRGB().  After clamping to zero, the upper halves are zero.
+	const __m128i full = _mm_set1_epi32(255);
+	r = _mm_min_epi16(QuadClampToZero(r), full);
+	g = _mm_min_epi16(QuadClampToZero(g), full);
+	b = _mm_min_epi16(QuadClampToZero(b), full);
+	const __m128i rgb = _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)), _mm_slli_epi32(b, 16));
+
+	// Stencil isn't written here, so keep the old alpha bits.
+	__m128i color;
+	if (fbFormat == GE_FORMAT_565) {
+		color = _mm_and_si128(_mm_srli_epi32(rgb, 3), _mm_set1_epi32(0x001F));
+		color = _mm_or_si128(color, _mm_and_si128(_mm_srli_epi32(rgb, 5), _mm_set1_epi32(0x07E0)));
+		color = _mm_or_si128(color, _mm_and_si128(_mm_srli_epi32(rgb, 8), _mm_set1_epi32(0xF800)));
+	} else if (fbFormat == GE_FORMAT_5551) {
+		color = _mm_and_si128(_mm_srli_epi32(rgb, 3), _mm_set1_epi32(0x001F));
+		color = _mm_or_si128(color, _mm_and_si128(_mm_srli_epi32(rgb, 6), _mm_set1_epi32(0x03E0)));
+		color = _mm_or_si128(color, _mm_and_si128(_mm_srli_epi32(rgb, 9), _mm_set1_epi32(0x7C00)));
+		color = _mm_or_si128(color, _mm_and_si128(old, _mm_set1_epi32(0x8000)));
+	} else if (fbFormat == GE_FORMAT_4444) {
+		const __m128i c = _mm_srli_epi32(rgb, 4);
+		color = _mm_and_si128(c, _mm_set1_epi32(0x000F));
+		color = _mm_or_si128(color, _mm_and_si128(_mm_srli_epi32(c, 4), _mm_set1_epi32(0x00F0)));
+		color = _mm_or_si128(color, _mm_and_si128(_mm_srli_epi32(c, 8), _mm_set1_epi32(0x0F00)));
+		color = _mm_or_si128(color, _mm_and_si128(old, _mm_set1_epi32(0xF000)));
+	} else {
+		color = _mm_or_si128(rgb, _mm_and_si128(old, _mm_set1_epi32(0xFF000000)));
+	}
+
+	if (pixelID.applyColorWriteMask) {
+		const __m128i writeMask = _mm_set1_epi32(pixelID.cached.colorWriteMask);
+		color = _mm_or_si128(_mm_andnot_si128(writeMask, color), _mm_and_si128(old, writeMask));
+	}
+
+	color = _mm_or_si128(_mm_and_si128(keep, color), _mm_andnot_si128(keep, old));
+	if (fbFormat == GE_FORMAT_8888) {
+		_mm_storel_epi64((__m128i *)fb.Get32Ptr(x, y, fbStride), color);
+		_mm_storel_epi64((__m128i *)fb.Get32Ptr(x, y + 1, fbStride), _mm_srli_si128(color, 8));
+	} else {
+		QuadStore16(fb.Get16Ptr(x, y, fbStride), fb.Get16Ptr(x, y + 1, fbStride), QuadPack16(color));
+	}
+}
+#endif
+
+QuadFunc GetQuadFunc(const PixelFuncID &id) {
+#if defined(_M_SSE)
+	// Stencil, color test, and logic ops are rare enough to leave to the single pixel path.
+	if (id.clearMode || id.stencilTest || id.colorTest || id.applyLogicOp)
+		return nullptr;
+
+	switch (id.fbFormat) {
+	case GE_FORMAT_565:
+		return &DrawQuadPixels<GE_FORMAT_565>;
+	case GE_FORMAT_5551:
+		return &DrawQuadPixels<GE_FORMAT_5551>;
+	case GE_FORMAT_4444:
+		return &DrawQuadPixels<GE_FORMAT_4444>;
+	case GE_FORMAT_8888:
+		return &DrawQuadPixels<GE_FORMAT_8888>;
+	}
+#endif
+	return nullptr;
+}
+
 SingleFunc GetSingleFunc(const PixelFuncID &id, BinManager *binner) {
 	SingleFunc jitted = jitCache->GetSingle(id, binner);
 	if (jitted) {
@@ -744,6 +1105,22 @@ SingleFunc PixelJitCache::GenericSingle(const PixelFuncID &id) {
 	return nullptr;
 }
 
+class PixelJitCompileTask : public Task {
+public:
+	PixelJitCompileTask(PixelJitCache *cache) : cache_(cache) {}
+
+	TaskType Type() const override {
+		return TaskType::CPU_COMPUTE;
+	}
+
+	void Run() override {
+		cache_->RunCompileWorker();
+	}
+
+private:
+	PixelJitCache *cache_;
+};
+
 thread_local PixelJitCache::LastCache PixelJitCache::lastSingle_;
 
 // 256k should be plenty of space for plenty of variations.
@@ -751,6 +1128,11 @@ PixelJitCache::PixelJitCache() : CodeBlock(1024 * 64 * 4), cache_(64) {
 	lastSingle_.gen = -1;
 }
 
+PixelJitCache::~PixelJitCache() {
+	std::unique_lock<std::mutex> guard(jitCacheLock);
+	WaitForCompileWorker(guard);
+}
+
 void PixelJitCache::Clear() {
 	clearGen_++;
 	CodeBlock::Clear();
@@ -780,8 +1162,23 @@ std::string PixelJitCache::DescribeCodePtr(const u8 *ptr) {
 	return CodeBlock::DescribeCodePtr(ptr);
 }
 
-void PixelJitCache::Flush() {
+bool PixelJitCache::Flush() {
 	std::unique_lock<std::mutex> guard(jitCacheLock);
+	// Compiling below might clear too, if it runs out of space.
+	const int startClearGen = clearGen_;
+	if (CanCompileInBackground()) {
+		// The raster threads are idle now, so this is our chance to clear.  The worker has stopped if this is set.
+		if (needsClear_) {
+			Clear();
+			needsClear_ = false;
+			// Any states using the old funcs need to be recreated.
+			compileCount_++;
+		}
+		if (!compileQueue_.empty())
+			StartCompileWorker();
+		return clearGen_ != startClearGen;
+	}
+
 	for (const auto &queued : compileQueue_) {
 		// Might've been compiled after enqueue, but before now.
 		size_t queuedKey = std::hash<PixelFuncID>()(queued);
@@ -789,6 +1186,7 @@ void PixelJitCache::Flush() {
 			Compile(queued);
 	}
 	compileQueue_.clear();
+	return clearGen_ != startClearGen;
 }
 
 SingleFunc PixelJitCache::GetSingle(const PixelFuncID &id, BinManager *binner) {
@@ -796,15 +1194,29 @@ SingleFunc PixelJitCache::GetSingle(const PixelFuncID &id, BinManager *binner) {
 		return nullptr;
 
 	const size_t key = std::hash<PixelFuncID>()(id);
-	if (lastSingle_.Match(key, clearGen_))
+	if (lastSingle_.Match(key, clearGen_)) {
+		lookupHits_++;
 		return lastSingle_.func;
+	}
 
 	std::unique_lock<std::mutex> guard(jitCacheLock);
 	auto it = cache_.Get(key);
 	if (it != nullptr) {
+		lookupHits_++;
 		lastSingle_.Set(key, it, clearGen_);
 		return it;
 	}
+	lookupMisses_++;
+
+	if (CanCompileInBackground()) {
+		// The caller uses the generic func until this is ready, no need to drain.
+		// If it's already in addresses_, it failed to compile, so don't bother retrying.
+		if (addresses_.find(id) == addresses_.end()) {
+			compileQueue_.insert(id);
+			StartCompileWorker();
+		}
+		return nullptr;
+	}
 
 	if (!binner) {
 		// Can't compile, let's try to do it later when there's an opportunity.
@@ -833,6 +1245,60 @@ SingleFunc PixelJitCache::GetSingle(const PixelFuncID &id, BinManager *binner) {
 	return it;
 }
 
+void PixelJitCache::StartCompileWorker() {
+	if (!compileWorkerActive_ && !needsClear_) {
+		// Only one at a time, since there's only one code space.
+		compileWorkerActive_ = true;
+		g_threadManager.EnqueueTask(new PixelJitCompileTask(this));
+	}
+}
+
+void PixelJitCache::WaitForCompileWorker(std::unique_lock<std::mutex> &guard) {
+	compileCond_.wait(guard, [&] {
+		return !compileWorkerActive_;
+	});
+}
+
+void PixelJitCache::RunCompileWorker() {
+	std::unique_lock<std::mutex> guard(jitCacheLock);
+	while (!compileQueue_.empty()) {
+		const PixelFuncID id = *compileQueue_.begin();
+		const size_t key = std::hash<PixelFuncID>()(id);
+		if (cache_.Get(key)) {
+			compileQueue_.erase(compileQueue_.begin());
+			continue;
+		}
+
+		// Raster threads might be running funcs from this space, so clearing waits for Flush().
+		if (GetSpaceLeft() < 65536) {
+			needsClear_ = true;
+			break;
+		}
+		compileQueue_.erase(compileQueue_.begin());
+
+		// Nothing else writes code while we're active, so the lock is only needed to publish.
+		guard.unlock();
+#if PPSSPP_ARCH(AMD64) && !PPSSPP_PLATFORM(UWP)
+		const u8 *start = GetCodePointer();
+		SingleFunc func = CompileSingle(id);
+#else
+		const u8 *start = nullptr;
+		SingleFunc func = nullptr;
+#endif
+		guard.lock();
+
+		addresses_[id] = start;
+		cache_.Insert(key, func);
+		if (func) {
+			compiledIDs_.insert(id);
+			compileCount_++;
+		}
+	}
+
+	compileWorkerActive_ = false;
+	compileCond_.notify_all();
+}
+
 void PixelJitCache::Compile(const PixelFuncID &id) {
 	// x64 is typically 200-500 bytes, but let's be safe.
 	if (GetSpaceLeft() < 65536) {
@@ -843,9 +1309,39 @@ void PixelJitCache::Compile(const PixelFuncID &id) {
 	addresses_[id] = GetCodePointer();
 	SingleFunc func = CompileSingle(id);
 	cache_.Insert(std::hash<PixelFuncID>()(id), func);
+	if (func)
+		compiledIDs_.insert(id);
 #endif
 }
 
+std::vector<PixelFuncID> PixelJitCache::GetCompiledIDs() {
+	std::unique_lock<std::mutex> guard(jitCacheLock);
+	return std::vector<PixelFuncID>(compiledIDs_.begin(), compiledIDs_.end());
+}
+
+void PixelJitCache::Precompile(const std::vector<PixelFuncID> &ids) {
+	if (!g_Config.bSoftwareRenderingJit)
+		return;
+
+	std::unique_lock<std::mutex> guard(jitCacheLock);
+	for (const PixelFuncID &id : ids) {
+		if (!cache_.Get(std::hash<PixelFuncID>()(id)))
+			compileQueue_.insert(id);
+	}
+
+	if (CanCompileInBackground()) {
+		StartCompileWorker();
+		return;
+	}
+
+	// Nothing is drawing, so it's safe to compile (and clear) right here.
+	for (const auto &queued : compileQueue_) {
+		if (!cache_.Get(std::hash<PixelFuncID>()(queued)))
+			Compile(queued);
+	}
+	compileQueue_.clear();
+}
+
 void ComputePixelBlendState(PixelBlendState &state, const PixelFuncID &id) {
 	switch (id.AlphaBlendEq()) {
 	case GE_BLENDMODE_MUL_AND_ADD:
@@ -19,6 +19,9 @@
 
 #include "ppsspp_config.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -42,9 +45,23 @@ namespace Rasterizer {
 typedef void (SOFTRAST_CALL *SingleFunc)(int x, int y, int z, int fog, Vec4IntArg color_in, const PixelFuncID &pixelID);
 SingleFunc GetSingleFunc(const PixelFuncID &id, BinManager *binner);
 
+// Draws a 2x2 quad: (x, y), (x + 1, y), (x, y + 1), (x + 1, y + 1).  Lanes with a negative mask are skipped.
+typedef void (SOFTRAST_CALL *QuadFunc)(int x, int y, const Math3D::Vec4<int> &z, const Math3D::Vec4<int> &fog, const Math3D::Vec4<int> *colors, const Math3D::Vec4<int> &mask, const PixelFuncID &pixelID);
+// Returns nullptr if the state needs the single pixel path.
+QuadFunc GetQuadFunc(const PixelFuncID &id);
+
 void Init();
-void FlushJit();
+// Returns true if the cache was cleared, so any funcs looked up before are gone.
+bool FlushJit();
 void Shutdown();
+// Changes whenever funcs finish compiling in the background, or the cache is cleared.
+int JitCompileCount();
+// Running totals of func lookups that found compiled code, or didn't.
+void JitLookupCounts(int *hits, int *misses);
+// Every id compiled since Init(), even if cleared since.
+std::vector<PixelFuncID> GetCompiledJitIDs();
+// Only call while nothing is drawing.
+void PrecompileJit(const std::vector<PixelFuncID> &ids);
 
 bool CheckDepthTestPassed(GEComparison func, int x, int y, int stride, u16 z);
 
@@ -63,18 +80,35 @@ void ComputePixelBlendState(PixelBlendState &state, const PixelFuncID &id);
 class PixelJitCache : public Rasterizer::CodeBlock {
 public:
 	PixelJitCache();
+	~PixelJitCache();
 
 	// Returns a pointer to the code to run.
 	SingleFunc GetSingle(const PixelFuncID &id, BinManager *binner);
 	SingleFunc GenericSingle(const PixelFuncID &id);
 	void Clear() override;
-	void Flush();
+	bool Flush();
 
 	std::string DescribeCodePtr(const u8 *ptr) override;
 
+	int CompileCount() const {
+		return compileCount_;
+	}
+	void LookupCounts(int *hits, int *misses) const {
+		*hits = lookupHits_;
+		*misses = lookupMisses_;
+	}
+	std::vector<PixelFuncID> GetCompiledIDs();
+	void Precompile(const std::vector<PixelFuncID> &ids);
+
 private:
+	friend class PixelJitCompileTask;
+
 	void Compile(const PixelFuncID &id);
 	SingleFunc CompileSingle(const PixelFuncID &id);
+	// These expect jitCacheLock to be held.
+	void StartCompileWorker();
+	void WaitForCompileWorker(std::unique_lock<std::mutex> &guard);
+	void RunCompileWorker();
 
 	RegCache::Reg GetPixelID();
 	void UnlockPixelID(RegCache::Reg &r);
@@ -128,9 +162,18 @@ class PixelJitCache : public Rasterizer::CodeBlock {
 	DenseHashMap<size_t, SingleFunc, nullptr> cache_;
 	std::unordered_map<PixelFuncID, const u8 *> addresses_;
 	std::unordered_set<PixelFuncID> compileQueue_;
+	std::unordered_set<PixelFuncID> compiledIDs_;
 	int clearGen_ = 0;
 	static thread_local LastCache lastSingle_;
 
+	std::condition_variable compileCond_;
+	bool compileWorkerActive_ = false;
+	// Set by the worker when it runs out of space, since it can't clear while raster threads run.
+	bool needsClear_ = false;
+	std::atomic<int> compileCount_{};
+	std::atomic<int> lookupHits_{};
+	std::atomic<int> lookupMisses_{};
+
 	const u8 *constBlendHalf_11_4s_ = nullptr;
 	const u8 *constBlendInvert_11_4s_ = nullptr;
 
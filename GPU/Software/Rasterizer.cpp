@@ -17,6 +17,7 @@
 
 #include "ppsspp_config.h"
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 
 #include "Common/Common.h"
@@ -28,6 +29,7 @@
 #include "Core/Debugger/MemBlockInfo.h"
 #include "Core/MemMap.h"
 #include "Core/Reporting.h"
+#include "Core/System.h"
 #include "GPU/GPUState.h"
 
 #include "GPU/Common/TextureDecoder.h"
@@ -93,22 +95,28 @@ static inline Vec4<float> Interpolate(const float &c0, const float &c1, const fl
 	return Interpolate(c0, c1, c2, w0.Cast<float>(), w1.Cast<float>(), w2.Cast<float>(), wsum_recip);
 }
 
+static void ComputeSamplerFuncs(RasterizerState *state, BinManager *binner) {
+	state->linear = Sampler::GetLinearFunc(state->samplerID, binner);
+	state->nearest = Sampler::GetNearestFunc(state->samplerID, binner);
+
+	// Since the definitions are the same, just force this setting using the func pointer.
+	if (g_Config.iTexFiltering == TEX_FILTER_FORCE_LINEAR) {
+		state->nearest = state->linear;
+	} else if (g_Config.iTexFiltering == TEX_FILTER_FORCE_NEAREST) {
+		state->linear = state->nearest;
+	}
+}
+
 void ComputeRasterizerState(RasterizerState *state, BinManager *binner) {
 	ComputePixelFuncID(&state->pixelID);
 	state->drawPixel = Rasterizer::GetSingleFunc(state->pixelID, binner);
+	state->drawQuad = Rasterizer::GetQuadFunc(state->pixelID);
 
 	state->enableTextures = gstate.isTextureMapEnabled() && !state->pixelID.clearMode;
+	state->texDecoded = false;
 	if (state->enableTextures) {
 		ComputeSamplerID(&state->samplerID);
-		state->linear = Sampler::GetLinearFunc(state->samplerID, binner);
-		state->nearest = Sampler::GetNearestFunc(state->samplerID, binner);
-
-		// Since the definitions are the same, just force this setting using the func pointer.
-		if (g_Config.iTexFiltering == TEX_FILTER_FORCE_LINEAR) {
-			state->nearest = state->linear;
-		} else if (g_Config.iTexFiltering == TEX_FILTER_FORCE_NEAREST) {
-			state->linear = state->nearest;
-		}
+		ComputeSamplerFuncs(state, binner);
 
 		state->maxTexLevel = state->samplerID.hasAnyMips ? gstate.getTextureMaxLevel() : 0;
 
@@ -155,6 +163,38 @@ void ComputeRasterizerState(RasterizerState *state, BinManager *binner) {
 #endif
 }
 
+void RefreshRasterizerFuncs(RasterizerState *state) {
+	// No binner, so this never flushes.  Anything not compiled yet uses the generic funcs meanwhile.
+	state->drawPixel = Rasterizer::GetSingleFunc(state->pixelID, nullptr);
+	state->drawQuad = Rasterizer::GetQuadFunc(state->pixelID);
+	if (state->enableTextures)
+		ComputeSamplerFuncs(state, nullptr);
+}
+
+void ApplyDecodedTexture(RasterizerState *state, const u8 *const texptr[8], const uint16_t texbufw[8], BinManager *binner) {
+	// Now it's a plain 8888 texture, with the standard bufw.  Sizes, wrapping, and the tex func all stay.
+	SamplerID &id = state->samplerID;
+	id.texfmt = GE_TFMT_8888;
+	id.clutfmt = 0;
+	id.swizzle = false;
+	id.useSharedClut = true;
+	id.hasClutMask = false;
+	id.hasClutShift = false;
+	id.hasClutOffset = false;
+	id.hasInvalidPtr = false;
+	id.overReadSafe = true;
+	id.useStandardBufw = true;
+	id.cached.clutFormat = 0;
+	id.cached.clut = nullptr;
+
+	for (int i = 0; i <= state->maxTexLevel; ++i) {
+		state->texptr[i] = texptr[i];
+		state->texbufw[i] = texbufw[i];
+	}
+	state->texDecoded = true;
+	ComputeSamplerFuncs(state, binner);
+}
+
 static inline void CalculateRasterStateFlags(RasterizerState *state, const VertexData &v0, bool useColor) {
 	if (useColor) {
 		if ((v0.color0 & 0x00FFFFFF) != 0x00FFFFFF)
@@ -419,6 +459,7 @@ static bool ApplyStateOptimizations(RasterizerState *state, const RasterizerStat
 		// Can't compile during runtime.  This failing is a bit of a problem when undoing...
 		if (drawPixel) {
 			state->drawPixel = drawPixel;
+			state->drawQuad = Rasterizer::GetQuadFunc(pixelID);
 			memcpy(&state->pixelID, &pixelID, sizeof(PixelFuncID));
 			state->flags = ReplacePixelIDFlags(state->flags, optimize) | RasterizerStateFlags::OPTIMIZED;
 			changed = true;
@@ -842,6 +883,18 @@ static inline Vec4<float> EdgeRecip(const Vec4<int> &w0, const Vec4<int> &w1, co
 #endif
 }
 
+static std::atomic<int64_t> pixelsCovered;
+static std::atomic<int64_t> pixelsEarlyRejected;
+
+void PixelCounts(int64_t *covered, int64_t *earlyRejected) {
+	*covered = pixelsCovered;
+	*earlyRejected = pixelsEarlyRejected;
+}
+
+static inline int CountMask(const Vec4<int> &mask) {
+	return (mask[0] >= 0) + (mask[1] >= 0) + (mask[2] >= 0) + (mask[3] >= 0);
+}
+
 template <bool clearMode, bool useSSE4>
 void DrawTriangleSlice(
 	const VertexData& v0, const VertexData& v1, const VertexData& v2,
@@ -891,6 +944,10 @@ void DrawTriangleSlice(
 	const Vec3<int> v1_c1 = Vec3<int>::FromRGB(v1.color1);
 	const Vec3<int> v2_c1 = Vec3<int>::FromRGB(v2.color1);
 
+	const bool collectStats = coreCollectDebugStats;
+	int covered = 0;
+	int earlyRejected = 0;
+
 	for (int64_t curY = minY; curY <= maxY; curY += SCREEN_SCALE_FACTOR * 2,
 										w0_base = e0.StepY(w0_base),
 										w1_base = e1.StepY(w1_base),
@@ -939,6 +996,7 @@ void DrawTriangleSlice(
 				}
 
 				if (pixelID.earlyZChecks) {
+					const int before = collectStats ? CountMask(mask) : 0;
 					for (int i = 0; i < 4; ++i) {
 						if (pixelID.applyDepthRange) {
 							if (z[i] < pixelID.cached.minz || z[i] > pixelID.cached.maxz)
@@ -953,6 +1011,12 @@ void DrawTriangleSlice(
 							mask[i] = -1;
 						}
 					}
+					if (collectStats) {
+						covered += before;
+						earlyRejected += before - CountMask(mask);
+					}
+				} else if (collectStats) {
+					covered += CountMask(mask);
 				}
 
 				// Color interpolation is not perspective corrected on the PSP.
@@ -1027,6 +1091,13 @@ void DrawTriangleSlice(
 				}
 
 				PROFILE_THIS_SCOPE("draw_tri_px");
+#if !defined(SOFTGPU_MEMORY_TAGGING_DETAILED)
+				if (state.drawQuad) {
+					state.drawQuad(p.x, p.y, z, fog, prim_color, mask, pixelID);
+					continue;
+				}
+#endif
+
 				DrawingCoords subp = p;
 				for (int i = 0; i < 4; ++i) {
 					if (mask[i] < 0) {
@@ -1050,6 +1121,11 @@ void DrawTriangleSlice(
 		}
 	}
 
+	if (collectStats) {
+		pixelsCovered += covered;
+		pixelsEarlyRejected += earlyRejected;
+	}
+
 #if !defined(SOFTGPU_MEMORY_TAGGING_DETAILED) && defined(SOFTGPU_MEMORY_TAGGING_BASIC)
 	for (int y = minY; y <= maxY; y += SCREEN_SCALE_FACTOR) {
 		DrawingCoords p = TransformUnit::ScreenToDrawing(minX, y);
@@ -1171,6 +1247,10 @@ void DrawRectangle(const VertexData &v0, const VertexData &v1, const BinCoords &
 	std::string ztag = StringFromFormat("DisplayListRZ_%08x", state.listPC);
 #endif
 
+	const bool collectStats = coreCollectDebugStats;
+	int covered = 0;
+	int earlyRejected = 0;
+
 	for (int64_t curY = minY; curY < maxY; curY += SCREEN_SCALE_FACTOR * 2, rowST += sty) {
 		DrawingCoords p = TransformUnit::ScreenToDrawing(minX, curY);
 
@@ -1190,6 +1270,7 @@ void DrawRectangle(const VertexData &v0, const VertexData &v1, const BinCoords &
 				prim_color[i] = c0;
 			}
 
+			const int before = collectStats ? CountMask(mask) : 0;
 			if (state.pixelID.earlyZChecks) {
 				for (int i = 0; i < 4; ++i) {
 					if (mask[i] < 0)
@@ -1201,7 +1282,10 @@ void DrawRectangle(const VertexData &v0, const VertexData &v1, const BinCoords &
 						mask[i] = -1;
 					}
 				}
+				if (collectStats)
+					earlyRejected += before - CountMask(mask);
 			}
+			covered += before;
 
 			if (state.enableTextures) {
 				Vec4<float> s, t;
@@ -1224,6 +1308,13 @@ void DrawRectangle(const VertexData &v0, const VertexData &v1, const BinCoords &
 			}
 
 			PROFILE_THIS_SCOPE("draw_rect_px");
+#if !defined(SOFTGPU_MEMORY_TAGGING_DETAILED)
+			if (state.drawQuad) {
+				state.drawQuad(p.x, p.y, z, fog, prim_color, mask, state.pixelID);
+				continue;
+			}
+#endif
+
 			DrawingCoords subp = p;
 			for (int i = 0; i < 4; ++i) {
 				if (mask[i] < 0) {
@@ -1246,6 +1337,11 @@ void DrawRectangle(const VertexData &v0, const VertexData &v1, const BinCoords &
 		}
 	}
 
+	if (collectStats) {
+		pixelsCovered += covered;
+		pixelsEarlyRejected += earlyRejected;
+	}
+
 #if !defined(SOFTGPU_MEMORY_TAGGING_DETAILED) && defined(SOFTGPU_MEMORY_TAGGING_BASIC)
 	for (int y = minY; y <= maxY; y += SCREEN_SCALE_FACTOR) {
 		DrawingCoords p = TransformUnit::ScreenToDrawing(minX, y);
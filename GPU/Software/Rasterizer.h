@@ -69,6 +69,7 @@ struct RasterizerState {
 	PixelFuncID pixelID;
 	SamplerID samplerID;
 	SingleFunc drawPixel;
+	QuadFunc drawQuad;
 	Sampler::LinearFunc linear;
 	Sampler::NearestFunc nearest;
 	uint32_t texaddr[8]{};
@@ -90,6 +91,8 @@ struct RasterizerState {
 		bool magFilt : 1;
 		bool antialiasLines : 1;
 		bool textureProj : 1;
+		// Sampling from a decoded copy, so writes to texaddr don't affect this state.
+		bool texDecoded : 1;
 	};
 
 #if defined(SOFTGPU_MEMORY_TAGGING_DETAILED) || defined(SOFTGPU_MEMORY_TAGGING_BASIC)
@@ -102,6 +105,10 @@ struct RasterizerState {
 };
 
 void ComputeRasterizerState(RasterizerState *state, BinManager *binner);
+// Looks up the state's funcs again, for after the jit caches were cleared.
+void RefreshRasterizerFuncs(RasterizerState *state);
+// Switches to sampling 8888 texels from the specified copy of the texture.
+void ApplyDecodedTexture(RasterizerState *state, const u8 *const texptr[8], const uint16_t texbufw[8], BinManager *binner);
 void CalculateRasterStateFlags(RasterizerState *state, const VertexData &v0);
 void CalculateRasterStateFlags(RasterizerState *state, const VertexData &v0, const VertexData &v1, bool forceFlat);
 void CalculateRasterStateFlags(RasterizerState *state, const VertexData &v0, const VertexData &v1, const VertexData &v2);
@@ -116,4 +123,7 @@ void ClearRectangle(const VertexData &v0, const VertexData &v1, const BinCoords
 
 bool GetCurrentTexture(GPUDebugBuffer &buffer, int level);
 
+// Running totals from triangles and rectangles, only counted while debug stats are collected.
+void PixelCounts(int64_t *covered, int64_t *earlyRejected);
+
 }  // namespace Rasterizer
@@ -18,6 +18,8 @@
 #include "GPU/Software/RasterizerRegCache.h"
 
 #include "Common/Arm64Emitter.h"
+#include "Common/MemoryUtil.h"
+#include "Common/Thread/ThreadManager.h"
 
 namespace Rasterizer {
 
@@ -409,6 +411,15 @@ CodeBlock::CodeBlock(int size)
 #endif
 }
 
+bool CodeBlock::CanCompileInBackground() {
+#if PPSSPP_ARCH(AMD64) && !PPSSPP_PLATFORM(UWP)
+	// With W^X, writing would make the whole space unexecutable for a moment.
+	return !PlatformIsWXExclusive() && g_threadManager.IsInitialized();
+#else
+	return false;
+#endif
+}
+
 int CodeBlock::WriteProlog(int extraStack, const std::vector<RegCache::Reg> &vec, const std::vector<RegCache::Reg> &gen) {
 	savedStack_ = 0;
 	firstVecStack_ = extraStack;
@@ -227,6 +227,9 @@ class CodeBlock : public BaseCodeBlock {
 protected:
 	CodeBlock(int size);
 
+	// Whether new funcs can be written on a worker while raster threads run others from this space.
+	static bool CanCompileInBackground();
+
 	RegCache::Reg GetZeroVec();
 
 	void Describe(const std::string &message);
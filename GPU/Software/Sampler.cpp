@@ -21,6 +21,7 @@
 #include "Common/Common.h"
 #include "Common/Data/Convert/ColorConv.h"
 #include "Common/StringUtils.h"
+#include "Common/Thread/ThreadManager.h"
 #include "Core/Config.h"
 #include "Core/Reporting.h"
 #include "GPU/Common/TextureDecoder.h"
@@ -50,8 +51,8 @@ void Init() {
 	jitCache = new SamplerJitCache();
 }
 
-void FlushJit() {
-	jitCache->Flush();
+bool FlushJit() {
+	return jitCache->Flush();
 }
 
 void Shutdown() {
@@ -59,6 +60,22 @@ void Shutdown() {
 	jitCache = nullptr;
 }
 
+int JitCompileCount() {
+	return jitCache->CompileCount();
+}
+
+void JitLookupCounts(int *hits, int *misses) {
+	jitCache->LookupCounts(hits, misses);
+}
+
+std::vector<SamplerID> GetCompiledJitIDs() {
+	return jitCache->GetCompiledIDs();
+}
+
+void PrecompileJit(const std::vector<SamplerID> &ids) {
+	jitCache->Precompile(ids);
+}
+
 bool DescribeCodePtr(const u8 *ptr, std::string &name) {
 	if (!jitCache->IsInSpace(ptr)) {
 		return false;
@@ -98,6 +115,22 @@ FetchFunc GetFetchFunc(SamplerID id, BinManager *binner) {
 	return &SampleFetch;
 }
 
+class SamplerJitCompileTask : public Task {
+public:
+	SamplerJitCompileTask(SamplerJitCache *cache) : cache_(cache) {}
+
+	TaskType Type() const override {
+		return TaskType::CPU_COMPUTE;
+	}
+
+	void Run() override {
+		cache_->RunCompileWorker();
+	}
+
+private:
+	SamplerJitCache *cache_;
+};
+
 thread_local SamplerJitCache::LastCache SamplerJitCache::lastFetch_;
 thread_local SamplerJitCache::LastCache SamplerJitCache::lastNearest_;
 thread_local SamplerJitCache::LastCache SamplerJitCache::lastLinear_;
@@ -109,6 +142,11 @@ SamplerJitCache::SamplerJitCache() : Rasterizer::CodeBlock(1024 * 64 * 4), cache
 	lastLinear_.gen = -1;
 }
 
+SamplerJitCache::~SamplerJitCache() {
+	std::unique_lock<std::mutex> guard(jitCacheLock);
+	WaitForCompileWorker(guard);
+}
+
 void SamplerJitCache::Clear() {
 	clearGen_++;
 	CodeBlock::Clear();
@@ -125,11 +163,14 @@ void SamplerJitCache::Clear() {
 
 	constOnes32_ = nullptr;
 	constOnes16_ = nullptr;
+	constMaxTexel32_ = nullptr;
 	constUNext_ = nullptr;
 	constVNext_ = nullptr;
 
 	const5551Swizzle_ = nullptr;
 	const5650Swizzle_ = nullptr;
+	constPairFracV_ = nullptr;
+	constPairFracU_ = nullptr;
 }
 
 std::string SamplerJitCache::DescribeCodePtr(const u8 *ptr) {
@@ -151,8 +192,23 @@ std::string SamplerJitCache::DescribeCodePtr(const u8 *ptr) {
 	return CodeBlock::DescribeCodePtr(ptr);
 }
 
-void SamplerJitCache::Flush() {
+bool SamplerJitCache::Flush() {
 	std::unique_lock<std::mutex> guard(jitCacheLock);
+	// Compiling below might clear too, if it runs out of space.
+	const int startClearGen = clearGen_;
+	if (CanCompileInBackground()) {
+		// The raster threads are idle now, so this is our chance to clear.  The worker has stopped if this is set.
+		if (needsClear_) {
+			Clear();
+			needsClear_ = false;
+			// Any states using the old funcs need to be recreated.
+			compileCount_++;
+		}
+		if (!compileQueue_.empty())
+			StartCompileWorker();
+		return clearGen_ != startClearGen;
+	}
+
 	for (const auto &queued : compileQueue_) {
 		// Might've been compiled after enqueue, but before now.
 		size_t queuedKey = std::hash<SamplerID>()(queued);
@@ -160,13 +216,27 @@ void SamplerJitCache::Flush() {
 			Compile(queued);
 	}
 	compileQueue_.clear();
+	return clearGen_ != startClearGen;
 }
 
 NearestFunc SamplerJitCache::GetByID(const SamplerID &id, size_t key, BinManager *binner) {
 	std::unique_lock<std::mutex> guard(jitCacheLock);
 	auto it = cache_.Get(key);
-	if (it != nullptr)
+	if (it != nullptr) {
+		lookupHits_++;
 		return it;
+	}
+	lookupMisses_++;
+
+	if (CanCompileInBackground()) {
+		// The caller uses the C++ sampler until this is ready, no need to drain.
+		// If it's already in addresses_, it failed to compile, so don't bother retrying.
+		if (addresses_.find(id) == addresses_.end()) {
+			compileQueue_.insert(id);
+			StartCompileWorker();
+		}
+		return nullptr;
+	}
 
 	if (!binner) {
 		// Can't compile, let's try to do it later when there's an opportunity.
@@ -198,11 +268,15 @@ NearestFunc SamplerJitCache::GetNearest(const SamplerID &id, BinManager *binner)
 		return nullptr;
 
 	const size_t key = std::hash<SamplerID>()(id);
-	if (lastNearest_.Match(key, clearGen_))
+	if (lastNearest_.Match(key, clearGen_)) {
+		lookupHits_++;
 		return (NearestFunc)lastNearest_.func;
+	}
 
 	auto func = GetByID(id, key, binner);
-	lastNearest_.Set(key, func, clearGen_);
+	// Might be compiling in the background, so check again next time.
+	if (func)
+		lastNearest_.Set(key, func, clearGen_);
 	return (NearestFunc)func;
 }
 
@@ -211,11 +285,15 @@ LinearFunc SamplerJitCache::GetLinear(const SamplerID &id, BinManager *binner) {
 		return nullptr;
 
 	const size_t key = std::hash<SamplerID>()(id);
-	if (lastLinear_.Match(key, clearGen_))
+	if (lastLinear_.Match(key, clearGen_)) {
+		lookupHits_++;
 		return (LinearFunc)lastLinear_.func;
+	}
 
 	auto func = GetByID(id, key, binner);
-	lastLinear_.Set(key, func, clearGen_);
+	// Might be compiling in the background, so check again next time.
+	if (func)
+		lastLinear_.Set(key, func, clearGen_);
 	return (LinearFunc)func;
 }
 
@@ -224,43 +302,140 @@ FetchFunc SamplerJitCache::GetFetch(const SamplerID &id, BinManager *binner) {
 		return nullptr;
 
 	const size_t key = std::hash<SamplerID>()(id);
-	if (lastFetch_.Match(key, clearGen_))
+	if (lastFetch_.Match(key, clearGen_)) {
+		lookupHits_++;
 		return (FetchFunc)lastFetch_.func;
+	}
 
 	auto func = GetByID(id, key, binner);
-	lastFetch_.Set(key, func, clearGen_);
+	// Might be compiling in the background, so check again next time.
+	if (func)
+		lastFetch_.Set(key, func, clearGen_);
 	return (FetchFunc)func;
 }
 
+void SamplerJitCache::StartCompileWorker() {
+	if (!compileWorkerActive_ && !needsClear_) {
+		// Only one at a time, since there's only one code space.
+		compileWorkerActive_ = true;
+		g_threadManager.EnqueueTask(new SamplerJitCompileTask(this));
+	}
+}
+
+void SamplerJitCache::WaitForCompileWorker(std::unique_lock<std::mutex> &guard) {
+	compileCond_.wait(guard, [&] {
+		return !compileWorkerActive_;
+	});
+}
+
+void SamplerJitCache::RunCompileWorker() {
+	std::unique_lock<std::mutex> guard(jitCacheLock);
+	while (!compileQueue_.empty()) {
+		const SamplerID id = *compileQueue_.begin();
+		if (cache_.Get(std::hash<SamplerID>()(id))) {
+			compileQueue_.erase(compileQueue_.begin());
+			continue;
+		}
+
+		// Raster threads might be running funcs from this space, so clearing waits for Flush().
+		if (GetSpaceLeft() < 16384) {
+			needsClear_ = true;
+			break;
+		}
+		compileQueue_.erase(compileQueue_.begin());
+
+		// Nothing else writes code while we're active, so the lock is only needed to publish.
+		CompiledFunc funcs[3];
+		guard.unlock();
+		CompileVariants(id, funcs);
+		guard.lock();
+
+		PublishVariants(funcs);
+		compileCount_++;
+	}
+
+	compileWorkerActive_ = false;
+	compileCond_.notify_all();
+}
+
 void SamplerJitCache::Compile(const SamplerID &id) {
 	// This should be sufficient.
 	if (GetSpaceLeft() < 16384) {
 		Clear();
 	}
 
+	CompiledFunc funcs[3];
+	CompileVariants(id, funcs);
+	PublishVariants(funcs);
+}
+
+void SamplerJitCache::CompileVariants(const SamplerID &id, CompiledFunc (&funcs)[3]) {
+	for (CompiledFunc &f : funcs) {
+		f.id = id;
+		f.start = nullptr;
+		f.func = nullptr;
+	}
+
 	// We compile them together so the cache can't possibly be cleared in between.
 	// We might vary between nearest and linear, so we can't clear between.
 #if PPSSPP_ARCH(AMD64) && !PPSSPP_PLATFORM(UWP)
-	SamplerID fetchID = id;
-	fetchID.linear = false;
-	fetchID.fetch = true;
-	addresses_[fetchID] = GetCodePointer();
-	cache_.Insert(std::hash<SamplerID>()(fetchID), (NearestFunc)CompileFetch(fetchID));
-
-	SamplerID nearestID = id;
-	nearestID.linear = false;
-	nearestID.fetch = false;
-	addresses_[nearestID] = GetCodePointer();
-	cache_.Insert(std::hash<SamplerID>()(nearestID), (NearestFunc)CompileNearest(nearestID));
-
-	SamplerID linearID = id;
-	linearID.linear = true;
-	linearID.fetch = false;
-	addresses_[linearID] = GetCodePointer();
-	cache_.Insert(std::hash<SamplerID>()(linearID), (NearestFunc)CompileLinear(linearID));
+	funcs[0].id.linear = false;
+	funcs[0].id.fetch = true;
+	funcs[0].start = GetCodePointer();
+	funcs[0].func = (NearestFunc)CompileFetch(funcs[0].id);
+
+	funcs[1].id.linear = false;
+	funcs[1].id.fetch = false;
+	funcs[1].start = GetCodePointer();
+	funcs[1].func = CompileNearest(funcs[1].id);
+
+	funcs[2].id.linear = true;
+	funcs[2].id.fetch = false;
+	funcs[2].start = GetCodePointer();
+	funcs[2].func = (NearestFunc)CompileLinear(funcs[2].id);
 #endif
 }
 
+void SamplerJitCache::PublishVariants(const CompiledFunc (&funcs)[3]) {
+#if PPSSPP_ARCH(AMD64) && !PPSSPP_PLATFORM(UWP)
+	for (const CompiledFunc &f : funcs) {
+		addresses_[f.id] = f.start;
+		cache_.Insert(std::hash<SamplerID>()(f.id), f.func);
+	}
+	// Any of the variants can recreate all three, so keep the nearest one.
+	if (funcs[0].func && funcs[1].func && funcs[2].func)
+		compiledIDs_.insert(funcs[1].id);
+#endif
+}
+
+std::vector<SamplerID> SamplerJitCache::GetCompiledIDs() {
+	std::unique_lock<std::mutex> guard(jitCacheLock);
+	return std::vector<SamplerID>(compiledIDs_.begin(), compiledIDs_.end());
+}
+
+void SamplerJitCache::Precompile(const std::vector<SamplerID> &ids) {
+	if (!g_Config.bSoftwareRenderingJit)
+		return;
+
+	std::unique_lock<std::mutex> guard(jitCacheLock);
+	for (const SamplerID &id : ids) {
+		if (!cache_.Get(std::hash<SamplerID>()(id)))
+			compileQueue_.insert(id);
+	}
+
+	if (CanCompileInBackground()) {
+		StartCompileWorker();
+		return;
+	}
+
+	// Nothing is drawing, so it's safe to compile (and clear) right here.
+	for (const auto &queued : compileQueue_) {
+		if (!cache_.Get(std::hash<SamplerID>()(queued)))
+			Compile(queued);
+	}
+	compileQueue_.clear();
+}
+
 template <uint32_t texel_size_bits>
 static inline int GetPixelDataOffset(uint32_t row_pitch_pixels, uint32_t u, uint32_t v, bool swizzled) {
 	if (!swizzled)
@@ -601,6 +776,25 @@ static Vec4IntResult SOFTRAST_CALL SampleFetch(int u, int v, const u8 *tptr, int
 	return ToVec4IntResult(Vec4<int>::FromRGBA(c.v[0]));
 }
 
+void DecodeTexture(u32 *dst, int dstStride, int w, int h, const u8 *tptr, uint16_t bufw, int level, const SamplerID &samplerID) {
+	for (int y = 0; y < h; ++y) {
+		u32 *row = dst + y * dstStride;
+		// Sizes are powers of two, so either it's a multiple of 4 or smaller.
+		if (w < 4) {
+			for (int x = 0; x < w; ++x)
+				row[x] = SampleNearest<1>(&x, &y, tptr, bufw, level, samplerID).v[0];
+			continue;
+		}
+
+		const int v[4] = { y, y, y, y };
+		for (int x = 0; x < w; x += 4) {
+			const int u[4] = { x, x + 1, x + 2, x + 3 };
+			Nearest4 c = SampleNearest<4>(u, v, tptr, bufw, level, samplerID);
+			memcpy(row + x, c.v, sizeof(c.v));
+		}
+	}
+}
+
 static inline Vec4IntResult SOFTRAST_CALL ApplyTexelClampQuad(bool clamp, Vec4IntArg vec, int width) {
 	Vec4<int> result = vec;
 #ifdef _M_SSE
@@ -19,8 +19,12 @@
 
 #include "ppsspp_config.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 #include "Common/Data/Collections/Hashmaps.h"
 #include "GPU/Math3D.h"
 #include "GPU/Software/FuncId.h"
@@ -46,28 +50,66 @@ NearestFunc GetNearestFunc(SamplerID id, BinManager *binner);
 typedef Rasterizer::Vec4IntResult (SOFTRAST_CALL *LinearFunc)(float s, float t, Rasterizer::Vec4IntArg prim_color, const u8 *const *tptr, const uint16_t *bufw, int level, int levelFrac, const SamplerID &samplerID);
 LinearFunc GetLinearFunc(SamplerID id, BinManager *binner);
 
+// Decodes one level to 8888, exactly as fetching each texel would.
+void DecodeTexture(u32 *dst, int dstStride, int w, int h, const u8 *tptr, uint16_t bufw, int level, const SamplerID &samplerID);
+
 void Init();
-void FlushJit();
+// Returns true if the cache was cleared, so any funcs looked up before are gone.
+bool FlushJit();
 void Shutdown();
+// Changes whenever funcs finish compiling in the background, or the cache is cleared.
+int JitCompileCount();
+// Running totals of func lookups that found compiled code, or didn't.
+void JitLookupCounts(int *hits, int *misses);
+// Every id compiled since Init(), even if cleared since.  Each covers fetch, nearest, and linear.
+std::vector<SamplerID> GetCompiledJitIDs();
+// Only call while nothing is drawing.
+void PrecompileJit(const std::vector<SamplerID> &ids);
 
 bool DescribeCodePtr(const u8 *ptr, std::string &name);
 
 class SamplerJitCache : public Rasterizer::CodeBlock {
 public:
 	SamplerJitCache();
+	~SamplerJitCache();
 
 	// Returns a pointer to the code to run.
 	NearestFunc GetNearest(const SamplerID &id, BinManager *binner);
 	LinearFunc GetLinear(const SamplerID &id, BinManager *binner);
 	FetchFunc GetFetch(const SamplerID &id, BinManager *binner);
 	void Clear() override;
-	void Flush();
+	bool Flush();
 
 	std::string DescribeCodePtr(const u8 *ptr) override;
 
+	int CompileCount() const {
+		return compileCount_;
+	}
+	void LookupCounts(int *hits, int *misses) const {
+		*hits = lookupHits_;
+		*misses = lookupMisses_;
+	}
+	std::vector<SamplerID> GetCompiledIDs();
+	void Precompile(const std::vector<SamplerID> &ids);
+
 private:
+	friend class SamplerJitCompileTask;
+
+	struct CompiledFunc {
+		SamplerID id;
+		const u8 *start;
+		NearestFunc func;
+	};
+
 	void Compile(const SamplerID &id);
+	// Fetch, nearest, and linear are compiled together.  This doesn't touch the lookup tables.
+	void CompileVariants(const SamplerID &id, CompiledFunc (&funcs)[3]);
+	void PublishVariants(const CompiledFunc (&funcs)[3]);
 	NearestFunc GetByID(const SamplerID &id, size_t key, BinManager *binner);
+	// These expect jitCacheLock to be held.
+	void StartCompileWorker();
+	void WaitForCompileWorker(std::unique_lock<std::mutex> &guard);
+	void RunCompileWorker();
 	FetchFunc CompileFetch(const SamplerID &id);
 	NearestFunc CompileNearest(const SamplerID &id);
 	LinearFunc CompileLinear(const SamplerID &id);
@@ -100,6 +142,7 @@ class SamplerJitCache : public Rasterizer::CodeBlock {
 	bool Jit_TransformClutIndexQuad(const SamplerID &id, int bitsPerIndex);
 	bool Jit_ReadClutQuad(const SamplerID &id, bool level1);
 	bool Jit_BlendQuad(const SamplerID &id, bool level1);
+	bool Jit_BlendQuadPair(const SamplerID &id);
 	bool Jit_DecodeQuad(const SamplerID &id, bool level1);
 	bool Jit_Decode5650Quad(const SamplerID &id, Rasterizer::RegCache::Reg quadReg);
 	bool Jit_Decode5551Quad(const SamplerID &id, Rasterizer::RegCache::Reg quadReg);
@@ -127,6 +170,8 @@ class SamplerJitCache : public Rasterizer::CodeBlock {
 	const u8 *const10All8_ = nullptr;
 	const u8 *const5551Swizzle_ = nullptr;
 	const u8 *const5650Swizzle_ = nullptr;
+	const u8 *constPairFracV_ = nullptr;
+	const u8 *constPairFracU_ = nullptr;
 
 	struct LastCache {
 		size_t key;
@@ -147,10 +192,19 @@ class SamplerJitCache : public Rasterizer::CodeBlock {
 	DenseHashMap<size_t, NearestFunc, nullptr> cache_;
 	std::unordered_map<SamplerID, const u8 *> addresses_;
 	std::unordered_set<SamplerID> compileQueue_;
+	std::unordered_set<SamplerID> compiledIDs_;
 	int clearGen_ = 0;
 	static thread_local LastCache lastFetch_;
 	static thread_local LastCache lastNearest_;
 	static thread_local LastCache lastLinear_;
+
+	std::condition_variable compileCond_;
+	bool compileWorkerActive_ = false;
+	// Set by the worker when it runs out of space, since it can't clear while raster threads run.
+	bool needsClear_ = false;
+	std::atomic<int> compileCount_{};
+	std::atomic<int> lookupHits_{};
+	std::atomic<int> lookupMisses_{};
 };
 
 #if defined(__clang__) || defined(__GNUC__)
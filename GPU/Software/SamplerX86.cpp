@@ -804,7 +804,10 @@ LinearFunc SamplerJitCache::CompileLinear(const SamplerID &id) {
 		regCache_.ForceRelease(RegCache::GEN_ARG_LEVEL);
 
 	success = success && Jit_DecodeQuad(id, false);
-	success = success && Jit_BlendQuad(id, false);
+	// With AVX2, we blend both levels at once when we need both.
+	bool blendPair = id.hasAnyMips && cpu_info.bAVX2;
+	if (!blendPair)
+		success = success && Jit_BlendQuad(id, false);
 	if (id.hasAnyMips) {
 		Describe("BlendMips");
 		if (!regCache_.Has(RegCache::GEN_ARG_LEVELFRAC)) {
@@ -819,7 +822,10 @@ LinearFunc SamplerJitCache::CompileLinear(const SamplerID &id) {
 		FixupBranch skip = J_CC(CC_Z, true);
 
 		success = success && Jit_DecodeQuad(id, true);
-		success = success && Jit_BlendQuad(id, true);
+		if (blendPair)
+			success = success && Jit_BlendQuadPair(id);
+		else
+			success = success && Jit_BlendQuad(id, true);
 
 		Describe("BlendMips");
 		// First, broadcast the levelFrac value into an XMM.
@@ -838,20 +844,38 @@ LinearFunc SamplerJitCache::CompileLinear(const SamplerID &id) {
 		MOVDQA(invFracReg, M(const10All16_));
 		PSUBW(invFracReg, R(fracReg));
 
-		// And multiply.
-		PMULLW(XMM0, R(invFracReg));
+		// And multiply.  This is XMM0 unless we blended the pair.
+		X64Reg color0Reg = regCache_.Find(RegCache::VEC_RESULT);
+		PMULLW(color0Reg, R(invFracReg));
 		regCache_.Release(fracReg, RegCache::VEC_TEMP0);
 		regCache_.Release(invFracReg, RegCache::VEC_TEMP1);
 
 		// Okay, now sum and divide by 16 (which is what the fraction maxed at.)
-		PADDW(XMM0, R(color1Reg));
-		PSRLW(XMM0, 4);
+		PADDW(color0Reg, R(color1Reg));
+		PSRLW(color0Reg, 4);
 
 		// And now we're done with color1Reg/VEC_RESULT1.
 		regCache_.Unlock(color1Reg, RegCache::VEC_RESULT1);
 		regCache_.ForceRelease(RegCache::VEC_RESULT1);
 
-		SetJumpTarget(skip);
+		if (blendPair) {
+			// The level 0 only path below leaves the result in XMM0, so match that.
+			if (color0Reg != XMM0)
+				MOVDQA(XMM0, R(color0Reg));
+			regCache_.Unlock(color0Reg, RegCache::VEC_RESULT);
+			FixupBranch done = J(true);
+
+			SetJumpTarget(skip);
+			success = success && Jit_BlendQuad(id, false);
+
+			SetJumpTarget(done);
+			// The zero reg might've only been set on the path we skipped.
+			if (regCache_.Has(RegCache::VEC_ZERO))
+				regCache_.ForceRelease(RegCache::VEC_ZERO);
+		} else {
+			regCache_.Unlock(color0Reg, RegCache::VEC_RESULT);
+			SetJumpTarget(skip);
+		}
 	}
 
 	if (regCache_.Has(RegCache::VEC_FRAC))
@@ -922,6 +946,24 @@ void SamplerJitCache::WriteConstantPool(const SamplerID &id) {
 	WriteSimpleConst4x32(const5551Swizzle_, 0x00070707);
 	WriteSimpleConst4x32(const5650Swizzle_, 0x00070307);
 
+	// For blending both mip levels in one 256-bit reg: frac_v in bytes and frac_u in words.
+	// The low lane picks level 0's fracs, and the high lane level 1's.
+	if (constPairFracV_ == nullptr && cpu_info.bAVX2) {
+		constPairFracV_ = AlignCode16();
+		for (int i = 0; i < 16; ++i)
+			Write8(2);
+		for (int i = 0; i < 16; ++i)
+			Write8(6);
+	}
+
+	if (constPairFracU_ == nullptr && cpu_info.bAVX2) {
+		constPairFracU_ = AlignCode16();
+		for (int i = 0; i < 8; ++i)
+			Write16(0x8000);
+		for (int i = 0; i < 8; ++i)
+			Write16(0x8004);
+	}
+
 	// These are unique to the sampler ID.
 	if (!id.hasAnyMips) {
 		float w256f = (1 << id.width0Shift) * 256;
@@ -1506,6 +1548,60 @@ bool SamplerJitCache::Jit_BlendQuad(const SamplerID &id, bool level1) {
 	return true;
 }
 
+bool SamplerJitCache::Jit_BlendQuadPair(const SamplerID &id) {
+	Describe("BlendQuadPair");
+
+	// This is the same as Jit_BlendQuad(), except level 1 goes in the upper lane.
+	// That way, we blend both levels together using 256-bit ops.
+	X64Reg quadReg = regCache_.Find(RegCache::VEC_RESULT);
+	X64Reg quad1Reg = regCache_.Find(RegCache::VEC_RESULT1);
+	VINSERTI128(quadReg, quadReg, R(quad1Reg), 1);
+
+	// Rearrange within each lane to TL BL TR BR, with all the RGBAs next to each other.
+	X64Reg tempArrangeReg = regCache_.Alloc(RegCache::VEC_TEMP0);
+	VPSHUFD(256, tempArrangeReg, R(quadReg), _MM_SHUFFLE(3, 2, 3, 2));
+	VPUNPCKLBW(256, quadReg, quadReg, R(tempArrangeReg));
+	VPSHUFD(256, tempArrangeReg, R(quadReg), _MM_SHUFFLE(3, 2, 3, 2));
+	VPUNPCKLWD(256, quadReg, quadReg, R(tempArrangeReg));
+	regCache_.Release(tempArrangeReg, RegCache::VEC_TEMP0);
+
+	// Copy the fracs into both lanes, then each lane shuffles out its own level's.
+	X64Reg bothFracReg = regCache_.Alloc(RegCache::VEC_TEMP0);
+	X64Reg allFracReg = regCache_.Find(RegCache::VEC_FRAC);
+	VINSERTI128(bothFracReg, allFracReg, R(allFracReg), 1);
+	regCache_.Unlock(allFracReg, RegCache::VEC_FRAC);
+
+	// First frac_v in every byte, interleaved with (0x10 - frac_v) for the TB pairs.
+	X64Reg fracReg = regCache_.Alloc(RegCache::VEC_TEMP1);
+	X64Reg multReg = regCache_.Alloc(RegCache::VEC_TEMP2);
+	VPSHUFB(256, fracReg, bothFracReg, M(constPairFracV_));
+	VBROADCASTI128(multReg, M(const10All8_));
+	VPSUBB(256, multReg, multReg, R(fracReg));
+	VPUNPCKLBW(256, multReg, multReg, R(fracReg));
+	VPMADDUBSW(256, quadReg, quadReg, R(multReg));
+
+	// Then frac_u as words, for the 0L0R multiplier.
+	VPSHUFB(256, fracReg, bothFracReg, M(constPairFracU_));
+	VBROADCASTI128(multReg, M(const10All16_));
+	VPSUBW(256, multReg, multReg, R(fracReg));
+	VPUNPCKLWD(256, multReg, multReg, R(fracReg));
+	VPMADDWD(256, quadReg, quadReg, R(multReg));
+	VPSRLD(256, quadReg, quadReg, 8);
+	regCache_.Release(bothFracReg, RegCache::VEC_TEMP0);
+	regCache_.Release(fracReg, RegCache::VEC_TEMP1);
+	regCache_.Release(multReg, RegCache::VEC_TEMP2);
+
+	// Shrink to 16-bit, and split level 1 back out.
+	VPACKSSDW(256, quadReg, quadReg, R(quadReg));
+	VEXTRACTI128(R(quad1Reg), quadReg, 1);
+	// Everything after this is SSE, so avoid transition penalties.
+	VZEROUPPER();
+
+	regCache_.Unlock(quadReg, RegCache::VEC_RESULT);
+	regCache_.Unlock(quad1Reg, RegCache::VEC_RESULT1);
+	return true;
+}
+
 bool SamplerJitCache::Jit_ApplyTextureFunc(const SamplerID &id) {
 	X64Reg resultReg = regCache_.Find(RegCache::VEC_RESULT);
 	X64Reg primColorReg = regCache_.Find(RegCache::VEC_ARG_COLOR);
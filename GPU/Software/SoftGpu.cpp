@@ -15,7 +15,11 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include <cstring>
 #include <set>
+#include "ext/xxhash.h"
+#include "Common/File/FileUtil.h"
+#include "Common/Serialize/Serializer.h"
 #include "Common/System/Display.h"
 #include "Common/GPU/OpenGL/GLFeatures.h"
 
@@ -28,12 +32,14 @@
 #include "Core/ConfigValues.h"
 #include "Core/Core.h"
 #include "Core/Debugger/MemBlockInfo.h"
+#include "Core/ELF/ParamSFO.h"
 #include "Core/MemMap.h"
 #include "Core/MemMapHelpers.h"
 #include "Core/HLE/sceKernelInterrupt.h"
 #include "Core/HLE/sceGe.h"
 #include "Core/MIPS/MIPS.h"
 #include "Core/Reporting.h"
+#include "Core/System.h"
 #include "Core/Util/PPGeDraw.h"
 #include "Common/Profiler/Profiler.h"
 #include "Common/GPU/thin3d.h"
@@ -393,6 +399,89 @@ const SoftwareCommandTableEntry softgpuCommandTable[] = {
 	{ GE_CMD_NOP_FF },
 };
 
+static const uint32_t JIT_ID_CACHE_MAGIC = 0x444A4653;  // SFJD
+static const uint32_t JIT_ID_CACHE_VERSION = 1;
+
+struct JitIDCacheHeader {
+	uint32_t magic;
+	uint32_t version;
+	// Hash of PPSSPP_GIT_VERSION, since the id bit layouts may change between builds.
+	uint64_t buildHash;
+	uint32_t numPixelIDs;
+	uint32_t numSamplerIDs;
+};
+
+static void LoadJitIDCache(const Path &filename) {
+	FILE *f = File::OpenCFile(filename, "rb");
+	if (!f)
+		return;
+
+	JitIDCacheHeader header{};
+	bool success = fread(&header, sizeof(header), 1, f) == 1;
+	if (!success || header.magic != JIT_ID_CACHE_MAGIC || header.version != JIT_ID_CACHE_VERSION || header.buildHash != XXH3_64bits(PPSSPP_GIT_VERSION, strlen(PPSSPP_GIT_VERSION))) {
+		INFO_LOG(G3D, "Software renderer JIT cache is from a different build, ignoring");
+		fclose(f);
+		return;
+	}
+	// Games use dozens of these, not tens of thousands.
+	if (header.numPixelIDs > 0x10000 || header.numSamplerIDs > 0x10000) {
+		ERROR_LOG(G3D, "Software renderer JIT cache is corrupt");
+		fclose(f);
+		return;
+	}
+
+	std::vector<uint64_t> pixelKeys(header.numPixelIDs);
+	std::vector<uint32_t> samplerKeys(header.numSamplerIDs);
+	success = fread(pixelKeys.data(), sizeof(uint64_t), pixelKeys.size(), f) == pixelKeys.size();
+	success = success && fread(samplerKeys.data(), sizeof(uint32_t), samplerKeys.size(), f) == samplerKeys.size();
+	fclose(f);
+	if (!success) {
+		ERROR_LOG(G3D, "Software renderer JIT cache truncated");
+		return;
+	}
+
+	// Only the keys matter for compiling, the cached values are read when drawing.
+	std::vector<PixelFuncID> pixelIDs(pixelKeys.size());
+	for (size_t i = 0; i < pixelKeys.size(); ++i)
+		pixelIDs[i].fullKey = pixelKeys[i];
+	std::vector<SamplerID> samplerIDs(samplerKeys.size());
+	for (size_t i = 0; i < samplerKeys.size(); ++i)
+		samplerIDs[i].fullKey = samplerKeys[i];
+
+	Rasterizer::PrecompileJit(pixelIDs);
+	Sampler::PrecompileJit(samplerIDs);
+	INFO_LOG(G3D, "Precompiling %d pixel and %d sampler funcs from the JIT cache", (int)pixelIDs.size(), (int)samplerIDs.size());
+}
+
+static void SaveJitIDCache(const Path &filename) {
+	const std::vector<PixelFuncID> pixelIDs = Rasterizer::GetCompiledJitIDs();
+	const std::vector<SamplerID> samplerIDs = Sampler::GetCompiledJitIDs();
+	if (pixelIDs.empty() && samplerIDs.empty())
+		return;
+
+	FILE *f = File::OpenCFile(filename, "wb");
+	if (!f)
+		return;
+
+	JitIDCacheHeader header{};
+	header.magic = JIT_ID_CACHE_MAGIC;
+	header.version = JIT_ID_CACHE_VERSION;
+	header.buildHash = XXH3_64bits(PPSSPP_GIT_VERSION, strlen(PPSSPP_GIT_VERSION));
+	header.numPixelIDs = (uint32_t)pixelIDs.size();
+	header.numSamplerIDs = (uint32_t)samplerIDs.size();
+	fwrite(&header, sizeof(header), 1, f);
+
+	for (const PixelFuncID &id : pixelIDs) {
+		uint64_t key = id.fullKey;
+		fwrite(&key, sizeof(key), 1, f);
+	}
+	for (const SamplerID &id : samplerIDs) {
+		uint32_t key = id.fullKey;
+		fwrite(&key, sizeof(key), 1, f);
+	}
+	fclose(f);
+}
+
 SoftGPU::SoftGPU(GraphicsContext *gfxCtx, Draw::DrawContext *draw)
 	: GPUCommon(gfxCtx, draw)
 {
@@ -432,6 +521,16 @@ SoftGPU::SoftGPU(GraphicsContext *gfxCtx, Draw::DrawContext *draw)
 
 	Rasterizer::Init();
 	Sampler::Init();
+
+	// We're created before the game is loaded, but PARAM.SFO has already been read.
+	std::string discID = g_paramSFO.GetDiscID();
+	if (g_Config.bSoftwareRenderingJitCache && g_Config.bSoftwareRenderingJit && !discID.empty()) {
+		File::CreateFullPath(GetSysDirectory(DIRECTORY_APP_CACHE));
+		jitIDCachePath_ = GetSysDirectory(DIRECTORY_APP_CACHE) / (discID + ".softjitcache");
+		// Compiles on worker threads, so the first frames don't have to wait.
+		LoadJitIDCache(jitIDCachePath_);
+	}
+
 	drawEngine_ = new SoftwareDrawEngine();
 	drawEngine_->Init();
 	drawEngineCommon_ = drawEngine_;
@@ -479,6 +578,8 @@ SoftGPU::~SoftGPU() {
 	delete presentation_;
 	delete drawEngine_;
 
+	if (!jitIDCachePath_.empty())
+		SaveJitIDCache(jitIDCachePath_);
 	Sampler::Shutdown();
 	Rasterizer::Shutdown();
 }
@@ -800,7 +901,8 @@ void SoftGPU::Execute_BlockTransferStart(u32 op, u32 diff) {
 	const uint32_t dstSize = (height - 1) * (dstStride + width) * bpp;
 
 	// Need to flush both source and target, so we overwrite properly.
-	if (Memory::IsValidRange(src, srcSize) && Memory::IsValidRange(dst, dstSize)) {
+	const bool wraps = !Memory::IsValidRange(src, srcSize) || !Memory::IsValidRange(dst, dstSize);
+	if (!wraps) {
 		drawEngine_->transformUnit.FlushIfOverlap("blockxfer", false, src, srcStride, width * bpp, height);
 		drawEngine_->transformUnit.FlushIfOverlap("blockxfer", true, dst, dstStride, width * bpp, height);
 	} else {
@@ -808,6 +910,11 @@ void SoftGPU::Execute_BlockTransferStart(u32 op, u32 diff) {
 	}
 
 	DoBlockTransfer(gstate_c.skipDrawReason);
+	// The width can be wider than the stride, so cover through the end of the last row written.
+	if (!wraps)
+		drawEngine_->transformUnit.NotifyMemoryWrite(dst, ((height - 1) * dstStride + width) * bpp);
+	else
+		InvalidateCache(0, -1, GPU_INVALIDATE_ALL);
 
 	// Could theoretically dirty the framebuffer.
 	MarkDirty(dst, dstSize, SoftGPUVRAMDirty::DIRTY | SoftGPUVRAMDirty::REALLY_DIRTY);
@@ -1240,14 +1347,33 @@ void SoftGPU::GetStats(char *buffer, size_t bufsize) {
 	drawEngine_->transformUnit.GetStats(buffer, bufsize);
 }
 
+bool SoftGPU::GetFrameCounters(GPUFrameCounters &counters) {
+	drawEngine_->transformUnit.GetFrameCounters(counters);
+	return true;
+}
+
 void SoftGPU::InvalidateCache(u32 addr, int size, GPUInvalidationType type)
 {
-	// Nothing to invalidate.
+	// Only the binner's depth bounds and decoded textures depend on memory contents.
+	if (type == GPU_INVALIDATE_ALL || size < 0) {
+		drawEngine_->transformUnit.NotifyMemoryWrite(PSP_GetVidMemBase(), 0x00200000);
+		drawEngine_->transformUnit.NotifyMemoryWrite(PSP_GetKernelMemoryBase(), PSP_GetUserMemoryEnd() - PSP_GetKernelMemoryBase());
+	} else {
+		drawEngine_->transformUnit.NotifyMemoryWrite(addr, size);
+	}
+}
+
+void SoftGPU::DoState(PointerWrap &p) {
+	GPUCommon::DoState(p);
+
+	// All of memory was replaced, including any depth buffer.
+	if (p.mode == p.MODE_READ)
+		InvalidateCache(0, -1, GPU_INVALIDATE_ALL);
 }
 
 void SoftGPU::PerformWriteFormattedFromMemory(u32 addr, int size, int width, GEBufferFormat format)
 {
-	// Ignore.
+	InvalidateCache(addr, size, GPU_INVALIDATE_HINT);
 }
 
 bool SoftGPU::PerformMemoryCopy(u32 dest, u32 src, int size, GPUCopyFlag flags) {
@@ -1287,6 +1413,7 @@ bool SoftGPU::PerformWriteColorFromMemory(u32 dest, int size)
 
 bool SoftGPU::PerformWriteStencilFromMemory(u32 dest, int size, WriteStencil flags)
 {
+	InvalidateCache(dest, size, GPU_INVALIDATE_HINT);
 	return false;
 }
 
@@ -18,6 +18,7 @@
 #pragma once
 
 #include <cstdint>
+#include "Common/File/Path.h"
 #include "GPU/GPUCommon.h"
 #include "GPU/Common/GPUDebugInterface.h"
 #include "Common/GPU/thin3d.h"
@@ -137,7 +138,9 @@ class SoftGPU : public GPUCommon {
 	void SetDisplayFramebuffer(u32 framebuf, u32 stride, GEBufferFormat format) override;
 	void CopyDisplayToOutput(bool reallyDirty) override;
 	void GetStats(char *buffer, size_t bufsize) override;
+	bool GetFrameCounters(GPUFrameCounters &counters) override;
 	void InvalidateCache(u32 addr, int size, GPUInvalidationType type) override;
+	void DoState(PointerWrap &p) override;
 	void PerformWriteFormattedFromMemory(u32 addr, int size, int width, GEBufferFormat format) override;
 	bool PerformMemoryCopy(u32 dest, u32 src, int size, GPUCopyFlag flags = GPUCopyFlag::NONE) override;
 	bool PerformMemorySet(u32 dest, u8 v, int size) override;
@@ -231,6 +234,9 @@ class SoftGPU : public GPUCommon {
 
 	Draw::Texture *fbTex = nullptr;
 	std::vector<u32> fbTexBuffer_;
+
+	// Where the list of JIT funcs this game uses is kept between runs.
+	Path jitIDCachePath_;
 };
 
 // TODO: These shouldn't be global.
@@ -0,0 +1,239 @@
+// Copyright (c) 2022- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <cstring>
+#include "ext/xxhash.h"
+#include "Core/MemMap.h"
+#include "GPU/Common/TextureDecoder.h"
+#include "GPU/Software/Rasterizer.h"
+#include "GPU/Software/Sampler.h"
+#include "GPU/Software/TextureDecodeCache.h"
+
+// Enough for every texture in most scenes, while staying small compared to the binner's queues.
+static constexpr size_t MAX_DECODED_BYTES = 32 * 1024 * 1024;
+// Lookups before we decode, so textures used for one draw don't pay for it.
+static constexpr int DECODE_AFTER_USES = 2;
+static constexpr int DECIMATE_AGE = 60;
+
+static inline bool IsWorthDecoding(GETextureFormat fmt) {
+	switch (fmt) {
+	case GE_TFMT_CLUT4:
+	case GE_TFMT_CLUT8:
+	case GE_TFMT_CLUT16:
+	case GE_TFMT_CLUT32:
+	case GE_TFMT_DXT1:
+	case GE_TFMT_DXT3:
+	case GE_TFMT_DXT5:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static inline uint32_t NormalizeAddress(uint32_t addr) {
+	// Like the binner, ignore VRAM mirrors and the cached bit.
+	return Memory::IsVRAMAddress(addr) ? addr & 0x041FFFFF : addr & 0x3FFFFFFF;
+}
+
+static inline uint32_t LevelSourceBytes(const Rasterizer::RasterizerState &state, int level) {
+	// For DXT, this works out to the size of the block rows too.
+	const uint32_t bytes = (state.texbufw[level] * textureBitsPerPixel[state.samplerID.texfmt] * state.samplerID.cached.sizes[level].h) / 8;
+	return Memory::ValidSize(state.texaddr[level], bytes);
+}
+
+bool TextureDecodeCache::Key::operator ==(const Key &other) const {
+	return memcmp(this, &other, sizeof(Key)) == 0;
+}
+
+const DecodedTexture *TextureDecodeCache::Lookup(const Rasterizer::RasterizerState &state, int frame) {
+	const SamplerID &id = state.samplerID;
+	if (!IsWorthDecoding(id.TexFmt()) || id.hasInvalidPtr)
+		return nullptr;
+
+	Key key;
+	// Zero the padding too, since we hash and compare the bytes.
+	memset(&key, 0, sizeof(key));
+	for (int i = 0; i <= state.maxTexLevel; ++i) {
+		key.texaddr[i] = NormalizeAddress(state.texaddr[i]);
+		key.texbufw[i] = state.texbufw[i];
+		key.w[i] = id.cached.sizes[i].w;
+		key.h[i] = id.cached.sizes[i].h;
+	}
+	key.texfmt = id.texfmt;
+	key.maxLevel = state.maxTexLevel;
+	key.swizzle = id.swizzle;
+	if (id.texfmt & 4) {
+		key.clutFormat = id.cached.clutFormat;
+		key.useSharedClut = id.useSharedClut;
+		// Hashing the whole thing is simpler than figuring out what the mask, shift, and offset can reach.
+		key.clutHash = XXH3_64bits(id.cached.clut, 1024);
+	}
+
+	const uint64_t keyHash = XXH3_64bits(&key, sizeof(key));
+	Entry &entry = entries_[keyHash];
+	if (!(entry.key == key)) {
+		// New, or an unlucky collision.  Either way, start over.
+		Retire(entry);
+		entry.key = key;
+		entry.uses = 0;
+		entry.start = 0xFFFFFFFF;
+		entry.end = 0;
+		for (int i = 0; i <= state.maxTexLevel; ++i) {
+			entry.start = std::min(entry.start, key.texaddr[i]);
+			entry.end = std::max(entry.end, key.texaddr[i] + LevelSourceBytes(state, i));
+		}
+	}
+
+	entry.uses++;
+	entry.lastFrame = frame;
+	if (!entry.data) {
+		if (entry.uses < DECODE_AFTER_USES)
+			return nullptr;
+		Decode(entry, state);
+		entry.verifiedFrame = frame;
+		return &entry.decoded;
+	}
+
+	// The CPU may change textures without telling us, so check once per frame as well as after writes.
+	if (entry.dirty || entry.verifiedFrame != frame) {
+		uint64_t sourceHash = HashSource(state);
+		if (sourceHash != entry.sourceHash) {
+			// Probably changing often, so wait to see if it gets used again before decoding.
+			Retire(entry);
+			entry.uses = 1;
+			return nullptr;
+		}
+		entry.dirty = false;
+		entry.verifiedFrame = frame;
+	}
+
+	hits_++;
+	return &entry.decoded;
+}
+
+uint64_t TextureDecodeCache::HashSource(const Rasterizer::RasterizerState &state) {
+	uint64_t hash = 0;
+	for (int i = 0; i <= state.maxTexLevel; ++i)
+		hash = XXH3_64bits_withSeed(state.texptr[i], LevelSourceBytes(state, i), hash);
+	return hash;
+}
+
+void TextureDecodeCache::Decode(Entry &entry, const Rasterizer::RasterizerState &state) {
+	const SamplerID &id = state.samplerID;
+
+	// Use the standard bufw for 8888, so the sampler can assume it.
+	size_t offsets[8];
+	size_t total = 0;
+	for (int i = 0; i <= state.maxTexLevel; ++i) {
+		offsets[i] = total;
+		entry.decoded.texbufw[i] = std::max((int)id.cached.sizes[i].w, 4);
+		total += entry.decoded.texbufw[i] * id.cached.sizes[i].h;
+	}
+
+	// A little extra, in case of vector reads off the end.
+	entry.data.reset(new u32[total + 4]);
+	entry.bytes = (total + 4) * sizeof(u32);
+	entry.sourceHash = HashSource(state);
+	entry.dirty = false;
+	for (int i = 0; i <= state.maxTexLevel; ++i) {
+		u32 *dst = entry.data.get() + offsets[i];
+		Sampler::DecodeTexture(dst, entry.decoded.texbufw[i], id.cached.sizes[i].w, id.cached.sizes[i].h, state.texptr[i], state.texbufw[i], i, id);
+		entry.decoded.texptr[i] = (const u8 *)dst;
+	}
+
+	bytes_ += entry.bytes;
+	decodes_++;
+	if (bytes_ > MAX_DECODED_BYTES)
+		Evict(&entry);
+}
+
+void TextureDecodeCache::Retire(Entry &entry) {
+	if (!entry.data)
+		return;
+
+	bytes_ -= entry.bytes;
+	entry.bytes = 0;
+	retired_.push_back(std::move(entry.data));
+	entry.decoded = DecodedTexture();
+}
+
+void TextureDecodeCache::Evict(const Entry *keep) {
+	std::vector<std::pair<int, Entry *>> decoded;
+	for (auto &it : entries_) {
+		if (it.second.data && &it.second != keep)
+			decoded.push_back(std::make_pair(it.second.lastFrame, &it.second));
+	}
+
+	// Oldest first.  Lots of textures are only used at the start of a frame, so this isn't perfect.
+	std::sort(decoded.begin(), decoded.end(), [](const std::pair<int, Entry *> &a, const std::pair<int, Entry *> &b) {
+		return a.first < b.first;
+	});
+	for (auto &it : decoded) {
+		if (bytes_ <= MAX_DECODED_BYTES)
+			break;
+		Retire(*it.second);
+		it.second->uses = 0;
+	}
+}
+
+bool TextureDecodeCache::Invalidate(uint32_t addr, uint32_t size) {
+	if (size == 0)
+		return false;
+
+	const uint32_t start = NormalizeAddress(addr);
+	const uint32_t end = size > 0xFFFFFFFF - start ? 0xFFFFFFFF : start + size;
+	bool found = false;
+	for (auto &it : entries_) {
+		Entry &entry = it.second;
+		if (entry.data && start < entry.end && end > entry.start) {
+			entry.dirty = true;
+			found = true;
+		}
+	}
+	return found;
+}
+
+void TextureDecodeCache::Decimate(int frame) {
+	for (auto it = entries_.begin(); it != entries_.end(); ) {
+		if (it->second.lastFrame + DECIMATE_AGE < frame) {
+			Retire(it->second);
+			it = entries_.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+void TextureDecodeCache::FreeRetired(const Rasterizer::RasterizerState &current) {
+	if (retired_.empty())
+		return;
+
+	// The current state can still be used for more draws, so keep what it points at until it changes.
+	size_t kept = 0;
+	for (size_t i = 0; i < retired_.size(); ++i) {
+		const u8 *start = (const u8 *)retired_[i].get();
+		if (current.texDecoded && current.texptr[0] == start)
+			std::swap(retired_[kept++], retired_[i]);
+	}
+	retired_.resize(kept);
+}
+
+void TextureDecodeCache::ResetStats() {
+	hits_ = 0;
+	decodes_ = 0;
+}
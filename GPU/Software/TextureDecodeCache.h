@@ -0,0 +1,100 @@
+// Copyright (c) 2022- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "Common/CommonTypes.h"
+
+namespace Rasterizer {
+struct RasterizerState;
+}
+
+struct DecodedTexture {
+	const u8 *texptr[8]{};
+	uint16_t texbufw[8]{};
+};
+
+// Keeps CLUT and DXT textures that are sampled often decoded to 8888, so the sampler can use its fastest path.
+// Decoded data is never freed while draws may still read it: replaced data waits for FreeRetired().
+class TextureDecodeCache {
+public:
+	// Returns nullptr if the texture isn't worth decoding (yet.)  Assumes the state has its CLUT set.
+	const DecodedTexture *Lookup(const Rasterizer::RasterizerState &state, int frame);
+	// The contents will be rehashed before use.  Returns true if anything was decoded from this range.
+	bool Invalidate(uint32_t addr, uint32_t size);
+	// Drops textures not used recently.
+	void Decimate(int frame);
+	// Call only once nothing is drawing.  Keeps anything the current state still points at.
+	void FreeRetired(const Rasterizer::RasterizerState &current);
+
+	void ResetStats();
+	int Hits() const {
+		return hits_;
+	}
+	int Decodes() const {
+		return decodes_;
+	}
+	size_t Bytes() const {
+		return bytes_;
+	}
+
+private:
+	struct Key {
+		uint32_t texaddr[8];
+		uint16_t texbufw[8];
+		uint16_t w[8];
+		uint16_t h[8];
+		uint32_t clutFormat;
+		uint8_t texfmt;
+		uint8_t maxLevel;
+		bool swizzle;
+		bool useSharedClut;
+		uint64_t clutHash;
+
+		bool operator ==(const Key &other) const;
+	};
+
+	struct Entry {
+		Key key;
+		DecodedTexture decoded;
+		std::unique_ptr<u32[]> data;
+		size_t bytes = 0;
+		uint64_t sourceHash = 0;
+		// Range of the source, for invalidation.
+		uint32_t start = 0;
+		uint32_t end = 0;
+		int uses = 0;
+		int lastFrame = 0;
+		int verifiedFrame = 0;
+		bool dirty = false;
+	};
+
+	static uint64_t HashSource(const Rasterizer::RasterizerState &state);
+	void Decode(Entry &entry, const Rasterizer::RasterizerState &state);
+	void Retire(Entry &entry);
+	void Evict(const Entry *keep);
+
+	std::unordered_map<uint64_t, Entry> entries_;
+	std::vector<std::unique_ptr<u32[]>> retired_;
+	size_t bytes_ = 0;
+	int hits_ = 0;
+	int decodes_ = 0;
+};
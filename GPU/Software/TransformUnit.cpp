@@ -23,6 +23,7 @@
 #include "Common/Math/math_util.h"
 #include "Common/MemoryUtil.h"
 #include "Common/Profiler/Profiler.h"
+#include "Common/Thread/ParallelLoop.h"
 #include "Core/Config.h"
 #include "GPU/GPUState.h"
 #include "GPU/Common/DrawEngineCommon.h"
@@ -40,6 +41,10 @@
 
 #define TRANSFORM_BUF_SIZE (65536 * 48)
 
+// Draws at least this large are transformed and clipped on multiple threads.
+static constexpr int PARALLEL_MIN_VERTS = 1536;
+static constexpr int PARALLEL_TRIS_PER_CHUNK = 128;
+
 TransformUnit::TransformUnit() {
 	decoded_ = (u8 *)AllocateMemoryPages(TRANSFORM_BUF_SIZE, MEM_PROT_READ | MEM_PROT_WRITE);
 	binner_ = new BinManager();
@@ -335,28 +340,36 @@ void ComputeTransformState(TransformState *state, const VertexReader &vreader) {
 		state->roundToScreen = &ClipToScreenInternal<false, false>;
 }
 
-ClipVertexData TransformUnit::ReadVertex(const VertexReader &vreader, const TransformState &state) {
-	PROFILE_THIS_SCOPE("read_vert");
-	// If we ever thread this, we'll have to change this.
-	ClipVertexData vertex;
+// Verts without UVs or normals use the last ones read, even from a previous draw.
+// Within a draw, these are either always read or always used, so threads only read them.
+static Vec3Packedf lastTC;
+static Vec3f lastnormal;
 
-	ModelCoords pos;
+// Must be called on the GPU thread, after reading the last vert of a batch.
+static void RememberLastAttribs(const VertexReader &vreader, const TransformState &state) {
+	if (state.readUV) {
+		vreader.ReadUV(lastTC.AsArray());
+		lastTC.q() = 0.0f;
+	}
+	if (vreader.hasNormal())
+		vreader.ReadNrm(lastnormal.AsArray());
+}
+
+static inline void ReadVertexAttribs(const VertexReader &vreader, const TransformState &state, ClipVertexData &vertex, ModelCoords &pos, Vec3f &normal) {
 	// VertexDecoder normally scales z, but we want it unscaled.
 	vreader.ReadPosThroughZ16(pos.AsArray());
 
-	static Vec3Packedf lastTC;
 	if (state.readUV) {
 		vreader.ReadUV(vertex.v.texturecoords.AsArray());
 		vertex.v.texturecoords.q() = 0.0f;
-		lastTC = vertex.v.texturecoords;
 	} else {
 		vertex.v.texturecoords = lastTC;
 	}
 
-	static Vec3f lastnormal;
 	if (vreader.hasNormal())
-		vreader.ReadNrm(lastnormal.AsArray());
-	Vec3f normal = lastnormal;
+		vreader.ReadNrm(normal.AsArray());
+	else
+		normal = lastnormal;
 	if (state.negateNormals)
 		normal = -normal;
 
@@ -367,6 +380,76 @@ ClipVertexData TransformUnit::ReadVertex(const VertexReader &vreader, const Tran
 	}
 
 	vertex.v.color1 = 0;
+}
+
+// Everything after the position transform, which is done either one at a time or in batches.
+static inline void FinishVertex(ClipVertexData &vertex, const ModelCoords &pos, const WorldCoords &worldpos, const Vec3f &normal, const Vec3f &screenScaled, float fogdepth, const TransformState &state) {
+	bool outside_range_flag = false;
+	vertex.v.screenpos = state.roundToScreen(screenScaled, vertex.clippos, &outside_range_flag);
+	if (outside_range_flag) {
+		// We use this, essentially, as the flag.
+		vertex.v.screenpos.x = 0x7FFFFFFF;
+		return;
+	}
+
+	vertex.v.fogdepth = fogdepth;
+	vertex.v.clipw = vertex.clippos.w;
+
+	Vec3<float> worldnormal;
+	if (state.enableLighting || state.uvGenMode == GE_TEXMAP_ENVIRONMENT_MAP) {
+		worldnormal = TransformUnit::ModelToWorldNormal(normal);
+		worldnormal.NormalizeOr001();
+	}
+
+	// Time to generate some texture coords.  Lighting will handle shade mapping.
+	if (state.uvGenMode == GE_TEXMAP_TEXTURE_MATRIX) {
+		Vec3f source;
+		switch (gstate.getUVProjMode()) {
+		case GE_PROJMAP_POSITION:
+			source = pos;
+			break;
+
+		case GE_PROJMAP_UV:
+			source = Vec3f(vertex.v.texturecoords.uv(), 0.0f);
+			break;
+
+		case GE_PROJMAP_NORMALIZED_NORMAL:
+			// This does not use 0, 0, 1 if length is zero.
+			source = normal.Normalized(cpu_info.bSSE4_1);
+			break;
+
+		case GE_PROJMAP_NORMAL:
+			source = normal;
+			break;
+		}
+
+		// Note that UV scale/offset are not used in this mode.
+		Vec3<float> stq = Vec3ByMatrix43(source, gstate.tgenMatrix);
+		vertex.v.texturecoords = Vec3Packedf(stq.x, stq.y, stq.z);
+	} else if (state.uvGenMode == GE_TEXMAP_ENVIRONMENT_MAP) {
+		Lighting::GenerateLightST(vertex.v, worldnormal);
+	}
+
+	PROFILE_THIS_SCOPE("light");
+	if (state.enableLighting)
+		Lighting::Process(vertex.v, worldpos, worldnormal, state.lightingState);
+}
+
+static inline void ReadThroughVertex(ClipVertexData &vertex, const ModelCoords &pos) {
+	vertex.v.screenpos.x = (int)(pos[0] * SCREEN_SCALE_FACTOR);
+	vertex.v.screenpos.y = (int)(pos[1] * SCREEN_SCALE_FACTOR);
+	vertex.v.screenpos.z = pos[2];
+	vertex.v.clipw = 1.0f;
+	vertex.v.fogdepth = 1.0f;
+}
+
+// Safe to call from any thread, doesn't update the last attribs.
+static ClipVertexData ReadSingleVertex(const VertexReader &vreader, const TransformState &state) {
+	ClipVertexData vertex;
+
+	ModelCoords pos;
+	Vec3f normal;
+	ReadVertexAttribs(vreader, state, vertex, pos, normal);
 
 	if (state.enableTransform) {
 		WorldCoords worldpos;
@@ -390,68 +473,157 @@ ClipVertexData TransformUnit::ReadVertex(const VertexReader &vreader, const Tran
 #else
 		screenScaled = vertex.clippos.xyz() * state.screenScale / vertex.clippos.w + state.screenAdd;
 #endif
-		bool outside_range_flag = false;
-		vertex.v.screenpos = state.roundToScreen(screenScaled, vertex.clippos, &outside_range_flag);
-		if (outside_range_flag) {
-			// We use this, essentially, as the flag.
-			vertex.v.screenpos.x = 0x7FFFFFFF;
-			return vertex;
-		}
+		float fogdepth = state.enableFog ? Dot(state.posToFog, Vec4f(pos, 1.0f)) : 1.0f;
+		FinishVertex(vertex, pos, worldpos, normal, screenScaled, fogdepth, state);
+	} else {
+		ReadThroughVertex(vertex, pos);
+	}
 
-		if (state.enableFog) {
-			vertex.v.fogdepth = Dot(state.posToFog, Vec4f(pos, 1.0f));
-		} else {
-			vertex.v.fogdepth = 1.0f;
-		}
-		vertex.v.clipw = vertex.clippos.w;
+	return vertex;
+}
 
-		Vec3<float> worldnormal;
-		if (state.enableLighting || state.uvGenMode == GE_TEXMAP_ENVIRONMENT_MAP) {
-			worldnormal = TransformUnit::ModelToWorldNormal(normal);
-			worldnormal.NormalizeOr001();
-		}
+ClipVertexData TransformUnit::ReadVertex(const VertexReader &vreader, const TransformState &state) {
+	PROFILE_THIS_SCOPE("read_vert");
+	ClipVertexData vertex = ReadSingleVertex(vreader, state);
+	RememberLastAttribs(vreader, state);
+	return vertex;
+}
 
-		// Time to generate some texture coords.  Lighting will handle shade mapping.
-		if (state.uvGenMode == GE_TEXMAP_TEXTURE_MATRIX) {
-			Vec3f source;
-			switch (gstate.getUVProjMode()) {
-			case GE_PROJMAP_POSITION:
-				source = pos;
-				break;
+// Transforms four positions at once, one per lane.  Operations are in the same order as the
+// single vertex path, so results match exactly.
+static void TransformPositions4(const ModelCoords pos[4], const TransformState &state, Vec4f clippos[4], WorldCoords worldpos[4], Vec3f screenScaled[4], float fogdepth[4]) {
+	const bool toWorld = MatrixMode(state.matrixMode) == MatrixMode::WORLD_TO_CLIP;
+	const float *w = gstate.worldMatrix;
+	const float *m = state.matrix;
 
-			case GE_PROJMAP_UV:
-				source = Vec3f(vertex.v.texturecoords.uv(), 0.0f);
-				break;
+#ifdef _M_SSE
+	__m128 x = pos[0].vec, y = pos[1].vec, z = pos[2].vec, unused = pos[3].vec;
+	_MM_TRANSPOSE4_PS(x, y, z, unused);
 
-			case GE_PROJMAP_NORMALIZED_NORMAL:
-				// This does not use 0, 0, 1 if length is zero.
-				source = normal.Normalized(cpu_info.bSSE4_1);
-				break;
+	auto madd3 = [](__m128 vx, __m128 vy, __m128 vz, float a, float b, float c, float d) {
+		return _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a), vx), _mm_mul_ps(_mm_set1_ps(b), vy)),
+			_mm_add_ps(_mm_mul_ps(_mm_set1_ps(c), vz), _mm_set1_ps(d)));
+	};
 
-			case GE_PROJMAP_NORMAL:
-				source = normal;
-				break;
-			}
+	if (state.enableFog) {
+		const Vec4f &f = state.posToFog;
+		__m128 fog = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(f.x), x), _mm_mul_ps(_mm_set1_ps(f.y), y));
+		fog = _mm_add_ps(fog, _mm_mul_ps(_mm_set1_ps(f.z), z));
+		_mm_storeu_ps(fogdepth, _mm_add_ps(fog, _mm_set1_ps(f.w)));
+	} else {
+		_mm_storeu_ps(fogdepth, _mm_set1_ps(1.0f));
+	}
+
+	if (toWorld) {
+		__m128 wx = madd3(x, y, z, w[0], w[3], w[6], w[9]);
+		__m128 wy = madd3(x, y, z, w[1], w[4], w[7], w[10]);
+		__m128 wz = madd3(x, y, z, w[2], w[5], w[8], w[11]);
+		x = wx;
+		y = wy;
+		z = wz;
+		__m128 tx = x, ty = y, tz = z, tw = _mm_setzero_ps();
+		_MM_TRANSPOSE4_PS(tx, ty, tz, tw);
+		worldpos[0].vec = tx;
+		worldpos[1].vec = ty;
+		worldpos[2].vec = tz;
+		worldpos[3].vec = tw;
+	}
+
+	__m128 cx = madd3(x, y, z, m[0], m[4], m[8], m[12]);
+	__m128 cy = madd3(x, y, z, m[1], m[5], m[9], m[13]);
+	__m128 cz = madd3(x, y, z, m[2], m[6], m[10], m[14]);
+	__m128 cw = madd3(x, y, z, m[3], m[7], m[11], m[15]);
+
+	__m128 sx = _mm_add_ps(_mm_div_ps(_mm_mul_ps(cx, _mm_set1_ps(state.screenScale.x)), cw), _mm_set1_ps(state.screenAdd.x));
+	__m128 sy = _mm_add_ps(_mm_div_ps(_mm_mul_ps(cy, _mm_set1_ps(state.screenScale.y)), cw), _mm_set1_ps(state.screenAdd.y));
+	__m128 sz = _mm_add_ps(_mm_div_ps(_mm_mul_ps(cz, _mm_set1_ps(state.screenScale.z)), cw), _mm_set1_ps(state.screenAdd.z));
+
+	_MM_TRANSPOSE4_PS(cx, cy, cz, cw);
+	clippos[0].vec = cx;
+	clippos[1].vec = cy;
+	clippos[2].vec = cz;
+	clippos[3].vec = cw;
+
+	__m128 sw = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS(sx, sy, sz, sw);
+	screenScaled[0].vec = sx;
+	screenScaled[1].vec = sy;
+	screenScaled[2].vec = sz;
+	screenScaled[3].vec = sw;
+#else
+	// Written lane by lane so the compiler can vectorize it.
+	float x[4], y[4], z[4];
+	for (int i = 0; i < 4; ++i) {
+		x[i] = pos[i].x;
+		y[i] = pos[i].y;
+		z[i] = pos[i].z;
+	}
 
-			// Note that UV scale/offset are not used in this mode.
-			Vec3<float> stq = Vec3ByMatrix43(source, gstate.tgenMatrix);
-			vertex.v.texturecoords = Vec3Packedf(stq.x, stq.y, stq.z);
-		} else if (state.uvGenMode == GE_TEXMAP_ENVIRONMENT_MAP) {
-			Lighting::GenerateLightST(vertex.v, worldnormal);
+	const Vec4f &f = state.posToFog;
+	for (int i = 0; i < 4; ++i)
+		fogdepth[i] = state.enableFog ? f.x * x[i] + f.y * y[i] + f.z * z[i] + f.w : 1.0f;
+
+	if (toWorld) {
+		for (int i = 0; i < 4; ++i) {
+			float wx = (x[i] * w[0] + y[i] * w[3]) + (z[i] * w[6] + w[9]);
+			float wy = (x[i] * w[1] + y[i] * w[4]) + (z[i] * w[7] + w[10]);
+			float wz = (x[i] * w[2] + y[i] * w[5]) + (z[i] * w[8] + w[11]);
+			x[i] = wx;
+			y[i] = wy;
+			z[i] = wz;
+			worldpos[i] = WorldCoords(wx, wy, wz);
 		}
+	}
 
-		PROFILE_THIS_SCOPE("light");
-		if (state.enableLighting)
-			Lighting::Process(vertex.v, worldpos, worldnormal, state.lightingState);
-	} else {
-		vertex.v.screenpos.x = (int)(pos[0] * SCREEN_SCALE_FACTOR);
-		vertex.v.screenpos.y = (int)(pos[1] * SCREEN_SCALE_FACTOR);
-		vertex.v.screenpos.z = pos[2];
-		vertex.v.clipw = 1.0f;
-		vertex.v.fogdepth = 1.0f;
+	for (int i = 0; i < 4; ++i) {
+		float cx = (x[i] * m[0] + y[i] * m[4]) + (z[i] * m[8] + m[12]);
+		float cy = (x[i] * m[1] + y[i] * m[5]) + (z[i] * m[9] + m[13]);
+		float cz = (x[i] * m[2] + y[i] * m[6]) + (z[i] * m[10] + m[14]);
+		float cw = (x[i] * m[3] + y[i] * m[7]) + (z[i] * m[11] + m[15]);
+		clippos[i] = Vec4f(cx, cy, cz, cw);
+		screenScaled[i] = Vec3f(cx * state.screenScale.x / cw + state.screenAdd.x, cy * state.screenScale.y / cw + state.screenAdd.y, cz * state.screenScale.z / cw + state.screenAdd.z);
 	}
+#endif
+}
 
-	return vertex;
+// Safe to call from any thread on separate ranges, with separate readers.
+static void ReadVertexBatch(VertexReader &vreader, const TransformState &state, int first, int count, ClipVertexData *verts) {
+	PROFILE_THIS_SCOPE("read_vert_batch");
+	if (!state.enableTransform) {
+		for (int i = 0; i < count; ++i) {
+			vreader.Goto(first + i);
+			verts[i] = ReadSingleVertex(vreader, state);
+		}
+		return;
+	}
+
+	ModelCoords pos[4];
+	Vec3f normal[4];
+	Vec4f clippos[4];
+	WorldCoords worldpos[4];
+	Vec3f screenScaled[4];
+	float fogdepth[4];
+
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		for (int j = 0; j < 4; ++j) {
+			vreader.Goto(first + i + j);
+			ReadVertexAttribs(vreader, state, verts[i + j], pos[j], normal[j]);
+		}
+
+		TransformPositions4(pos, state, clippos, worldpos, screenScaled, fogdepth);
+
+		for (int j = 0; j < 4; ++j) {
+			verts[i + j].clippos = clippos[j];
+			FinishVertex(verts[i + j], pos[j], worldpos[j], normal[j], screenScaled[j], fogdepth[j], state);
+		}
+	}
+
+	for (; i < count; ++i) {
+		vreader.Goto(first + i);
+		verts[i] = ReadSingleVertex(vreader, state);
+	}
 }
 
 void TransformUnit::SetDirty(SoftDirty flags) {
@@ -477,26 +649,51 @@ class SoftwareVertexReader {
 		// If we're only using a subset of verts, it's better to decode with random access (usually.)
 		// However, if we're reusing a lot of verts, we should read and cache them.
 		useCache_ = useIndices_ && vertex_count > (upperBound_ - lowerBound_ + 1);
-		if (useCache_ && cached_.size() < upperBound_ - lowerBound_ + 1)
-			cached_.resize(std::max(128, upperBound_ - lowerBound_ + 1));
 	}
 
 	const VertexReader &GetVertexReader() const {
 		return vreader_;
 	}
 
+	// Below this, it's not worth the copy through cached_.
+	static constexpr int BATCH_MIN_VERTS = 16;
+
 	bool IsThrough() const {
 		return vreader_.isThrough();
 	}
 
 	void UpdateCache() {
+		// Larger draws without indices read each vert once, in order, so transform them in batches up front.
+		// This is only known once the transform state is updated.
+		if (!useIndices_ && upperBound_ + 1 >= BATCH_MIN_VERTS && transformState_.enableTransform)
+			useCache_ = true;
 		if (!useCache_)
 			return;
 
-		for (int i = 0; i < upperBound_ - lowerBound_ + 1; ++i) {
-			vreader_.Goto(i);
-			cached_[i] = transform_.ReadVertex(vreader_, transformState_);
+		const int count = upperBound_ - lowerBound_ + 1;
+		if (cached_.size() < count)
+			cached_.resize(std::max(128, count));
+		if (count >= PARALLEL_MIN_VERTS && g_threadManager.GetNumLooperThreads() > 1) {
+			ParallelRangeLoop(&g_threadManager, [&](int l, int h) {
+				// Each thread needs its own reader, since it seeks.
+				VertexReader vreader = vreader_;
+				ReadVertexBatch(vreader, transformState_, l, h - l, cached_.data() + l);
+			}, 0, count, PARALLEL_MIN_VERTS / 4);
+		} else {
+			ReadVertexBatch(vreader_, transformState_, 0, count, cached_.data());
 		}
+
+		vreader_.Goto(count - 1);
+		RememberLastAttribs(vreader_, transformState_);
+	}
+
+	bool IsCached() const {
+		return useCache_;
+	}
+
+	// Only valid if IsCached(), but then safe from any thread.
+	inline const ClipVertexData &ReadCached(int vtx) const {
+		return cached_[(useIndices_ ? conv_(vtx) : vtx) - lowerBound_];
 	}
 
 	inline ClipVertexData Read(int vtx) {
@@ -505,6 +702,8 @@ class SoftwareVertexReader {
 				return cached_[conv_(vtx) - lowerBound_];
 			}
 			vreader_.Goto(conv_(vtx) - lowerBound_);
+		} else if (useCache_) {
+			return cached_[vtx];
 		} else {
 			vreader_.Goto(vtx);
 		}
@@ -527,6 +726,21 @@ class SoftwareVertexReader {
 // Static to reduce allocations mid-frame.
 std::vector<ClipVertexData> SoftwareVertexReader::cached_;
 
+// Static to avoid recomputing when state hasn't changed.
+static TransformState transformState;
+
+void TransformUnit::ReadVertices(VertexReader &vreader, int first, int count, ClipVertexData *verts) {
+	if (binner_->HasDirty(SoftDirty::LIGHT_ALL | SoftDirty::TRANSFORM_ALL)) {
+		ComputeTransformState(&transformState, vreader);
+		binner_->ClearDirty(SoftDirty::LIGHT_ALL | SoftDirty::TRANSFORM_ALL);
+	}
+	ReadVertexBatch(vreader, transformState, first, count, verts);
+	if (count > 0) {
+		vreader.Goto(first + count - 1);
+		RememberLastAttribs(vreader, transformState);
+	}
+}
+
 void TransformUnit::SubmitPrimitive(const void* vertices, const void* indices, GEPrimitiveType prim_type, int vertex_count, u32 vertex_type, int *bytesRead, SoftwareDrawEngine *drawEngine)
 {
 	VertexDecoder &vdecoder = *drawEngine->FindVertexDecoder(vertex_type);
@@ -543,7 +757,6 @@ void TransformUnit::SubmitPrimitive(const void* vertices, const void* indices, G
 	if ((vertex_type & GE_VTYPE_POS_MASK) == 0)
 		return;
 
-	static TransformState transformState;
 	SoftwareVertexReader vreader(decoded_, vdecoder, vertex_type, vertex_count, vertices, indices, transformState, *this);
 
 	if (prim_type != GE_PRIM_KEEP_PREVIOUS) {
@@ -634,7 +847,12 @@ void TransformUnit::SubmitPrimitive(const void* vertices, const void* indices, G
 		break;
 
 	case GE_PRIM_TRIANGLES:
-		for (int vtx = 0; vtx < vertex_count; ++vtx) {
+	{
+		int vtx = 0;
+		if (data_index_ == 0 && vertex_count >= PARALLEL_MIN_VERTS && vreader.IsCached() && !vreader.IsThrough() && g_threadManager.GetNumLooperThreads() > 1)
+			vtx = SendTrianglesParallel(vreader, cullType, vertex_count);
+
+		for (; vtx < vertex_count; ++vtx) {
 			data_[data_index_++] = vreader.Read(vtx);
 			if (data_index_ < 3) {
 				// Keep reading.  Note: an incomplete prim will stay read for GE_PRIM_KEEP_PREVIOUS.
@@ -651,6 +869,7 @@ void TransformUnit::SubmitPrimitive(const void* vertices, const void* indices, G
 			data_index_ = 0;
 		}
 		break;
+	}
 
 	case GE_PRIM_RECTANGLES:
 		for (int vtx = 0; vtx < vertex_count; ++vtx) {
@@ -859,17 +1078,52 @@ void TransformUnit::SubmitImmVertex(const ClipVertexData &vert, SoftwareDrawEngi
 	isImmDraw_ = false;
 }
 
-void TransformUnit::SendTriangle(CullType cullType, const ClipVertexData *verts, int provoking) {
+template <typename T>
+static inline void SendTriangleTo(CullType cullType, const ClipVertexData *verts, int provoking, T &binner) {
 	if (cullType == CullType::OFF) {
-		Clipper::ProcessTriangle(verts[0], verts[1], verts[2], verts[provoking], *binner_);
-		Clipper::ProcessTriangle(verts[2], verts[1], verts[0], verts[provoking], *binner_);
+		Clipper::ProcessTriangle(verts[0], verts[1], verts[2], verts[provoking], binner);
+		Clipper::ProcessTriangle(verts[2], verts[1], verts[0], verts[provoking], binner);
 	} else if (cullType == CullType::CW) {
-		Clipper::ProcessTriangle(verts[2], verts[1], verts[0], verts[provoking], *binner_);
+		Clipper::ProcessTriangle(verts[2], verts[1], verts[0], verts[provoking], binner);
 	} else {
-		Clipper::ProcessTriangle(verts[0], verts[1], verts[2], verts[provoking], *binner_);
+		Clipper::ProcessTriangle(verts[0], verts[1], verts[2], verts[provoking], binner);
 	}
 }
 
+void TransformUnit::SendTriangle(CullType cullType, const ClipVertexData *verts, int provoking) {
+	SendTriangleTo(cullType, verts, provoking, *binner_);
+}
+
+// Static to reduce allocations mid-frame.
+static std::vector<Clipper::ClippedTriangles> clippedChunks;
+
+int TransformUnit::SendTrianglesParallel(SoftwareVertexReader &vreader, CullType cullType, int vertex_count) {
+	PROFILE_THIS_SCOPE("tri_parallel");
+	const int numTris = vertex_count / 3;
+	const int numChunks = (numTris + PARALLEL_TRIS_PER_CHUNK - 1) / PARALLEL_TRIS_PER_CHUNK;
+	if ((int)clippedChunks.size() < numChunks)
+		clippedChunks.resize(numChunks);
+
+	// Clipping and culling only depend on the verts, so chunks can run in any order.
+	ParallelRangeLoop(&g_threadManager, [&](int l, int h) {
+		for (int c = l; c < h; ++c) {
+			Clipper::ClippedTriangles &out = clippedChunks[c];
+			out.Reset();
+
+			const int end = std::min(numTris, (c + 1) * PARALLEL_TRIS_PER_CHUNK);
+			for (int t = c * PARALLEL_TRIS_PER_CHUNK; t < end; ++t) {
+				const ClipVertexData verts[3] = { vreader.ReadCached(t * 3 + 0), vreader.ReadCached(t * 3 + 1), vreader.ReadCached(t * 3 + 2) };
+				SendTriangleTo(cullType, verts, 2, out);
+			}
+		}
+	}, 0, numChunks, 1);
+
+	// Binning, however, must stay in the original order.
+	for (int c = 0; c < numChunks; ++c)
+		clippedChunks[c].Send(*binner_);
+	return numTris * 3;
+}
+
 void TransformUnit::Flush(const char *reason) {
 	if (!hasDraws_)
 		return;
@@ -884,6 +1138,10 @@ void TransformUnit::GetStats(char *buffer, size_t bufsize) {
 	binner_->GetStats(buffer, bufsize);
 }
 
+void TransformUnit::GetFrameCounters(GPUFrameCounters &counters) {
+	binner_->GetFrameCounters(counters);
+}
+
 void TransformUnit::FlushIfOverlap(const char *reason, bool modifying, uint32_t addr, uint32_t stride, uint32_t w, uint32_t h) {
 	if (!hasDraws_)
 		return;
@@ -894,6 +1152,12 @@ void TransformUnit::FlushIfOverlap(const char *reason, bool modifying, uint32_t
 		Flush(reason);
 }
 
+void TransformUnit::NotifyMemoryWrite(uint32_t addr, uint32_t size) {
+	// Draws already binned were culled against the old values, which is fine: they were submitted first.
+	binner_->InvalidateDepthBounds(addr, size);
+	binner_->InvalidateTextures(addr, size);
+}
+
 void TransformUnit::NotifyClutUpdate(const void *src) {
 	binner_->UpdateClut(src);
 }
@@ -136,14 +136,18 @@ class TransformUnit {
 
 	void SubmitPrimitive(const void* vertices, const void* indices, GEPrimitiveType prim_type, int vertex_count, u32 vertex_type, int *bytesRead, SoftwareDrawEngine *drawEngine);
 	void SubmitImmVertex(const ClipVertexData &vert, SoftwareDrawEngine *drawEngine);
+	// Transforms already decoded verts [first, first + count) using the current state, four at a time when possible.
+	void ReadVertices(VertexReader &vreader, int first, int count, ClipVertexData *verts);
 
 	bool GetCurrentSimpleVertices(int count, std::vector<GPUDebugVertex> &vertices, std::vector<u16> &indices);
 
 	void Flush(const char *reason);
 	void FlushIfOverlap(const char *reason, bool modifying, uint32_t addr, uint32_t stride, uint32_t w, uint32_t h);
+	void NotifyMemoryWrite(uint32_t addr, uint32_t size);
 	void NotifyClutUpdate(const void *src);
 
 	void GetStats(char *buffer, size_t bufsize);
+	void GetFrameCounters(GPUFrameCounters &counters);
 
 	void SetDirty(SoftDirty flags);
 	SoftDirty GetDirty();
@@ -151,6 +155,8 @@ class TransformUnit {
 private:
 	ClipVertexData ReadVertex(const VertexReader &vreader, const TransformState &state);
 	void SendTriangle(CullType cullType, const ClipVertexData *verts, int provoking = 2);
+	// Clips and culls whole triangles across threads, returns the number of verts consumed.
+	int SendTrianglesParallel(SoftwareVertexReader &vreader, CullType cullType, int vertex_count);
 
 	u8 *decoded_ = nullptr;
 	BinManager *binner_ = nullptr;
@@ -388,6 +388,8 @@ static const JitDisableFlag jitDisableFlags[] = {
 	{ MIPSComp::JitDisable::CACHE_POINTERS, "Cached pointers" },
 	{ MIPSComp::JitDisable::REGALLOC_GPR, "GPR Regalloc across instructions" },
 	{ MIPSComp::JitDisable::REGALLOC_FPR, "FPR Regalloc across instructions" },
+	{ MIPSComp::JitDisable::IR_PREDECODE, "IR pre-decoding" },
+	{ MIPSComp::JitDisable::IR_NATIVE_THREAD, "IR native code on thread" },
 };
 
 void JitDebugScreen::CreateViews() {
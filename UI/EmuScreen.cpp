@@ -1157,6 +1157,7 @@ static const char *CPUCoreAsString(int core) {
 	case 0: return "Interpreter";
 	case 1: return "JIT";
 	case 2: return "IR Interpreter";
+	case 3: return "JIT using IR";
 	default: return "N/A";
 	}
 }
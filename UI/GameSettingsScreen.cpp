@@ -18,6 +18,7 @@
 #include "ppsspp_config.h"
 
 #include <algorithm>
+#include <atomic>
 #include <set>
 
 #include "Common/Net/Resolve.h"
@@ -56,6 +57,7 @@
 
 #include "Common/File/FileUtil.h"
 #include "Common/OSVersion.h"
+#include "Common/Thread/ThreadManager.h"
 #include "Common/TimeUtil.h"
 #include "Common/StringUtils.h"
 #include "Core/Config.h"
@@ -1697,6 +1699,37 @@ UI::EventReturn GameSettingsScreen::OnClearSearchFilter(UI::EventParams &e) {
 	return UI::EVENT_DONE;
 }
 
+class TexturePackTask : public Task {
+public:
+	TexturePackTask(const std::string &gameID, const std::string &created, const std::string &failed)
+		: gameID_(gameID), created_(created), failed_(failed) {}
+
+	TaskType Type() const override {
+		return TaskType::IO_BLOCKING;
+	}
+
+	void Run() override {
+		Path generatedFilename;
+		if (TextureReplacer::GeneratePack(gameID_, generatedFilename)) {
+			// Reloads the replacer, which then swaps in the new pack once textures are cleared.
+			NativeMessageReceived("gpu_configChanged", "");
+			host->NotifyUserMessage(generatedFilename.ToVisualString() + ": " + created_, 6.0f);
+		} else {
+			host->NotifyUserMessage(failed_, 6.0f, 0xFF3030FF);
+		}
+		running = false;
+	}
+
+	static std::atomic<bool> running;
+
+private:
+	std::string gameID_;
+	std::string created_;
+	std::string failed_;
+};
+
+std::atomic<bool> TexturePackTask::running;
+
 void DeveloperToolsScreen::CreateViews() {
 	using namespace UI;
 	root_ = new LinearLayout(ORIENT_VERTICAL, new LayoutParams(FILL_PARENT, FILL_PARENT));
@@ -1721,12 +1754,17 @@ void DeveloperToolsScreen::CreateViews() {
 	// iOS can now use JIT on all modes, apparently.
 	// The bool may come in handy for future non-jit platforms though (UWP XB1?)
 
-	static const char *cpuCores[] = {"Interpreter", "Dynarec (JIT)", "IR Interpreter"};
+	static const char *cpuCores[] = {"Interpreter", "Dynarec (JIT)", "IR Interpreter", "JIT using IR"};
 	PopupMultiChoice *core = list->Add(new PopupMultiChoice(&g_Config.iCpuCore, gr->T("CPU Core"), cpuCores, 0, ARRAY_SIZE(cpuCores), sy->GetName(), screenManager()));
 	core->OnChoice.Handle(this, &DeveloperToolsScreen::OnJitAffectingSetting);
 	if (!canUseJit) {
 		core->HideChoice(1);
+		core->HideChoice(3);
 	}
+#if !PPSSPP_ARCH(AMD64)
+	// The IR only has a native backend on x86-64.
+	core->HideChoice(3);
+#endif
 
 	list->Add(new Choice(dev->T("JIT debug tools")))->OnClick.Handle(this, &DeveloperToolsScreen::OnJitDebugTools);
 	list->Add(new CheckBox(&g_Config.bShowDeveloperMenu, dev->T("Show Developer Menu")));
@@ -1779,6 +1817,12 @@ void DeveloperToolsScreen::CreateViews() {
 		return true;
 	});
 
+	Choice *createTexturePack = list->Add(new Choice(dev->T("Create texture pack for current game")));
+	createTexturePack->OnClick.Handle(this, &DeveloperToolsScreen::OnCreateTexturePack);
+	createTexturePack->SetEnabledFunc([] {
+		return PSP_IsInited() && !TexturePackTask::running;
+	});
+
 	Draw::DrawContext *draw = screenManager()->getDrawContext();
 
 	// Experimental, will move to main graphics settings later.
@@ -1894,6 +1938,16 @@ UI::EventReturn DeveloperToolsScreen::OnOpenTexturesIniFile(UI::EventParams &e)
 	return UI::EVENT_DONE;
 }
 
+UI::EventReturn DeveloperToolsScreen::OnCreateTexturePack(UI::EventParams &e) {
+	if (TexturePackTask::running.exchange(true))
+		return UI::EVENT_DONE;
+
+	// Decoding every image takes a while, so don't block the UI.
+	auto dev = GetI18NCategory("Developer");
+	g_threadManager.EnqueueTask(new TexturePackTask(g_paramSFO.GetDiscID(), dev->T("Texture pack created"), dev->T("Texture pack creation failed")));
+	return UI::EVENT_DONE;
+}
+
 UI::EventReturn DeveloperToolsScreen::OnLogConfig(UI::EventParams &e) {
 	screenManager()->push(new LogConfigScreen());
 	return UI::EVENT_DONE;
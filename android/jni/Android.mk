@@ -238,6 +238,7 @@ ARCH_FILES := \
   $(SRC)/Core/MIPS/x86/CompLoadStore.cpp \
   $(SRC)/Core/MIPS/x86/CompVFPU.cpp \
   $(SRC)/Core/MIPS/x86/CompReplace.cpp \
+  $(SRC)/Core/MIPS/x86/IRToX86.cpp \
   $(SRC)/Core/MIPS/x86/Asm.cpp \
   $(SRC)/Core/MIPS/x86/Jit.cpp \
   $(SRC)/Core/MIPS/x86/JitSafeMem.cpp \
@@ -355,6 +356,7 @@ EXEC_AND_LIB_FILES := \
   $(SRC)/GPU/Common/VertexDecoderCommon.cpp.arm \
   $(SRC)/GPU/Common/TextureCacheCommon.cpp.arm \
   $(SRC)/GPU/Common/TextureScalerCommon.cpp.arm \
+  $(SRC)/GPU/Common/ScaledTextureCache.cpp \
   $(SRC)/GPU/Common/ShaderCommon.cpp \
   $(SRC)/GPU/Common/StencilCommon.cpp \
   $(SRC)/GPU/Common/SplineCommon.cpp.arm \
@@ -389,6 +391,7 @@ EXEC_AND_LIB_FILES := \
   $(SRC)/GPU/Software/RasterizerRegCache.cpp \
   $(SRC)/GPU/Software/Sampler.cpp \
   $(SRC)/GPU/Software/SoftGpu.cpp \
+  $(SRC)/GPU/Software/TextureDecodeCache.cpp \
   $(SRC)/GPU/Software/TransformUnit.cpp \
   $(SRC)/Core/ELF/ElfReader.cpp \
   $(SRC)/Core/ELF/PBPReader.cpp \
@@ -429,6 +432,7 @@ EXEC_AND_LIB_FILES := \
   $(SRC)/Core/MemMapFunctions.cpp \
   $(SRC)/Core/Reporting.cpp \
   $(SRC)/Core/Replay.cpp \
+  $(SRC)/Core/ReplacementPack.cpp \
   $(SRC)/Core/SaveState.cpp \
   $(SRC)/Core/Screenshot.cpp \
   $(SRC)/Core/System.cpp \
@@ -782,8 +786,11 @@ ifeq ($(UNITTEST),1)
   LOCAL_SRC_FILES := \
     $(SRC)/unittest/JitHarness.cpp \
     $(SRC)/unittest/TestIRPassSimplify.cpp \
+    $(SRC)/unittest/TestJitBlockCache.cpp \
     $(SRC)/unittest/TestShaderGenerators.cpp \
     $(SRC)/unittest/TestSoftwareGPUJit.cpp \
+    $(SRC)/unittest/TestSoftwareTransform.cpp \
+    $(SRC)/unittest/TestTextureDecoder.cpp \
     $(SRC)/unittest/TestThreadManager.cpp \
     $(SRC)/unittest/TestVertexJit.cpp \
     $(TESTARMEMITTER_FILE) \
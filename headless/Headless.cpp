@@ -36,6 +36,7 @@
 #include "Core/System.h"
 #include "Core/WebServer.h"
 #include "Core/HLE/sceUtility.h"
+#include "Core/MIPS/JitCommon/JitState.h"
 #include "Core/Host.h"
 #include "Core/SaveState.h"
 #include "GPU/Common/FramebufferManagerCommon.h"
@@ -139,6 +140,8 @@ int printUsage(const char *progname, const char *reason)
 	fprintf(stderr, "  -v, --verbose         show the full passed/failed result\n");
 	fprintf(stderr, "  -i                    use the interpreter\n");
 	fprintf(stderr, "  --ir                  use ir interpreter\n");
+	fprintf(stderr, "  --irjit               use ir jit\n");
+	fprintf(stderr, "  --ir-switch           interpret ir without pre-decoding (to compare with --bench)\n");
 	fprintf(stderr, "  -j                    use jit (default)\n");
 	fprintf(stderr, "  -c, --compare         compare with output in file.expected\n");
 	fprintf(stderr, "  --bench               run multiple times and output speed\n");
@@ -285,6 +288,7 @@ int main(int argc, const char* argv[])
 	const char *stateToLoad = 0;
 	GPUCore gpuCore = GPUCORE_SOFTWARE;
 	CPUCore cpuCore = CPUCore::JIT;
+	bool irSwitch = false;
 	int debuggerPort = -1;
 
 	std::vector<std::string> testFilenames;
@@ -314,6 +318,10 @@ int main(int argc, const char* argv[])
 			cpuCore = CPUCore::JIT;
 		else if (!strcmp(argv[i], "--ir"))
 			cpuCore = CPUCore::IR_JIT;
+		else if (!strcmp(argv[i], "--irjit"))
+			cpuCore = CPUCore::JIT_IR;
+		else if (!strcmp(argv[i], "--ir-switch"))
+			irSwitch = true;
 		else if (!strcmp(argv[i], "-c") || !strcmp(argv[i], "--compare"))
 			testOptions.compare = true;
 		else if (!strcmp(argv[i], "--bench"))
@@ -428,6 +436,8 @@ int main(int argc, const char* argv[])
 	g_Config.iAnisotropyLevel = 0;  // When testing mipmapping we really don't want this.
 	g_Config.iMultiSampleLevel = 0;
 	g_Config.bVertexCache = false;
+	g_Config.bIRBlockCache = false;
+	g_Config.bSoftwareRenderingJitCache = false;
 	g_Config.iLanguage = PSP_SYSTEMPARAM_LANGUAGE_ENGLISH;
 	g_Config.iTimeFormat = PSP_SYSTEMPARAM_TIME_FORMAT_24HR;
 	g_Config.bEncryptSave = true;
@@ -453,6 +463,8 @@ int main(int argc, const char* argv[])
 	g_Config.iPSPModel = PSP_MODEL_SLIM;
 	g_Config.iGlobalVolume = VOLUME_FULL;
 	g_Config.iReverbVolume = VOLUME_FULL;
+	if (irSwitch)
+		g_Config.uJitDisableFlags |= (uint32_t)MIPSComp::JitDisable::IR_PREDECODE;
 
 #if PPSSPP_PLATFORM(WINDOWS)
 	g_Config.internalDataDirectory.clear();
@@ -16,12 +16,15 @@
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
 #include <algorithm>
+#include <cstring>
+#include <vector>
 
 #include "ppsspp_config.h"
 
 #include "Common/System/NativeApp.h"
 #include "Common/System/System.h"
 #include "Common/TimeUtil.h"
+#include "Core/Config.h"
 #include "Core/ConfigValues.h"
 #include "Core/Debugger/SymbolMap.h"
 #include "Core/MIPS/JitCommon/JitCommon.h"
@@ -34,6 +37,7 @@
 #include "Core/MemMap.h"
 #include "Core/Core.h"
 #include "Core/CoreTiming.h"
+#include "Core/Host.h"
 #include "Core/HLE/HLE.h"
 
 // Temporary hacks around annoying linking errors.  Copied from Headless.
@@ -205,3 +209,180 @@ bool TestJit() {
 
 	return jit_speed >= interp_speed;
 }
+
+static bool AssembleRepeated(const char *const *lines, size_t count, int reps) {
+	u32 addr = PSP_GetUserMemoryBase();
+	bool success = true;
+	for (int i = 0; i < reps; ++i) {
+		for (size_t j = 0; j < count; ++j) {
+			if (!MIPSAsm::MipsAssembleOpcode(lines[j], currentDebugMIPS, addr)) {
+				printf("ERROR: %s\n", MIPSAsm::GetAssembleError().c_str());
+				success = false;
+			}
+			addr += 4;
+		}
+	}
+
+	Memory::Write_U32(MIPS_MAKE_SYSCALL("UnitTestFakeSyscalls", "UnitTestTerminator"), addr);
+	Memory::Write_U32(MIPS_MAKE_BREAK(1), addr + 4);
+	return success;
+}
+
+// Compares IR loads and stores with a constant address (which skip validation) to ones through a register.
+bool TestIRMemoryAccess() {
+	SetupJitHarness();
+	bool oldFastMemory = g_Config.bFastMemory;
+	g_Config.bFastMemory = false;
+
+	static const char *constLines[] = {
+		"lui r1, 0x0890",
+		"lw r2, 0(r1)",
+		"lw r3, 4(r1)",
+		"sw r2, 8(r1)",
+		"sw r3, 12(r1)",
+		"lw r4, 16(r1)",
+		"sh r4, 20(r1)",
+		"lbu r4, 24(r1)",
+	};
+	// r5 isn't known while compiling, so every access is validated.
+	static const char *regLines[] = {
+		"addu r1, r5, r0",
+		"lw r2, 0(r1)",
+		"lw r3, 4(r1)",
+		"sw r2, 8(r1)",
+		"sw r3, 12(r1)",
+		"lw r4, 16(r1)",
+		"sh r4, 20(r1)",
+		"lbu r4, 24(r1)",
+	};
+	const int reps = 100;
+	const double instCount = (double)(ARRAY_SIZE(constLines) * reps);
+
+	mipsr4k.UpdateCore(CPUCore::IR_JIT);
+	currentMIPS->r[MIPS_REG_A1] = 0x08900000;
+
+	bool success = AssembleRepeated(regLines, ARRAY_SIZE(regLines), reps);
+	mipsr4k.ClearJitCache();
+	double regSpeed = ExecCPUTest();
+
+	success = AssembleRepeated(constLines, ARRAY_SIZE(constLines), reps) && success;
+	mipsr4k.ClearJitCache();
+	double constSpeed = ExecCPUTest();
+
+	if (success) {
+		double regNs = 1000000000.0 / (regSpeed * instCount);
+		double constNs = 1000000000.0 / (constSpeed * instCount);
+		printf("IR memory access: %0.2f ns/inst validated, %0.2f ns/inst constant (%0.2fx)\n", regNs, constNs, regNs / constNs);
+	}
+
+	g_Config.bFastMemory = oldFastMemory;
+	DestroyJitHarness();
+	return success;
+}
+
+static void RunCPUTestOnce() {
+	currentMIPS->pc = PSP_GetUserMemoryBase();
+	coreState = CORE_RUNNING;
+	while (coreState == CORE_RUNNING) {
+		mipsr4k.RunLoopUntil(1000000);
+	}
+}
+
+// Runs some FPU ops with the native IR backend and the IR interpreter, and checks they agree.
+bool TestIRNativeFPU() {
+#if PPSSPP_ARCH(AMD64)
+	SetupJitHarness();
+
+	static const char *lines[] = {
+		"lui r1, 0x7F80",
+		"mtc1 r1, f1",
+		"mtc1 r0, f2",
+		"mtc1 r1, f4",
+		"mtc1 r1, f5",
+		"mtc1 r0, f6",
+		// inf * 0, with dest the same as src1, src2, or neither.
+		"mul.s f1, f1, f2",
+		"mul.s f6, f5, f6",
+		"mul.s f3, f2, f4",
+		// NAN inputs pass through.
+		"mul.s f7, f1, f2",
+		"add.s f8, f4, f4",
+		"sub.s f9, f4, f4",
+	};
+	const int numRegs = 10;
+
+	bool success = AssembleRepeated(lines, ARRAY_SIZE(lines), 1);
+	u32 expected[numRegs]{};
+	u32 native[numRegs]{};
+
+	mipsr4k.UpdateCore(CPUCore::IR_JIT);
+	memset(currentMIPS->f, 0, sizeof(currentMIPS->f));
+	RunCPUTestOnce();
+	memcpy(expected, currentMIPS->f, sizeof(expected));
+
+	mipsr4k.UpdateCore(CPUCore::JIT_IR);
+	memset(currentMIPS->f, 0, sizeof(currentMIPS->f));
+	RunCPUTestOnce();
+	memcpy(native, currentMIPS->f, sizeof(native));
+
+	if (expected[1] != 0x7FC00000) {
+		printf("inf * 0: interpreter %08x, expected 7fc00000\n", expected[1]);
+		success = false;
+	}
+	for (int i = 0; i < numRegs; ++i) {
+		if (expected[i] != native[i]) {
+			printf("f%d: native %08x, interpreter %08x\n", i, native[i], expected[i]);
+			success = false;
+		}
+	}
+
+	DestroyJitHarness();
+	return success;
+#else
+	return true;
+#endif
+}
+
+class JitHarnessHost : public Host {
+public:
+	bool InitGraphics(std::string *error_string, GraphicsContext **ctx) override { return false; }
+	void ShutdownGraphics() override {}
+	void InitSound() override {}
+	void ShutdownSound() override {}
+};
+
+// Jumps through a null register, which must leave the block and report a bad exec address.
+bool TestIRExitToZero() {
+	SetupJitHarness();
+	JitHarnessHost testHost;
+	host = &testHost;
+
+	static const char *lines[] = {
+		"jr r5",
+		"nop",
+	};
+	bool success = AssembleRepeated(lines, ARRAY_SIZE(lines), 1);
+
+	std::vector<CPUCore> cores{ CPUCore::IR_JIT };
+#if PPSSPP_ARCH(AMD64)
+	cores.push_back(CPUCore::JIT_IR);
+#endif
+	for (CPUCore core : cores) {
+		mipsr4k.UpdateCore(core);
+		mipsr4k.ClearJitCache();
+		Core_ResetException();
+		currentMIPS->r[MIPS_REG_A1] = 0;
+		RunCPUTestOnce();
+
+		const ExceptionInfo &info = Core_GetExceptionInfo();
+		if (coreState != CORE_STEPPING || info.type != ExceptionType::BAD_EXEC_ADDR || info.address != 0) {
+			printf("Exit to 0 with core %d: state %d, exception %d at %08x\n", (int)core, (int)coreState, (int)info.type, info.address);
+			success = false;
+		}
+	}
+
+	Core_ResetException();
+	host = nullptr;
+	DestroyJitHarness();
+	return success;
+}
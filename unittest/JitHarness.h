@@ -18,3 +18,6 @@
 #pragma once
 
 bool TestJit();
+bool TestIRMemoryAccess();
+bool TestIRNativeFPU();
+bool TestIRExitToZero();
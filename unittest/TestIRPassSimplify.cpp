@@ -166,6 +166,89 @@ static const IRVerification tests[] = {
 		},
 		{ &PropagateConstants },
 	},
+	{
+		"DropConstantValidation",
+		{
+			{ IROp::SetConst, { MIPS_REG_A0 }, 0, 0, 0x08900000 },
+			{ IROp::ValidateAddress32, { 0 }, MIPS_REG_A0, 0, 0x10 },
+			{ IROp::Load32, { MIPS_REG_V0 }, MIPS_REG_A0, 0, 0x10 },
+			{ IROp::ValidateAddress32, { 0 }, MIPS_REG_A0, 1, 0x12 },
+			{ IROp::Store32, { MIPS_REG_V0 }, MIPS_REG_A0, 0, 0x12 },
+		},
+		{
+			{ IROp::Load32, { MIPS_REG_V0 }, MIPS_REG_ZERO, 0, 0x08900010 },
+			// Misaligned, so this one still needs to throw.
+			{ IROp::ValidateAddress32, { 0 }, MIPS_REG_ZERO, 1, 0x08900012 },
+			{ IROp::Store32, { MIPS_REG_V0 }, MIPS_REG_ZERO, 0, 0x08900012 },
+			{ IROp::SetConst, { MIPS_REG_A0 }, 0, 0, 0x08900000 },
+		},
+		{ &PropagateConstants },
+	},
+	{
+		// Like a prefixed vadd.q, which goes through temps one lane at a time.
+		"VectorizeLanes",
+		{
+			{ IROp::FAdd, { IRVTEMP_0 }, IRVTEMP_PFX_S, 64 },
+			{ IROp::FAdd, { IRVTEMP_0 + 1 }, IRVTEMP_PFX_S + 1, 65 },
+			{ IROp::FAdd, { IRVTEMP_0 + 2 }, IRVTEMP_PFX_S + 2, 66 },
+			{ IROp::FAdd, { IRVTEMP_0 + 3 }, IRVTEMP_PFX_S + 3, 67 },
+			{ IROp::FMov, { 32 }, IRVTEMP_0 },
+			{ IROp::FMov, { 36 }, IRVTEMP_0 + 1 },
+			{ IROp::FMov, { 40 }, IRVTEMP_0 + 2 },
+			{ IROp::FMov, { 44 }, IRVTEMP_0 + 3 },
+		},
+		{
+			{ IROp::Vec4Add, { IRVTEMP_0 }, IRVTEMP_PFX_S, 64 },
+			{ IROp::FMov, { 32 }, IRVTEMP_0 },
+			{ IROp::FMov, { 36 }, IRVTEMP_0 + 1 },
+			{ IROp::FMov, { 40 }, IRVTEMP_0 + 2 },
+			{ IROp::FMov, { 44 }, IRVTEMP_0 + 3 },
+		},
+		{ &VectorizeVFPU },
+	},
+	{
+		"VectorizeSwizzleAndScale",
+		{
+			{ IROp::FMov, { IRVTEMP_PFX_S }, 35 },
+			{ IROp::FMov, { IRVTEMP_PFX_S + 1 }, 34 },
+			{ IROp::FMov, { IRVTEMP_PFX_S + 2 }, 33 },
+			{ IROp::FMov, { IRVTEMP_PFX_S + 3 }, 32 },
+			{ IROp::FMul, { 43 }, 51, 36 },
+			{ IROp::FMul, { 40 }, 48, 36 },
+			{ IROp::FMul, { 41 }, 49, 36 },
+			{ IROp::FMul, { 42 }, 50, 36 },
+		},
+		{
+			{ IROp::Vec4Shuffle, { IRVTEMP_PFX_S }, 32, 0x1B },
+			{ IROp::Vec4Scale, { 40 }, 48, 36 },
+		},
+		{ &VectorizeVFPU },
+	},
+	{
+		// Each lane would read a value already overwritten, so these must stay scalar.
+		"VectorizeOverlap",
+		{
+			{ IROp::FMul, { 40 }, 48, 41 },
+			{ IROp::FMul, { 41 }, 49, 41 },
+			{ IROp::FMul, { 42 }, 50, 41 },
+			{ IROp::FMul, { 43 }, 51, 41 },
+			{ IROp::FMov, { 44 }, 45 },
+			{ IROp::FMov, { 45 }, 44 },
+			{ IROp::FMov, { 46 }, 46 },
+			{ IROp::FMov, { 47 }, 47 },
+		},
+		{
+			{ IROp::FMul, { 40 }, 48, 41 },
+			{ IROp::FMul, { 41 }, 49, 41 },
+			{ IROp::FMul, { 42 }, 50, 41 },
+			{ IROp::FMul, { 43 }, 51, 41 },
+			{ IROp::FMov, { 44 }, 45 },
+			{ IROp::FMov, { 45 }, 44 },
+			{ IROp::FMov, { 46 }, 46 },
+			{ IROp::FMov, { 47 }, 47 },
+		},
+		{ &VectorizeVFPU },
+	},
 };
 
 bool TestIRPassSimplify() {
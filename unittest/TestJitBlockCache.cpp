@@ -0,0 +1,190 @@
+// Copyright (c) 2022- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "Common/TimeUtil.h"
+#include "Core/MIPS/JitCommon/JitBlockCache.h"
+
+#include "UnitTest.h"
+
+// What JitBlockCache used to do: (end, start) -> block number, searched from lower_bound, restarting after each removal.
+class OldBlockMap {
+public:
+	void Add(int block_num, u32 start, u32 end) {
+		map_[std::make_pair(end, start)] = block_num;
+	}
+	void Invalidate(u32 start, u32 end, std::vector<int> &results) {
+	restart:
+		auto next = map_.lower_bound(std::make_pair(start, 0));
+		auto last = map_.upper_bound(std::make_pair(end + 0x4000, 0));
+		for (; next != last; ++next) {
+			if (next->first.second < end && next->first.first > start) {
+				results.push_back(next->second);
+				map_.erase(next);
+				goto restart;
+			}
+		}
+	}
+
+private:
+	std::map<std::pair<u32, u32>, u32> map_;
+};
+
+struct BlockOp {
+	bool invalidate;
+	u32 start;
+	u32 end;
+};
+
+// Simulates a game compiling blocks, with frequent small self-modifying writes and occasional overlay loads.
+static std::vector<BlockOp> GenerateWorkload(int count) {
+	std::vector<BlockOp> ops;
+	u32 seed = 0x12345678;
+	auto rand = [&]() {
+		seed = seed * 1664525 + 1013904223;
+		return seed >> 8;
+	};
+
+	// The old map could only hold one block per exact range, so we avoid repeats.
+	std::set<std::pair<u32, u32>> used;
+	const u32 codeBase = 0x08804000;
+	const u32 codeSize = 0x00400000;
+	for (int i = 0; i < count; ++i) {
+		u32 r = rand() % 100;
+		u32 start = codeBase + ((rand() % codeSize) & ~3);
+		if (r < 60) {
+			// Blocks are mostly short.
+			u32 size = 4 * (1 + rand() % 32);
+			if (used.insert(std::make_pair(start, start + size)).second)
+				ops.push_back(BlockOp{ false, start, start + size });
+		} else if (r < 99) {
+			// Self-modifying code, a word or two.
+			ops.push_back(BlockOp{ true, start, start + 4 * (1 + rand() % 2) });
+		} else {
+			// Overlay load.
+			ops.push_back(BlockOp{ true, start, start + 0x8000 + (rand() % 0x20000) });
+		}
+	}
+	return ops;
+}
+
+static bool TestRangeMapSemantics() {
+	JitBlockRangeMap map;
+	map.Add(0, 0x08804000, 0x08804010);
+	// Crosses a page.
+	map.Add(1, 0x08804FF0, 0x08805010);
+	map.Add(2, 0x08806000, 0x08806000);
+	map.Add(3, 0x08810000, 0x08818000);
+
+	std::vector<int> results;
+	map.FindOverlapping(0x08804000, 0x08804004, results);
+	EXPECT_EQ_INT(results.size(), 1);
+	EXPECT_EQ_INT(results[0], 0);
+
+	// Block 1 touches two pages, but should only be reported once.
+	results.clear();
+	map.FindOverlapping(0x08804000, 0x08806000, results);
+	std::sort(results.begin(), results.end());
+	EXPECT_EQ_INT(results.size(), 2);
+	EXPECT_EQ_INT(results[0], 0);
+	EXPECT_EQ_INT(results[1], 1);
+
+	// End is exclusive.
+	results.clear();
+	map.FindOverlapping(0x08804010, 0x08804FF0, results);
+	EXPECT_EQ_INT(results.size(), 0);
+
+	// In the middle of a large block.
+	results.clear();
+	map.FindOverlapping(0x08814000, 0x08814004, results);
+	EXPECT_EQ_INT(results.size(), 1);
+	EXPECT_EQ_INT(results[0], 3);
+
+	EXPECT_TRUE(map.Remove(1));
+	EXPECT_FALSE(map.Remove(1));
+	results.clear();
+	map.FindOverlapping(0x08805000, 0x08805004, results);
+	EXPECT_EQ_INT(results.size(), 0);
+
+	// Re-adding moves the block.
+	map.Add(0, 0x08820000, 0x08820008);
+	results.clear();
+	map.FindOverlapping(0x08804000, 0x08805000, results);
+	EXPECT_EQ_INT(results.size(), 0);
+	EXPECT_TRUE(map.GetPage(0x08820004) != nullptr);
+
+	map.Clear();
+	EXPECT_TRUE(map.GetPage(0x08820004) == nullptr);
+	EXPECT_FALSE(map.Remove(3));
+	return true;
+}
+
+static bool TestRangeMapWorkload() {
+	const std::vector<BlockOp> ops = GenerateWorkload(400000);
+
+	int numBlocks = 0;
+	std::vector<int> oldResults, newResults, invalidated;
+
+	OldBlockMap oldMap;
+	double oldStart = time_now_d();
+	for (const BlockOp &op : ops) {
+		if (op.invalidate) {
+			oldMap.Invalidate(op.start, op.end, oldResults);
+		} else {
+			oldMap.Add(numBlocks++, op.start, op.end);
+		}
+	}
+	double oldTime = time_now_d() - oldStart;
+
+	JitBlockRangeMap newMap;
+	int nextBlock = 0;
+	double newStart = time_now_d();
+	for (const BlockOp &op : ops) {
+		if (op.invalidate) {
+			invalidated.clear();
+			newMap.FindOverlapping(op.start, op.end, invalidated);
+			for (int block_num : invalidated)
+				newMap.Remove(block_num);
+			newResults.insert(newResults.end(), invalidated.begin(), invalidated.end());
+		} else {
+			newMap.Add(nextBlock++, op.start, op.end);
+		}
+	}
+	double newTime = time_now_d() - newStart;
+
+	printf("Invalidation workload (%d ops): std::map %0.2f ms, page map %0.2f ms\n", (int)ops.size(), oldTime * 1000.0, newTime * 1000.0);
+
+	// The old search only looked 0x4000 past the end, so it can miss large blocks.  None are that big here.
+	std::sort(oldResults.begin(), oldResults.end());
+	std::sort(newResults.begin(), newResults.end());
+	EXPECT_EQ_INT(oldResults.size(), newResults.size());
+	EXPECT_TRUE(oldResults == newResults);
+	return true;
+}
+
+bool TestJitBlockCache() {
+	if (!TestRangeMapSemantics())
+		return false;
+	if (!TestRangeMapWorkload())
+		return false;
+	return true;
+}
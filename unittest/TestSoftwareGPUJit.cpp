@@ -15,11 +15,16 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include "ppsspp_config.h"
+#include "Common/CPUDetect.h"
 #include "Common/Data/Random/Rng.h"
 #include "Common/StringUtils.h"
+#include "Common/Thread/ThreadManager.h"
+#include "Common/TimeUtil.h"
 #include "Core/Config.h"
 #include "GPU/Software/BinManager.h"
 #include "GPU/Software/DrawPixel.h"
+#include "GPU/Software/Rasterizer.h"
 #include "GPU/Software/Sampler.h"
 #include "GPU/Software/SoftGpu.h"
 
@@ -110,6 +115,107 @@ static bool TestSamplerJit() {
 	return successes == count && !HitAnyAsserts();
 }
 
+static bool TestSamplerBlendPair() {
+#if PPSSPP_ARCH(AMD64)
+	using namespace Sampler;
+	// This compares the AVX2 mip blending against SSE, so there's nothing to test without it.
+	if (!cpu_info.bAVX2)
+		return true;
+
+	SamplerJitCache *sseCache = new SamplerJitCache();
+	SamplerJitCache *avxCache = new SamplerJitCache();
+	BinManager binner;
+	// The last used func is remembered across caches by generation, so keep them apart.
+	avxCache->Clear();
+
+	GMRng rng;
+	int tested = 0;
+	int mismatches = 0;
+	const int count = 500;
+
+	u8 **tptr = new u8 *[8];
+	uint16_t *bufw = new uint16_t[8];
+	u8 *clut = new u8[1024];
+	for (int i = 0; i < 1024; ++i)
+		clut[i] = (u8)rng.R32();
+
+	for (int i = 0; i < 8; ++i) {
+		tptr[i] = new u8[64 * 64 * 4 + 64];
+		for (int j = 0; j < 64 * 64 * 4 + 64; ++j)
+			tptr[i][j] = (u8)rng.R32();
+		bufw[i] = 64;
+	}
+
+	for (int i = 0; i < count; ) {
+		SamplerID id;
+		memset(&id, 0, sizeof(id));
+		id.fullKey = rng.R32();
+		id.linear = true;
+		id.fetch = false;
+		id.hasAnyMips = true;
+		id.hasInvalidPtr = false;
+		id.useStandardBufw = false;
+		id.cached.clut = clut;
+		id.cached.texBlendColor = rng.R32();
+		for (int j = 0; j < 8; ++j) {
+			id.cached.sizes[j].w = 64;
+			id.cached.sizes[j].h = 64;
+		}
+
+		std::string desc = DescribeSamplerID(id);
+		if (startsWith(desc, "INVALID"))
+			continue;
+		i++;
+
+		// We clear each time to compile fresh, and so we never fill up and clear mid-test.
+		sseCache->Clear();
+		avxCache->Clear();
+		cpu_info.bAVX2 = false;
+		LinearFunc sseFunc = sseCache->GetLinear(id, &binner);
+		cpu_info.bAVX2 = true;
+		LinearFunc avxFunc = avxCache->GetLinear(id, &binner);
+		if (!sseFunc || !avxFunc)
+			continue;
+
+		tested++;
+		for (int j = 0; j < 64; ++j) {
+			float s = rng.F();
+			float t = rng.F();
+			const auto primArg = Rasterizer::ToVec4IntArg(Math3D::Vec4<int>(rng.R32() & 0xFF, rng.R32() & 0xFF, rng.R32() & 0xFF, rng.R32() & 0xFF));
+			int level = rng.R32() % 7;
+			// Include zero, which skips the second level.
+			int levelFrac = rng.R32() % 17;
+
+			Rasterizer::Vec4IntResult sseResult = sseFunc(s, t, primArg, tptr, bufw, level, levelFrac, id);
+			Rasterizer::Vec4IntResult avxResult = avxFunc(s, t, primArg, tptr, bufw, level, levelFrac, id);
+			if (memcmp(&sseResult, &avxResult, sizeof(sseResult)) != 0) {
+				if (mismatches == 0)
+					printf("Sampler AVX2 mismatches:\n");
+				mismatches++;
+				printf(" * %s (level %d, frac %d)\n", desc.c_str(), level, levelFrac);
+				break;
+			}
+		}
+	}
+
+	if (mismatches != 0)
+		printf("Sampler AVX2 mismatches: %d / %d\n", mismatches, tested);
+
+	for (int i = 0; i < 8; ++i) {
+		delete [] tptr[i];
+	}
+	delete [] tptr;
+	delete [] bufw;
+	delete [] clut;
+
+	delete sseCache;
+	delete avxCache;
+	return mismatches == 0 && !HitAnyAsserts();
+#else
+	return true;
+#endif
+}
+
 static bool TestPixelJit() {
 	using namespace Rasterizer;
 	PixelJitCache *cache = new PixelJitCache();
@@ -161,6 +267,188 @@ static bool TestPixelJit() {
 	return successes == count && !HitAnyAsserts();
 }
 
+static bool TestPixelQuad() {
+	using namespace Rasterizer;
+	PixelJitCache *cache = new PixelJitCache();
+
+	GMRng rng;
+	int tested = 0;
+	int mismatches = 0;
+	const int count = 3000;
+
+	// Rows 0 and 1, with a stride of 512.
+	const int size = 512 * 2;
+	u32 *fb_single = new u32[size];
+	u32 *fb_quad = new u32[size];
+	u16 *zb_single = new u16[size];
+	u16 *zb_quad = new u16[size];
+
+	for (int i = 0; i < count; ) {
+		PixelFuncID id;
+		memset(&id, 0, sizeof(id));
+		id.fullKey = (uint64_t)rng.R32() | ((uint64_t)rng.R32() << 32);
+		id.clearMode = false;
+		id.stencilTest = false;
+		id.colorTest = false;
+		id.applyLogicOp = false;
+
+		std::string desc = DescribePixelFuncID(id);
+		if (startsWith(desc, "INVALID"))
+			continue;
+		i++;
+
+		QuadFunc quadFunc = GetQuadFunc(id);
+		if (!quadFunc)
+			continue;
+		SingleFunc singleFunc = cache->GenericSingle(id);
+
+		id.cached.framebufStride = 512;
+		id.cached.depthbufStride = 512;
+		id.cached.minz = rng.R32() & 0x7FFF;
+		id.cached.maxz = id.cached.minz + (rng.R32() & 0x7FFF);
+		id.cached.fogColor = rng.R32() & 0x00FFFFFF;
+		id.cached.alphaTestMask = rng.R32() & 0xFF;
+		id.cached.alphaBlendSrc = rng.R32() & 0x00FFFFFF;
+		id.cached.alphaBlendDst = rng.R32() & 0x00FFFFFF;
+		id.cached.colorWriteMask = id.applyColorWriteMask ? rng.R32() : 0;
+		if (id.FBFormat() != GE_FORMAT_8888)
+			id.cached.colorWriteMask &= 0xFFFF;
+		for (int j = 0; j < 16; ++j)
+			id.cached.ditherMatrix[j] = (int8_t)((rng.R32() % 8) - 4);
+
+		for (int j = 0; j < size; ++j) {
+			fb_single[j] = fb_quad[j] = rng.R32();
+			zb_single[j] = zb_quad[j] = (u16)rng.R32();
+		}
+
+		const int x = (rng.R32() % 256) * 2;
+		Math3D::Vec4<int> z, fog, mask;
+		Math3D::Vec4<int> colors[4];
+		for (int j = 0; j < 4; ++j) {
+			z[j] = rng.R32() & 0xFFFF;
+			fog[j] = rng.R32() & 0xFF;
+			mask[j] = (rng.R32() & 3) == 0 ? -1 : 0;
+			// Out of range values should be clamped the same way.
+			for (int c = 0; c < 4; ++c)
+				colors[j][c] = (int)(rng.R32() % 320) - 32;
+		}
+
+		fb.as32 = fb_single;
+		depthbuf.as16 = zb_single;
+		for (int j = 0; j < 4; ++j) {
+			if (mask[j] >= 0)
+				singleFunc(x + (j & 1), j / 2, z[j], fog[j], ToVec4IntArg(colors[j]), id);
+		}
+
+		fb.as32 = fb_quad;
+		depthbuf.as16 = zb_quad;
+		quadFunc(x, 0, z, fog, colors, mask, id);
+
+		tested++;
+		if (memcmp(fb_single, fb_quad, sizeof(u32) * size) != 0 || memcmp(zb_single, zb_quad, sizeof(u16) * size) != 0) {
+			if (mismatches == 0)
+				printf("Quad pixel mismatches:\n");
+			mismatches++;
+			printf(" * %s\n", desc.c_str());
+		}
+	}
+
+	if (mismatches != 0)
+		printf("PixelQuad mismatches: %d / %d\n", mismatches, tested);
+
+	delete [] fb_single;
+	delete [] fb_quad;
+	delete [] zb_single;
+	delete [] zb_quad;
+	delete cache;
+	return mismatches == 0 && !HitAnyAsserts();
+}
+
+static bool TestPixelJitBackground() {
+#if PPSSPP_ARCH(AMD64) && !PPSSPP_PLATFORM(UWP)
+	using namespace Rasterizer;
+	// Funcs only compile on a worker when there's a thread manager.
+	const bool ownThreadManager = !g_threadManager.IsInitialized();
+	if (ownThreadManager)
+		g_threadManager.Init(cpu_info.num_cores, cpu_info.logical_cpu_count);
+	Init();
+
+	GMRng rng;
+	auto randomID = [&] {
+		PixelFuncID id;
+		do {
+			memset(&id, 0, sizeof(id));
+			id.fullKey = (uint64_t)rng.R32() | ((uint64_t)rng.R32() << 32);
+		} while (startsWith(DescribePixelFuncID(id), "INVALID"));
+		return id;
+	};
+	auto isJitted = [](SingleFunc func) {
+		std::string name;
+		return DescribeCodePtr((const u8 *)func, name);
+	};
+
+	bool success = true;
+	RasterizerState state{};
+	state.pixelID = randomID();
+
+	// The first lookup queues it and falls back to the generic func.
+	int compileCount = JitCompileCount();
+	RefreshRasterizerFuncs(&state);
+	if (isJitted(state.drawPixel)) {
+		printf("Pixel func was compiled before the worker ran\n");
+		success = false;
+	}
+	for (int i = 0; i < 5000 && JitCompileCount() == compileCount; ++i)
+		sleep_ms(1);
+	RefreshRasterizerFuncs(&state);
+	if (!isJitted(state.drawPixel)) {
+		printf("Pixel func never compiled on the worker\n");
+		success = false;
+	}
+
+	// Now fill the space, so the worker has to stop and ask for a clear.
+	std::vector<PixelFuncID> ids;
+	for (int i = 0; i < 3000; ++i)
+		ids.push_back(randomID());
+	PrecompileJit(ids);
+	bool cleared = false;
+	for (int i = 0; i < 5000 && !cleared; ++i) {
+		cleared = FlushJit();
+		if (!cleared)
+			sleep_ms(1);
+	}
+	if (!cleared) {
+		printf("Pixel jit space never cleared\n");
+		success = false;
+	}
+
+	// This is what the binner does with the state it keeps, which now points at cleared code.
+	RefreshRasterizerFuncs(&state);
+	if (cleared && isJitted(state.drawPixel)) {
+		printf("Pixel func still points into the cleared space\n");
+		success = false;
+	}
+	// Make sure the generic func runs fine.
+	u32 *fb_data = new u32[512 * 2];
+	u16 *zb_data = new u16[512 * 2];
+	fb.as32 = fb_data;
+	depthbuf.as16 = zb_data;
+	memset(fb_data, 0, sizeof(u32) * 512 * 2);
+	memset(zb_data, 0, sizeof(u16) * 512 * 2);
+	state.drawPixel(0, 0, 1000, 255, ToVec4IntArg(Math3D::Vec4<int>(127, 127, 127, 127)), state.pixelID);
+	delete [] fb_data;
+	delete [] zb_data;
+
+	// Waits for the worker.
+	Shutdown();
+	if (ownThreadManager)
+		g_threadManager.Teardown();
+	return success && !HitAnyAsserts();
+#else
+	return true;
+#endif
+}
+
 bool TestSoftwareGPUJit() {
 	g_Config.bSoftwareRenderingJit = true;
 	ResetHitAnyAsserts();
@@ -169,9 +457,21 @@ bool TestSoftwareGPUJit() {
 		return false;
 	}
 
+	if (!TestSamplerBlendPair()) {
+		return false;
+	}
+
 	if (!TestPixelJit()) {
 		return false;
 	}
 
+	if (!TestPixelQuad()) {
+		return false;
+	}
+
+	if (!TestPixelJitBackground()) {
+		return false;
+	}
+
 	return true;
 }
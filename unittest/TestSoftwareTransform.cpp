@@ -0,0 +1,165 @@
+// Copyright (c) 2022- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "Common/Data/Random/Rng.h"
+#include "Common/TimeUtil.h"
+#include "GPU/Common/VertexDecoderCommon.h"
+#include "GPU/GPUState.h"
+#include "GPU/ge_constants.h"
+#include "GPU/Software/TransformUnit.h"
+
+#include "UnitTest.h"
+
+static u32 ToFloat24(float f) {
+	u32 bits;
+	memcpy(&bits, &f, sizeof(bits));
+	return bits >> 8;
+}
+
+static void SetupTransformState(bool pointLight) {
+	static const float world[12] = {
+		0.9f, 0.1f, 0.0f,
+		-0.1f, 0.9f, 0.05f,
+		0.0f, -0.05f, 1.0f,
+		0.5f, -0.25f, 0.1f,
+	};
+	static const float view[12] = {
+		1.0f, 0.0f, 0.0f,
+		0.0f, 1.0f, 0.0f,
+		0.0f, 0.0f, 1.0f,
+		0.0f, 0.0f, -4.0f,
+	};
+	// A typical perspective projection.
+	static const float proj[16] = {
+		1.5f, 0.0f, 0.0f, 0.0f,
+		0.0f, 2.6f, 0.0f, 0.0f,
+		0.0f, 0.0f, -1.002f, -1.0f,
+		0.0f, 0.0f, -0.2f, 0.0f,
+	};
+	memcpy(gstate.worldMatrix, world, sizeof(world));
+	memcpy(gstate.viewMatrix, view, sizeof(view));
+	memcpy(gstate.projMatrix, proj, sizeof(proj));
+
+	// Bones are near identity, so skinned positions stay on screen.
+	GMRng rng;
+	for (int i = 0; i < 8; ++i) {
+		float *bone = gstate.boneMatrix + i * 12;
+		for (int j = 0; j < 12; ++j)
+			bone[j] = (j % 4 == 0 ? 1.0f : 0.0f) + (rng.F() - 0.5f) * 0.1f;
+	}
+
+	gstate.viewportxscale = (GE_CMD_VIEWPORTXSCALE << 24) | ToFloat24(240.0f);
+	gstate.viewportyscale = (GE_CMD_VIEWPORTYSCALE << 24) | ToFloat24(-136.0f);
+	gstate.viewportzscale = (GE_CMD_VIEWPORTZSCALE << 24) | ToFloat24(-32767.5f);
+	gstate.viewportxcenter = (GE_CMD_VIEWPORTXCENTER << 24) | ToFloat24(2048.0f);
+	gstate.viewportycenter = (GE_CMD_VIEWPORTYCENTER << 24) | ToFloat24(2048.0f);
+	gstate.viewportzcenter = (GE_CMD_VIEWPORTZCENTER << 24) | ToFloat24(32767.5f);
+	gstate.offsetx = (GE_CMD_OFFSETX << 24) | (1808 << 4);
+	gstate.offsety = (GE_CMD_OFFSETY << 24) | (1912 << 4);
+
+	gstate.fogEnable = (GE_CMD_FOGENABLE << 24) | 1;
+	gstate.fog1 = (GE_CMD_FOG1 << 24) | ToFloat24(5.0f);
+	gstate.fog2 = (GE_CMD_FOG2 << 24) | ToFloat24(0.25f);
+
+	gstate.lightingEnable = (GE_CMD_LIGHTINGENABLE << 24) | 1;
+	gstate.lightEnable[0] = (GE_CMD_LIGHTENABLE0 << 24) | 1;
+	// Point lights need world positions, which uses a different matrix path.
+	gstate.ltype[0] = (GE_CMD_LIGHTTYPE0 << 24) | ((pointLight ? GE_LIGHTTYPE_POINT : GE_LIGHTTYPE_DIRECTIONAL) << 8) | GE_LIGHTCOMP_BOTH;
+	gstate.lpos[0] = (GE_CMD_LX0 << 24) | ToFloat24(0.5f);
+	gstate.lpos[1] = (GE_CMD_LY0 << 24) | ToFloat24(1.0f);
+	gstate.lpos[2] = (GE_CMD_LZ0 << 24) | ToFloat24(-0.5f);
+	gstate.latt[0] = (GE_CMD_LKA0 << 24) | ToFloat24(1.0f);
+	gstate.lcolor[0] = (GE_CMD_LAC0 << 24) | 0x202020;
+	gstate.lcolor[1] = (GE_CMD_LDC0 << 24) | 0xC0C0C0;
+	gstate.lcolor[2] = (GE_CMD_LSC0 << 24) | 0x808080;
+	gstate.materialspecularcoef = (GE_CMD_MATERIALSPECULARCOEF << 24) | ToFloat24(4.0f);
+	gstate.materialupdate = (GE_CMD_MATERIALUPDATE << 24) | 7;
+}
+
+static bool SameVertex(const ClipVertexData &a, const ClipVertexData &b) {
+	if (a.v.screenpos.x != b.v.screenpos.x)
+		return false;
+	// Nothing else is set when outside the range.
+	if (a.OutsideRange())
+		return true;
+	return a.v.screenpos.y == b.v.screenpos.y && a.v.screenpos.z == b.v.screenpos.z &&
+		a.clippos == b.clippos && a.v.clipw == b.v.clipw && a.v.fogdepth == b.v.fogdepth &&
+		a.v.color0 == b.v.color0 && a.v.color1 == b.v.color1 &&
+		a.v.texturecoords.x == b.v.texturecoords.x && a.v.texturecoords.y == b.v.texturecoords.y && a.v.texturecoords.z == b.v.texturecoords.z;
+}
+
+static bool TestSkinnedMesh(bool pointLight) {
+	// A large skinned mesh: 4 weights, texcoords, normals, all float.
+	const u32 vtype = GE_VTYPE_WEIGHT_FLOAT | (3 << GE_VTYPE_WEIGHTCOUNT_SHIFT) | GE_VTYPE_TC_FLOAT | GE_VTYPE_NRM_FLOAT | GE_VTYPE_POS_FLOAT;
+	const int count = 60000;
+
+	VertexDecoderOptions options{};
+	options.applySkinInDecode = true;
+	VertexDecoder dec;
+	dec.SetVertexType(vtype, options);
+
+	// Every component is a float, so any float in range is a valid vertex.
+	GMRng rng;
+	std::vector<float> src(count * dec.VertexSize() / sizeof(float));
+	for (float &f : src)
+		f = rng.F() * 2.0f - 1.0f;
+
+	gstate_c.uv.uScale = 1.0f;
+	gstate_c.uv.vScale = 1.0f;
+	SetupTransformState(pointLight);
+
+	std::vector<u8> decoded(count * dec.GetDecVtxFmt().stride);
+	dec.DecodeVerts(decoded.data(), src.data(), 0, count - 1);
+	VertexReader vreader(decoded.data(), dec.GetDecVtxFmt(), vtype);
+
+	TransformUnit *transformUnit = new TransformUnit();
+	transformUnit->SetDirty(SoftDirty(-1));
+
+	std::vector<ClipVertexData> single(count), batched(count);
+	double st = time_now_d();
+	for (int i = 0; i < count; ++i)
+		transformUnit->ReadVertices(vreader, i, 1, &single[i]);
+	double singleTime = time_now_d() - st;
+
+	st = time_now_d();
+	transformUnit->ReadVertices(vreader, 0, count, batched.data());
+	double batchedTime = time_now_d() - st;
+
+	printf("Skinned mesh (%d verts, %s light): one at a time %0.2f ms, batched %0.2f ms\n", count, pointLight ? "point" : "directional", singleTime * 1000.0, batchedTime * 1000.0);
+
+	int mismatches = 0;
+	for (int i = 0; i < count; ++i) {
+		if (!SameVertex(single[i], batched[i]))
+			mismatches++;
+	}
+	delete transformUnit;
+
+	EXPECT_EQ_INT(mismatches, 0);
+	return true;
+}
+
+bool TestSoftwareTransform() {
+	if (!TestSkinnedMesh(false))
+		return false;
+	if (!TestSkinnedMesh(true))
+		return false;
+	return true;
+}
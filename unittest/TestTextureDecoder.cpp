@@ -0,0 +1,161 @@
+// Copyright (c) 2022- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "Common/Data/Random/Rng.h"
+#include "Common/TimeUtil.h"
+#include "GPU/Common/TextureDecoder.h"
+#include "GPU/GPUState.h"
+#include "GPU/ge_constants.h"
+
+#include "UnitTest.h"
+
+// Like a 512x512 texture.
+static const int TEX_SIZE = 512;
+static const int BENCH_LOOPS = 20;
+
+template <typename DXTBlock>
+static void FillRandom(std::vector<u8> &data) {
+	GMRng rng;
+	for (u8 &b : data)
+		b = (u8)rng.R32();
+
+	// Make about half the blocks use the 3 color (1-bit alpha) mode.
+	for (size_t i = 0; i + 2 * sizeof(DXTBlock) <= data.size(); i += 2 * sizeof(DXTBlock)) {
+		DXT1Block *block = (DXT1Block *)&data[i];
+		u16 c1 = block->color1;
+		u16 c2 = block->color2;
+		if (c1 > c2) {
+			block->color1 = c2;
+			block->color2 = c1;
+		}
+	}
+}
+
+template <typename DXTBlock, int n>
+static bool TestDXT() {
+	const int blocksPerRow = TEX_SIZE / 4;
+	std::vector<u8> src(blocksPerRow * blocksPerRow * sizeof(DXTBlock));
+	FillRandom<DXTBlock>(src);
+	const DXTBlock *blocks = (const DXTBlock *)src.data();
+
+	std::vector<u32> single(TEX_SIZE * TEX_SIZE), rows(TEX_SIZE * TEX_SIZE);
+	u32 singleAlpha = 1, rowsAlpha = 1;
+
+	double st = time_now_d();
+	for (int loop = 0; loop < BENCH_LOOPS; ++loop) {
+		for (int y = 0; y < blocksPerRow; ++y) {
+			for (int x = 0; x < blocksPerRow; ++x) {
+				u32 *dst = single.data() + y * 4 * TEX_SIZE + x * 4;
+				const DXTBlock *block = blocks + y * blocksPerRow + x;
+				switch (n) {
+				case 1: DecodeDXT1Block(dst, (const DXT1Block *)block, TEX_SIZE, 4, 4, &singleAlpha); break;
+				case 3: DecodeDXT3Block(dst, (const DXT3Block *)block, TEX_SIZE, 4, 4); break;
+				case 5: DecodeDXT5Block(dst, (const DXT5Block *)block, TEX_SIZE, 4, 4); break;
+				}
+			}
+		}
+	}
+	double singleTime = time_now_d() - st;
+
+	st = time_now_d();
+	for (int loop = 0; loop < BENCH_LOOPS; ++loop) {
+		for (int y = 0; y < blocksPerRow; ++y) {
+			u32 *dst = rows.data() + y * 4 * TEX_SIZE;
+			const DXTBlock *row = blocks + y * blocksPerRow;
+			switch (n) {
+			case 1: DecodeDXT1Blocks(dst, (const DXT1Block *)row, TEX_SIZE, blocksPerRow, &rowsAlpha); break;
+			case 3: DecodeDXT3Blocks(dst, (const DXT3Block *)row, TEX_SIZE, blocksPerRow); break;
+			case 5: DecodeDXT5Blocks(dst, (const DXT5Block *)row, TEX_SIZE, blocksPerRow); break;
+			}
+		}
+	}
+	double rowsTime = time_now_d() - st;
+
+	printf("DXT%d %dx%d: one block at a time %0.2f ms, rows %0.2f ms\n", n, TEX_SIZE, TEX_SIZE, singleTime * 1000.0 / BENCH_LOOPS, rowsTime * 1000.0 / BENCH_LOOPS);
+
+	EXPECT_EQ_INT(memcmp(single.data(), rows.data(), single.size() * sizeof(u32)), 0);
+	EXPECT_EQ_INT(singleAlpha, rowsAlpha);
+
+	// A block that's partially off the edge of the row still goes one at a time.
+	const int oddCount = 7;
+	std::fill(rows.begin(), rows.end(), 0);
+	std::fill(single.begin(), single.end(), 0);
+	for (int x = 0; x < oddCount; ++x) {
+		switch (n) {
+		case 1: DecodeDXT1Block(single.data() + x * 4, (const DXT1Block *)(blocks + x), TEX_SIZE, 4, 4, &singleAlpha); break;
+		case 3: DecodeDXT3Block(single.data() + x * 4, (const DXT3Block *)(blocks + x), TEX_SIZE, 4, 4); break;
+		case 5: DecodeDXT5Block(single.data() + x * 4, (const DXT5Block *)(blocks + x), TEX_SIZE, 4, 4); break;
+		}
+	}
+	switch (n) {
+	case 1: DecodeDXT1Blocks(rows.data(), (const DXT1Block *)blocks, TEX_SIZE, oddCount, &rowsAlpha); break;
+	case 3: DecodeDXT3Blocks(rows.data(), (const DXT3Block *)blocks, TEX_SIZE, oddCount); break;
+	case 5: DecodeDXT5Blocks(rows.data(), (const DXT5Block *)blocks, TEX_SIZE, oddCount); break;
+	}
+	EXPECT_EQ_INT(memcmp(single.data(), rows.data(), 4 * TEX_SIZE * sizeof(u32)), 0);
+	return true;
+}
+
+static bool TestDeIndex() {
+	u32 clut[256];
+	GMRng rng;
+	for (u32 &c : clut)
+		c = rng.R32() | 0xFF000000;
+
+	std::vector<u8> indexed(TEX_SIZE * TEX_SIZE);
+	for (u8 &b : indexed)
+		b = (u8)rng.R32();
+	std::vector<u32> out(TEX_SIZE * TEX_SIZE);
+
+	// No mask, shift, or offset, which is the usual case.
+	gstate.clutformat = (GE_CMD_CLUTFORMAT << 24) | 0xFF00 | GE_CMODE_32BIT_ABGR8888;
+	u32 alphaSum = 0xFFFFFFFF;
+	double st = time_now_d();
+	for (int loop = 0; loop < BENCH_LOOPS; ++loop) {
+		for (int y = 0; y < TEX_SIZE; ++y)
+			DeIndexTexture4(out.data() + y * TEX_SIZE, indexed.data() + y * TEX_SIZE / 2, TEX_SIZE, clut, &alphaSum);
+	}
+	double clut4Time = time_now_d() - st;
+	EXPECT_EQ_HEX(out[1], clut[indexed[0] >> 4]);
+
+	st = time_now_d();
+	for (int loop = 0; loop < BENCH_LOOPS; ++loop) {
+		for (int y = 0; y < TEX_SIZE; ++y)
+			DeIndexTexture(out.data() + y * TEX_SIZE, indexed.data() + y * TEX_SIZE, TEX_SIZE, clut, &alphaSum);
+	}
+	double clut8Time = time_now_d() - st;
+	EXPECT_EQ_HEX(out[TEX_SIZE - 1], clut[indexed[TEX_SIZE - 1]]);
+	EXPECT_EQ_HEX(alphaSum & 0xFF000000, 0xFF000000);
+
+	printf("CLUT4 %dx%d: %0.2f ms, CLUT8: %0.2f ms\n", TEX_SIZE, TEX_SIZE, clut4Time * 1000.0 / BENCH_LOOPS, clut8Time * 1000.0 / BENCH_LOOPS);
+	return true;
+}
+
+bool TestTextureDecoder() {
+	if (!TestDXT<DXT1Block, 1>())
+		return false;
+	if (!TestDXT<DXT3Block, 3>())
+		return false;
+	if (!TestDXT<DXT5Block, 5>())
+		return false;
+	return TestDeIndex();
+}
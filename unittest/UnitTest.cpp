@@ -806,7 +806,10 @@ bool TestX64Emitter();
 bool TestRiscVEmitter();
 bool TestShaderGenerators();
 bool TestSoftwareGPUJit();
+bool TestSoftwareTransform();
+bool TestTextureDecoder();
 bool TestIRPassSimplify();
+bool TestJitBlockCache();
 bool TestThreadManager();
 
 TestItem availableTests[] = {
@@ -829,7 +832,11 @@ TestItem availableTests[] = {
 	TEST_ITEM(MathUtil),
 	TEST_ITEM(Parsers),
 	TEST_ITEM(IRPassSimplify),
+	TEST_ITEM(JitBlockCache),
 	TEST_ITEM(Jit),
+	TEST_ITEM(IRMemoryAccess),
+	TEST_ITEM(IRNativeFPU),
+	TEST_ITEM(IRExitToZero),
 	TEST_ITEM(MatrixTranspose),
 	TEST_ITEM(ParseLBN),
 	TEST_ITEM(QuickTexHash),
@@ -837,6 +844,8 @@ TestItem availableTests[] = {
 	TEST_ITEM(MemMap),
 	TEST_ITEM(ShaderGenerators),
 	TEST_ITEM(SoftwareGPUJit),
+	TEST_ITEM(SoftwareTransform),
+	TEST_ITEM(TextureDecoder),
 	TEST_ITEM(Path),
 	TEST_ITEM(AndroidContentURI),
 	TEST_ITEM(ThreadManager),